@@ -0,0 +1,638 @@
+/**
+ *
+ *  Low-latency C++ Utilities - Benchmarks
+ *
+ *  @file bench_sockets.cpp
+ *  @brief Microbenchmarks of the llbase socket layer, over loopback or a veth pair
+ *  @author Stacy Gaudreau
+ *  @date 2025.02.18
+ *
+ *  Measures, for each socket mode (default, batched, busy_poll, io_uring, packet_ring, xdp):
+ *   - tcp_rtt: round trip latency of a message echoed by a TCPServer to a TCPSocket
+ *   - mcast_one_way: latency of a paced message from one McastSocket to another
+ *   - mcast_max_rate: the highest send rate received with no more than MAX_LOSS lost
+ *  along with the syscalls made per message, where the kernel can count them. Batching, and
+ *  receiving from a packet ring or AF_XDP socket, only apply to multicast, so TCP isn't run in
+ *  those modes. A mode whose ring can't be set up here (eg: without CAP_NET_RAW) is reported as
+ *  skipped. Results are written as JSON, so that runs in different modes (or on different
+ *  hosts) can be compared side by side.
+ *
+ *  usage: bench_sockets [--n <messages>] [--size <bytes>] [--modes <m1,m2,...>]
+ *                       [--ip <address>] [--iface <name>] [--iface-tx <name>]
+ *                       [--group <address>] [--port <port>] [--cores <rx>,<tx>]
+ *                       [--out <file.json>]
+ *
+ *  The multicast benchmarks send out of iface-tx and receive on iface, so with the two ends of
+ *  a veth pair they cross a real (virtual) device rather than looping back in the stack:
+ *      ip link add llbench0 type veth peer name llbench1
+ *      ip addr add 10.78.0.1/24 dev llbench0 && ip addr add 10.78.0.2/24 dev llbench1
+ *      ip link set llbench0 up && ip link set llbench1 up
+ *      bench_sockets --iface llbench1 --iface-tx llbench0 --ip 10.78.0.2
+ *  TCP between two addresses of the same host always takes the loopback path. The packet_ring
+ *  and xdp modes only see datagrams which arrive on a device, so they need such a pair: the
+ *  copies the stack loops back to itself never reach them.
+ *
+ */
+
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "llbase/logging.h"
+#include "llbase/threading.h"
+#include "llbase/timekeeping.h"
+#include "llbase/io_ring.h"
+#include "llbase/tcp_socket.h"
+#include "llbase/tcp_server.h"
+#include "llbase/mcast_socket.h"
+#include "llbase/packet_ring.h"
+#include "llbase/xdp_socket.h"
+
+
+using namespace LL;
+
+
+namespace
+{
+constexpr Nanos T_TIMEOUT{ 1'000'000'000 };     // longest wait for any one message
+constexpr size_t N_WARMUP{ 1000 };              // messages sent before measuring starts
+constexpr Nanos T_PACING{ 20'000 };             // gap between one-way latency messages
+constexpr Nanos T_RATE_STEP{ 200'000'000 };     // time spent sending at each rate
+constexpr Nanos T_RATE_DRAIN{ 50'000'000 };     // time allowed for a step's last messages
+constexpr double MAX_LOSS{ 0.001 };             // most loss a sustainable rate may have
+constexpr double RATE_START{ 100'000 };         // messages/s the rate sweep starts from
+constexpr double RATE_MAX{ 50'000'000 };
+
+
+struct Options {
+    size_t n{ 100'000 };
+    size_t size{ 64 };
+    std::vector<std::string> modes{ "default", "batched", "busy_poll", "io_uring",
+                                    "packet_ring", "xdp" };
+    std::string ip{ "127.0.0.1" };
+    std::string iface{ "lo" };
+    std::string iface_tx{ };        // defaults to iface
+    std::string group{ "239.0.0.77" };
+    int port{ 12500 };
+    int core_rx{ -1 };
+    int core_tx{ -1 };
+    std::string out{ "bench_sockets.json" };
+};
+
+/**
+ * @brief The message every benchmark sends, padded out to the size asked for
+ */
+struct Header {
+    uint64_t n_seq;
+    Nanos t_tx;
+    uint32_t i_step;    // of the rate sweep
+};
+
+/**
+ * @brief How a mode configures the sockets under test
+ */
+struct Mode {
+    std::string name;
+    McastBatchConfig batching{ };
+    SocketTuning tuning{ };
+    bool is_io_ring{ false };
+    bool is_packet_ring{ false };   // multicast is received from a packet ring
+    bool is_xdp{ false };           // multicast is received through an AF_XDP socket
+
+    static auto from_str(const std::string& name) -> Mode {
+        Mode mode{ name };
+        if (name == "batched")
+            mode.batching = MCAST_BATCHED;
+        else if (name == "busy_poll")
+            mode.tuning = SocketTuning::from_str("busy_poll=50 prefer_busy_poll");
+        else if (name == "io_uring")
+            mode.is_io_ring = true;
+        else if (name == "packet_ring")
+            mode.is_packet_ring = true;
+        else if (name == "xdp")
+            mode.is_xdp = true;
+        else
+            VERIFY(name == "default", "<bench_sockets> unknown mode: " + name);
+        return mode;
+    }
+    /** @brief Only multicast is affected by the mode, so TCP would only repeat the default */
+    [[nodiscard]] auto is_mcast_only() const noexcept -> bool {
+        return batching.n_batch || is_packet_ring || is_xdp;
+    }
+};
+
+
+/**
+ * @brief Counts the syscalls made by the thread which creates it, and by the threads that
+ * thread starts afterwards (once they've exited), with a raw_syscalls:sys_enter perf counter
+ * @details Needs tracefs mounted and perf events allowed; otherwise read() returns -1.
+ */
+class SyscallCounter {
+public:
+    SyscallCounter() {
+        const auto id = get_tracepoint_id();
+        if (id < 0)
+            return;
+        perf_event_attr attr{ };
+        attr.type = PERF_TYPE_TRACEPOINT;
+        attr.size = sizeof(attr);
+        attr.config = static_cast<uint64_t>(id);
+        attr.inherit = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~SyscallCounter() {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    [[nodiscard]] auto read_count() const noexcept -> int64_t {
+        uint64_t n{ };
+        if (fd < 0 || ::read(fd, &n, sizeof(n)) != sizeof(n))
+            return -1;
+        return static_cast<int64_t>(n);
+    }
+
+private:
+    int fd{ -1 };
+
+    static auto get_tracepoint_id() -> int64_t {
+        for (const auto& path: { "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+                                 "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"
+                               }) {
+            std::ifstream file{ path };
+            int64_t id{ -1 };
+            if (file >> id)
+                return id;
+        }
+        return -1;
+    }
+
+public:
+    SyscallCounter(const SyscallCounter&) = delete;
+    SyscallCounter& operator=(const SyscallCounter&) = delete;
+};
+
+
+/**
+ * @brief One benchmark's result for one mode, as a JSON object of its fields
+ */
+class Result {
+public:
+    Result(const std::string& bench, const std::string& mode) {
+        add("bench", "\"" + bench + "\"");
+        add("mode", "\"" + mode + "\"");
+    }
+
+    template<typename T>
+    void add(const std::string& key, const T& value) {
+        std::stringstream ss;
+        ss << value;
+        fields.emplace_back(key, ss.str());
+    }
+    void add_latencies(std::vector<Nanos>& latencies) {
+        add("n_measured", latencies.size());
+        if (latencies.empty())
+            return;
+        std::sort(latencies.begin(), latencies.end());
+        const auto at = [&](double q) {
+            return latencies[std::min(latencies.size() - 1,
+                                      static_cast<size_t>(q * latencies.size()))];
+        };
+        Nanos sum{ };
+        for (auto t: latencies)
+            sum += t;
+        add("min_ns", latencies.front());
+        add("mean_ns", sum / static_cast<Nanos>(latencies.size()));
+        add("p50_ns", at(0.5));
+        add("p90_ns", at(0.9));
+        add("p99_ns", at(0.99));
+        add("p999_ns", at(0.999));
+        add("max_ns", latencies.back());
+    }
+    void add_syscalls(const SyscallCounter& counter, size_t n_msgs) {
+        const auto n = counter.read_count();
+        if (n < 0 || !n_msgs) {
+            add("syscalls_per_msg", "null");
+            return;
+        }
+        add("syscalls_per_msg", static_cast<double>(n) / static_cast<double>(n_msgs));
+    }
+    void add_error(const std::string& error) {
+        add("error", "\"" + error + "\"");
+    }
+    void add_skip(const std::string& reason) {
+        add("skipped", "\"" + reason + "\"");
+    }
+
+    [[nodiscard]] auto to_json() const -> std::string {
+        std::string json{ "    {" };
+        for (size_t i{ }; i < fields.size(); ++i) {
+            json += (i ? ", \"" : "\"") + fields[i].first + "\": " + fields[i].second;
+        }
+        return json + "}";
+    }
+
+private:
+    std::vector<std::pair<std::string, std::string>> fields;
+};
+
+
+auto load_message(auto& socket, std::vector<char>& msg, uint64_t n_seq, uint32_t i_step = 0) {
+    const Header header{ n_seq, get_time_nanos(), i_step };
+    memcpy(msg.data(), &header, sizeof(header));
+    socket.load_tx(msg.data(), msg.size());
+}
+
+auto read_header(const char* data) -> Header {
+    Header header{ };
+    memcpy(&header, data, sizeof(header));
+    return header;
+}
+
+
+/**
+ * @brief Round trips of a message echoed back by a TCPServer, one in flight at a time
+ */
+auto bench_tcp_rtt(const Options& opt, const Mode& mode, int port, Logger& logger) -> Result {
+    Result result{ "tcp_rtt", mode.name };
+    result.add("msg_size", opt.size);
+    std::unique_ptr<IORing> ring_server, ring_client;
+    if (mode.is_io_ring) {
+        ring_server = IORing::create(logger);
+        ring_client = IORing::create(logger);
+        if (!ring_server || !ring_client) {
+            result.add_skip("io_uring unavailable");
+            return result;
+        }
+    }
+    SyscallCounter syscalls;
+    std::atomic<bool> is_running{ true };
+    std::atomic<bool> is_listening{ false };
+    auto thread_server = create_and_start_thread(opt.core_rx, "BenchTCPServer", [&]() {
+        TCPServer server{ logger, 4, 1 << 20 };
+        server.get_socket().tuning = mode.tuning;
+        server.set_io_ring(ring_server.get());
+        server.listen(opt.iface, port);
+        is_listening = true;
+        const auto echo = [](TCPSocket* s, Nanos) {
+            s->load_tx(s->rx_buffer.data(), s->rx_buffer.size());
+            s->rx_buffer.consume(s->rx_buffer.size());
+        };
+        while (is_running) {
+            server.poll();
+            server.tx_and_rx(echo, []() { });
+        }
+    });
+    while (!is_listening)
+        std::this_thread::yield();
+    TCPSocket client{ logger, 1 << 20 };
+    client.tuning = mode.tuning;
+    if (client.connect(opt.ip, opt.iface, port, false) < 0) {
+        result.add_error(std::string("connect failed: ") + std::strerror(errno));
+        is_running = false;
+        thread_server->join();
+        return result;
+    }
+    if (ring_client && !client.attach(*ring_client))
+        result.add("is_io_ring_attached", "false");
+    std::vector<char> msg(opt.size);
+    std::vector<Nanos> latencies;
+    latencies.reserve(opt.n);
+    size_t n_rx{ };
+    const auto on_rx = [&](TCPSocket* s, Nanos) {
+        n_rx += s->rx_buffer.size();
+        s->rx_buffer.consume(s->rx_buffer.size());
+    };
+    bool is_timed_out{ false };
+    for (size_t i{ }; i < N_WARMUP + opt.n && !is_timed_out; ++i) {
+        load_message(client, msg, i);
+        const auto t_start = get_time_nanos();
+        while (n_rx < msg.size()) {
+            client.tx_and_rx(on_rx);
+            if (get_time_nanos() - t_start > T_TIMEOUT) {
+                is_timed_out = true;
+                break;
+            }
+        }
+        n_rx -= std::min(n_rx, msg.size());
+        if (i >= N_WARMUP && !is_timed_out)
+            latencies.push_back(get_time_nanos() - t_start);
+    }
+    is_running = false;
+    thread_server->join();
+    if (is_timed_out)
+        result.add_error("echo timed out");
+    result.add_latencies(latencies);
+    result.add_syscalls(syscalls, N_WARMUP + opt.n);
+    return result;
+}
+
+
+/**
+ * @brief The rings a mode's multicast sockets use, if any: an io_uring each way, or a packet
+ * ring or AF_XDP socket on the receiving interface
+ */
+struct McastRings {
+    std::unique_ptr<IORing> rx, tx;
+    std::unique_ptr<PacketRing> packet;
+    std::unique_ptr<XdpSocket> xdp;
+
+    /**
+     * @brief Set up the rings the mode needs
+     * @return What couldn't be set up, or an empty string when everything was
+     */
+    auto create(const Options& opt, const Mode& mode, Logger& logger) -> std::string {
+        if (mode.is_io_ring) {
+            rx = IORing::create(logger);
+            tx = IORing::create(logger);
+            if (!rx || !tx)
+                return "io_uring unavailable";
+        }
+        if (mode.is_packet_ring && !(packet = PacketRing::create(logger, opt.iface)))
+            return "packet ring unavailable";
+        if (mode.is_xdp && !(xdp = XdpSocket::create(logger, opt.iface)))
+            return "AF_XDP unavailable";
+        return { };
+    }
+};
+
+
+/**
+ * @brief A multicast receiver on a thread of its own, which hands each message it receives
+ * to on_msg along with the time it was dispatched
+ */
+template<typename F>
+class McastReceiver {
+public:
+    McastReceiver(const Options& opt, const Mode& mode, int port, Logger& logger,
+                  McastRings& rings, F on_msg)
+            : socket(logger, mode.batching), size(opt.size), on_msg(on_msg) {
+        socket.tuning = mode.tuning;
+        is_ok = socket.init(opt.group, opt.iface, port, true) >= 0
+                && socket.join_group(opt.group)
+                && (!rings.rx || socket.attach(*rings.rx))
+                && (!rings.packet || socket.attach(*rings.packet, opt.group, port))
+                && (!rings.xdp || socket.attach(*rings.xdp, opt.group, port, true));
+        if (!is_ok)
+            return;
+        thread = create_and_start_thread(opt.core_rx, "BenchMcastRx", [this]() { run(); });
+    }
+    ~McastReceiver() {
+        is_running = false;
+        if (thread)
+            thread->join();
+    }
+
+    bool is_ok{ false };
+
+private:
+    McastSocket socket;
+    const size_t size;
+    F on_msg;
+    std::atomic<bool> is_running{ true };
+    std::unique_ptr<std::thread> thread;
+
+    void run() {
+        const auto on_rx = [this](McastSocket* s, Nanos) {
+            const auto t_rx = get_time_nanos();
+            while (s->rx_buffer.size() >= size) {
+                on_msg(read_header(s->rx_buffer.data()), t_rx);
+                s->rx_buffer.consume(size);
+            }
+        };
+        while (is_running)
+            socket.tx_and_rx(on_rx);
+    }
+};
+
+auto create_mcast_sender(const Options& opt, const Mode& mode, int port, Logger& logger,
+                         IORing* ring) -> std::unique_ptr<McastSocket> {
+    auto socket = std::make_unique<McastSocket>(logger, mode.batching);
+    socket->tuning = mode.tuning;
+    if (socket->init(opt.group, opt.iface_tx, port, false) < 0 || (ring && !socket->attach(*ring)))
+        return nullptr;
+    return socket;
+}
+
+
+/**
+ * @brief Latency of messages paced far enough apart that none queue behind another
+ */
+auto bench_mcast_one_way(const Options& opt, const Mode& mode, int port,
+                         Logger& logger) -> Result {
+    Result result{ "mcast_one_way", mode.name };
+    result.add("msg_size", opt.size);
+    McastRings rings;
+    if (const auto unavailable = rings.create(opt, mode, logger); !unavailable.empty()) {
+        result.add_skip(unavailable);
+        return result;
+    }
+    SyscallCounter syscalls;
+    std::vector<Nanos> latencies(opt.n);
+    std::atomic<size_t> n_measured{ };
+    {
+        McastReceiver receiver{ opt, mode, port, logger, rings,
+                                [&](const Header& header, Nanos t_rx) {
+            if (header.n_seq >= N_WARMUP) {
+                latencies[header.n_seq - N_WARMUP] = t_rx - header.t_tx;
+                n_measured.fetch_add(1, std::memory_order_release);
+            }
+        }};
+        auto sender = create_mcast_sender(opt, mode, port, logger, rings.tx.get());
+        if (!receiver.is_ok || !sender) {
+            result.add_error(std::string("socket setup failed: ") + std::strerror(errno));
+            return result;
+        }
+        std::vector<char> msg(opt.size);
+        const auto on_rx = [](McastSocket*, Nanos) { };
+        for (size_t i{ }; i < N_WARMUP + opt.n; ++i) {
+            load_message(*sender, msg, i);
+            sender->end_datagram();
+            sender->tx_and_rx(on_rx);
+            const auto t_next = get_time_nanos() + T_PACING;
+            while (get_time_nanos() < t_next)
+                sender->tx_and_rx(on_rx);
+        }
+        const auto t_deadline = get_time_nanos() + T_RATE_DRAIN;
+        while (n_measured.load(std::memory_order_acquire) < opt.n
+               && get_time_nanos() < t_deadline)
+            std::this_thread::yield();
+    }
+    // messages lost are left out, rather than counted as zero latency
+    std::erase(latencies, Nanos{ 0 });
+    result.add("n_lost", opt.n - latencies.size());
+    result.add_latencies(latencies);
+    result.add_syscalls(syscalls, N_WARMUP + opt.n);
+    return result;
+}
+
+
+/**
+ * @brief Send at doubling rates for T_RATE_STEP each, until more than MAX_LOSS of a step's
+ * messages are lost or the sender can't reach the rate, reporting the highest rate which kept
+ * within MAX_LOSS
+ */
+auto bench_mcast_max_rate(const Options& opt, const Mode& mode, int port,
+                          Logger& logger) -> Result {
+    Result result{ "mcast_max_rate", mode.name };
+    result.add("msg_size", opt.size);
+    McastRings rings;
+    if (const auto unavailable = rings.create(opt, mode, logger); !unavailable.empty()) {
+        result.add_skip(unavailable);
+        return result;
+    }
+    SyscallCounter syscalls;
+    constexpr size_t N_STEPS_MAX{ 32 };
+    std::array<std::atomic<size_t>, N_STEPS_MAX> n_rx_per_step{ };
+    double rate_sustained{ };
+    size_t n_tx_total{ };
+    std::string steps{ "[" };
+    {
+        McastReceiver receiver{ opt, mode, port, logger, rings,
+                                [&](const Header& header, Nanos) {
+            if (header.i_step < N_STEPS_MAX)
+                n_rx_per_step[header.i_step].fetch_add(1, std::memory_order_relaxed);
+        }};
+        auto sender = create_mcast_sender(opt, mode, port, logger, rings.tx.get());
+        if (!receiver.is_ok || !sender) {
+            result.add_error(std::string("socket setup failed: ") + std::strerror(errno));
+            return result;
+        }
+        std::vector<char> msg(opt.size);
+        const auto on_rx = [](McastSocket*, Nanos) { };
+        uint32_t i_step{ };
+        for (auto rate = RATE_START; rate <= RATE_MAX && i_step < N_STEPS_MAX;
+             rate *= 2, ++i_step) {
+            // messages due by now go out together, so a sender running behind batches up
+            size_t n_tx{ };
+            const auto t_start = get_time_nanos();
+            auto t_now = t_start;
+            while (t_now - t_start < T_RATE_STEP) {
+                const auto n_due = static_cast<size_t>(
+                        static_cast<double>(t_now - t_start) * rate / 1e9);
+                for (; n_tx < n_due; ++n_tx) {
+                    load_message(*sender, msg, n_tx, i_step);
+                    sender->end_datagram();
+                }
+                sender->tx_and_rx(on_rx);
+                t_now = get_time_nanos();
+            }
+            const auto rate_achieved = static_cast<double>(n_tx) * 1e9
+                    / static_cast<double>(t_now - t_start);
+            const auto t_drained = get_time_nanos() + T_RATE_DRAIN;
+            while (get_time_nanos() < t_drained)
+                sender->tx_and_rx(on_rx);
+            n_tx_total += n_tx;
+            const auto n_rx = n_rx_per_step[i_step].load(std::memory_order_relaxed);
+            const auto loss = n_tx ? 1.0 - static_cast<double>(n_rx) / static_cast<double>(n_tx)
+                                   : 0.0;
+            std::stringstream ss;
+            ss << (i_step ? ", " : "") << "{\"rate_target\": " << rate
+               << ", \"rate_achieved\": " << rate_achieved << ", \"n_tx\": " << n_tx
+               << ", \"n_rx\": " << n_rx << ", \"loss\": " << loss << "}";
+            steps += ss.str();
+            if (loss > MAX_LOSS || rate_achieved < 0.95 * rate)
+                break;
+            rate_sustained = rate_achieved;
+        }
+    }
+    result.add("max_loss", MAX_LOSS);
+    result.add("msgs_per_sec", rate_sustained);
+    result.add("steps", steps + "]");
+    result.add_syscalls(syscalls, n_tx_total);
+    return result;
+}
+
+
+auto split(const std::string& str, char delimiter) -> std::vector<std::string> {
+    std::vector<std::string> parts;
+    std::stringstream ss{ str };
+    for (std::string part; std::getline(ss, part, delimiter);)
+        parts.push_back(part);
+    return parts;
+}
+
+auto parse_options(int argc, char** argv) -> Options {
+    Options opt;
+    for (int i{ 1 }; i < argc; ++i) {
+        const std::string key{ argv[i] };
+        VERIFY(i + 1 < argc, "<bench_sockets> missing value for " + key);
+        const std::string value{ argv[++i] };
+        if (key == "--n")
+            opt.n = std::stoul(value);
+        else if (key == "--size")
+            opt.size = std::stoul(value);
+        else if (key == "--modes")
+            opt.modes = split(value, ',');
+        else if (key == "--ip")
+            opt.ip = value;
+        else if (key == "--iface")
+            opt.iface = value;
+        else if (key == "--iface-tx")
+            opt.iface_tx = value;
+        else if (key == "--group")
+            opt.group = value;
+        else if (key == "--port")
+            opt.port = std::stoi(value);
+        else if (key == "--cores") {
+            const auto cores = split(value, ',');
+            VERIFY(cores.size() == 2, "<bench_sockets> --cores takes <rx>,<tx>");
+            opt.core_rx = std::stoi(cores[0]);
+            opt.core_tx = std::stoi(cores[1]);
+        }
+        else if (key == "--out")
+            opt.out = value;
+        else
+            VERIFY(false, "<bench_sockets> unknown option: " + key);
+    }
+    if (opt.iface_tx.empty())
+        opt.iface_tx = opt.iface;
+    VERIFY(opt.size >= sizeof(Header), "<bench_sockets> --size must be at least "
+            + std::to_string(sizeof(Header)));
+    return opt;
+}
+}
+
+
+int main(int argc, char** argv) {
+    const auto opt = parse_options(argc, argv);
+    TSCClock::calibrate();
+    Logger logger{ "bench_sockets.log" };
+    // the calling thread sends, and is placed as the sender
+    if (opt.core_tx >= 0)
+        VERIFY(pin_thread_to_core(opt.core_tx), "<bench_sockets> failed to pin sender");
+    std::vector<Result> results;
+    int port{ opt.port };
+    for (const auto& name: opt.modes) {
+        const auto mode = Mode::from_str(name);
+        // every run gets ports of its own, so none waits on another's connections closing
+        for (auto bench: { bench_tcp_rtt, bench_mcast_one_way, bench_mcast_max_rate }) {
+            if (bench == bench_tcp_rtt && mode.is_mcast_only())
+                continue;
+            results.push_back(bench(opt, mode, port++, logger));
+            std::cout << results.back().to_json() << std::endl;
+        }
+    }
+    std::ofstream file{ opt.out };
+    VERIFY(file.is_open(), "<bench_sockets> could not open " + opt.out);
+    file << "{\n  \"iface\": \"" << opt.iface << "\", \"iface_tx\": \"" << opt.iface_tx
+         << "\", \"ip\": \"" << opt.ip << "\", \"group\": \"" << opt.group
+         << "\", \"n\": " << opt.n << ", \"msg_size\": " << opt.size << ",\n  \"results\": [\n";
+    for (size_t i{ }; i < results.size(); ++i)
+        file << results[i].to_json() << (i + 1 < results.size() ? ",\n" : "\n");
+    file << "  ]\n}\n";
+    return EXIT_SUCCESS;
+}
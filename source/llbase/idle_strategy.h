@@ -0,0 +1,137 @@
+/**
+ *
+ *  Low-latency C++ Utilities
+ *
+ *  @file idle_strategy.h
+ *  @brief Pluggable idle behaviour for worker thread run loops
+ *  @author Stacy Gaudreau
+ *  @date 2025.01.26
+ *
+ */
+
+
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <x86intrin.h>
+
+#include "macros.h"
+#include "timekeeping.h"
+
+
+namespace LL
+{
+/**
+ * @brief What a run loop does when a pass through it found no work.
+ */
+enum class IdleKind : uint8_t {
+    BUSY_SPIN = 0,  // go straight back around; lowest latency, burns the core
+    PAUSE = 1,      // spin with a pause instruction, to ease off the sibling hyperthread
+    YIELD = 2,      // give up the rest of the time slice to other runnable threads
+    BACKOFF = 3     // spin, then yield, then sleep for exponentially longer periods
+};
+
+inline auto idle_kind_to_str(IdleKind kind) -> std::string {
+    switch (kind) {
+    case IdleKind::BUSY_SPIN:
+        return "BUSY_SPIN";
+    case IdleKind::PAUSE:
+        return "PAUSE";
+    case IdleKind::YIELD:
+        return "YIELD";
+    case IdleKind::BACKOFF:
+        return "BACKOFF";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+/** @brief The IdleKind named as by idle_kind_to_str(), eg: "BACKOFF" */
+inline auto idle_kind_from_str(const std::string& name) -> IdleKind {
+    for (const auto kind: { IdleKind::BUSY_SPIN, IdleKind::PAUSE, IdleKind::YIELD,
+                            IdleKind::BACKOFF }) {
+        if (name == idle_kind_to_str(kind))
+            return kind;
+    }
+    FATAL("<IdleStrategy> unknown idle kind " + name);
+}
+
+
+class IdleStrategy final {
+public:
+    // BACKOFF spins this many idle passes, then yields for as many again, before sleeping
+    static constexpr uint32_t N_SPINS{ 100 };
+    static constexpr uint32_t N_YIELDS{ 100 };
+    static constexpr Nanos T_SLEEP_MIN{ 1 * NANOS_TO_MICROS };
+    static constexpr Nanos T_SLEEP_MAX{ 1 * NANOS_TO_MILLIS };
+
+    /**
+     * @brief Idle behaviour for a single run loop, owned by that loop's thread.
+     * @param kind How to idle; defaults to the process-wide default for the deployment
+     */
+    explicit IdleStrategy(IdleKind kind = get_default()) noexcept : kind(kind) { }
+
+    /**
+     * @brief Called once per pass of the run loop with the amount of work the pass did.
+     * @details Idles only when nothing was done, and any work resets the backoff.
+     */
+    inline void idle(size_t n_work) noexcept {
+        if (n_work) [[likely]] {
+            n_idle = 0;
+            return;
+        }
+        switch (kind) {
+        case IdleKind::BUSY_SPIN:
+            break;
+        case IdleKind::PAUSE:
+            _mm_pause();
+            break;
+        case IdleKind::YIELD:
+            std::this_thread::yield();
+            break;
+        case IdleKind::BACKOFF:
+            backoff();
+            break;
+        }
+    }
+
+    [[nodiscard]] inline auto get_kind() const noexcept { return kind; }
+    /** @brief Number of consecutive passes which found no work */
+    [[nodiscard]] inline auto get_n_idle() const noexcept { return n_idle; }
+
+    /**
+     * @brief Set the idle behaviour of all run loops constructed after this call, eg: BUSY_SPIN
+     * on production hosts and BACKOFF on shared simulation boxes.
+     */
+    static inline void set_default(IdleKind kind) noexcept {
+        default_kind.store(kind, std::memory_order_relaxed);
+    }
+    [[nodiscard]] static inline auto get_default() noexcept -> IdleKind {
+        return default_kind.load(std::memory_order_relaxed);
+    }
+
+private:
+    const IdleKind kind;
+    uint64_t n_idle{ 0 };
+    static inline std::atomic<IdleKind> default_kind{ IdleKind::BUSY_SPIN };
+
+    inline void backoff() noexcept {
+        ++n_idle;
+        if (n_idle <= N_SPINS) {
+            _mm_pause();
+        } else if (n_idle <= N_SPINS + N_YIELDS) {
+            std::this_thread::yield();
+        } else {
+            // sleep doubles with each idle pass, up to the max
+            const auto n_doublings = std::min<uint64_t>(n_idle - N_SPINS - N_YIELDS - 1, 20);
+            const auto t_sleep = std::min(T_SLEEP_MIN << n_doublings, T_SLEEP_MAX);
+            std::this_thread::sleep_for(std::chrono::nanoseconds(t_sleep));
+        }
+    }
+};
+}
@@ -0,0 +1,380 @@
+#include "io_ring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+namespace LL
+{
+namespace
+{
+// there's no liburing in this tree, so the three io_uring syscalls are made directly
+inline auto io_uring_setup(uint32_t entries, io_uring_params* p) noexcept -> int {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+inline auto io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete,
+                           uint32_t flags) noexcept -> int {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                                    nullptr, 0));
+}
+inline auto io_uring_register(int fd, uint32_t opcode, const void* arg,
+                              uint32_t n_args) noexcept -> int {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, n_args));
+}
+template<typename T>
+inline auto ring_ptr(void* ring, uint32_t offset) noexcept -> T* {
+    return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+}
+
+
+auto IORing::create(Logger& logger, const IORingConfig& conf) -> std::unique_ptr<IORing> {
+    std::unique_ptr<IORing> ring{ new IORing(logger, conf) };
+    if (!ring->init())
+        return nullptr;
+    return ring;
+}
+
+IORing::IORing(Logger& logger, const IORingConfig& conf)
+        : logger(logger), conf(conf) { }
+
+auto IORing::init() -> bool {
+    VERIFY(conf.n_rx_buffers && (conf.n_rx_buffers & (conf.n_rx_buffers - 1)) == 0
+                   && conf.n_rx_buffers <= 32768,
+           "<IORing> n_rx_buffers must be a power of two, no more than 32768");
+    const auto fail = [this](const char* what) {
+        logger.logf("% <IORing::%> % failed, error: %; falling back to socket syscalls\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, what,
+                    std::string(std::strerror(errno)));
+        return false;
+    };
+    io_uring_params p{ };
+    // multishot receives post many completions per submission, so the CQ is kept deeper
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = 4 * conf.n_entries;
+    if (conf.is_sq_poll) {
+        p.flags |= IORING_SETUP_SQPOLL;
+        p.sq_thread_idle = conf.sq_poll_idle_ms;
+        if (conf.sq_poll_core_id >= 0) {
+            p.flags |= IORING_SETUP_SQ_AFF;
+            p.sq_thread_cpu = static_cast<uint32_t>(conf.sq_poll_core_id);
+        }
+    }
+    fd = io_uring_setup(conf.n_entries, &p);
+    if (fd < 0)
+        return fail("io_uring_setup()");
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_NODROP))
+        return fail("io_uring feature check");
+
+    // map the submission and completion rings, which share a single mapping, and the SQEs
+    size_rings = std::max(p.sq_off.array + p.sq_entries * sizeof(uint32_t),
+                          p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe));
+    auto mapped_rings = mmap(nullptr, size_rings, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (mapped_rings == MAP_FAILED)
+        return fail("mmap() of rings");
+    rings = mapped_rings;
+    size_sqes = p.sq_entries * sizeof(io_uring_sqe);
+    auto mapped_sqes = mmap(nullptr, size_sqes, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (mapped_sqes == MAP_FAILED)
+        return fail("mmap() of SQEs");
+    sqes = static_cast<io_uring_sqe*>(mapped_sqes);
+    sq_head = ring_ptr<uint32_t>(rings, p.sq_off.head);
+    sq_tail = ring_ptr<uint32_t>(rings, p.sq_off.tail);
+    sq_flags = ring_ptr<uint32_t>(rings, p.sq_off.flags);
+    sq_mask = *ring_ptr<uint32_t>(rings, p.sq_off.ring_mask);
+    sq_entries = p.sq_entries;
+    sq_tail_local = *sq_tail;
+    // SQEs are always used in order, so the index array is filled once
+    auto sq_array = ring_ptr<uint32_t>(rings, p.sq_off.array);
+    for (uint32_t i{ }; i < sq_entries; ++i)
+        sq_array[i] = i;
+    cq_head = ring_ptr<uint32_t>(rings, p.cq_off.head);
+    cq_tail = ring_ptr<uint32_t>(rings, p.cq_off.tail);
+    cq_mask = *ring_ptr<uint32_t>(rings, p.cq_off.ring_mask);
+    cqes = ring_ptr<io_uring_cqe>(rings, p.cq_off.cqes);
+
+    // a sparse table of fixed files, filled in as sockets attach
+    std::vector<int> fds(conf.n_files, -1);
+    if (io_uring_register(fd, IORING_REGISTER_FILES, fds.data(), conf.n_files) < 0)
+        return fail("io_uring_register(FILES)");
+
+    // the receive buffer pool, provided to the kernel through a registered buffer ring
+    size_buf_ring = conf.n_rx_buffers * sizeof(io_uring_buf);
+    auto mapped_buf_ring = mmap(nullptr, size_buf_ring, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (mapped_buf_ring == MAP_FAILED)
+        return fail("mmap() of buffer ring");
+    buf_ring = static_cast<io_uring_buf_ring*>(mapped_buf_ring);
+    io_uring_buf_reg reg{ };
+    reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring);
+    reg.ring_entries = conf.n_rx_buffers;
+    reg.bgid = BUFFER_GROUP;
+    if (io_uring_register(fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        return fail("io_uring_register(PBUF_RING)");
+    rx_buffers = std::make_unique_for_overwrite<char[]>(
+            static_cast<size_t>(conf.n_rx_buffers) * conf.size_rx_buffer);
+    for (uint32_t i{ }; i < conf.n_rx_buffers; ++i)
+        recycle_buffer(static_cast<uint16_t>(i));
+    publish_buffers();
+
+    slots.resize(conf.n_files);
+    for (auto& slot: slots)
+        slot.parked.resize(conf.n_rx_buffers);
+    slots_parked.reserve(conf.n_files);
+    slots_rearm.reserve(conf.n_files);
+    // handed out from the back, lowest slot first
+    for (int i = static_cast<int>(conf.n_files) - 1; i >= 0; --i)
+        slots_free.push_back(i);
+    logger.logf("% <IORing::%> ring fd: %, sq entries: %, cq entries: %, sqpoll: %\n",
+                LL::get_time_str(&t_str), __FUNCTION__, fd, p.sq_entries, p.cq_entries,
+                conf.is_sq_poll);
+    return true;
+}
+
+IORing::~IORing() {
+    if (fd >= 0)
+        close(fd);  // also cancels anything still in flight
+    if (sqes)
+        munmap(sqes, size_sqes);
+    if (rings)
+        munmap(rings, size_rings);
+    if (buf_ring)
+        munmap(buf_ring, size_buf_ring);
+}
+
+auto IORing::attach(int socket_fd, Handlers handlers) noexcept -> int {
+    if (slots_free.empty())
+        return -1;
+    const auto i_slot = slots_free.back();
+    io_uring_files_update update{ static_cast<uint32_t>(i_slot), 0,
+                                  reinterpret_cast<uint64_t>(&socket_fd) };
+    if (io_uring_register(fd, IORING_REGISTER_FILES_UPDATE, &update, 1) != 1) {
+        logger.logf("% <IORing::%> failed to register fd: %, error: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, socket_fd,
+                    std::string(std::strerror(errno)));
+        return -1;
+    }
+    slots_free.pop_back();
+    auto& slot = slots[i_slot];
+    slot.handlers = std::move(handlers);
+    slot.is_attached = true;
+    slot.is_free = false;
+    arm_recv(i_slot);
+    return i_slot;
+}
+
+void IORing::detach(int i_slot) noexcept {
+    auto& slot = slots[i_slot];
+    if (!slot.is_attached)
+        return;
+    slot.is_attached = false;
+    slot.handlers = { };
+    for (; slot.n_parked; --slot.n_parked) {
+        recycle_buffer(slot.parked[slot.i_parked].i_buffer);
+        slot.i_parked = (slot.i_parked + 1) & (conf.n_rx_buffers - 1);
+    }
+    std::erase(slots_parked, i_slot);
+    publish_buffers();
+    // cancel whatever is in flight on the file, then drop the ring's reference to it
+    if (slot.n_in_flight) {
+        auto sqe = get_sqe();
+        VERIFY(sqe != nullptr, "<IORing> no submission entry free to cancel with");
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = i_slot;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_FD_FIXED
+                | IORING_ASYNC_CANCEL_ALL;
+        sqe->user_data = to_user_data(Op::CANCEL, i_slot);
+        submit();
+    }
+    const int fd_none{ -1 };
+    io_uring_files_update update{ static_cast<uint32_t>(i_slot), 0,
+                                  reinterpret_cast<uint64_t>(&fd_none) };
+    io_uring_register(fd, IORING_REGISTER_FILES_UPDATE, &update, 1);
+    release_if_done(i_slot);
+}
+
+auto IORing::send(int i_slot, const void* data, size_t len) noexcept -> bool {
+    auto sqe = get_sqe();
+    if (sqe == nullptr) [[unlikely]]
+        return false;
+    sqe->opcode = IORING_OP_SEND;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->fd = i_slot;
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = static_cast<uint32_t>(len);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = to_user_data(Op::SEND, i_slot);
+    ++slots[i_slot].n_in_flight;
+    return true;
+}
+
+auto IORing::submit() noexcept -> int {
+    if (!n_sq_pending)
+        return 0;
+    // publish the new tail; the kernel (or its polling thread) reads entries up to it
+    __atomic_store_n(sq_tail, sq_tail_local, __ATOMIC_RELEASE);
+    const auto n = n_sq_pending;
+    n_sq_pending = 0;
+    if (conf.is_sq_poll) {
+        // only a polling thread which has gone idle needs a syscall to wake it
+        if (__atomic_load_n(sq_flags, __ATOMIC_ACQUIRE) & IORING_SQ_NEED_WAKEUP)
+            enter(0, IORING_ENTER_SQ_WAKEUP);
+        return static_cast<int>(n);
+    }
+    return enter(n, 0);
+}
+
+auto IORing::reap() noexcept -> size_t {
+    // completions the CQ had no room for are held by the kernel until asked for
+    if (__atomic_load_n(sq_flags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) [[unlikely]]
+        enter(0, IORING_ENTER_GETEVENTS);
+    // data parked for lack of room is offered again first, so it arrives in order
+    if (!slots_parked.empty()) [[unlikely]] {
+        size_t n_still_parked{ };
+        for (auto i_slot: slots_parked) {
+            if (!deliver_parked(slots[i_slot]))
+                slots_parked[n_still_parked++] = i_slot;
+        }
+        slots_parked.resize(n_still_parked);
+    }
+
+    auto head = *cq_head;
+    const auto tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    const size_t n_cqes = tail - head;
+    for (; head != tail; ++head) {
+        const auto& cqe = cqes[head & cq_mask];
+        const auto op = static_cast<Op>(cqe.user_data >> 32);
+        const auto i_slot = static_cast<int>(cqe.user_data & UINT32_MAX);
+        auto& slot = slots[i_slot];
+        if (op == Op::RECV) {
+            if (cqe.flags & IORING_CQE_F_BUFFER) {
+                const auto i_buffer = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                const auto data = rx_buffers.get() + static_cast<size_t>(i_buffer)
+                        * conf.size_rx_buffer;
+                const auto len = static_cast<uint32_t>(std::max(cqe.res, 0));
+                if (!slot.is_attached || !len)
+                    recycle_buffer(i_buffer);
+                else if (!slot.n_parked && slot.handlers.on_rx(data, len))
+                    recycle_buffer(i_buffer);
+                else {
+                    if (!slot.n_parked)
+                        slots_parked.push_back(i_slot);
+                    park(slot, i_buffer, len);
+                }
+            }
+            if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                // the multishot receive has ended
+                --slot.n_in_flight;
+                if (slot.is_attached) {
+                    if (cqe.res > 0 || cqe.res == -ENOBUFS)
+                        slots_rearm.push_back(i_slot);  // ran out of buffers or CQ space
+                    else
+                        slot.handlers.on_rx_end(cqe.res);
+                }
+            }
+        }
+        else if (op == Op::SEND) {
+            --slot.n_in_flight;
+            if (slot.is_attached)
+                slot.handlers.on_tx(cqe.res);
+        }
+        if (op != Op::CANCEL)
+            release_if_done(i_slot);
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    publish_buffers();
+    // receives which stopped for lack of buffers are re-armed once per reap
+    for (auto i_slot: slots_rearm) {
+        if (slots[i_slot].is_attached)
+            arm_recv(i_slot);
+    }
+    slots_rearm.clear();
+    return n_cqes;
+}
+
+auto IORing::get_sqe() noexcept -> io_uring_sqe* {
+    if (sq_tail_local - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+        // full; hand what's queued to the kernel to make room
+        submit();
+        if (sq_tail_local - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries)
+            return nullptr;
+    }
+    auto sqe = &sqes[sq_tail_local & sq_mask];
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++sq_tail_local;
+    ++n_sq_pending;
+    return sqe;
+}
+
+void IORing::arm_recv(int i_slot) noexcept {
+    auto sqe = get_sqe();
+    VERIFY(sqe != nullptr, "<IORing> no submission entry free to arm a receive");
+    sqe->opcode = IORING_OP_RECV;
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+    sqe->fd = i_slot;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = to_user_data(Op::RECV, i_slot);
+    ++slots[i_slot].n_in_flight;
+}
+
+void IORing::recycle_buffer(uint16_t i_buffer) noexcept {
+    // entries start at the top of the ring, which the header's flexible array member doesn't
+    //  guarantee in C++ (its empty placeholder struct takes space), so they're indexed directly
+    auto& buf = reinterpret_cast<io_uring_buf*>(buf_ring)[buf_ring_tail
+            & (conf.n_rx_buffers - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(rx_buffers.get() + static_cast<size_t>(i_buffer)
+            * conf.size_rx_buffer);
+    buf.len = conf.size_rx_buffer;
+    buf.bid = i_buffer;
+    ++buf_ring_tail;
+}
+
+void IORing::publish_buffers() noexcept {
+    __atomic_store_n(&buf_ring->tail, buf_ring_tail, __ATOMIC_RELEASE);
+}
+
+void IORing::release_if_done(int i_slot) noexcept {
+    auto& slot = slots[i_slot];
+    if (!slot.is_attached && !slot.n_in_flight && !slot.is_free) {
+        slot.is_free = true;
+        slots_free.push_back(i_slot);
+    }
+}
+
+void IORing::park(Slot& slot, uint16_t i_buffer, uint32_t len) noexcept {
+    // a slot can't park more buffers than the pool has
+    slot.parked[(slot.i_parked + slot.n_parked) & (conf.n_rx_buffers - 1)] = { i_buffer, len };
+    ++slot.n_parked;
+}
+
+auto IORing::deliver_parked(Slot& slot) noexcept -> bool {
+    while (slot.n_parked) {
+        const auto& parked = slot.parked[slot.i_parked];
+        const auto data = rx_buffers.get() + static_cast<size_t>(parked.i_buffer)
+                * conf.size_rx_buffer;
+        if (!slot.handlers.on_rx(data, parked.len))
+            return false;
+        recycle_buffer(parked.i_buffer);
+        slot.i_parked = (slot.i_parked + 1) & (conf.n_rx_buffers - 1);
+        --slot.n_parked;
+    }
+    return true;
+}
+
+auto IORing::enter(uint32_t to_submit, uint32_t flags) noexcept -> int {
+    const auto n = io_uring_enter(fd, to_submit, 0, flags);
+    if (n < 0 && errno != EAGAIN && errno != EBUSY && errno != EINTR) [[unlikely]]
+        logger.logf("% <IORing::%> io_uring_enter() failed! error: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, std::string(std::strerror(errno)));
+    return n;
+}
+
+}
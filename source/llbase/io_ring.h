@@ -0,0 +1,184 @@
+/**
+ *
+ *  Low-latency C++ Utilities
+ *
+ *  @file io_ring.h
+ *  @brief An io_uring backend for socket sends and receives
+ *  @author Stacy Gaudreau
+ *  @date 2025.02.11
+ *
+ */
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <linux/io_uring.h>
+
+#include "macros.h"
+#include "logging.h"
+
+
+namespace LL
+{
+struct IORingConfig {
+    uint32_t n_entries{ 256 };          // submission queue depth
+    uint32_t n_files{ 64 };             // sockets which can be attached at once
+    uint32_t n_rx_buffers{ 256 };       // receive buffers shared by all sockets; a power of two
+    uint32_t size_rx_buffer{ 16 * 1024 };
+    bool is_sq_poll{ false };           // a kernel thread polls for submissions (SQPOLL)
+    uint32_t sq_poll_idle_ms{ 1000 };   // the polling thread sleeps after this long idle
+    int sq_poll_core_id{ -1 };          // core to pin the polling thread to, if any
+};
+
+
+/**
+ * @brief A single thread's io_uring instance, which sockets attach to in place of making their
+ * own recv() and send() calls.
+ * @details Each attached socket is a registered (fixed) file with one multishot receive armed
+ * on it, which fills buffers from a pool registered with the kernel for as long as data
+ * arrives, so idle sockets cost nothing and busy ones need no syscall to receive. Sends are
+ * queued and go to the kernel together at the next submit(), or are picked up by the kernel's
+ * polling thread with SQPOLL. Completions are read from shared memory by reap(), without a
+ * syscall, and handed to each socket's handlers.
+ *
+ * Not thread safe; owned by the thread which polls the sockets attached to it.
+ */
+class IORing {
+public:
+    /**
+     * @brief What an attached socket is told of its completions
+     */
+    struct Handlers {
+        // data received; returns false when there's no room for it yet, and it's offered again
+        //  (in order, before anything newer) at the next reap()
+        std::function<bool(const char* data, size_t len)> on_rx;
+        // the receive stream has ended: 0 when the peer closed, else -errno
+        std::function<void(int res)> on_rx_end;
+        // a send completed: bytes sent, else -errno
+        std::function<void(int res)> on_tx;
+    };
+
+    /**
+     * @brief Set up an io_uring instance with the given configuration
+     * @return The ring, or nullptr if the kernel doesn't support what it needs (or io_uring is
+     * disabled), in which case sockets should keep to their own syscalls
+     */
+    [[nodiscard]] static auto create(Logger& logger, const IORingConfig& conf = { })
+            -> std::unique_ptr<IORing>;
+    ~IORing();
+
+    /**
+     * @brief Register a socket with the ring and arm a multishot receive on it
+     * @return The socket's slot in the ring, or -1 if every slot is taken
+     */
+    auto attach(int fd, Handlers handlers) noexcept -> int;
+    /**
+     * @brief Cancel a socket's outstanding operations and unregister it. Its handlers are not
+     * called again. The slot is reused once the kernel has finished with it.
+     */
+    void detach(int i_slot) noexcept;
+    /**
+     * @brief Queue a send of len bytes at data, which must stay untouched until on_tx()
+     * @return False if the submission queue is full
+     */
+    auto send(int i_slot, const void* data, size_t len) noexcept -> bool;
+    /**
+     * @brief Hand queued operations to the kernel
+     * @return Number of operations submitted
+     */
+    auto submit() noexcept -> int;
+    /**
+     * @brief Dispatch every completion the kernel has posted to the handlers of its socket
+     * @return Number of completions
+     */
+    auto reap() noexcept -> size_t;
+
+    [[nodiscard]] inline auto get_n_slots_free() const noexcept { return slots_free.size(); }
+    /**
+     * @brief Whether a detached socket's operations are still in flight, in which case the
+     * memory its sends read from mustn't be reused yet
+     */
+    [[nodiscard]] inline auto is_draining(int i_slot) const noexcept {
+        return !slots[i_slot].is_attached && slots[i_slot].n_in_flight;
+    }
+
+private:
+    IORing(Logger& logger, const IORingConfig& conf);
+    auto init() -> bool;
+
+    // operations are told apart in completions by the top half of their user_data
+    enum class Op : uint64_t { RECV = 1, SEND = 2, CANCEL = 3 };
+    static constexpr uint16_t BUFFER_GROUP{ 0 };
+
+    // a received buffer its socket had no room for yet
+    struct Parked {
+        uint16_t i_buffer;
+        uint32_t len;
+    };
+    struct Slot {
+        Handlers handlers;
+        uint32_t n_in_flight{ };        // operations the kernel hasn't completed
+        bool is_attached{ false };
+        bool is_free{ true };           // on slots_free
+        // buffers parked in the order received, in a ring as large as the whole buffer pool,
+        //  so it can never fill and parking never allocates
+        std::vector<Parked> parked;
+        uint32_t i_parked{ };           // oldest parked buffer
+        uint32_t n_parked{ };
+    };
+
+    Logger& logger;
+    std::string t_str;
+    const IORingConfig conf;
+    int fd{ -1 };
+
+    // submission and completion rings, shared with the kernel
+    void* rings{ nullptr };
+    size_t size_rings{ };
+    io_uring_sqe* sqes{ nullptr };
+    size_t size_sqes{ };
+    uint32_t* sq_head{ nullptr };
+    uint32_t* sq_tail{ nullptr };
+    uint32_t* sq_flags{ nullptr };
+    uint32_t sq_mask{ };
+    uint32_t sq_entries{ };
+    uint32_t sq_tail_local{ };          // tail including entries not yet published
+    uint32_t n_sq_pending{ };           // entries queued since the last submit()
+    uint32_t* cq_head{ nullptr };
+    uint32_t* cq_tail{ nullptr };
+    uint32_t cq_mask{ };
+    io_uring_cqe* cqes{ nullptr };
+
+    // receive buffers, and the ring through which they're provided to the kernel
+    io_uring_buf_ring* buf_ring{ nullptr };
+    size_t size_buf_ring{ };
+    std::unique_ptr<char[]> rx_buffers;
+    uint16_t buf_ring_tail{ };
+
+    std::vector<Slot> slots;            // indexed by each socket's fixed file index
+    std::vector<int> slots_free;
+    std::vector<int> slots_parked;      // slots with received data waiting for room
+    std::vector<int> slots_rearm;       // slots whose multishot receive has ended early
+
+    auto get_sqe() noexcept -> io_uring_sqe*;
+    void arm_recv(int i_slot) noexcept;
+    void recycle_buffer(uint16_t i_buffer) noexcept;
+    void publish_buffers() noexcept;
+    void release_if_done(int i_slot) noexcept;
+    void park(Slot& slot, uint16_t i_buffer, uint32_t len) noexcept;
+    auto deliver_parked(Slot& slot) noexcept -> bool;
+    auto enter(uint32_t to_submit, uint32_t flags) noexcept -> int;
+
+    [[nodiscard]] static inline auto to_user_data(Op op, int i_slot) noexcept -> uint64_t {
+        return (static_cast<uint64_t>(op) << 32) | static_cast<uint32_t>(i_slot);
+    }
+
+DELETE_DEFAULT_COPY_AND_MOVE(IORing)
+};
+}
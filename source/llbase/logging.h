@@ -23,6 +23,7 @@
 #include "lfqueue.h"
 #include "threading.h"
 #include "timekeeping.h"
+#include "loop_progress.h"
 
 
 namespace LL
@@ -69,25 +70,21 @@ public:
 
     explicit Logger(const std::string& output_filename)
             : filename(output_filename),
-              queue(QUEUE_SIZE) {
+              queue(QUEUE_SIZE),
+              progress("Logger " + output_filename) {
         file.open(filename);
-        ASSERT(file.is_open(), "<Logger> could not open output logfile "
+        VERIFY(file.is_open(), "<Logger> could not open output logfile "
                 + output_filename);
         thread = create_and_start_thread(
                 -1, "<LL::Logger>", [this]() { process_queue(); });
-        ASSERT(thread != nullptr, "<Logger> failed to start thread");
+        VERIFY(thread != nullptr, "<Logger> failed to start thread");
     }
 
     ~Logger() {
         std::string time_str;
         std::cerr << get_time_str(&time_str) << " <Logger> flush and close logfile " <<
                   filename << std::endl;
-        // wait for the logging queue to be emptied out by its dedicated thread
-        while (queue.size()) {
-            using namespace std::literals::chrono_literals;
-            std::this_thread::sleep_for(500ms);
-        }
-        // clean up after all logging events in the queue have been processed
+        // the logging thread empties out the queue before it exits
         is_running = false;
         if (thread != nullptr && thread->joinable())
             thread->join();
@@ -100,7 +97,12 @@ public:
      * @brief Process data in the logging queue, flushing it to file.
      */
     void process_queue() noexcept {
-        while (is_running) {
+        // the queue is drained once more after a stop, so no log entries are lost
+        bool is_last_pass{ false };
+        progress.watch();
+        while (!is_last_pass) {
+            is_last_pass = !is_running;
+            size_t n_written{ };
             for (auto next = queue.get_next_to_read();
                  queue.size() && next;
                  next = queue.get_next_to_read()) {
@@ -134,11 +136,16 @@ public:
                     break;
                 }
                 queue.increment_read_index();
+                ++n_written;
             }
             file.flush();
-            using namespace std::literals::chrono_literals;
-            std::this_thread::sleep_for(10ms);
+            progress.tick(n_written);
+            if (!is_last_pass) {
+                using namespace std::literals::chrono_literals;
+                std::this_thread::sleep_for(10ms);
+            }
         }
+        progress.unwatch();
     }
 
     /**
@@ -284,6 +291,7 @@ private:
     LFQueue<LogElement> queue;  // log events pending write to file
     std::atomic<bool> is_running{ true };  // for stopping the process
     std::unique_ptr<std::thread> thread{ nullptr }; // dedicated logging thread
+    LoopProgress progress;  // sampled by the liveness watchdog
 
 DELETE_DEFAULT_COPY_AND_MOVE(Logger)
 };
@@ -0,0 +1,92 @@
+/**
+ *
+ *  Low-latency C++ Utilities
+ *
+ *  @file loop_progress.h
+ *  @brief Per-thread run loop progress counters, for liveness monitoring
+ *  @author Stacy Gaudreau
+ *  @date 2025.02.02
+ *
+ */
+
+
+#pragma once
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "macros.h"
+#include "timekeeping.h"
+
+
+namespace LL
+{
+/**
+ * @brief Progress of a single worker thread's run loop, sampled by the Watchdog.
+ * @details Aligned to its own cache line, so the owning thread's stores never contend with
+ * other data. Only the owning thread writes to it.
+ */
+class alignas(64) LoopProgress final {
+public:
+    explicit LoopProgress(std::string name) : name(std::move(name)) { }
+    ~LoopProgress() { unwatch(); }
+
+    /**
+     * @brief Record one pass of the run loop, and how much work it did.
+     * @details A single relaxed store on passes which did no work, plus a coarse timestamp
+     * store on passes which did.
+     */
+    inline void tick(size_t n_work) noexcept {
+        n_loops.store(++n_loops_local, std::memory_order_relaxed);
+        if (n_work)
+            t_last_work.store(CoarseClock::get_nanos(), std::memory_order_relaxed);
+    }
+
+    /** @brief Start having this loop sampled by the watchdog; call as the loop starts */
+    void watch() {
+        std::lock_guard<std::mutex> lock(watched_mutex);
+        if (std::find(watched.begin(), watched.end(), this) == watched.end())
+            watched.push_back(this);
+    }
+    /** @brief Stop having this loop sampled; call as the loop exits */
+    void unwatch() {
+        std::lock_guard<std::mutex> lock(watched_mutex);
+        std::erase(watched, this);
+    }
+
+    [[nodiscard]] inline auto get_n_loops() const noexcept {
+        return n_loops.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] inline auto get_t_last_work() const noexcept {
+        return t_last_work.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] inline const auto& get_name() const noexcept { return name; }
+
+    /**
+     * @brief Call fn(const LoopProgress&) for every watched loop. Watched loops can't be
+     * destroyed while this runs.
+     */
+    template<typename F>
+    static void for_each_watched(F&& fn) {
+        std::lock_guard<std::mutex> lock(watched_mutex);
+        for (const auto p: watched)
+            fn(*p);
+    }
+
+private:
+    std::atomic<uint64_t> n_loops{ 0 };
+    std::atomic<Nanos> t_last_work{ 0 };
+    uint64_t n_loops_local{ 0 };    // the owner's copy, so a tick needs no atomic RMW
+    const std::string name;
+
+    static inline std::mutex watched_mutex;
+    static inline std::vector<LoopProgress*> watched;
+
+DELETE_DEFAULT_COPY_AND_MOVE(LoopProgress)
+};
+}
@@ -13,24 +13,53 @@
 #pragma once
 
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <vector>
 
 
-inline auto ASSERT(bool cond, const std::string& msg) noexcept {
-    // todo: add debug/release flag to optimise this out in release builds
-    if (!cond) [[unlikely]] {
-        std::cerr << msg << "\n";
-        exit(EXIT_FAILURE);
-    }
-}
-
-inline auto FATAL(const std::string& msg) noexcept {
-    std::cerr << msg << "\n";
+/**
+ * @brief Report a failed check and exit. Kept out of line and marked cold, so that a check's
+ * failure path costs nothing on the hot path which contains it.
+ */
+[[noreturn]] [[gnu::cold]] [[gnu::noinline]]
+inline void check_failed(const char* file, int line, const std::string& msg) noexcept {
+    std::cerr << file << ":" << line << " " << msg << "\n";
     exit(EXIT_FAILURE);
 }
 
+/**
+ * @brief Exit with the given message when the condition does not hold. The message is only
+ * evaluated on failure. Always on; use for invariants which must hold in production, such as
+ * system calls when setting up, and for conditions which have side effects.
+ */
+#define VERIFY(cond, msg) \
+    do { \
+        if (!(cond)) [[unlikely]] \
+            check_failed(__FILE__, __LINE__, (msg)); \
+    } while (0)
+
+/**
+ * @brief Exit with the given message when the condition does not hold. The message is only
+ * evaluated on failure. Compiled out entirely, condition included, when LL_NO_ASSERTS is
+ * defined (as it is for release builds), so the condition must not have side effects.
+ */
+#ifdef LL_NO_ASSERTS
+#define ASSERT(cond, msg) \
+    do { \
+        static_cast<void>(sizeof(!(cond))); \
+    } while (0)
+#else
+#define ASSERT(cond, msg) VERIFY(cond, msg)
+#endif
+
+/**
+ * @brief Exit with the given message. Always on, since execution cannot carry on past it.
+ */
+#define FATAL(msg) check_failed(__FILE__, __LINE__, (msg))
+
 /**
  * @brief Check if an element does not exist in a vector
  * @return True when the element is not in the vector
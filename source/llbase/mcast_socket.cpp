@@ -7,8 +7,12 @@ namespace LL
 auto McastSocket::init(const std::string& ip, const std::string& iface, int port,
                        bool is_listening) -> int {
     const SocketConfig conf{ ip, iface, port, true,
-                             is_listening, false };
+                             is_listening, true, false, tuning.is_hw_timestamps, tuning };
     fd = create_socket(conf, logger);
+    is_gso = batching.is_gso && fd != -1 && has_udp_gso(fd);
+    if (batching.is_gso && !is_gso)
+        logger.logf("% <McastSocket::%> UDP GSO unsupported at socket %, sending datagrams "
+                    "singly\n", LL::get_time_str(&t_str), __FUNCTION__, fd);
     return fd;
 }
 
@@ -17,44 +21,458 @@ auto McastSocket::join_group(const std::string& ip) -> bool {
 }
 
 void McastSocket::leave_group() {
+    detach();
     close(fd);
     fd = -1;
+    tx_completions = { };
+    i_tx_next = i_tx_start = 0;
+    tx_datagram_ends.clear();
 }
 
 void McastSocket::load_tx(const void* data, size_t len) noexcept {
+    VERIFY(i_tx_next + len <= MCAST_BUFFER_SIZE,
+           "<McastSocket> tx buffer overflow! Have you called tx_and_rx()?");
     memcpy(tx_buffer.data() + i_tx_next, data, len);
     i_tx_next += len;
-    ASSERT(i_tx_next < MCAST_BUFFER_SIZE,
-           "<McastSocket> tx buffer overflow! Have you called tx_and_rx()?");
 }
 
-auto McastSocket::tx_and_rx() noexcept -> bool {
-    // non-blocking read
-    const auto rx_size = recv(fd, rx_buffer.data() + i_rx_next,
-                              MCAST_BUFFER_SIZE - i_rx_next, MSG_DONTWAIT);
-    if (rx_size > 0) {
-        i_rx_next += rx_size;
+auto McastSocket::attach(IORing& io_ring) noexcept -> bool {
+    const auto i_slot = io_ring.attach(fd, {
+            [this](const char* data, size_t len) {
+                return rx_to_buffer(data, len);
+            },
+            [this](int res) {
+                logger.logf("% <McastSocket::%> rx ended at socket %, res: %\n",
+                            LL::get_time_str(&t_str), __FUNCTION__, fd, res);
+            },
+            [this](int res) {
+                logger.logf("% <McastSocket::%> TX at socket %, size: %\n",
+                            LL::get_time_str(&t_str), __FUNCTION__, fd, res);
+                // a datagram is sent whole or not at all; either way it's done with
+                if (!--n_tx_sends_in_flight)
+                    release_ring_tx();
+            }});
+    if (i_slot < 0)
+        return false;
+    ring = &io_ring;
+    i_ring_slot = i_slot;
+    return true;
+}
+
+auto McastSocket::rx_to_buffer(const char* data, size_t len) noexcept -> bool {
+    // no room yet; the datagram is offered again at the next poll
+    if (len > rx_buffer.get_n_free())
+        return false;
+    memcpy(rx_buffer.write_ptr(), data, len);
+    rx_buffer.commit(len);
+    if (!has_ring_rx) {
+        has_ring_rx = true;
+        t_ring_rx = get_time_nanos();
+    }
+    return true;
+}
+
+auto McastSocket::enable_tx_timestamps() noexcept -> bool {
+    if (!tx_completions.enable_tx_timestamps(fd)) {
+        logger.logf("% <McastSocket::%> tx timestamps unavailable at socket %, error: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, fd, std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+auto McastSocket::enable_zerocopy(size_t size_min) noexcept -> bool {
+    if (!tx_completions.enable_zerocopy(fd, size_min)) {
+        logger.logf("% <McastSocket::%> zerocopy unavailable at socket %, error: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, fd, std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void McastSocket::read_tx_completions() noexcept {
+    const auto is_newly_copied = tx_completions.read(fd, [this](uint32_t id, Nanos t_tx) {
+        if (tx_timestamp_callback)
+            tx_timestamp_callback(this, id, t_tx);
+    });
+    if (is_newly_copied)
+        logger.logf("% <McastSocket::%> zerocopy sends are being copied at socket %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, fd);
+    // the kernel's done with everything sent, so the buffer can start over
+    if (!tx_completions.is_zerocopy_pending() && i_tx_start == i_tx_next) {
+        i_tx_next = i_tx_start = 0;
+        tx_datagram_ends.clear();
+    }
+}
+
+void McastSocket::complete_tx() noexcept {
+    i_tx_start = i_tx_next;
+    tx_datagram_ends.clear();
+    if (tx_completions.is_pending())
+        read_tx_completions();
+    if (!tx_completions.is_zerocopy_pending())
+        i_tx_next = i_tx_start = 0;
+}
+
+auto McastSocket::attach(PacketRing& ring, const std::string& ip, int port) -> bool {
+    const auto i_flow = ring.attach(ip, port, [this](const char* data, size_t len) {
+        return rx_to_buffer(data, len);
+    });
+    if (i_flow < 0)
+        return false;
+    if (!set_rx_discard(fd)) {
+        logger.logf("% <McastSocket::%> set_rx_discard() failed at socket %, error: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, fd, std::strerror(errno));
+        ring.detach(i_flow);
+        return false;
+    }
+    packet_ring = &ring;
+    i_packet_flow = i_flow;
+    return true;
+}
+
+auto McastSocket::attach(XdpSocket& xsk, const std::string& ip, int port,
+                         bool is_listening) -> bool {
+    in_addr group{ };
+    if (inet_pton(AF_INET, ip.c_str(), &group) != 1)
+        return false;
+    if (is_listening) {
+        // the kernel never sees the flow's packets, so there are no copies of its to discard
+        const auto i_flow = xsk.attach(ip, port, [this](const char* data, size_t len) {
+            return rx_to_buffer(data, len);
+        });
+        if (i_flow < 0)
+            return false;
+        i_xdp_flow = i_flow;
+    }
+    xdp = &xsk;
+    group_xdp = group;
+    port_xdp = port;
+    return true;
+}
+
+void McastSocket::detach() noexcept {
+    if (xdp != nullptr) {
+        if (i_xdp_flow >= 0)
+            xdp->detach(i_xdp_flow);
+        xdp = nullptr;
+        i_xdp_flow = -1;
+        has_ring_rx = false;
+    }
+    if (packet_ring != nullptr) {
+        packet_ring->detach(i_packet_flow);
+        packet_ring = nullptr;
+        i_packet_flow = -1;
+        has_ring_rx = false;
+    }
+    if (ring == nullptr)
+        return;
+    ring->detach(i_ring_slot);
+    ring = nullptr;
+    i_ring_slot = -1;
+    n_tx_in_flight = n_tx_sends_in_flight = 0;
+    has_ring_rx = false;
+}
+
+void McastSocket::end_datagram() noexcept {
+    if (!batching.n_batch && ring == nullptr)
+        return;
+    const auto i_end = tx_datagram_ends.empty() ? i_tx_start : tx_datagram_ends.back();
+    if (i_tx_next == i_end)
+        return;     // nothing loaded since the last datagram ended
+    tx_datagram_ends.push_back(i_tx_next);
+    if (ring == nullptr && batching.n_tx_flush
+            && tx_datagram_ends.size() >= batching.n_tx_flush)
+        tx_batch();
+}
+
+auto McastSocket::shared_rx() noexcept -> bool {
+    // the packet ring or XDP socket is shared, so this may deliver to other sockets too; they
+    //  dispatch their own
+    if (xdp != nullptr)
+        xdp->poll();
+    else
+        packet_ring->poll();
+    if (!has_ring_rx)
+        return false;
+    has_ring_rx = false;
+    logger.logf("% <McastSocket::%> RX at socket %, size: %\n",
+                LL::get_time_str(&t_str), __FUNCTION__, fd, rx_buffer.size());
+    t_rx_last = t_ring_rx;
+    return true;
+}
+
+void McastSocket::ring_tx() noexcept {
+    end_datagram();
+    // each datagram is a send of its own; the next lot is queued once these have completed
+    if (!n_tx_sends_in_flight) {
+        size_t start{ };
+        for (const auto end: tx_datagram_ends) {
+            if (end - start > MCAST_MAX_PAYLOAD) [[unlikely]] {
+                logger.logf("% <McastSocket::%> dropping datagram of % bytes at socket %, "
+                            "larger than a UDP payload\n", LL::get_time_str(&t_str),
+                            __FUNCTION__, end - start, fd);
+            }
+            else if (ring->send(i_ring_slot, tx_buffer.data() + start, end - start)) {
+                ++n_tx_sends_in_flight;
+            }
+            else {
+                break;  // the submission queue is full; the rest go in the next lot
+            }
+            n_tx_in_flight = start = end;
+        }
+        // only dropped datagrams, which no completion will release
+        if (!n_tx_sends_in_flight && n_tx_in_flight)
+            release_ring_tx();
+    }
+    ring->submit();
+}
+
+void McastSocket::release_ring_tx() noexcept {
+    memmove(tx_buffer.data(), tx_buffer.data() + n_tx_in_flight, i_tx_next - n_tx_in_flight);
+    i_tx_next -= n_tx_in_flight;
+    // the datagrams which were sent are at the front, and those after move down with the data
+    const auto n_sent = std::upper_bound(tx_datagram_ends.begin(), tx_datagram_ends.end(),
+                                         n_tx_in_flight) - tx_datagram_ends.begin();
+    tx_datagram_ends.erase(tx_datagram_ends.begin(), tx_datagram_ends.begin() + n_sent);
+    for (auto& end: tx_datagram_ends)
+        end -= n_tx_in_flight;
+    n_tx_in_flight = 0;
+}
+
+void McastSocket::xdp_tx() noexcept {
+    // each datagram goes out in a frame of its own; when not batching, the whole buffer's one
+    if (tx_datagram_ends.empty() || tx_datagram_ends.back() != i_tx_next)
+        tx_datagram_ends.push_back(i_tx_next);
+    size_t n_sent{ };
+    for (; n_sent < tx_datagram_ends.size(); ++n_sent) {
+        const auto start = n_sent ? tx_datagram_ends[n_sent - 1] : i_tx_start;
+        if (!xdp->send(group_xdp, port_xdp, tx_buffer.data() + start,
+                       tx_datagram_ends[n_sent] - start))
+            break;
+    }
+    xdp->flush();
+    logger.logf("% <McastSocket::%> TX at socket %, datagrams: % of %, size: %\n",
+                LL::get_time_str(&t_str), __FUNCTION__, fd, n_sent, tx_datagram_ends.size(),
+                i_tx_next);
+    // as with sendmmsg(), whatever there's no frame for is dropped
+    complete_tx();
+}
+
+auto McastSocket::rx_batch() noexcept -> bool {
+    // each datagram gets a slot of its own in the ring's free space, so only as many are
+    //  received as there's room for; the rest wait in the kernel
+    const auto n_slots = std::min(batching.n_batch,
+                                  rx_buffer.get_n_free() / batching.size_datagram);
+    if (!n_slots) [[unlikely]]
+        return false;
+    const auto base = rx_buffer.write_ptr();
+    for (size_t i{ }; i < n_slots; ++i) {
+        iovs[i] = { base + i * batching.size_datagram, batching.size_datagram };
+        msgs[i] = { { nullptr, 0, &iovs[i], 1, rx_controls[i].buffer,
+                      sizeof(rx_controls[i].buffer), 0 }, 0 };
+    }
+    const auto n_rx = recvmmsg(fd, msgs.data(), static_cast<unsigned>(n_slots),
+                               MSG_DONTWAIT, nullptr);
+    if (n_rx <= 0)
+        return false;
+    // datagrams are packed down against one another, so records stay contiguous; truncated
+    //  ones are dropped, since what's left of their records can't be parsed
+    size_t len{ };
+    int i_first{ -1 };
+    for (int i{ }; i < n_rx; ++i) {
+        if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) [[unlikely]] {
+            logger.logf("% <McastSocket::%> dropping datagram larger than % bytes at "
+                        "socket %\n", LL::get_time_str(&t_str), __FUNCTION__,
+                        batching.size_datagram, fd);
+            continue;
+        }
+        if (i_first < 0)
+            i_first = i;
+        if (base + len != iovs[i].iov_base)
+            memmove(base + len, iovs[i].iov_base, msgs[i].msg_len);
+        len += msgs[i].msg_len;
+    }
+    if (i_first < 0) [[unlikely]]
+        return false;
+    rx_buffer.commit(len);
+    logger.logf("% <McastSocket::%> RX at socket %, datagrams: %, size: %\n",
+                LL::get_time_str(&t_str), __FUNCTION__, fd, n_rx, rx_buffer.size());
+    t_rx_last = get_timestamp(msgs[i_first].msg_hdr);
+    return true;
+}
+
+auto McastSocket::get_gso_run(size_t i_datagram) const noexcept -> size_t {
+    if (!is_gso)
+        return 1;
+    const auto size_datagram = [this](size_t i) {
+        return tx_datagram_ends[i] - (i ? tx_datagram_ends[i - 1] : i_tx_start);
+    };
+    // the kernel cuts a GSO send into segments of the first datagram's size, so only a run of
+    //  equal sized datagrams, each within the MTU sized budget, can go out as one
+    const auto size = size_datagram(i_datagram);
+    if (size > batching.size_datagram)
+        return 1;
+    size_t n_run{ 1 };
+    while (i_datagram + n_run < tx_datagram_ends.size() && n_run < MCAST_GSO_SEGMENTS
+           && (n_run + 1) * size <= MCAST_GSO_SIZE && size_datagram(i_datagram + n_run) == size)
+        ++n_run;
+    return n_run;
+}
+
+void McastSocket::tx_batch() noexcept {
+    if (xdp != nullptr) {
+        xdp_tx();
+        return;
+    }
+    const auto n_datagrams = tx_datagram_ends.size();
+    // until no more pages can be pinned
+    auto is_zerocopy_ok = tx_completions.size_zerocopy_min != 0;
+    size_t n_sent{ }, n_zerocopy{ };
+    while (n_sent < n_datagrams) {
+        // each message is a single datagram, or a run of them for the kernel to segment. The
+        //  flags cover the whole call, so its messages are either all zerocopy or all copied
+        size_t n{ };
+        bool is_zerocopy{ false };
+        for (auto i_datagram = n_sent; n < batching.n_batch && i_datagram < n_datagrams; ++n) {
+            const auto start = i_datagram ? tx_datagram_ends[i_datagram - 1] : i_tx_start;
+            const auto n_run = get_gso_run(i_datagram);
+            const auto end = tx_datagram_ends[i_datagram + n_run - 1];
+            const auto is_zerocopy_msg = is_zerocopy_ok
+                    && tx_completions.is_zerocopy_send(start, end, MCAST_BUFFER_SIZE);
+            if (!n)
+                is_zerocopy = is_zerocopy_msg;
+            else if (is_zerocopy_msg != is_zerocopy)
+                break;
+            i_datagram += n_run;
+            iovs[n] = { tx_buffer.data() + start, end - start };
+            msgs[n] = { { nullptr, 0, &iovs[n], 1, nullptr, 0, 0 }, 0 };
+            if (!is_gso)
+                continue;
+            gso_runs[n] = n_run;
+            if (n_run > 1) {
+                auto& hdr = msgs[n].msg_hdr;
+                hdr.msg_control = gso_controls[n].buffer;
+                hdr.msg_controllen = sizeof(gso_controls[n].buffer);
+                auto cmsg = CMSG_FIRSTHDR(&hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                const auto size_segment = static_cast<uint16_t>(iovs[n].iov_len / n_run);
+                memcpy(CMSG_DATA(cmsg), &size_segment, sizeof(size_segment));
+            }
+        }
+        const auto n_tx = sendmmsg(fd, msgs.data(), static_cast<unsigned>(n),
+                                   MSG_DONTWAIT | MSG_NOSIGNAL
+                                   | (is_zerocopy ? MSG_ZEROCOPY : 0));
+        if (n_tx < 0 && is_zerocopy && errno == ENOBUFS) {
+            // no more pages can be pinned for now; the rest are copied
+            is_zerocopy_ok = false;
+            continue;
+        }
+        if (n_tx < 0 && is_gso && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT)) {
+            // the route's device can't segment after all; send the rest one datagram at a time
+            logger.logf("% <McastSocket::%> UDP GSO failed at socket %, error: %; sending "
+                        "datagrams singly\n", LL::get_time_str(&t_str), __FUNCTION__, fd,
+                        std::strerror(errno));
+            is_gso = false;
+            continue;
+        }
+        if (n_tx <= 0)
+            break;
+        tx_completions.on_sent(static_cast<uint32_t>(n_tx),
+                               is_zerocopy ? static_cast<uint32_t>(n_tx) : 0);
+        if (is_zerocopy)
+            n_zerocopy += static_cast<size_t>(n_tx);
+        for (int i{ }; i < n_tx; ++i)
+            n_sent += is_gso ? gso_runs[static_cast<size_t>(i)] : 1;
+        if (static_cast<size_t>(n_tx) < n)
+            break;
+    }
+    logger.logf("% <McastSocket::%> TX at socket %, datagrams: % of %, size: %, "
+                "zerocopy sends: %\n", LL::get_time_str(&t_str), __FUNCTION__, fd, n_sent,
+                n_datagrams, i_tx_next - i_tx_start, n_zerocopy);
+    // as with a single send(), whatever the kernel wouldn't take is dropped
+    complete_tx();
+}
+
+auto McastSocket::receive() noexcept -> bool {
+    if (ring != nullptr) {
+        ring->reap();
+        if (!has_ring_rx)
+            return false;
+        has_ring_rx = false;
         logger.logf("% <McastSocket::%> RX at socket %, size: %\n",
-                    LL::get_time_str(&t_str), __FUNCTION__, fd, i_rx_next);
-        // callback when data is available to read
-        rx_callback(this);
+                    LL::get_time_str(&t_str), __FUNCTION__, fd, rx_buffer.size());
+        t_rx_last = t_ring_rx;
+        return true;
+    }
+    if (xdp != nullptr || packet_ring != nullptr)
+        return shared_rx();
+    if (batching.n_batch)
+        return rx_batch();
+    // non-blocking read, along with the datagram's kernel timestamp
+    TimestampControl ctrl;
+    iovec iov{ rx_buffer.write_ptr(), rx_buffer.get_n_free() };
+    msghdr msg{ nullptr, 0, &iov, 1, ctrl.buffer, sizeof(ctrl.buffer), 0 };
+    const auto rx_size = recvmsg(fd, &msg, MSG_DONTWAIT);
+    if (rx_size <= 0)
+        return false;
+    if (msg.msg_flags & MSG_TRUNC) [[unlikely]] {
+        logger.logf("% <McastSocket::%> dropping datagram larger than the % bytes free at "
+                    "socket %\n", LL::get_time_str(&t_str), __FUNCTION__, iov.iov_len, fd);
+        return false;
     }
+    rx_buffer.commit(rx_size);
+    logger.logf("% <McastSocket::%> RX at socket %, size: %\n",
+                LL::get_time_str(&t_str), __FUNCTION__, fd, rx_buffer.size());
+    t_rx_last = get_timestamp(msg);
+    return true;
+}
 
+void McastSocket::transmit() noexcept {
+    if (ring != nullptr) {
+        ring_tx();
+        return;
+    }
+    if (xdp != nullptr) {
+        end_datagram();
+        if (i_tx_next > i_tx_start)
+            xdp_tx();
+        return;
+    }
+    if (batching.n_batch) {
+        end_datagram();
+        if (!tx_datagram_ends.empty())
+            tx_batch();
+        else if (tx_completions.is_pending())
+            read_tx_completions();
+        return;
+    }
     // transmit outgoing data to stream
-    if (i_tx_next > 0) {
+    const auto len = i_tx_next - i_tx_start;
+    if (len > 0) {
         // we don't have to use sendto() with this multicast socket since
         //  the call to create_socket() already calls connect() on the
         //  multicast group this socket belongs to. If the design changes
         //  it may be necessary to use sendto() here instead.
-        const auto n = send(fd, tx_buffer.data(), i_tx_next,
-                            MSG_DONTWAIT | MSG_NOSIGNAL);
-        logger.logf("% <McastSocket::%> TX at socket %, size: %\n",
-                    LL::get_time_str(&t_str), __FUNCTION__, fd, n);
+        auto is_zerocopy = tx_completions.is_zerocopy_send(i_tx_start, i_tx_next,
+                                                           MCAST_BUFFER_SIZE);
+        auto n = send(fd, tx_buffer.data() + i_tx_start, len,
+                      MSG_DONTWAIT | MSG_NOSIGNAL | (is_zerocopy ? MSG_ZEROCOPY : 0));
+        if (n == -1 && is_zerocopy && errno == ENOBUFS) {
+            // no more pages can be pinned for now; this send is copied
+            is_zerocopy = false;
+            n = send(fd, tx_buffer.data() + i_tx_start, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        }
+        logger.logf("% <McastSocket::%> TX at socket %, size: %, zerocopy: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, fd, n, is_zerocopy);
+        if (n > 0)
+            tx_completions.on_sent(1, is_zerocopy);
     }
 
-    // clear tx buffer and return number of rx waiting to be read
-    i_tx_next = 0;
-    return (rx_size > 0);
+    // clear tx buffer, holding on to whatever zerocopy sends are still using
+    complete_tx();
 }
 
 }
@@ -13,28 +13,74 @@
 #pragma once
 
 
+#include <algorithm>
 #include <functional>
 #include <vector>
 #include <string>
 #include "sockets.h"
 #include "logging.h"
+#include "ring_buffer.h"
+#include "io_ring.h"
+#include "packet_ring.h"
+#include "xdp_socket.h"
 
 
 namespace LL
 {
 constexpr size_t MCAST_BUFFER_SIZE{ 64 * 1024 * 1024 };
+constexpr size_t MCAST_BATCH_SIZE{ 64 };        // datagrams per batched call
+constexpr size_t MCAST_DATAGRAM_SIZE{ 1472 };   // UDP payload which fits a 1500 byte MTU
+constexpr size_t MCAST_GSO_SEGMENTS{ 64 };      // datagrams the kernel segments from one send
+constexpr size_t MCAST_MAX_PAYLOAD{ 65507 };    // largest UDP payload
+constexpr size_t MCAST_GSO_SIZE{ MCAST_MAX_PAYLOAD };   // largest UDP payload for one GSO send
+
+
+/**
+ * @brief Batched datagram I/O for an McastSocket
+ */
+struct McastBatchConfig {
+    // datagrams received per recvmmsg() and sent per sendmmsg(); 0 keeps to a single recv()
+    //  and a single send() of the whole tx buffer per tx_and_rx()
+    size_t n_batch{ 0 };
+    size_t size_datagram{ MCAST_DATAGRAM_SIZE };    // largest datagram received
+    // end_datagram() sends once this many datagrams are queued; 0 waits for tx_and_rx()
+    size_t n_tx_flush{ 0 };
+    // runs of queued datagrams of equal size are handed to the kernel as one buffer, which it
+    //  segments (UDP_SEGMENT), where the kernel supports it
+    bool is_gso{ false };
+};
+// batches of up to MCAST_BATCH_SIZE sends each way, sent as soon as a batch is queued, with
+//  each run of equal sized datagrams in a single GSO send
+constexpr McastBatchConfig MCAST_BATCHED{ MCAST_BATCH_SIZE, MCAST_DATAGRAM_SIZE,
+                                          MCAST_BATCH_SIZE, true };
+
+// what a multicast stream's datagrams are sent and received through
+enum class McastTransport : uint8_t {
+    SOCKET,         // the socket's own syscalls
+    PACKET_RING,    // received from a PacketRing on the interface; sent by the socket
+    XDP             // sent and received through an XdpSocket on the interface
+};
 
 
 class McastSocket {
 public:
     /**
      * @brief UDP Multicast socket
+     * @param batching Send and receive many datagrams per syscall when batching.n_batch > 0
      */
-    explicit McastSocket(Logger& logger) : logger(logger) {
+    explicit McastSocket(Logger& logger, const McastBatchConfig& batching = { })
+            : rx_buffer(MCAST_BUFFER_SIZE), batching(batching), logger(logger) {
         tx_buffer.resize(MCAST_BUFFER_SIZE);
-        rx_buffer.resize(MCAST_BUFFER_SIZE);
+        msgs.resize(batching.n_batch);
+        iovs.resize(batching.n_batch);
+        rx_controls.resize(batching.n_batch);
+        if (batching.is_gso) {
+            gso_controls.resize(batching.n_batch);
+            gso_runs.resize(batching.n_batch);
+        }
     }
     ~McastSocket() {
+        detach();
         if (fd)
             close(fd);
     }
@@ -50,6 +96,16 @@ public:
      */
     auto init(const std::string& ip, const std::string& iface,
               int port, bool is_listening) -> int;
+    /**
+     * @brief Whether queued datagrams are being sent with UDP generic segmentation offload
+     */
+    [[nodiscard]] inline auto get_is_gso() const noexcept { return is_gso; }
+    /**
+     * @brief Number of sends made with MSG_ZEROCOPY since it was enabled
+     */
+    [[nodiscard]] inline auto get_n_zerocopy_sent() const noexcept {
+        return tx_completions.n_zerocopy_sent;
+    }
     /**
      * @brief Join a multicast group
      * @param ip Multicast IP address identifier
@@ -66,25 +122,160 @@ public:
      * @param len Length of given data
      */
     void load_tx(const void* data, size_t len) noexcept;
+    /**
+     * @brief End the datagram being loaded, so that it's sent on its own when batching or
+     * attached to an IORing, and send the queued datagrams once n_tx_flush of them are
+     * waiting. Otherwise a no-op.
+     */
+    void end_datagram() noexcept;
+    /**
+     * @brief Hand the socket's sends and receives to an io_uring instance, instead of making
+     * its own syscalls. Received datagrams are copied onto the end of rx_buffer by the ring.
+     * Each datagram is queued to the ring as a send of its own: those ended with
+     * end_datagram(), and whatever was loaded since at each tx. Datagrams larger than the
+     * largest UDP payload are dropped.
+     * @return False if the ring has no room for the socket, which then keeps to its syscalls
+     */
+    auto attach(IORing& ring) noexcept -> bool;
+    /**
+     * @brief Receive the datagrams sent to the given group and port from a packet ring,
+     * instead of from the socket. The socket stays joined to the group, so that the host keeps
+     * receiving it, but the kernel discards its own copies. Received payloads are copied onto
+     * the end of rx_buffer as with batching; sends are unchanged.
+     * @return False if the ring has no room for the flow, and the socket keeps to its syscalls
+     */
+    auto attach(PacketRing& ring, const std::string& ip, int port) -> bool;
+    /**
+     * @brief Send and receive the socket's datagrams through an AF_XDP socket, bypassing the
+     * kernel's network stack. The socket stays joined to its group, so that the interface
+     * keeps accepting it. Received payloads are copied onto the end of rx_buffer as with
+     * batching, and each datagram loaded (or the whole tx buffer, when not batching) is sent
+     * in a frame of its own.
+     * @param is_listening Receive the group's datagrams too, not only send them
+     * @return False if the XDP socket has no room for the flow, and the socket keeps to its
+     * syscalls
+     */
+    auto attach(XdpSocket& xsk, const std::string& ip, int port, bool is_listening) -> bool;
+    /**
+     * @brief Have the kernel stamp each send as it leaves for the interface, and report the
+     * stamps to tx_timestamp_callback from tx_and_rx()
+     * @details Sends are keyed by their count from here on: one per datagram, or one per run
+     * of datagrams sent together with GSO, which is stamped as a whole. Sends made through an
+     * IORing or XdpSocket aren't stamped.
+     * @return True when successful
+     */
+    auto enable_tx_timestamps() noexcept -> bool;
+    /**
+     * @brief Send each message of at least size_min with MSG_ZEROCOPY, so that the kernel
+     * reads datagrams straight from tx_buffer instead of copying them
+     * @details A message is a single datagram, a GSO run of them, or the whole tx buffer when
+     * not batching. The data sent then stays where it is in tx_buffer, with whatever's loaded
+     * after it following on, until the kernel has finished with it and the buffer is rewound.
+     * Worth it for large sends, such as long GSO runs; small ones are still copied, as are
+     * those from past the middle of the buffer, which leave it room to rewind. Sends made
+     * through an IORing or XdpSocket are unaffected.
+     * @return True when successful
+     */
+    auto enable_zerocopy(size_t size_min = ZEROCOPY_SIZE_MIN) noexcept -> bool;
     /**
      * @brief Publish tx and rx data to buffers. Dispatches an rx_callback if needed.
+     * @details The rx_callback reads records in place from rx_buffer.data() and consume()s
+     * those it has handled. Any partial record is left for the next call. When batching,
+     * datagrams received together are packed one after another in rx_buffer, and every
+     * datagram loaded is sent, the last one being ended if it hasn't been.
      * @return True when data is ready to read in rx_buffer
      */
-    auto tx_and_rx() noexcept -> bool;
+    inline auto tx_and_rx() noexcept -> bool { return tx_and_rx(rx_callback); }
+    /**
+     * @brief Publish tx and rx data to buffers, dispatching to on_rx instead of the
+     * rx_callback
+     * @details The handler's type is known here, so its call (and whatever parsing it does)
+     * can be inlined into the caller's receive loop, rather than made through a
+     * std::function.
+     * @param on_rx Called as on_rx(McastSocket*, Nanos t_rx), exactly as the rx_callback is
+     */
+    template<typename Handler>
+    inline auto tx_and_rx(Handler&& on_rx) noexcept -> bool {
+        const auto is_rx = receive();
+        if (is_rx)
+            on_rx(this, t_rx_last);
+        transmit();
+        return is_rx;
+    }
 
     std::vector<char> tx_buffer{ };  // transmit data buffer
     size_t i_tx_next{ };             // index of next element to transmit
+    // start of what's yet to be sent; data before it is held by zerocopy sends in flight
+    size_t i_tx_start{ };
+    // end of each datagram queued, when batching or attached to an IORing
+    std::vector<size_t> tx_datagram_ends{ };
 
-    std::vector<char> rx_buffer{ };  // receive data buffer
-    size_t i_rx_next{ };             // index of next element to receive
-    std::function<void(McastSocket* socket)> rx_callback{ nullptr };
+    RingBuffer rx_buffer;            // receive data buffer
+    // t_rx is the kernel's (nanosecond) timestamp of the first datagram received; those
+    //  delivered by an IORing, PacketRing or XdpSocket are stamped as they're handed over
+    std::function<void(McastSocket* socket, Nanos t_rx)> rx_callback{ nullptr };
+    // called with the id and kernel timestamp of each send stamped, once enabled
+    std::function<void(McastSocket* socket, uint32_t id, Nanos t_tx)> tx_timestamp_callback{
+            nullptr };
 
     int fd{ -1 }; // file descriptor for socket
+    SocketTuning tuning{ };     // applied by init()
 
 private:
+    const McastBatchConfig batching;
+    std::vector<mmsghdr> msgs;      // a header and an iovec per datagram in a batched call
+    std::vector<iovec> iovs;
+    std::vector<TimestampControl> rx_controls;  // the kernel timestamp of each datagram read
+    // the segment size control message of each GSO send, and the datagrams it carries
+    union GSOControl {
+        char buffer[CMSG_SPACE(sizeof(uint16_t))];
+        cmsghdr align;
+    };
+    std::vector<GSOControl> gso_controls;
+    std::vector<size_t> gso_runs;
+    bool is_gso{ false };           // configured, and supported by the kernel for this socket
     std::string t_str;
     Logger& logger;
 
+    IORing* ring{ nullptr };    // the ring the socket is attached to, if any
+    int i_ring_slot{ -1 };
+    size_t n_tx_in_flight{ };   // bytes at the front of tx_buffer the ring is sending
+    size_t n_tx_sends_in_flight{ };     // sends of those bytes the ring hasn't completed
+    bool has_ring_rx{ false };  // the ring delivered data which hasn't been dispatched yet
+    Nanos t_ring_rx{ };
+    Nanos t_rx_last{ };         // of the data the last receive() read, to be dispatched
+    PacketRing* packet_ring{ nullptr };     // the packet ring the socket receives from, if any
+    int i_packet_flow{ -1 };
+    XdpSocket* xdp{ nullptr };  // the XDP socket the socket sends and receives through, if any
+    int i_xdp_flow{ -1 };
+    in_addr group_xdp{ };       // the group sent to through the XDP socket
+    int port_xdp{ };
+
+    TxCompletions tx_completions{ };    // sends still to be stamped or completed, in datagrams
+
+    void detach() noexcept;
+    void read_tx_completions() noexcept;
+    void complete_tx() noexcept;
+    /**
+     * @brief Read into rx_buffer by whichever means the socket receives, without
+     * dispatching, noting the data's time in t_rx_last
+     * @return True when there's data to dispatch
+     */
+    auto receive() noexcept -> bool;
+    /**
+     * @brief Send everything loaded by whichever means the socket sends
+     */
+    void transmit() noexcept;
+    auto rx_batch() noexcept -> bool;
+    auto rx_to_buffer(const char* data, size_t len) noexcept -> bool;
+    auto shared_rx() noexcept -> bool;
+    void xdp_tx() noexcept;
+    void ring_tx() noexcept;
+    void release_ring_tx() noexcept;
+    void tx_batch() noexcept;
+    // number of queued datagrams from i_datagram on which can go out in a single GSO send
+    [[nodiscard]] auto get_gso_run(size_t i_datagram) const noexcept -> size_t;
+
 DELETE_DEFAULT_COPY_AND_MOVE(McastSocket)
 };
 }
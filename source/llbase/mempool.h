@@ -110,8 +110,9 @@ private:
                 i_next_free = 0;
             }
             if (i == i_next_free) [[unlikely]] {
-                // there are better methods to handle this in production
-                ASSERT(i != i_next_free, "<MemPool> memory pool overrun");
+                // there are better methods to handle this in production, but searching on
+                //  would never end, so this must also fail in release builds
+                FATAL("<MemPool> memory pool overrun");
             }
         }
     }
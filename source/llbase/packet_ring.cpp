@@ -0,0 +1,237 @@
+#include "packet_ring.h"
+
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+namespace LL
+{
+namespace
+{
+constexpr size_t SIZE_UDP_HEADER{ 8 };
+template<typename T>
+inline auto load_be(const char* p) noexcept -> T {
+    T v;
+    memcpy(&v, p, sizeof(v));
+    if constexpr (sizeof(T) == 2)
+        return ntohs(v);
+    else
+        return ntohl(v);
+}
+}
+
+
+auto PacketRing::create(Logger& logger, const std::string& iface, const PacketRingConfig& conf)
+        -> std::unique_ptr<PacketRing> {
+    std::unique_ptr<PacketRing> ring{ new PacketRing(logger, conf) };
+    if (!ring->init(iface))
+        return nullptr;
+    return ring;
+}
+
+PacketRing::PacketRing(Logger& logger, const PacketRingConfig& conf)
+        : logger(logger), conf(conf) { }
+
+auto PacketRing::init(const std::string& iface) -> bool {
+    const auto size_page = static_cast<uint32_t>(sysconf(_SC_PAGESIZE));
+    VERIFY(conf.size_block && (conf.size_block & (conf.size_block - 1)) == 0
+                   && conf.size_block % size_page == 0,
+           "<PacketRing> size_block must be a power of two multiple of the page size");
+    VERIFY(conf.size_frame && conf.size_frame % TPACKET_ALIGNMENT == 0
+                   && conf.size_frame <= conf.size_block,
+           "<PacketRing> size_frame must be aligned to TPACKET_ALIGNMENT and fit a block");
+    const auto fail = [this](const char* what) {
+        logger.logf("% <PacketRing::%> % failed, error: %; falling back to socket syscalls\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, what,
+                    std::string(std::strerror(errno)));
+        return false;
+    };
+    const auto i_iface = if_nametoindex(iface.c_str());
+    if (!i_iface)
+        return fail("if_nametoindex()");
+    // no protocol yet, so nothing is received until the filter's in place and it's bound
+    fd = socket(AF_PACKET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (fd < 0)
+        return fail("socket(AF_PACKET)");
+    int version{ TPACKET_V3 };
+    if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+        return fail("setsockopt(PACKET_VERSION)");
+    tpacket_req3 req{ };
+    req.tp_block_size = conf.size_block;
+    req.tp_block_nr = conf.n_blocks;
+    req.tp_frame_size = conf.size_frame;
+    req.tp_frame_nr = conf.size_block / conf.size_frame * conf.n_blocks;
+    req.tp_retire_blk_tov = conf.block_timeout_ms;
+    if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0)
+        return fail("setsockopt(PACKET_RX_RING)");
+    size_ring = static_cast<size_t>(conf.size_block) * conf.n_blocks;
+    auto mapped = mmap(nullptr, size_ring, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (mapped == MAP_FAILED)
+        return fail("mmap() of ring");
+    blocks = static_cast<char*>(mapped);
+    if (!update_filter())
+        return fail("setsockopt(SO_ATTACH_FILTER)");
+    // packets the IP layer has consumed are seen by the ring; the link header is stripped
+    sockaddr_ll addr{ };
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_IP);
+    addr.sll_ifindex = static_cast<int>(i_iface);
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0)
+        return fail("bind()");
+    logger.logf("% <PacketRing::%> ring fd: %, iface: %, blocks: % of % bytes\n",
+                LL::get_time_str(&t_str), __FUNCTION__, fd, iface, conf.n_blocks,
+                conf.size_block);
+    return true;
+}
+
+PacketRing::~PacketRing() {
+    if (fd >= 0)
+        close(fd);
+    if (blocks)
+        munmap(blocks, size_ring);
+}
+
+auto PacketRing::attach(const std::string& ip, int port, RxHandler on_rx) -> int {
+    in_addr addr{ };
+    VERIFY(inet_pton(AF_INET, ip.c_str(), &addr) == 1,
+           "<PacketRing> invalid IPv4 address: " + ip);
+    if (n_flows >= MAX_FLOWS)
+        return -1;
+    size_t i_flow{ };
+    while (i_flow < flows.size() && flows[i_flow].is_attached)
+        ++i_flow;
+    if (i_flow == flows.size())
+        flows.emplace_back();
+    flows[i_flow] = { ntohl(addr.s_addr), static_cast<uint16_t>(port), std::move(on_rx), true };
+    ++n_flows;
+    if (!update_filter()) {
+        logger.logf("% <PacketRing::%> filter update failed, error: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, std::string(std::strerror(errno)));
+        flows[i_flow] = { };
+        --n_flows;
+        return -1;
+    }
+    logger.logf("% <PacketRing::%> flow % attached: %:%\n", LL::get_time_str(&t_str),
+                __FUNCTION__, i_flow, ip, port);
+    return static_cast<int>(i_flow);
+}
+
+void PacketRing::detach(int i_flow) {
+    auto& flow = flows[static_cast<size_t>(i_flow)];
+    if (!flow.is_attached)
+        return;
+    // any of its packets already in the ring find no flow, and are skipped
+    flow = { };
+    --n_flows;
+    update_filter();
+    logger.logf("% <PacketRing::%> flow % detached\n", LL::get_time_str(&t_str),
+                __FUNCTION__, i_flow);
+}
+
+auto PacketRing::update_filter() noexcept -> bool {
+    // packets start at their IP header. Non-UDP packets and fragments (more fragments set,
+    //  or a fragment offset) are dropped, then each flow's destination address and port are
+    //  checked in turn:
+    //      ldb [9]; jeq #UDP; ldh [6]; jset #0x3fff; ldxb 4*([0]&0xf)
+    //      (ld [16]; jeq #ip; ldh [x+2]; jeq #port -> accept) for each flow
+    //      ret #0 (drop); ret #0xffff (accept)
+    std::vector<sock_filter> program;
+    const auto i_drop = static_cast<uint8_t>(5 + 4 * n_flows);
+    const auto jump_to = [&program](uint8_t i_target) {
+        return static_cast<uint8_t>(i_target - program.size() - 1);
+    };
+    program.push_back(BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 9));
+    program.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, jump_to(i_drop)));
+    program.push_back(BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 6));
+    program.push_back(BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x3fff, jump_to(i_drop), 0));
+    program.push_back(BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0));
+    for (const auto& flow: flows) {
+        if (!flow.is_attached)
+            continue;
+        program.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 16));
+        program.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, flow.ip, 0, 2));
+        program.push_back(BPF_STMT(BPF_LD | BPF_H | BPF_IND, 2));
+        program.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, flow.port,
+                                   jump_to(static_cast<uint8_t>(i_drop + 1)), 0));
+    }
+    program.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+    program.push_back(BPF_STMT(BPF_RET | BPF_K, 0xffff));
+    const sock_fprog fprog{ static_cast<unsigned short>(program.size()), program.data() };
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) == 0;
+}
+
+auto PacketRing::find_flow(const char* packet, size_t len, const char** payload,
+                           size_t* len_payload) const noexcept -> int {
+    if (len < 20) [[unlikely]]
+        return -1;
+    const auto size_ip_header = static_cast<size_t>(packet[0] & 0xf) * 4;
+    if (len < size_ip_header + SIZE_UDP_HEADER) [[unlikely]]
+        return -1;
+    const auto ip = load_be<uint32_t>(packet + 16);
+    const auto udp = packet + size_ip_header;
+    const auto port = load_be<uint16_t>(udp + 2);
+    // the UDP length excludes any padding the link added
+    const auto len_udp = static_cast<size_t>(load_be<uint16_t>(udp + 4));
+    if (len_udp < SIZE_UDP_HEADER || size_ip_header + len_udp > len) [[unlikely]]
+        return -1;
+    for (size_t i{ }; i < flows.size(); ++i) {
+        if (flows[i].is_attached && flows[i].ip == ip && flows[i].port == port) {
+            *payload = udp + SIZE_UDP_HEADER;
+            *len_payload = len_udp - SIZE_UDP_HEADER;
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+auto PacketRing::poll() noexcept -> size_t {
+    size_t n_delivered{ };
+    for (uint32_t n{ }; n < conf.n_blocks; ++n) {
+        auto block = reinterpret_cast<tpacket_block_desc*>(
+                blocks + static_cast<size_t>(i_block) * conf.size_block);
+        auto& bh = block->hdr.bh1;
+        if (!(__atomic_load_n(&bh.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+            break;
+        if (!i_packet)
+            offset_packet = bh.offset_to_first_pkt;
+        for (; i_packet < bh.num_pkts; ++i_packet) {
+            const auto hdr = reinterpret_cast<const tpacket3_hdr*>(
+                    reinterpret_cast<const char*>(block) + offset_packet);
+            const char* payload{ nullptr };
+            size_t len{ };
+            const auto i_flow = find_flow(reinterpret_cast<const char*>(hdr) + hdr->tp_net,
+                                          hdr->tp_snaplen, &payload, &len);
+            if (i_flow >= 0) {
+                // no room; the block is kept, and delivery resumes here next time
+                if (!flows[static_cast<size_t>(i_flow)].on_rx(payload, len))
+                    return n_delivered;
+                ++n_delivered;
+            }
+            offset_packet += hdr->tp_next_offset;
+        }
+        // every payload in the block has been delivered; it's the kernel's again
+        i_packet = 0;
+        __atomic_store_n(&bh.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        i_block = (i_block + 1) % conf.n_blocks;
+    }
+    return n_delivered;
+}
+
+auto PacketRing::get_n_dropped() noexcept -> size_t {
+    tpacket_stats_v3 stats{ };
+    socklen_t len{ sizeof(stats) };
+    if (getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) < 0)
+        return 0;
+    return stats.tp_drops;
+}
+
+}
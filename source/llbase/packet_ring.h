@@ -0,0 +1,123 @@
+/**
+ *
+ *  Low-latency C++ Utilities
+ *
+ *  @file packet_ring.h
+ *  @brief A memory-mapped AF_PACKET receive ring for UDP feeds
+ *  @author Stacy Gaudreau
+ *  @date 2025.02.13
+ *
+ */
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <linux/if_packet.h>
+
+#include "macros.h"
+#include "logging.h"
+
+
+namespace LL
+{
+struct PacketRingConfig {
+    uint32_t size_block{ 1 << 20 };     // a power of two multiple of the page size
+    uint32_t n_blocks{ 64 };
+    uint32_t size_frame{ 2048 };        // nominal; TPACKET_V3 packs packets by their length
+    uint32_t block_timeout_ms{ 1 };     // a partly filled block is handed over after this long
+};
+
+
+/**
+ * @brief An AF_PACKET socket whose TPACKET_V3 receive ring is mapped into user space, from
+ * which the UDP payloads of a set of flows (destination address and port) are handed to each
+ * flow's handler without a syscall per packet.
+ * @details The kernel copies every IPv4 packet the interface receives which passes a BPF
+ * filter built from the attached flows into blocks of the ring, and hands a block over once
+ * it's full or block_timeout_ms has passed since its first packet. poll() walks the blocks the
+ * kernel has handed over by reading their status from shared memory, and returns each to the
+ * kernel once every payload in it has been delivered.
+ *
+ * The ring sees packets at the interface, so the host must still be a member of any multicast
+ * group it reads (ie: a UDP socket joined to it), and packets this host sends to a multicast
+ * group it belongs to are looped back to it in the IP layer without passing through the ring.
+ * Works on any interface with an IPv4 link, including loopback and veth. Needs CAP_NET_RAW.
+ *
+ * Not thread safe; owned by the thread which polls the sockets attached to it.
+ */
+class PacketRing {
+public:
+    // a flow's UDP payload; returns false when there's no room for it yet, and it's offered
+    //  again (in order, before anything newer for any flow) at the next poll()
+    using RxHandler = std::function<bool(const char* data, size_t len)>;
+    static constexpr size_t MAX_FLOWS{ 60 };   // as many as the BPF filter's jumps can reach
+
+    /**
+     * @brief Open a receive ring on the given interface
+     * @return The ring, or nullptr if it can't be set up (eg: without CAP_NET_RAW), in which
+     * case sockets should keep to their own syscalls
+     */
+    [[nodiscard]] static auto create(Logger& logger, const std::string& iface,
+                                     const PacketRingConfig& conf = { })
+            -> std::unique_ptr<PacketRing>;
+    ~PacketRing();
+
+    /**
+     * @brief Deliver the UDP payloads sent to the given address and port to a handler
+     * @return The flow's index, or -1 if there are already MAX_FLOWS
+     */
+    auto attach(const std::string& ip, int port, RxHandler on_rx) -> int;
+    /**
+     * @brief Stop delivering a flow's payloads. Its handler is not called again.
+     */
+    void detach(int i_flow);
+    /**
+     * @brief Deliver every payload in the blocks the kernel has handed over
+     * @return Number of payloads delivered
+     */
+    auto poll() noexcept -> size_t;
+
+    [[nodiscard]] inline auto get_n_flows() const noexcept { return n_flows; }
+    /**
+     * @brief Packets the kernel dropped for want of a free block, since the last call
+     */
+    [[nodiscard]] auto get_n_dropped() noexcept -> size_t;
+
+private:
+    PacketRing(Logger& logger, const PacketRingConfig& conf);
+    auto init(const std::string& iface) -> bool;
+    auto update_filter() noexcept -> bool;
+    auto find_flow(const char* packet, size_t len, const char** payload,
+                   size_t* len_payload) const noexcept -> int;
+
+    struct Flow {
+        uint32_t ip{ };                 // host byte order
+        uint16_t port{ };
+        RxHandler on_rx;
+        bool is_attached{ false };
+    };
+
+    Logger& logger;
+    std::string t_str;
+    const PacketRingConfig conf;
+    int fd{ -1 };
+
+    char* blocks{ nullptr };            // the ring, mapped from the kernel
+    size_t size_ring{ };
+    uint32_t i_block{ };                // next block to be handed over
+    // where delivery stopped in the current block, when a handler had no room
+    uint32_t i_packet{ };
+    uint32_t offset_packet{ };
+
+    std::vector<Flow> flows;
+    size_t n_flows{ };
+
+DELETE_DEFAULT_COPY_AND_MOVE(PacketRing)
+};
+}
@@ -0,0 +1,115 @@
+/**
+ *
+ *  Low-latency C++ Utilities
+ *
+ *  @file ring_buffer.h
+ *  @brief Virtual memory mirrored ring buffer for socket receive paths
+ *  @author Stacy Gaudreau
+ *  @date 2025.02.09
+ *
+ */
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "macros.h"
+
+
+namespace LL
+{
+/** @brief The kernel's page size, which is not always 4K (eg: 16K or 64K on arm64 and ppc64le) */
+inline auto get_page_size() noexcept -> size_t {
+    static const auto size_page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size_page;
+}
+
+/**
+ * @brief A byte ring buffer whose memory is mapped twice, back to back, so that any run of
+ * up to capacity bytes starting anywhere in the ring is contiguous in memory.
+ * @details The writer receives directly into write_ptr() and commits what it wrote; readers
+ * consume records in place from data() and advance past them with consume(). Records never
+ * straddle the wrap and partial records are simply left in place for the next read, so
+ * nothing is ever copied or compacted. Not thread safe; owned by a single socket's thread.
+ */
+class RingBuffer final {
+public:
+    /**
+     * @param capacity Size of the ring in bytes; a power of two and a multiple of the page size
+     */
+    explicit RingBuffer(size_t capacity) : capacity(capacity), mask(capacity - 1) {
+        VERIFY(capacity && (capacity & mask) == 0,
+               "<RingBuffer> capacity must be a power of two");
+        VERIFY(capacity % get_page_size() == 0,
+               "<RingBuffer> capacity must be a multiple of the page size");
+        const auto fd = memfd_create("LL::RingBuffer", 0);
+        VERIFY(fd != -1, "<RingBuffer> memfd_create() failed! error: "
+                + std::string(std::strerror(errno)));
+        VERIFY(ftruncate(fd, static_cast<off_t>(capacity)) == 0,
+               "<RingBuffer> ftruncate() failed! error: " + std::string(std::strerror(errno)));
+        // reserve twice the capacity, then map the same pages over both halves
+        auto region = mmap(nullptr, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS,
+                           -1, 0);
+        VERIFY(region != MAP_FAILED, "<RingBuffer> mmap() reserve failed! error: "
+                + std::string(std::strerror(errno)));
+        buffer = static_cast<char*>(region);
+        for (auto half: { buffer, buffer + capacity }) {
+            auto mapped = mmap(half, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                               fd, 0);
+            VERIFY(mapped == half, "<RingBuffer> mmap() mirror failed! error: "
+                    + std::string(std::strerror(errno)));
+        }
+        close(fd);
+    }
+    ~RingBuffer() {
+        munmap(buffer, 2 * capacity);
+    }
+
+    /** @brief Start of the unread data, contiguous for size() bytes */
+    [[nodiscard]] inline auto data() const noexcept -> const char* {
+        return buffer + (i_read & mask);
+    }
+    /** @brief Number of unread bytes */
+    [[nodiscard]] inline auto size() const noexcept -> size_t { return i_write - i_read; }
+    [[nodiscard]] inline auto empty() const noexcept { return i_write == i_read; }
+    /** @brief Advance past n bytes which have been read */
+    inline void consume(size_t n) noexcept {
+        ASSERT(n <= size(), "<RingBuffer> consumed more than was available");
+        i_read += n;
+    }
+    /** @brief Discard all unread data */
+    inline void clear() noexcept { i_read = i_write; }
+
+    /** @brief Where to write the next data, contiguous for get_n_free() bytes */
+    [[nodiscard]] inline auto write_ptr() noexcept -> char* {
+        return buffer + (i_write & mask);
+    }
+    /** @brief Number of bytes which can be written before the ring is full */
+    [[nodiscard]] inline auto get_n_free() const noexcept -> size_t {
+        return capacity - size();
+    }
+    /** @brief Make n bytes written at write_ptr() available to read */
+    inline void commit(size_t n) noexcept {
+        ASSERT(n <= get_n_free(), "<RingBuffer> committed more than was free");
+        i_write += n;
+    }
+
+    [[nodiscard]] inline auto get_capacity() const noexcept { return capacity; }
+
+private:
+    const size_t capacity;
+    const size_t mask;
+    char* buffer{ nullptr };
+    // monotonic read/write positions; only their offset into the ring wraps
+    uint64_t i_read{ 0 };
+    uint64_t i_write{ 0 };
+
+DELETE_DEFAULT_COPY_AND_MOVE(RingBuffer)
+};
+}
@@ -0,0 +1,438 @@
+#include "shm_transport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace LL
+{
+namespace
+{
+// copy in and out of a ring of the given size, wrapping around its end
+inline void copy_to_ring(char* ring, size_t size, uint64_t i, const char* src,
+                         size_t len) noexcept {
+    const auto i_wrap = i % size;
+    const auto n_first = std::min(len, size - i_wrap);
+    memcpy(ring + i_wrap, src, n_first);
+    memcpy(ring, src + n_first, len - n_first);
+}
+
+inline void copy_from_ring(const char* ring, size_t size, uint64_t i, char* dst,
+                           size_t len) noexcept {
+    const auto i_wrap = i % size;
+    const auto n_first = std::min(len, size - i_wrap);
+    memcpy(dst, ring + i_wrap, n_first);
+    memcpy(dst + n_first, ring, len - n_first);
+}
+
+/**
+ * @brief Open (or create) a named region of shared memory and map it
+ * @return The region's descriptor and mapping, or -1 and nullptr on failure
+ */
+auto map_region(const std::string& name, size_t size, int flags)
+        -> std::pair<int, void*> {
+    const auto fd = shm_open(name.c_str(), flags | O_RDWR, 0600);
+    if (fd == -1)
+        return { -1, nullptr };
+    const auto fail = [fd]() -> std::pair<int, void*> {
+        close(fd);
+        return { -1, nullptr };
+    };
+    struct stat st{ };
+    if (fstat(fd, &st) == -1)
+        return fail();
+    if (st.st_size == 0 && (flags & O_CREAT)) {
+        // a new region is sized (and so zeroed) by whoever opens it first
+        if (ftruncate(fd, static_cast<off_t>(size)) == -1)
+            return fail();
+    } else if (static_cast<size_t>(st.st_size) != size) {
+        errno = EINVAL;
+        return fail();
+    }
+    auto region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (region == MAP_FAILED)
+        return fail();
+    return { fd, region };
+}
+
+inline auto get_stream_name(int port) {
+    return "/LL.shm." + std::to_string(port);
+}
+
+inline auto get_mcast_name(const std::string& ip, int port) {
+    return "/LL.mcast." + ip + "." + std::to_string(port);
+}
+}
+
+
+auto ShmByteRing::write(const char* src, size_t len) noexcept -> size_t {
+    const auto i_w = i_write.load(std::memory_order_relaxed);
+    const auto n_free = SHM_STREAM_SIZE - (i_w - i_read.load(std::memory_order_acquire));
+    const auto n = std::min(len, n_free);
+    copy_to_ring(data, SHM_STREAM_SIZE, i_w, src, n);
+    i_write.store(i_w + n, std::memory_order_release);
+    return n;
+}
+
+auto ShmByteRing::read(char* dst, size_t len) noexcept -> size_t {
+    const auto i_r = i_read.load(std::memory_order_relaxed);
+    const auto n = std::min(len, i_write.load(std::memory_order_acquire) - i_r);
+    copy_from_ring(data, SHM_STREAM_SIZE, i_r, dst, n);
+    i_read.store(i_r + n, std::memory_order_release);
+    return n;
+}
+
+
+ShmSocket::ShmSocket(Logger& logger, size_t size_buffer)
+        : tx_buffer(new char[size_buffer]), rx_buffer(size_buffer),
+          size_buffer(size_buffer), logger(logger) {
+    rx_callback = [this](auto socket, auto t_rx) { default_rx_callback(socket, t_rx); };
+}
+
+ShmSocket::~ShmSocket() {
+    if (is_listener)
+        shm_unlink(name.c_str());
+    reset();
+}
+
+auto ShmSocket::connect(const std::string&, const std::string&, int port, bool is_listening,
+                        bool is_reuse_port) -> int {
+    name = get_stream_name(port);
+    is_listener = is_listening;
+    // a listener alone on its port starts afresh; clients of an old one keep its region
+    if (is_listening && !is_reuse_port)
+        shm_unlink(name.c_str());
+    const auto [fd_region, mapped] = map_region(name, sizeof(ShmStreamRegion),
+                                                is_listening ? O_CREAT : 0);
+    if (mapped == nullptr) {
+        logger.logf("% <ShmSocket::%> failed to map region %, error: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, name, std::string(strerror(errno)));
+        if (!is_listening)
+            errno = ECONNREFUSED;
+        return -1;
+    }
+    fd = fd_region;
+    region = static_cast<ShmStreamRegion*>(mapped);
+    is_region_owned = true;
+    if (is_listening)
+        return fd;
+    // claim a free slot, and open it once its rings are emptied
+    for (auto& conn: region->connections) {
+        uint32_t state{ ShmConnection::FREE };
+        if (!conn.state.compare_exchange_strong(state, ShmConnection::CONNECTING,
+                                                std::memory_order_acq_rel))
+            continue;
+        for (auto ring: { &conn.to_server, &conn.to_client }) {
+            ring->i_write.store(0, std::memory_order_relaxed);
+            ring->i_read.store(0, std::memory_order_relaxed);
+        }
+        conn.state.store(ShmConnection::OPEN, std::memory_order_release);
+        connection = &conn;
+        ring_rx = &conn.to_client;
+        ring_tx = &conn.to_server;
+        logger.logf("% <ShmSocket::%> connected at region %, slot: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, name,
+                    &conn - region->connections);
+        return fd;
+    }
+    logger.logf("% <ShmSocket::%> no free connection slot at region %\n",
+                LL::get_time_str(&t_str), __FUNCTION__, name);
+    reset();
+    errno = ECONNREFUSED;
+    return -1;
+}
+
+void ShmSocket::accept(ShmStreamRegion* listener_region, ShmConnection* conn,
+                       int fd_dup) noexcept {
+    fd = fd_dup;
+    region = listener_region;
+    is_region_owned = false;
+    connection = conn;
+    is_server_side = true;
+    ring_rx = &conn->to_server;
+    ring_tx = &conn->to_client;
+}
+
+void ShmSocket::load_tx(const void* data, size_t len) noexcept {
+    VERIFY(i_tx_next + len <= size_buffer,
+           "<ShmSocket> tx buffer overflow! Have you called tx_and_rx()?");
+    memcpy(tx_buffer.get() + i_tx_next, data, len);
+    i_tx_next += len;
+}
+
+auto ShmSocket::receive() noexcept -> bool {
+    if (ring_rx == nullptr)
+        return false;
+    const auto n = ring_rx->read(rx_buffer.write_ptr(), rx_buffer.get_n_free());
+    if (n == 0) {
+        // the peer's last data has all been read once it's closed
+        const auto state = connection->state.load(std::memory_order_acquire);
+        is_peer_closed = state == (is_server_side ? ShmConnection::CLIENT_CLOSED
+                                                  : ShmConnection::SERVER_CLOSED);
+        return false;
+    }
+    rx_buffer.commit(n);
+    t_rx_last = get_time_nanos();
+    logger.logf("% <ShmSocket::%> RX at socket %, len: %, t_rx: %\n",
+                LL::get_time_str(&t_str), __FUNCTION__, fd, rx_buffer.size(), t_rx_last);
+    return true;
+}
+
+void ShmSocket::tx() noexcept {
+    if (ring_tx == nullptr || i_tx_next == i_tx_start)
+        return;
+    const auto n = ring_tx->write(tx_buffer.get() + i_tx_start, i_tx_next - i_tx_start);
+    logger.logf("% <ShmSocket::%> TX at socket %, size: %, pending: %\n",
+                LL::get_time_str(&t_str), __FUNCTION__, fd, n, i_tx_next - i_tx_start - n);
+    i_tx_start += n;
+    if (i_tx_start == i_tx_next) {
+        i_tx_start = i_tx_next = 0;
+    } else if (i_tx_start > 0) {
+        // what the peer's ring had no room for goes first next time
+        memmove(tx_buffer.get(), tx_buffer.get() + i_tx_start, i_tx_next - i_tx_start);
+        i_tx_next -= i_tx_start;
+        i_tx_start = 0;
+    }
+}
+
+void ShmSocket::close_connection() noexcept {
+    if (connection == nullptr)
+        return;
+    const uint32_t closed_self = is_server_side ? ShmConnection::SERVER_CLOSED
+                                                : ShmConnection::CLIENT_CLOSED;
+    const uint32_t closed_peer = is_server_side ? ShmConnection::CLIENT_CLOSED
+                                                : ShmConnection::SERVER_CLOSED;
+    auto state = connection->state.load(std::memory_order_acquire);
+    for (;;) {
+        uint32_t next{ };
+        if (state == closed_peer)
+            next = ShmConnection::FREE;     // the peer's gone too, so the slot's done with
+        else if (state == ShmConnection::ACCEPTED)
+            next = closed_self;
+        else if (state == ShmConnection::OPEN && !is_server_side)
+            next = ShmConnection::FREE;     // never accepted
+        else
+            break;
+        if (connection->state.compare_exchange_weak(state, next, std::memory_order_acq_rel))
+            break;
+    }
+    connection = nullptr;
+    ring_rx = ring_tx = nullptr;
+}
+
+void ShmSocket::reset() noexcept {
+    close_connection();
+    if (region != nullptr && is_region_owned)
+        munmap(region, sizeof(ShmStreamRegion));
+    region = nullptr;
+    if (fd != -1)
+        close(fd);
+    fd = -1;
+    is_listener = false;
+    is_server_side = false;
+    is_peer_closed = false;
+    i_tx_next = i_tx_start = 0;
+    rx_buffer.clear();
+}
+
+
+ShmServer::ShmServer(Logger& logger, size_t size_socket_buffer)
+        // the listener only maps the region, so never needs more than a page of buffer
+        : listener_socket(logger, get_page_size()), size_socket_buffer(size_socket_buffer),
+          logger(logger) {
+    rx_callback = [this](auto socket, auto t_rx) { default_rx_callback(socket, t_rx); };
+    rx_done_callback = []() { };
+    dx_callback = [this](auto socket) { default_dx_callback(socket); };
+}
+
+void ShmServer::listen(const std::string& iface, int port, bool is_reuse_port) {
+    const auto status = listener_socket.connect({ }, iface, port, true, is_reuse_port);
+    VERIFY(status >= 0, "<ShmServer> listener failed to map its region at port: "
+            + std::to_string(port) + ", error: " + std::string(std::strerror(errno)));
+}
+
+auto ShmServer::poll() noexcept -> int {
+    auto region = listener_socket.region;
+    if (region == nullptr)
+        return 0;
+    int n_accepted{ };
+    for (auto& conn: region->connections) {
+        uint32_t state{ ShmConnection::OPEN };
+        if (conn.state.load(std::memory_order_relaxed) != state
+                || !conn.state.compare_exchange_strong(state, ShmConnection::ACCEPTED,
+                                                       std::memory_order_acq_rel))
+            continue;
+        // each connection holds its own descriptor of the region, to tell it apart by
+        ShmSocket* socket{ nullptr };
+        if (sockets_free.empty()) {
+            socket = sockets.emplace_back(
+                    std::make_unique<ShmSocket>(logger, size_socket_buffer)).get();
+        } else {
+            socket = sockets_free.back();
+            sockets_free.pop_back();
+        }
+        socket->accept(region, &conn, dup(listener_socket.fd));
+        socket->rx_callback = rx_callback;
+        connections.push_back(socket);
+        logger.logf("% <ShmServer::%> accepted new socket fd: %, slot: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, socket->fd,
+                    &conn - region->connections);
+        ++n_accepted;
+    }
+    return n_accepted;
+}
+
+void ShmServer::tx_and_recycle() noexcept {
+    for (auto s: connections)
+        s->tx();
+    // connections closed by their clients are recycled once everything they sent is read
+    for (size_t i{ }; i < connections.size();) {
+        auto s = connections[i];
+        if (!s->is_peer_closed) {
+            ++i;
+            continue;
+        }
+        dx_callback(s);
+        s->reset();
+        sockets_free.push_back(s);
+        connections[i] = connections.back();
+        connections.pop_back();
+    }
+}
+
+
+ShmMcastSocket::ShmMcastSocket(Logger& logger, const McastBatchConfig& batching)
+        : rx_buffer(MCAST_BUFFER_SIZE), batching(batching), logger(logger) {
+    tx_buffer.resize(MCAST_BUFFER_SIZE);
+}
+
+ShmMcastSocket::~ShmMcastSocket() {
+    leave_group();
+}
+
+auto ShmMcastSocket::init(const std::string& ip, const std::string&, int port,
+                          bool) -> int {
+    const auto name = get_mcast_name(ip, port);
+    const auto [fd_region, mapped] = map_region(name, sizeof(ShmMcastRing), O_CREAT);
+    if (mapped == nullptr) {
+        logger.logf("% <ShmMcastSocket::%> failed to map region %, error: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, name, std::string(strerror(errno)));
+        return -1;
+    }
+    fd = fd_region;
+    ring = static_cast<ShmMcastRing*>(mapped);
+    return fd;
+}
+
+auto ShmMcastSocket::join_group(const std::string&) -> bool {
+    if (ring == nullptr)
+        return false;
+    i_read = ring->i_publish.load(std::memory_order_acquire);
+    is_joined = true;
+    return true;
+}
+
+void ShmMcastSocket::leave_group() {
+    if (ring != nullptr)
+        munmap(ring, sizeof(ShmMcastRing));
+    if (fd != -1)
+        close(fd);
+    ring = nullptr;
+    fd = -1;
+    is_joined = false;
+    i_tx_next = 0;
+    tx_datagram_ends.clear();
+}
+
+void ShmMcastSocket::load_tx(const void* data, size_t len) noexcept {
+    VERIFY(i_tx_next + len <= MCAST_BUFFER_SIZE,
+           "<ShmMcastSocket> tx buffer overflow! Have you called tx_and_rx()?");
+    memcpy(tx_buffer.data() + i_tx_next, data, len);
+    i_tx_next += len;
+}
+
+void ShmMcastSocket::end_datagram() noexcept {
+    if (tx_datagram_ends.empty() ? i_tx_next == 0 : tx_datagram_ends.back() == i_tx_next)
+        return;
+    tx_datagram_ends.push_back(i_tx_next);
+    if (batching.n_tx_flush && tx_datagram_ends.size() >= batching.n_tx_flush)
+        publish();
+}
+
+void ShmMcastSocket::publish() noexcept {
+    if (ring == nullptr || tx_datagram_ends.empty())
+        return;
+    const auto i_start = ring->i_publish.load(std::memory_order_relaxed);
+    const auto size_total = tx_datagram_ends.size() * sizeof(uint32_t) + i_tx_next;
+    VERIFY(size_total <= SHM_MCAST_SIZE, "<ShmMcastSocket> datagrams loaded exceed the ring");
+    // subscribers reading what's about to be overwritten find out from i_reserve
+    ring->i_reserve.store(i_start + size_total, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    auto i = i_start;
+    size_t i_datagram{ };
+    for (const auto i_end: tx_datagram_ends) {
+        const auto len = static_cast<uint32_t>(i_end - i_datagram);
+        copy_to_ring(ring->data, SHM_MCAST_SIZE, i, reinterpret_cast<const char*>(&len),
+                     sizeof(len));
+        copy_to_ring(ring->data, SHM_MCAST_SIZE, i + sizeof(len),
+                     tx_buffer.data() + i_datagram, len);
+        i += sizeof(len) + len;
+        i_datagram = i_end;
+    }
+    ring->i_publish.store(i, std::memory_order_release);
+    logger.logf("% <ShmMcastSocket::%> TX at socket %, datagrams: %, size: %\n",
+                LL::get_time_str(&t_str), __FUNCTION__, fd, tx_datagram_ends.size(),
+                i_tx_next);
+    tx_datagram_ends.clear();
+    i_tx_next = 0;
+}
+
+auto ShmMcastSocket::receive() noexcept -> bool {
+    if (!is_joined)
+        return false;
+    const auto i_end = ring->i_publish.load(std::memory_order_acquire);
+    if (i_end == i_read)
+        return false;
+    const auto overrun = [&]() {
+        ++n_rx_overruns;
+        logger.logf("% <ShmMcastSocket::%> lapped at socket %; lost % bytes of datagrams\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, fd, i_end - i_read);
+        i_read = ring->i_publish.load(std::memory_order_acquire);
+        return false;
+    };
+    if (i_end - i_read > SHM_MCAST_SIZE)
+        return overrun();
+    // copy whole datagrams for as long as they fit, then check none were overwritten meanwhile
+    auto i = i_read;
+    size_t n_copied{ };
+    while (i < i_end) {
+        uint32_t len{ };
+        copy_from_ring(ring->data, SHM_MCAST_SIZE, i, reinterpret_cast<char*>(&len),
+                       sizeof(len));
+        if (i_end - i < sizeof(len) || len > i_end - i - sizeof(len))
+            return overrun();
+        if (len > rx_buffer.get_n_free() - n_copied)
+            break;
+        copy_from_ring(ring->data, SHM_MCAST_SIZE, i + sizeof(len),
+                       rx_buffer.write_ptr() + n_copied, len);
+        n_copied += len;
+        i += sizeof(len) + len;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (ring->i_reserve.load(std::memory_order_relaxed) - i_read > SHM_MCAST_SIZE)
+        return overrun();
+    i_read = i;
+    if (n_copied == 0)
+        return false;
+    rx_buffer.commit(n_copied);
+    t_rx_last = get_time_nanos();
+    logger.logf("% <ShmMcastSocket::%> RX at socket %, len: %, t_rx: %\n",
+                LL::get_time_str(&t_str), __FUNCTION__, fd, rx_buffer.size(), t_rx_last);
+    return true;
+}
+}
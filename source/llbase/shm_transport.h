@@ -0,0 +1,431 @@
+/**
+ *
+ *  Low-latency C++ Utilities
+ *
+ *  @file shm_transport.h
+ *  @brief Shared memory streams and multicast groups for co-located processes
+ *  @author Stacy Gaudreau
+ *  @date 2025.02.18
+ *
+ */
+
+
+#pragma once
+
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "macros.h"
+#include "logging.h"
+#include "sockets.h"
+#include "ring_buffer.h"
+#include "mcast_socket.h"
+
+
+namespace LL
+{
+constexpr size_t SHM_BUFFER_SIZE{ 64 * 1024 * 1024 };
+constexpr size_t SHM_STREAM_SIZE{ 1024 * 1024 };    // each way of a connection
+constexpr size_t SHM_MAX_CONNECTIONS{ 16 };         // connections open at once, per port
+constexpr size_t SHM_MCAST_SIZE{ 4 * 1024 * 1024 }; // datagrams held by a group's ring
+
+
+/**
+ * @brief A single-producer, single-consumer byte stream living in shared memory
+ * @details The indices count bytes written and read in all, so that a full ring is told
+ * apart from an empty one without giving up a byte. Each is only stored by its own side.
+ */
+struct ShmByteRing {
+    alignas(64) std::atomic<uint64_t> i_write;
+    alignas(64) std::atomic<uint64_t> i_read;
+    alignas(64) char data[SHM_STREAM_SIZE];
+
+    /** @brief Write as much of the data as there's room for; returns the number of bytes */
+    auto write(const char* src, size_t len) noexcept -> size_t;
+    /** @brief Read up to len bytes of what's been written; returns the number of bytes */
+    auto read(char* dst, size_t len) noexcept -> size_t;
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared memory rings need lock-free atomics to work across processes");
+
+
+/**
+ * @brief One connection's slot in a listening port's region: a ring each way, and its state
+ */
+struct ShmConnection {
+    // FREE -> CONNECTING -> OPEN (by the client) -> ACCEPTED (by a server) -> the first side
+    //  to close marks it, and the second frees it. Each step is a compare and swap.
+    enum State : uint32_t {
+        FREE = 0, CONNECTING, OPEN, ACCEPTED, CLIENT_CLOSED, SERVER_CLOSED
+    };
+    alignas(64) std::atomic<uint32_t> state;
+    ShmByteRing to_server;
+    ShmByteRing to_client;
+};
+
+
+/**
+ * @brief The connection slots of a listening port, mapped by its listeners and clients
+ */
+struct ShmStreamRegion {
+    ShmConnection connections[SHM_MAX_CONNECTIONS];
+};
+
+
+/**
+ * @brief A stream connection through shared memory, shaped like a TCPSocket, for processes
+ * on the same host
+ * @details Each connection is a pair of rings in a region of shared memory named for the
+ * listening port, so nothing passes through the kernel once the region's mapped. Data is
+ * received into rx_buffer and loaded to send exactly as with a TCPSocket. Whatever doesn't fit
+ * the peer's ring stays loaded and goes first at the next tx(). The address and interface are
+ * ignored, and the tuning is kept only so that either transport can be configured the same
+ * way, since there's no kernel socket to apply it to. Not thread safe.
+ */
+class ShmSocket {
+public:
+    /**
+     * @param logger Logging instance to write to
+     * @param size_buffer Size of each of the tx and rx buffers; a power of two and a multiple
+     * of the page size
+     */
+    explicit ShmSocket(Logger& logger, size_t size_buffer = SHM_BUFFER_SIZE);
+    ~ShmSocket();
+
+    /**
+     * @brief Listen on the region for a port, or connect to one that's being listened on
+     * @param ip Ignored; the peer is always on this host
+     * @param iface Ignored
+     * @param port Port whose region to listen on or connect to
+     * @param is_listening Creates the port's region for incoming connections when true. A
+     * stale region left by a listener which is no longer running is replaced.
+     * @param is_reuse_port Shares the region with other listeners on the port, which each
+     * accept a share of the connections
+     * @return The descriptor of the region if successful, else -1. Clients fail with
+     * ECONNREFUSED when nothing's listening, or every connection slot is taken.
+     */
+    auto connect(const std::string& ip, const std::string& iface,
+                 int port, bool is_listening, bool is_reuse_port = false) -> int;
+    /**
+     * @brief Call to load data into the send (tx) buffer for transmission
+     */
+    void load_tx(const void* data, size_t len) noexcept;
+    /**
+     * @brief Publish tx and rx data to buffers, dispatching an rx_callback if needed
+     * @return True when data is ready to read in rx_buffer
+     */
+    inline auto tx_and_rx() noexcept -> bool { return tx_and_rx(rx_callback); }
+    /**
+     * @brief Publish tx and rx data to buffers, dispatching to on_rx instead of the
+     * rx_callback, so that its call can be inlined
+     */
+    template<typename Handler>
+    inline auto tx_and_rx(Handler&& on_rx) noexcept -> bool {
+        const auto is_rx = rx(on_rx);
+        tx();
+        return is_rx;
+    }
+    /**
+     * @brief Read what the peer has written into rx_buffer, dispatching an rx_callback if
+     * anything was read. Sets is_peer_closed once the peer's closed and everything's read.
+     * @return True when data was received
+     */
+    inline auto rx() noexcept -> bool { return rx(rx_callback); }
+    /**
+     * @brief Read what the peer has written into rx_buffer, dispatching to on_rx if anything
+     * was read
+     */
+    template<typename Handler>
+    inline auto rx(Handler&& on_rx) noexcept -> bool {
+        if (!receive())
+            return false;
+        on_rx(this, t_rx_last);
+        return true;
+    }
+    /**
+     * @brief Write as much of what's loaded as the peer's ring has room for
+     */
+    void tx() noexcept;
+    /**
+     * @brief Close the connection and discard any buffered data, so that the socket can be
+     * reused for a new connection
+     */
+    void reset() noexcept;
+
+    /** @brief Number of bytes loaded which have yet to be sent */
+    [[nodiscard]] inline auto get_n_tx_pending() const noexcept {
+        return i_tx_next - i_tx_start;
+    }
+
+    int fd{ -1 };
+    std::unique_ptr<char[]> tx_buffer;
+    size_t i_tx_next{ };
+    size_t i_tx_start{ };           // start of what's yet to be sent
+    RingBuffer rx_buffer;
+    bool is_peer_closed{ false };   // the peer closed the connection, and it's all been read
+    // t_rx is the time the read's data was found in the ring
+    std::function<void(ShmSocket* s, Nanos t_rx)> rx_callback;
+    SocketTuning tuning{ };
+
+private:
+    friend class ShmServer;
+
+    const size_t size_buffer;
+    Logger& logger;
+    std::string t_str;
+    std::string name;               // of the region, which a listener unlinks when it closes
+    ShmStreamRegion* region{ nullptr };
+    bool is_region_owned{ false };  // mapped by this socket, rather than by its listener
+    bool is_listener{ false };
+    ShmConnection* connection{ nullptr };
+    bool is_server_side{ false };
+    ShmByteRing* ring_rx{ nullptr };
+    ShmByteRing* ring_tx{ nullptr };
+    Nanos t_rx_last{ };         // of the data the last receive() read, to be dispatched
+
+    /**
+     * @brief Take on a connection in a region mapped by a listener, as its server side
+     */
+    void accept(ShmStreamRegion* listener_region, ShmConnection* conn, int fd_dup) noexcept;
+    /**
+     * @brief Mark this side of the connection closed, freeing its slot if the peer had
+     */
+    void close_connection() noexcept;
+    /**
+     * @brief Read into rx_buffer without dispatching, noting the time in t_rx_last
+     * @return True when there's data to dispatch
+     */
+    auto receive() noexcept -> bool;
+
+    void default_rx_callback(ShmSocket* socket, Nanos t_rx) noexcept {
+        logger.logf("% <ShmSocket::%> socket: %, len: %, rx: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, socket->fd,
+                    socket->rx_buffer.size(), t_rx);
+    }
+
+DELETE_DEFAULT_COPY_AND_MOVE(ShmSocket)
+};
+
+
+/**
+ * @brief A server accepting ShmSocket connections, shaped like a TCPServer
+ * @details There's nothing to wait on, so poll() simply looks for connection slots a client
+ * has opened and tx_and_rx() reads and writes every connection's rings.
+ */
+class ShmServer {
+public:
+    explicit ShmServer(Logger& logger, size_t size_socket_buffer = SHM_BUFFER_SIZE);
+
+    /**
+     * @brief Listen for connections on the port's region
+     * @param iface Ignored
+     * @param port Port number
+     * @param is_reuse_port Share the region with other servers, which then each accept a
+     * share of the connections
+     */
+    void listen(const std::string& iface, int port, bool is_reuse_port = false);
+    /**
+     * @brief Accept every connection clients have opened since the last poll
+     * @return Number of connections accepted
+     */
+    auto poll() noexcept -> int;
+    /**
+     * @brief Receive on every connection, send what's loaded on each, then recycle any
+     * connections their clients have closed
+     * @return True if any data was received
+     */
+    inline auto tx_and_rx() noexcept -> bool {
+        return tx_and_rx([](ShmSocket* s, Nanos t_rx) { s->rx_callback(s, t_rx); },
+                         rx_done_callback);
+    }
+    /**
+     * @brief As tx_and_rx(), but dispatching to the given handlers instead of each socket's
+     * rx_callback and the rx_done_callback, so that their calls can be inlined
+     */
+    template<typename OnRx, typename OnRxDone>
+    inline auto tx_and_rx(OnRx&& on_rx, OnRxDone&& on_rx_done) noexcept -> bool {
+        bool receiving{ false };
+        for (auto s: connections)
+            receiving = s->rx(on_rx) || receiving;
+        if (receiving)
+            on_rx_done();
+        tx_and_recycle();
+        return receiving;
+    }
+
+    inline void set_rx_callback(std::function<void(ShmSocket* s, Nanos t_rx)> fn) noexcept {
+        rx_callback = std::move(fn);
+    }
+    inline void set_rx_done_callback(std::function<void()> fn) noexcept {
+        rx_done_callback = std::move(fn);
+    }
+    inline void set_dx_callback(std::function<void(ShmSocket* s)> fn) noexcept {
+        dx_callback = std::move(fn);
+    }
+
+    inline ShmSocket& get_socket() noexcept { return listener_socket; }
+    inline auto& get_connections() noexcept { return connections; }
+
+private:
+    ShmSocket listener_socket;      // maps the port's region
+    std::vector<ShmSocket*> connections;
+    std::vector<std::unique_ptr<ShmSocket>> sockets;    // every connection socket created
+    std::vector<ShmSocket*> sockets_free;   // pooled sockets ready for new connections
+    const size_t size_socket_buffer;
+    std::function<void(ShmSocket* s, Nanos t_rx)> rx_callback;
+    std::function<void()> rx_done_callback;
+    std::function<void(ShmSocket* s)> dx_callback;
+    std::string t_str;
+    Logger& logger;
+
+    /**
+     * @brief Send what's loaded on every connection, then recycle those closed by their
+     * clients
+     */
+    void tx_and_recycle() noexcept;
+
+    void default_rx_callback(ShmSocket* socket, Nanos t_rx) noexcept {
+        logger.logf("% <ShmServer::%> socket: %, len: %, rx: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__,
+                    socket->fd, socket->rx_buffer.size(), t_rx);
+    }
+    void default_dx_callback(ShmSocket* socket) noexcept {
+        logger.logf("% <ShmServer::%> socket: % disconnected\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, socket->fd);
+    }
+
+DELETE_DEFAULT_COPY_AND_MOVE(ShmServer)
+};
+
+
+/**
+ * @brief A group's datagrams, written by its one publisher and read by any number of
+ * subscribers, each at their own pace
+ * @details Each datagram is a 32 bit length followed by its payload. The publisher marks how
+ * far it's about to write in i_reserve before writing, and what's complete in i_publish after.
+ * A subscriber which falls a ring's length behind loses the datagrams overwritten, just as a
+ * slow multicast receiver would, and finds out from i_reserve once it's copied them.
+ */
+struct ShmMcastRing {
+    alignas(64) std::atomic<uint64_t> i_publish;
+    alignas(64) std::atomic<uint64_t> i_reserve;
+    alignas(64) char data[SHM_MCAST_SIZE];
+};
+
+
+/**
+ * @brief A multicast group through shared memory, shaped like an McastSocket, for
+ * processes on the same host
+ * @details The group's ring lives in a region of shared memory named for its address and
+ * port, which is created by whichever of its publisher or subscribers opens it first, and
+ * left for the next to open once they've all gone, as a multicast group outlives its members.
+ * A group takes a single publisher. Subscribers receive what's published after they join,
+ * packed one datagram after another into rx_buffer. Datagrams loaded are published together
+ * by tx_and_rx(), or once batching.n_tx_flush are ended. The interface and tuning are ignored.
+ * Not thread safe.
+ */
+class ShmMcastSocket {
+public:
+    explicit ShmMcastSocket(Logger& logger, const McastBatchConfig& batching = { });
+    ~ShmMcastSocket();
+
+    /**
+     * @brief Open the group's ring to read from or publish to
+     * @details Doesn't join the group. Use join_group() and leave_group() for membership
+     * @return -1 for failure, else the descriptor of the group's region
+     */
+    auto init(const std::string& ip, const std::string& iface,
+              int port, bool is_listening) -> int;
+    /**
+     * @brief Receive the group's datagrams from those published next on
+     * @return True if join is successful
+     */
+    auto join_group(const std::string& ip) -> bool;
+    /**
+     * @brief Stop receiving, and close the group's ring
+     * @details As with McastSocket, whatever's in rx_buffer is left there, since the caller
+     * may still be reading it in place
+     */
+    void leave_group();
+    void load_tx(const void* data, size_t len) noexcept;
+    /**
+     * @brief End the datagram being loaded, and publish those queued once n_tx_flush of them
+     * are waiting
+     */
+    void end_datagram() noexcept;
+    /**
+     * @brief Publish every datagram loaded, then receive what's been published since the last
+     * call, dispatching an rx_callback if anything was
+     * @return True when data is ready to read in rx_buffer
+     */
+    inline auto tx_and_rx() noexcept -> bool {
+        return tx_and_rx([](ShmMcastSocket* s, Nanos t_rx) {
+            if (s->rx_callback)
+                s->rx_callback(s, t_rx);
+        });
+    }
+    /**
+     * @brief Publish, then receive, dispatching to on_rx instead of the rx_callback, so that
+     * its call can be inlined
+     */
+    template<typename Handler>
+    inline auto tx_and_rx(Handler&& on_rx) noexcept -> bool {
+        // the last datagram loaded goes out with the rest, ended or not
+        end_datagram();
+        publish();
+        if (!receive())
+            return false;
+        on_rx(this, t_rx_last);
+        return true;
+    }
+
+    /** @brief Number of times the publisher lapped this subscriber, losing what it hadn't read */
+    [[nodiscard]] inline auto get_n_rx_overruns() const noexcept { return n_rx_overruns; }
+
+    std::vector<char> tx_buffer{ };
+    size_t i_tx_next{ };
+    RingBuffer rx_buffer;
+    std::function<void(ShmMcastSocket* socket, Nanos t_rx)> rx_callback{ nullptr };
+    int fd{ -1 };
+    SocketTuning tuning{ };
+
+private:
+    const McastBatchConfig batching;
+    std::vector<size_t> tx_datagram_ends{ };   // end of each datagram loaded
+    Logger& logger;
+    std::string t_str;
+    ShmMcastRing* ring{ nullptr };
+    bool is_joined{ false };
+    uint64_t i_read{ };         // where this subscriber's next datagram starts in the ring
+    size_t n_rx_overruns{ };
+    Nanos t_rx_last{ };         // of the data the last receive() read, to be dispatched
+
+    void publish() noexcept;
+    /**
+     * @brief Copy what's been published since the last call into rx_buffer, without
+     * dispatching, noting the time in t_rx_last
+     * @return True when there's data to dispatch
+     */
+    auto receive() noexcept -> bool;
+
+DELETE_DEFAULT_COPY_AND_MOVE(ShmMcastSocket)
+};
+
+
+/**
+ * @brief The shared memory transport's stream and datagram types, for components templated
+ * on a transport (see transport.h)
+ */
+struct ShmTransport {
+    using Stream = ShmSocket;
+    using StreamServer = ShmServer;
+    using Datagram = ShmMcastSocket;
+    // there's no network interface underneath, for a packet ring or XDP socket to bypass
+    static constexpr bool IS_NETWORKED{ false };
+};
+}
@@ -13,10 +13,14 @@
 #pragma once
 
 
+#include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <mutex>
 #include <string>
 #include <unordered_set>
 #include <sstream>
+#include <vector>
 #include <sys/epoll.h>
 #include <unistd.h>
 #include <sys/types.h>
@@ -24,6 +28,13 @@
 #include <netdb.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
+#include <linux/filter.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
 #include <arpa/inet.h>
 #include <ifaddrs.h>
 #include <sys/socket.h>
@@ -38,6 +49,8 @@ namespace LL
 {
 
 constexpr int MAX_TCP_BACKLOG{ 1024 };  // (server) max tcp connections pending/unaccepted
+// smallest send worth pinning pages for, rather than copying, with MSG_ZEROCOPY
+constexpr size_t ZEROCOPY_SIZE_MIN{ 16 * 1024 };
 
 /**
  * @brief Get network interface IP address from its name
@@ -94,16 +107,220 @@ inline auto set_no_delay(int fd) -> bool {
                        reinterpret_cast<void*>(&one), sizeof(one)) != -1);
 }
 /**
- * @brief Set the socket to use software packet timestamping. Don't set this when using an
- * interface that supports hardware timestamping.
+ * @brief Have the kernel discard everything the socket receives, before it's queued, with a
+ * socket filter which accepts nothing. Multicast group memberships are kept.
  * @param fd Socket file descriptor
  * @return True when successful
  */
-inline auto set_software_timestamps(int fd) -> bool {
+inline auto set_rx_discard(int fd) -> bool {
+    sock_filter drop_all{ BPF_RET | BPF_K, 0, 0, 0 };
+    const sock_fprog fprog{ 1, &drop_all };
+    return (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER,
+                       reinterpret_cast<const void*>(&fprog), sizeof(fprog)) != -1);
+}
+/**
+ * @brief Have the kernel stamp what the socket receives, in nanoseconds (SO_TIMESTAMPING).
+ * Software stamps are taken as packets enter the stack, and hardware stamps are reported too
+ * wherever the interface takes them (see set_hardware_timestamps()).
+ * @param fd Socket file descriptor
+ * @param is_tx Also stamp each send as it leaves for the interface, with the stamps read back
+ * from the socket's error queue by read_tx_completion(). Each is keyed by an id counting from
+ * zero: a datagram's index for UDP, or the index of a send's last byte for TCP, which must be
+ * connecting or connected.
+ * @return True when successful
+ */
+inline auto set_timestamping(int fd, bool is_tx = false) -> bool {
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_RX_HARDWARE
+            | SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (is_tx)
+        flags |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_TX_HARDWARE
+                | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    return (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING,
+                       reinterpret_cast<void*>(&flags), sizeof(flags)) != -1);
+}
+/**
+ * @brief Have an interface stamp every packet it sends and receives in hardware. This is
+ * device wide, and most virtual interfaces (eg: loopback) can't.
+ * @param fd Any socket file descriptor
+ * @param iface Interface name, eg: "eth0"
+ * @return True when successful
+ */
+inline auto set_hardware_timestamps(int fd, const std::string& iface) -> bool {
+    hwtstamp_config hw_conf{ 0, HWTSTAMP_TX_ON, HWTSTAMP_FILTER_ALL };
+    ifreq ifr{ };
+    strncpy(ifr.ifr_name, iface.c_str(), IFNAMSIZ - 1);
+    ifr.ifr_data = reinterpret_cast<char*>(&hw_conf);
+    return (ioctl(fd, SIOCSHWTSTAMP, &ifr) != -1);
+}
+/**
+ * @brief Control message space for a kernel timestamp (SO_TIMESTAMPING)
+ */
+union TimestampControl {
+    char buffer[CMSG_SPACE(sizeof(scm_timestamping))];
+    cmsghdr align;
+};
+/**
+ * @brief Get the kernel timestamp of a message read by recvmsg() from a timestamping socket
+ * @return Its hardware stamp where there is one, else its software stamp; 0 when unstamped
+ */
+[[nodiscard]] inline auto get_timestamp(const msghdr& msg) noexcept -> Nanos {
+    for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&msg),
+                                                                    cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING)
+            continue;
+        scm_timestamping stamps{ };
+        memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+        const auto& ts = (stamps.ts[2].tv_sec || stamps.ts[2].tv_nsec) ? stamps.ts[2]
+                                                                         : stamps.ts[0];
+        return ts.tv_sec * NANOS_TO_SECS + ts.tv_nsec;
+    }
+    return 0;
+}
+/**
+ * @brief Let the socket send with MSG_ZEROCOPY, which pins the pages of the data sent rather
+ * than copying them into the kernel. The data mustn't then be changed until the kernel reports
+ * the send complete, through read_tx_completion().
+ * @param fd Socket file descriptor
+ * @return True when successful
+ */
+inline auto set_zerocopy(int fd) -> bool {
     int one{ 1 };
-    return (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMP,
+    return (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY,
                        reinterpret_cast<void*>(&one), sizeof(one)) != -1);
+}
+/**
+ * @brief A notice about earlier sends, read off a socket's error queue
+ */
+struct TxCompletion {
+    bool is_zerocopy{ false };  // a range of MSG_ZEROCOPY sends completed, else a send stamped
+    uint32_t id{ };             // the send stamped, or the first of the range completed
+    uint32_t id_last{ };        // the last of the range completed
+    Nanos t_tx{ };              // when the send stamped left, in hardware where it was stamped
+    bool is_copied{ false };    // the kernel copied the range's data after all (eg: loopback)
 };
+/**
+ * @brief Read one send timestamp (see set_timestamping()) or MSG_ZEROCOPY completion (see
+ * set_zerocopy()) off a socket's error queue. Zerocopy sends are numbered from zero, once
+ * each call to send.
+ * @param fd Socket file descriptor
+ * @param completion Set to the notice read
+ * @return False once the queue is empty
+ */
+inline auto read_tx_completion(int fd, TxCompletion& completion) noexcept -> bool {
+    char ctrl[CMSG_SPACE(sizeof(scm_timestamping)) + CMSG_SPACE(sizeof(sock_extended_err))
+              + CMSG_SPACE(sizeof(sockaddr_in))];
+    while (true) {
+        msghdr msg{ nullptr, 0, nullptr, 0, ctrl, sizeof(ctrl), 0 };
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+            return false;
+        // the error says what the notice is; a timestamp comes in a message of its own
+        for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR)
+                continue;
+            sock_extended_err err{ };
+            memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+                completion = { false, err.ee_data, err.ee_data, get_timestamp(msg), false };
+                return true;
+            }
+            if (err.ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+                completion = { true, err.ee_info, err.ee_data, 0,
+                               err.ee_code == SO_EE_CODE_ZEROCOPY_COPIED };
+                return true;
+            }
+            break;
+        }
+        // anything else queued (eg: an ICMP error) is skipped
+    }
+}
+/**
+ * @brief A socket's sends still to be stamped (see set_timestamping()) or completed (see
+ * set_zerocopy()), and the bookkeeping of the notices read off its error queue
+ * @details Sends are counted as the kernel keys their stamps: in datagrams for UDP, and in
+ * bytes for TCP. Zerocopy sends are counted once each call to send.
+ */
+struct TxCompletions {
+    bool is_tx_timestamped{ false };
+    uint32_t n_tx_sent{ };      // sends made since tx timestamps were enabled
+    uint32_t n_tx_stamped{ };   // of those, the sends which have been stamped
+    size_t size_zerocopy_min{ };    // smallest send made with MSG_ZEROCOPY; 0 when off
+    uint32_t n_zerocopy_sent{ };    // zerocopy sends made
+    uint32_t n_zerocopy_done{ };    // of those, the sends the kernel has finished with
+    bool is_zerocopy_copied{ false };   // the kernel has copied zerocopy sends after all
+
+    /** @brief Stamp the socket's sends from now on, counting from zero again */
+    inline auto enable_tx_timestamps(int fd) noexcept -> bool {
+        if (!set_timestamping(fd, true))
+            return false;
+        is_tx_timestamped = true;
+        n_tx_sent = n_tx_stamped = 0;
+        return true;
+    }
+    /** @brief Send with MSG_ZEROCOPY from now on, whenever at least size_min is sent */
+    inline auto enable_zerocopy(int fd, size_t size_min) noexcept -> bool {
+        if (!set_zerocopy(fd))
+            return false;
+        size_zerocopy_min = std::max(size_min, size_t{ 1 });
+        return true;
+    }
+    /**
+     * @brief Whether the send from start to end of a tx buffer of size_buffer is made with
+     * MSG_ZEROCOPY
+     * @details Past half the buffer it's copied instead, so that the sends in flight can all
+     * complete and the buffer rewind before it fills, however steadily it's loaded.
+     */
+    [[nodiscard]] inline auto is_zerocopy_send(size_t start, size_t end,
+                                               size_t size_buffer) const noexcept -> bool {
+        return size_zerocopy_min && end - start >= size_zerocopy_min && end < size_buffer / 2;
+    }
+    /** @brief Count sends just made: n_tx stamped ones, of which n_zerocopy were zerocopy */
+    inline void on_sent(uint32_t n_tx, uint32_t n_zerocopy) noexcept {
+        if (is_tx_timestamped)
+            n_tx_sent += n_tx;
+        n_zerocopy_sent += n_zerocopy;
+    }
+    /** @brief Whether the kernel still holds on to the data of any zerocopy send */
+    [[nodiscard]] inline auto is_zerocopy_pending() const noexcept {
+        return n_zerocopy_done != n_zerocopy_sent;
+    }
+    /** @brief Whether any send is yet to be stamped or completed */
+    [[nodiscard]] inline auto is_pending() const noexcept {
+        return n_tx_stamped != n_tx_sent || is_zerocopy_pending();
+    }
+    /**
+     * @brief Read every notice queued on the socket, handing each send's stamp to
+     * on_stamp(id, t_tx)
+     * @return True when the kernel has just begun to copy zerocopy sends, eg: on loopback
+     */
+    template<typename OnStamp>
+    inline auto read(int fd, OnStamp&& on_stamp) noexcept -> bool {
+        bool is_newly_copied{ false };
+        TxCompletion completion{ };
+        while (read_tx_completion(fd, completion)) {
+            if (!completion.is_zerocopy) {
+                n_tx_stamped = completion.id + 1;
+                on_stamp(completion.id, completion.t_tx);
+                continue;
+            }
+            n_zerocopy_done += completion.id_last - completion.id + 1;
+            if (completion.is_copied && !is_zerocopy_copied)
+                is_zerocopy_copied = is_newly_copied = true;
+        }
+        return is_newly_copied;
+    }
+};
+/**
+ * @brief Query whether the kernel can segment a large UDP send into equal sized datagrams on
+ * this socket (UDP generic segmentation offload, UDP_SEGMENT)
+ * @param fd Socket file descriptor
+ * @return True when supported
+ */
+inline auto has_udp_gso(int fd) -> bool {
+    int size_segment{ };
+    socklen_t len{ sizeof(size_segment) };
+    return (getsockopt(fd, SOL_UDP, UDP_SEGMENT,
+                       reinterpret_cast<void*>(&size_segment), &len) != -1);
+}
 /**
  * @brief Query whether or not a socket operation will block right now
  * @return True if the socket blocks
@@ -145,6 +362,224 @@ inline auto mcast_group_join(int fd, const std::string& ip) -> bool {
 }
 
 
+/**
+ * @brief Low-latency tuning for a socket, applied by create_socket(). Anything left at its
+ * default keeps the kernel's setting.
+ */
+struct SocketTuning {
+    int busy_poll_us{ -1 };         // spin on the device queue this long in reads (SO_BUSY_POLL)
+    bool is_prefer_busy_poll{ false };  // defer device interrupts while busy polling
+    int busy_poll_budget{ -1 };     // packets handled per busy poll (needs CAP_NET_ADMIN to raise)
+    int size_rcvbuf{ -1 };          // kernel receive buffer, in bytes
+    int size_sndbuf{ -1 };          // kernel send buffer, in bytes
+    bool is_force_buffers{ false }; // size buffers past the sysctl limits (needs CAP_NET_ADMIN)
+    int incoming_cpu{ -1 };         // the CPU the socket's packets should be handled on
+    bool is_quickack{ false };      // (TCP) acknowledge at once, rather than delaying acks
+    int notsent_lowat{ -1 };        // (TCP) most unsent data queued before it's not writable
+    int mcast_loop{ -1 };           // (UDP) 0 or 1: loop multicast sends back to this host
+    bool is_hw_timestamps{ false }; // have the interface stamp packets in hardware, if it can
+
+    /**
+     * @brief Parse a tuning from options separated by whitespace: busy_poll=<us>,
+     * prefer_busy_poll, busy_poll_budget=<n>, rcvbuf=<bytes>, sndbuf=<bytes>, force_buffers,
+     * incoming_cpu=<cpu>, quickack, notsent_lowat=<bytes>, mcast_loop=<0|1> and
+     * hw_timestamps
+     */
+    static auto from_str(const std::string& options) -> SocketTuning {
+        SocketTuning tuning;
+        std::stringstream ss{ options };
+        std::string option;
+        while (ss >> option) {
+            const auto i_eq = option.find('=');
+            const auto key = option.substr(0, i_eq);
+            const auto value = [&]() {
+                VERIFY(i_eq != std::string::npos, "<SocketTuning> missing value for " + key);
+                return std::stoi(option.substr(i_eq + 1));
+            };
+            if (key == "busy_poll")
+                tuning.busy_poll_us = value();
+            else if (key == "prefer_busy_poll")
+                tuning.is_prefer_busy_poll = true;
+            else if (key == "busy_poll_budget")
+                tuning.busy_poll_budget = value();
+            else if (key == "rcvbuf")
+                tuning.size_rcvbuf = value();
+            else if (key == "sndbuf")
+                tuning.size_sndbuf = value();
+            else if (key == "force_buffers")
+                tuning.is_force_buffers = true;
+            else if (key == "incoming_cpu")
+                tuning.incoming_cpu = value();
+            else if (key == "quickack")
+                tuning.is_quickack = true;
+            else if (key == "notsent_lowat")
+                tuning.notsent_lowat = value();
+            else if (key == "mcast_loop")
+                tuning.mcast_loop = value();
+            else if (key == "hw_timestamps")
+                tuning.is_hw_timestamps = true;
+            else
+                FATAL("<SocketTuning> unknown option " + option);
+        }
+        return tuning;
+    }
+
+    [[nodiscard]] auto to_str() const {
+        std::stringstream ss;
+        ss << "SocketTuning: { busy_poll_us: " << busy_poll_us
+           << ", is_prefer_busy_poll: " << is_prefer_busy_poll
+           << ", busy_poll_budget: " << busy_poll_budget
+           << ", size_rcvbuf: " << size_rcvbuf
+           << ", size_sndbuf: " << size_sndbuf
+           << ", is_force_buffers: " << is_force_buffers
+           << ", incoming_cpu: " << incoming_cpu
+           << ", is_quickack: " << is_quickack
+           << ", notsent_lowat: " << notsent_lowat
+           << ", mcast_loop: " << mcast_loop
+           << ", is_hw_timestamps: " << is_hw_timestamps << " }";
+        return ss.str();
+    }
+};
+
+
+/**
+ * @brief Maps named sockets (eg: "OGS", "MDC.incremental") to their tuning, so that each
+ * deployment can tune its own without code changes.
+ */
+class SocketProfiles final {
+public:
+    /**
+     * @brief Load profiles from a text file, with one socket per line in the format:
+     *  <socket_name> [<option>...]
+     * @details The options are those of SocketTuning::from_str(). A trailing '*' on the name
+     * matches any socket with that prefix. Blank lines and lines beginning with '#' are
+     * ignored.
+     */
+    static auto from_file(const std::string& filename) -> SocketProfiles {
+        std::ifstream file{ filename };
+        VERIFY(file.is_open(), "<SocketProfiles> could not open profiles file " + filename);
+        SocketProfiles profiles;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::stringstream ss{ line };
+            std::string name;
+            if (!(ss >> name) || name[0] == '#')
+                continue;
+            std::string options;
+            std::getline(ss, options);
+            profiles.add(name, SocketTuning::from_str(options));
+        }
+        return profiles;
+    }
+
+    inline void add(const std::string& name, const SocketTuning& tuning) {
+        profiles.emplace_back(name, tuning);
+    }
+
+    /** @brief Find the first profile matching the socket name, or nullptr */
+    [[nodiscard]] auto find(const std::string& socket_name) const noexcept
+            -> const SocketTuning* {
+        for (const auto& [name, tuning]: profiles) {
+            if (!name.empty() && name.back() == '*') {
+                if (socket_name.compare(0, name.size() - 1, name, 0, name.size() - 1) == 0)
+                    return &tuning;
+            } else if (socket_name == name) {
+                return &tuning;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Install profiles for all sockets subsequently looked up in this process
+     */
+    static void install(const SocketProfiles& profiles) {
+        std::lock_guard<std::mutex> lock(installed_mutex);
+        get_installed() = profiles;
+    }
+
+    /**
+     * @brief Get the installed tuning for a socket; the kernel's defaults when there's none
+     */
+    static auto lookup(const std::string& socket_name) -> SocketTuning {
+        std::lock_guard<std::mutex> lock(installed_mutex);
+        if (const auto tuning = get_installed().find(socket_name))
+            return *tuning;
+        return { };
+    }
+
+private:
+    std::vector<std::pair<std::string, SocketTuning>> profiles;
+    static inline std::mutex installed_mutex;
+
+    /** @brief The process-wide installed profiles; guarded by installed_mutex */
+    static auto get_installed() -> SocketProfiles& {
+        static SocketProfiles installed;
+        return installed;
+    }
+};
+
+
+/**
+ * @brief Apply a tuning to a socket, reading back each setting to check it took
+ * @param fd Socket file descriptor
+ * @param tuning The settings to apply
+ * @param is_udp Skips the TCP settings when true, and the UDP ones when false
+ * @param logger Logs each setting which failed, or which the kernel capped
+ * @return Number of settings which failed to apply
+ */
+inline auto apply_socket_tuning(int fd, const SocketTuning& tuning, bool is_udp,
+                                Logger& logger) -> size_t {
+    std::string t_str;
+    size_t n_failed{ };
+    // read an option back to check it took; the kernel may round (or double) what it's given
+    const auto check = [&](int level, int option, const char* name, int value, bool is_set,
+                           bool is_at_least = false) {
+        const std::string error{ is_set ? "" : strerror(errno) };
+        int value_read{ };
+        socklen_t len{ sizeof(value_read) };
+        const auto is_read = getsockopt(fd, level, option, &value_read, &len) != -1;
+        if (is_set && is_read && (is_at_least ? value_read >= value : value_read == value))
+            return;
+        ++n_failed;
+        logger.logf("% <Sockets::%> % not applied at socket %, wanted: %, read back: %, "
+                    "error: %\n", LL::get_time_str(&t_str), __FUNCTION__, name, fd, value,
+                    value_read, error);
+    };
+    const auto apply = [&](int level, int option, const char* name, int value) {
+        const auto is_set = setsockopt(fd, level, option, &value, sizeof(value)) != -1;
+        check(level, option, name, value, is_set);
+    };
+    // a forced size is tried first, falling back to one within the sysctl limits
+    const auto apply_buffer = [&](int option, int option_force, const char* name, int size) {
+        auto is_set = tuning.is_force_buffers
+                      && setsockopt(fd, SOL_SOCKET, option_force, &size, sizeof(size)) != -1;
+        if (!is_set)
+            is_set = setsockopt(fd, SOL_SOCKET, option, &size, sizeof(size)) != -1;
+        check(SOL_SOCKET, option, name, size, is_set, true);
+    };
+    if (tuning.busy_poll_us >= 0)
+        apply(SOL_SOCKET, SO_BUSY_POLL, "SO_BUSY_POLL", tuning.busy_poll_us);
+    if (tuning.is_prefer_busy_poll)
+        apply(SOL_SOCKET, SO_PREFER_BUSY_POLL, "SO_PREFER_BUSY_POLL", 1);
+    if (tuning.busy_poll_budget >= 0)
+        apply(SOL_SOCKET, SO_BUSY_POLL_BUDGET, "SO_BUSY_POLL_BUDGET", tuning.busy_poll_budget);
+    if (tuning.size_rcvbuf >= 0)
+        apply_buffer(SO_RCVBUF, SO_RCVBUFFORCE, "SO_RCVBUF", tuning.size_rcvbuf);
+    if (tuning.size_sndbuf >= 0)
+        apply_buffer(SO_SNDBUF, SO_SNDBUFFORCE, "SO_SNDBUF", tuning.size_sndbuf);
+    if (tuning.incoming_cpu >= 0)
+        apply(SOL_SOCKET, SO_INCOMING_CPU, "SO_INCOMING_CPU", tuning.incoming_cpu);
+    if (!is_udp && tuning.is_quickack)
+        apply(IPPROTO_TCP, TCP_QUICKACK, "TCP_QUICKACK", 1);
+    if (!is_udp && tuning.notsent_lowat >= 0)
+        apply(IPPROTO_TCP, TCP_NOTSENT_LOWAT, "TCP_NOTSENT_LOWAT", tuning.notsent_lowat);
+    if (is_udp && tuning.mcast_loop >= 0)
+        apply(IPPROTO_IP, IP_MULTICAST_LOOP, "IP_MULTICAST_LOOP", tuning.mcast_loop);
+    return n_failed;
+}
+
+
 /**
  * @brief Configuration for a networking socket
  */
@@ -154,7 +589,10 @@ struct SocketConfig {
     int port{ -1 };
     bool is_udp{ false };
     bool is_listening{ false };
-    bool has_software_timestamp{ false };
+    bool has_software_timestamp{ false };   // kernel receive timestamps (SO_TIMESTAMPING)
+    bool is_reuse_port{ false };
+    bool has_hardware_timestamp{ false };   // also have the interface stamp in hardware
+    SocketTuning tuning{ };
 
     [[nodiscard]] auto to_str() const {
         std::stringstream ss;
@@ -163,7 +601,10 @@ struct SocketConfig {
            << ", port: " << port
            << ", is_udp: " << is_udp
            << ", is_listening: " << is_listening
-           << ", has_software_timestamp: " << has_software_timestamp << " }\n";
+           << ", has_software_timestamp: " << has_software_timestamp
+           << ", is_reuse_port: " << is_reuse_port
+           << ", has_hardware_timestamp: " << has_hardware_timestamp
+           << ", tuning: " << tuning.to_str() << " }\n";
         return ss.str();
     }
 };
@@ -195,7 +636,7 @@ struct SocketConfig {
     addrinfo* result{ nullptr };
     status = getaddrinfo(ip.c_str(), std::to_string(conf.port).c_str(),
                          &hints, &result);
-    ASSERT(!status, "<Sockets> getaddrinfo() failed! error: "
+    VERIFY(!status, "<Sockets> getaddrinfo() failed! error: "
             + std::string(gai_strerror(status)) + ", errno: " + strerror(errno));
 
     // create the socket
@@ -207,21 +648,23 @@ struct SocketConfig {
         //  would ever be >1 matches in our use case since we explicitly set protocol, ipv4, port
         //  and match to a specific IP address
         fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
-        ASSERT(fd != -1, "<Sockets> socket() failed! error: "
+        VERIFY(fd != -1, "<Sockets> socket() failed! error: "
                 + std::string(strerror(errno)));
         status = set_non_blocking(fd);
-        ASSERT(status, "<Sockets> set_non_blocking() failed! error: "
+        VERIFY(status, "<Sockets> set_non_blocking() failed! error: "
                 + std::string(strerror(errno)));
         if (!conf.is_udp) {
             // TCP sockets have no_delay set to disable nagle's algo
             status = set_no_delay(fd);
-            ASSERT(status, "<Sockets> set_no_delay() failed! "
+            VERIFY(status, "<Sockets> set_no_delay() failed! "
                     + std::string(strerror(errno)));
         }
+        // settings which fail are logged; the socket still works without them
+        apply_socket_tuning(fd, conf.tuning, conf.is_udp, logger);
         if (!conf.is_listening) {
             // client mode; connect to given IP address
             status = connect(fd, rp->ai_addr, rp->ai_addrlen);
-            ASSERT(status != 1, "<Sockets> connect() failed! error: "
+            VERIFY(status != 1, "<Sockets> connect() failed! error: "
                     + std::string(strerror(errno)));
         }
         else {
@@ -230,28 +673,42 @@ struct SocketConfig {
             //   parallel connections, rebinding and rapid restarts
             status = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
                                 reinterpret_cast<const char*>(&one), sizeof(one));
-            ASSERT(status != -1, "<Sockets> setsockopt(SO_REUSEADDR) failed! error: "
+            VERIFY(status != -1, "<Sockets> setsockopt(SO_REUSEADDR) failed! error: "
                     + std::string(strerror(errno)));
+            if (conf.is_reuse_port) {
+                // several sockets may bind the same port; the kernel then spreads incoming
+                //  connections (or datagrams) across them
+                status = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT,
+                                    reinterpret_cast<const char*>(&one), sizeof(one));
+                VERIFY(status != -1, "<Sockets> setsockopt(SO_REUSEPORT) failed! error: "
+                        + std::string(strerror(errno)));
+            }
             // bind/listen on the address and port
             const sockaddr_in addr{ AF_INET, htons(conf.port),
                                     { htonl(INADDR_ANY) }, { }};
             status = bind(fd, conf.is_udp ? reinterpret_cast<const struct sockaddr*>(&addr)
                                           : rp->ai_addr, sizeof(addr));
-            ASSERT(status >= 0, "<Sockets> bind() failed! error: "
+            VERIFY(status >= 0, "<Sockets> bind() failed! error: "
                     + std::string(strerror(errno)));
         }
         if (!conf.is_udp && conf.is_listening) {
             // TCP server mode -> listen for tcp connections
             status = listen(fd, MAX_TCP_BACKLOG);
-            ASSERT(status == 0, "<Sockets> listen() failed! error: "
+            VERIFY(status == 0, "<Sockets> listen() failed! error: "
                     + std::string(strerror(errno)));
         }
-        if (conf.has_software_timestamp) {
-            // enable software packet timestamps
-            status = set_software_timestamps(fd);
-            ASSERT(status, "<Sockets> set_software_timestamps() failed! error: "
+        if (conf.has_software_timestamp || conf.has_hardware_timestamp) {
+            // enable nanosecond packet timestamps
+            status = set_timestamping(fd);
+            VERIFY(status, "<Sockets> set_timestamping() failed! error: "
                     + std::string(strerror(errno)));
         }
+        if (conf.has_hardware_timestamp && !set_hardware_timestamps(fd, conf.iface)) {
+            // not every interface can; software stamps are used instead
+            logger.logf("% <Sockets::%> hardware timestamps unavailable on %, error: %\n",
+                        LL::get_time_str(&t_str), __FUNCTION__, conf.iface,
+                        std::string(strerror(errno)));
+        }
     }
     freeaddrinfo(result);
     return fd;
@@ -4,32 +4,76 @@
 namespace LL
 {
 
-void TCPServer::listen(const std::string& iface, int port) {
+void TCPServer::listen(const std::string& iface, int port, bool is_reuse_port) {
     int status{ };
     fd_epoll = epoll_create(1);
-    ASSERT(fd_epoll >= 0, "<TCPServer> epoll create failed! error: "
+    VERIFY(fd_epoll >= 0, "<TCPServer> epoll create failed! error: "
             + std::string(std::strerror(errno)));
     // connect the socket in listening mode
-    status = listener_socket.connect({ }, iface, port, true);
-    ASSERT(status >= 0, "<TCPServer> listener socket connect() failed at iface: "
+    status = listener_socket.connect({ }, iface, port, true, is_reuse_port);
+    VERIFY(status >= 0, "<TCPServer> listener socket connect() failed at iface: "
             + iface + ", port: " + std::to_string(port) + ", error: "
             + std::string(std::strerror(errno)));
     status = epoll_add(&listener_socket);
-    ASSERT(status != -1, "<TCPServer> epoll_ctl() failed! error: "
+    VERIFY(status != -1, "<TCPServer> epoll_ctl() failed! error: "
             + std::string(std::strerror(errno)));
 }
 
 auto TCPServer::epoll_add(TCPSocket* socket) -> int {
     // enable edge-triggered epoll -> ie: notify once when data needs reading
-    //  (instead of constant polling reminders)
-    epoll_event e{ EPOLLET | EPOLLIN | EPOLLOUT,
+    //  (instead of constant polling reminders), or when a socket which couldn't take all it
+    //  was sent has room again
+    epoll_event e{ EPOLLET | EPOLLIN | EPOLLOUT | EPOLLRDHUP,
                    { reinterpret_cast<void*>(socket) }};
     return epoll_ctl(fd_epoll, EPOLL_CTL_ADD, socket->fd, &e);
 }
 
-void TCPServer::poll() noexcept {
-    const int max_events = 1 + static_cast<int>(tx_sockets.size())
-            + static_cast<int>(rx_sockets.size());
+auto TCPServer::create_socket() -> TCPSocket* {
+    auto socket = sockets.emplace_back(
+            std::make_unique<TCPSocket>(logger, size_socket_buffer)).get();
+    // with an io_uring, data arriving for a connection puts it on the list to read
+    socket->rx_ready_callback = [this](auto s) { mark_rx_ready(s); };
+    // and loading data to send puts it on the list to send from
+    socket->tx_ready_callback = [this](auto s) { mark_tx_ready(s); };
+    return socket;
+}
+
+auto TCPServer::acquire_socket() -> TCPSocket* {
+    if (sockets_free.empty()) [[unlikely]] {
+        logger.logf("% <TCPServer::%> socket pool exhausted at % sockets, growing it\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, sockets.size());
+        return create_socket();
+    }
+    auto socket = sockets_free.back();
+    sockets_free.pop_back();
+    return socket;
+}
+
+void TCPServer::release_socket(TCPSocket* socket) noexcept {
+    dx_callback(socket);
+    epoll_ctl(fd_epoll, EPOLL_CTL_DEL, socket->fd, nullptr);
+    // swap the last connection into the released one's slot in the table
+    const auto i = socket->conn.i_table;
+    connections[i] = connections.back();
+    connections[i]->conn.i_table = i;
+    connections.pop_back();
+    // one closed for lagging (or on an epoll error) may not have been read since it was
+    //  listed, so it mustn't be left there to be read once reset
+    if (socket->conn.is_rx_ready)
+        std::erase(rx_sockets, socket);
+    if (socket->conn.is_tx_ready)
+        std::erase(tx_sockets, socket);
+    socket->reset();
+    if (socket->is_ring_draining()) [[unlikely]]
+        sockets_draining.push_back(socket);
+    else
+        sockets_free.push_back(socket);
+}
+
+auto TCPServer::poll() noexcept -> int {
+    const int n_completions = ring != nullptr ? static_cast<int>(ring->reap()) : 0;
+    const int max_events = static_cast<int>(std::min(1 + connections.size(),
+                                                     std::size(events)));
     const int n_events = epoll_wait(fd_epoll, events, max_events, 0);
     bool has_new_connection{ false };
     int status{ 0 }; // tracks function return status
@@ -48,23 +92,17 @@ void TCPServer::poll() noexcept {
                 has_new_connection = true;
                 continue;
             }
-            // received on different socket; add to rx_sockets if it isn't
-            //  already there
+            // received on different socket; read from it until it's drained
             logger.logf("% <TCPServer::%> EPOLLIN at socket fd: %\n",
                         LL::get_time_str(&t_str), __FUNCTION__,
                         socket->fd);
-            if (element_does_not_exist(rx_sockets, socket))
-                rx_sockets.push_back(socket);
+            mark_rx_ready(socket);
         }
-        // socket we can write to
+        // socket with room to send again; whatever it's holding goes out at the next tx
         if (e.events & EPOLLOUT) {
-            // add to tx_sockets if it's not already there
-            logger.logf("% <TCPServer::%> EPOLLOUT at socket fd: %\n",
-                        LL::get_time_str(&t_str), __FUNCTION__,
-                        socket->fd);
-            if (element_does_not_exist(tx_sockets, socket)) {
-                tx_sockets.push_back(socket);
-            }
+            socket->is_tx_blocked = false;
+            if (socket->i_tx_next > 0)
+                mark_tx_ready(socket);
         }
         // EPOLLERR or EPOLLHUP -> socket was disconnected
         //  (error or signal hang up) -> add to dx_sockets
@@ -72,8 +110,7 @@ void TCPServer::poll() noexcept {
             logger.logf("% <TCPServer::%> EPOLLERR|HUP at socket fd: %\n",
                         LL::get_time_str(&t_str), __FUNCTION__,
                         socket->fd);
-            if (element_does_not_exist(dx_sockets, socket))
-                dx_sockets.push_back(socket);
+            mark_dx(socket);
         }
     }
 
@@ -88,42 +125,74 @@ void TCPServer::poll() noexcept {
         if (fd == -1)
             break;
         status = set_non_blocking(fd);
-        ASSERT(status,
+        VERIFY(status,
                "<TCPServer> error! failed to set non-blocking on socket fd: "
                        + std::to_string(fd));
         status = set_no_delay(fd);
-        ASSERT(status,
+        VERIFY(status,
                "<TCPServer> error! failed to set no delay mode on socket fd: "
                        + std::to_string(fd));
+        // accepted connections are tuned as the listener is
+        apply_socket_tuning(fd, listener_socket.tuning, false, logger);
         logger.logf("% <TCPServer::%> accepted new socket fd: %\n",
                     LL::get_time_str(&t_str), __FUNCTION__,
                     fd);
-        // create TCPSocket and add it to containers
-        auto socket = new TCPSocket(logger);
+        // hand a pooled TCPSocket to the connection and add it to the table
+        auto socket = acquire_socket();
         socket->fd = fd;
         socket->rx_callback = rx_callback;
+        socket->tuning = listener_socket.tuning;
+        socket->conn.i_table = static_cast<uint32_t>(connections.size());
+        connections.push_back(socket);
+        // the ring receives continuously from an attached socket, so it needs no epoll
+        if (ring != nullptr && socket->attach(*ring))
+            continue;
         status = epoll_add(socket);
-        ASSERT(status != -1,
+        VERIFY(status != -1,
                "<TCPServer> error! unable to add socket: "
                        + std::string(std::strerror(errno)));
-        if (element_does_not_exist(rx_sockets, socket))
-            rx_sockets.push_back(socket);
+        // data may have arrived before the socket was added to epoll
+        mark_rx_ready(socket);
     }
+    return std::max(n_events, 0) + n_completions;
 }
 
-void TCPServer::tx_and_rx() noexcept {
-    // call socket.tx_and_rx() for each of the
-    //  sockets on this server
-    bool receiving{ false };
-    for (auto s: rx_sockets) {
-        if (s->tx_and_rx())
-            receiving = true;
+void TCPServer::tx_and_recycle() noexcept {
+    // send from each connection with data loaded to send, unless it's waiting for room
+    size_t n_still_ready{ };
+    for (size_t i{ }; i < tx_sockets.size(); ++i) {
+        auto s = tx_sockets[i];
+        if (!s->is_tx_blocked)
+            s->tx();
+        if (s->get_n_tx_pending() > tx_high_watermark && !s->conn.is_dx) [[unlikely]] {
+            logger.logf("% <TCPServer::%> socket: % over tx high-watermark, pending: %; "
+                        "closing it\n", LL::get_time_str(&t_str), __FUNCTION__, s->fd,
+                        s->get_n_tx_pending());
+            mark_dx(s);
+        }
+        // a blocked connection is listed again on EPOLLOUT, or when more is loaded
+        if (s->i_tx_next > 0 && !s->is_tx_blocked && !s->conn.is_dx)
+            tx_sockets[n_still_ready++] = s;
+        else
+            s->conn.is_tx_ready = false;
     }
-    if (receiving)
-        rx_done_callback();
-    for (auto s: tx_sockets) {
-        s->tx_and_rx();
+    tx_sockets.resize(n_still_ready);
+    // the ring's sends (and receives armed for new connections) go to the kernel together
+    if (ring != nullptr)
+        ring->submit();
+    // closed connections are recycled only now, after any final data has been read
+    for (auto s: dx_sockets)
+        release_socket(s);
+    dx_sockets.clear();
+    // and those the ring was still sending from once it has finished with them
+    if (!sockets_draining.empty()) [[unlikely]] {
+        std::erase_if(sockets_draining, [this](TCPSocket* s) {
+            if (s->is_ring_draining())
+                return false;
+            sockets_free.push_back(s);
+            return true;
+        });
     }
 }
 
-}
\ No newline at end of file
+}
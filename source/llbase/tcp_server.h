@@ -9,6 +9,8 @@
  *
  */
 
+#include <algorithm>
+#include <memory>
 #include <utility>
 #include <vector>
 #include <sys/epoll.h>
@@ -23,12 +25,31 @@ namespace LL
 
 class TCPServer {
 public:
-    explicit TCPServer(Logger& logger) : listener_socket(logger),
-                                         logger(logger) {
+    static constexpr size_t N_SOCKETS_POOLED{ 16 };
+
+    /**
+     * @brief A TCP server which hands out pooled TCPSockets to new connections
+     * @param logger Logging instance to write to
+     * @param n_sockets_pooled Number of sockets created up front, ready for connections.
+     * The pool grows should more connections than this ever be open at once.
+     * @param size_socket_buffer Size of each connection socket's tx and rx buffers
+     */
+    explicit TCPServer(Logger& logger, size_t n_sockets_pooled = N_SOCKETS_POOLED,
+                       size_t size_socket_buffer = TCP_BUFFER_SIZE)
+            // the listener only accepts connections, so never needs more than a page of buffer
+            : listener_socket(logger, get_page_size()),
+              size_socket_buffer(size_socket_buffer),
+              tx_high_watermark(size_socket_buffer / 2),
+              logger(logger) {
         rx_callback = [this](auto socket, auto t_rx) {
             default_rx_callback(socket, t_rx);
         };
         rx_done_callback = [this]() { default_rx_done_callback(); };
+        dx_callback = [this](auto socket) { default_dx_callback(socket); };
+        sockets.reserve(n_sockets_pooled);
+        sockets_free.reserve(n_sockets_pooled);
+        for (size_t i{ }; i < n_sockets_pooled; ++i)
+            sockets_free.push_back(create_socket());
     }
     ~TCPServer() {
         close(fd_epoll);
@@ -38,16 +59,60 @@ public:
      * @brief Listen for connections on the iface/port specified
      * @param iface Interface name
      * @param port Port number
+     * @param is_reuse_port Share the port with other servers' listeners (SO_REUSEPORT), so
+     * that the kernel balances new connections across them
+     */
+    void listen(const std::string& iface, int port, bool is_reuse_port = false);
+    /**
+     * @brief Poll for new or dead connections and for connections with data to read,
+     * updating socket tracking containers
+     * @return Number of epoll events handled
      */
-    void listen(const std::string& iface, int port);
+    auto poll() noexcept -> int;
     /**
-     * @brief Poll for new or dead connections, updating socket tracking containers
+     * @brief Receive on every socket with data ready to read, send from every connection
+     * with data loaded to send, then recycle any sockets which were disconnected
+     * @details Reading costs one syscall per socket with data ready, and sending one per
+     * socket with data loaded, regardless of how many connections are open. A connection
+     * whose peer isn't keeping up keeps what it couldn't send, and isn't sent from again
+     * until epoll says it's writable; once more than the high-watermark is waiting, the
+     * connection is closed, so that a slow consumer can only ever hold up itself.
+     * @return True if any data was received
      */
-    void poll() noexcept;
+    inline auto tx_and_rx() noexcept -> bool {
+        return tx_and_rx([](TCPSocket* s, Nanos t_rx) { s->rx_callback(s, t_rx); },
+                         rx_done_callback);
+    }
     /**
-     * @brief Send and receive data from all tx and rx socket buffers
+     * @brief As tx_and_rx(), but dispatching to the given handlers instead of each socket's
+     * rx_callback and the rx_done_callback
+     * @details The handlers' types are known here, so their calls can be inlined into the
+     * receive loop, rather than made through a std::function per read.
+     * @param on_rx Called as on_rx(TCPSocket*, Nanos t_rx) for each socket read
+     * @param on_rx_done Called once every socket with data ready has been read
      */
-    void tx_and_rx() noexcept;
+    template<typename OnRx, typename OnRxDone>
+    inline auto tx_and_rx(OnRx&& on_rx, OnRxDone&& on_rx_done) noexcept -> bool {
+        // read each socket with data ready, keeping only those which may have more waiting
+        bool receiving{ false };
+        size_t n_still_ready{ };
+        for (size_t i{ }; i < rx_sockets.size(); ++i) {
+            auto s = rx_sockets[i];
+            if (s->rx(on_rx))
+                receiving = true;
+            if (s->is_peer_closed)
+                mark_dx(s);
+            if (s->is_rx_pending && !s->conn.is_dx)
+                rx_sockets[n_still_ready++] = s;
+            else
+                s->conn.is_rx_ready = false;
+        }
+        rx_sockets.resize(n_still_ready);
+        if (receiving)
+            on_rx_done();
+        tx_and_recycle();
+        return receiving;
+    }
     /**
      * @brief Set the function to be called when data is available to read from
      * the rx_buffer
@@ -63,24 +128,56 @@ public:
     inline void set_rx_done_callback(std::function<void()> fn) noexcept {
         rx_done_callback = fn;
     }
+    /**
+     * @brief Set the function to be called when a connection is closed, just before its
+     * socket is returned to the pool for reuse
+     */
+    inline void set_dx_callback(std::function<void(TCPSocket* s)> fn) noexcept {
+        dx_callback = std::move(fn);
+    }
+
+    /**
+     * @brief Have new connections send and receive through an io_uring instance, which must
+     * outlive the server. Connections it has no room for keep to epoll and syscalls.
+     */
+    inline void set_io_ring(IORing* io_ring) noexcept { ring = io_ring; }
+    /**
+     * @brief Set the most unsent data a connection may hold before it's closed; by default,
+     * half its tx buffer
+     */
+    inline void set_tx_high_watermark(size_t n) noexcept { tx_high_watermark = n; }
 
     inline TCPSocket& get_socket() noexcept { return listener_socket; };
     inline int get_fd_epoll() noexcept { return fd_epoll; };
+    inline auto& get_connections() noexcept { return connections; };
     inline auto& get_rx_sockets() noexcept { return rx_sockets; };
     inline auto& get_tx_sockets() noexcept { return tx_sockets; };
     inline auto& get_dx_sockets() noexcept { return dx_sockets; };
+    /** @brief Number of pooled sockets ready to be handed out to new connections */
+    inline auto get_n_sockets_free() const noexcept { return sockets_free.size(); };
 
 private:
     int fd_epoll{ -1 };                 // file descriptor for EPOLL
     TCPSocket listener_socket;          // listener for new incoming connections
     epoll_event events[1024];           // for monitoring the listener fd
-    std::vector<TCPSocket*> rx_sockets; // receiving sockets
-    std::vector<TCPSocket*> tx_sockets; // transmission sockets
-    std::vector<TCPSocket*> dx_sockets; // disconnected sockets
+    // every open connection, indexed by each socket's conn.i_table
+    std::vector<TCPSocket*> connections;
+    std::vector<TCPSocket*> rx_sockets; // connections with data ready to read
+    std::vector<TCPSocket*> tx_sockets; // connections with data loaded to send
+    std::vector<TCPSocket*> dx_sockets; // disconnected sockets, to be closed
+    std::vector<std::unique_ptr<TCPSocket>> sockets;    // every connection socket created
+    std::vector<TCPSocket*> sockets_free;   // pooled sockets ready for new connections
+    // released sockets which the ring may still be sending from, to be pooled once it's done
+    std::vector<TCPSocket*> sockets_draining;
+    const size_t size_socket_buffer;
+    size_t tx_high_watermark;           // most unsent data a connection may hold
+    IORing* ring{ nullptr };            // sends and receives for connections, if set
     // rx data available callback
     std::function<void(TCPSocket* s, Nanos t_rx)> rx_callback;
     // callback when all rx sockets have completed read cycle
     std::function<void()> rx_done_callback;
+    // callback when a connection is closed
+    std::function<void(TCPSocket* s)> dx_callback;
     std::string t_str;
     Logger& logger;
 
@@ -90,13 +187,51 @@ private:
      * @return 0 if success, -1 if failure
      */
     auto epoll_add(TCPSocket* socket) -> int;
+    /**
+     * @brief Create a new connection socket, owned by the server
+     */
+    auto create_socket() -> TCPSocket*;
+    /**
+     * @brief Take a socket from the pool for a new connection, growing the pool if it's empty
+     */
+    auto acquire_socket() -> TCPSocket*;
+    /**
+     * @brief Close a disconnected socket, stop tracking it and return it to the pool, once
+     * any operations an IORing has in flight on it are done
+     */
+    void release_socket(TCPSocket* socket) noexcept;
+    /**
+     * @brief Send from each connection with data loaded, then recycle those disconnected
+     */
+    void tx_and_recycle() noexcept;
+    /** @brief Add a socket to the list to read from, unless it's already on it */
+    inline void mark_rx_ready(TCPSocket* socket) noexcept {
+        if (!socket->conn.is_rx_ready) {
+            socket->conn.is_rx_ready = true;
+            rx_sockets.push_back(socket);
+        }
+    }
+    /** @brief Add a socket to the list to send from, unless it's already on it */
+    inline void mark_tx_ready(TCPSocket* socket) noexcept {
+        if (!socket->conn.is_tx_ready) {
+            socket->conn.is_tx_ready = true;
+            tx_sockets.push_back(socket);
+        }
+    }
+    /** @brief Add a socket to the list to close, unless it's already on it */
+    inline void mark_dx(TCPSocket* socket) noexcept {
+        if (!socket->conn.is_dx) {
+            socket->conn.is_dx = true;
+            dx_sockets.push_back(socket);
+        }
+    }
     /**
      * @brief Default rx callback simply logs a message on receipt
      */
     void default_rx_callback(TCPSocket* socket, Nanos t_rx) noexcept {
         logger.logf("% <TCPServer::%> socket: %, len: %, rx: %\n",
                     LL::get_time_str(&t_str), __FUNCTION__,
-                    socket->fd, socket->i_rx_next, t_rx);
+                    socket->fd, socket->rx_buffer.size(), t_rx);
     }
     /**
     * @brief Default rx complete callback simply logs a message on receipt
@@ -105,6 +240,13 @@ private:
         logger.logf("% <TCPServer::%> server rx done\n",
                     LL::get_time_str(&t_str), __FUNCTION__);
     }
+    /**
+     * @brief Default disconnect callback simply logs a message
+     */
+    void default_dx_callback(TCPSocket* socket) noexcept {
+        logger.logf("% <TCPServer::%> socket: % disconnected\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, socket->fd);
+    }
 };
 
 }
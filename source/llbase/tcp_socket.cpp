@@ -5,10 +5,11 @@ namespace LL
 {
 
 auto TCPSocket::connect(const std::string& ip, const std::string& iface, int port,
-                        bool is_listening) -> int {
+                        bool is_listening, bool is_reuse_port) -> int {
     // configure and create socket
     const SocketConfig conf{
-            ip, iface, port, false, is_listening, true };
+            ip, iface, port, false, is_listening, true, is_reuse_port,
+            tuning.is_hw_timestamps, tuning };
     fd = create_socket(conf, logger);
     // set connection attributes and return descriptor
     in_inaddr.sin_addr.s_addr = INADDR_ANY;
@@ -19,49 +20,227 @@ auto TCPSocket::connect(const std::string& ip, const std::string& iface, int por
 
 void TCPSocket::load_tx(const void* data, size_t len) noexcept {
     // we simply copy the given data into the buffer and advance its index
-    memcpy(tx_buffer.data() + i_tx_next, data, len);
-    i_tx_next += len;
-    ASSERT(i_tx_next < TCP_BUFFER_SIZE,
+    VERIFY(i_tx_next + len <= size_buffer,
            "<TCPSocket> tx buffer overflow! Have you called tx_and_rx()?");
+    memcpy(tx_buffer.get() + i_tx_next, data, len);
+    i_tx_next += len;
+    if (!conn.is_tx_ready && tx_ready_callback)
+        tx_ready_callback(this);
+}
+
+auto TCPSocket::attach(IORing& io_ring) noexcept -> bool {
+    const auto i_slot = io_ring.attach(fd, {
+            [this](const char* data, size_t len) { return ring_rx(data, len); },
+            [this](int res) {
+                logger.logf("% <TCPSocket::%> rx ended at socket %, res: %\n",
+                            LL::get_time_str(&t_str), __FUNCTION__, fd, res);
+                is_peer_closed = true;
+                has_ring_rx = true;
+                if (rx_ready_callback)
+                    rx_ready_callback(this);
+            },
+            [this](int res) { ring_tx_done(res); }});
+    if (i_slot < 0)
+        return false;
+    ring = &io_ring;
+    i_ring_slot = i_slot;
+    return true;
+}
+
+auto TCPSocket::enable_tx_timestamps() noexcept -> bool {
+    if (!tx_completions.enable_tx_timestamps(fd)) {
+        logger.logf("% <TCPSocket::%> tx timestamps unavailable at socket %, error: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, fd, std::string(strerror(errno)));
+        return false;
+    }
+    return true;
+}
+
+auto TCPSocket::enable_zerocopy(size_t size_min) noexcept -> bool {
+    if (!tx_completions.enable_zerocopy(fd, size_min)) {
+        logger.logf("% <TCPSocket::%> zerocopy unavailable at socket %, error: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, fd, std::string(strerror(errno)));
+        return false;
+    }
+    return true;
+}
+
+void TCPSocket::read_tx_completions() noexcept {
+    const auto is_newly_copied = tx_completions.read(fd, [this](uint32_t id, Nanos t_tx) {
+        if (tx_timestamp_callback)
+            tx_timestamp_callback(this, id, t_tx);
+    });
+    if (is_newly_copied)
+        logger.logf("% <TCPSocket::%> zerocopy sends are being copied at socket %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, fd);
+    recycle_tx_buffer();
+}
+
+void TCPSocket::recycle_tx_buffer() noexcept {
+    // what zerocopy sends hold stays put until the kernel's done with it
+    if (tx_completions.is_zerocopy_pending() || !i_tx_start)
+        return;
+    // anything still to send moves up to the front, so the buffer doesn't creep along
+    memmove(tx_buffer.get(), tx_buffer.get() + i_tx_start, i_tx_next - i_tx_start);
+    i_tx_next -= i_tx_start;
+    i_tx_start = 0;
+}
+
+void TCPSocket::detach() noexcept {
+    if (ring == nullptr)
+        return;
+    // a send the ring has in flight may still read from tx_buffer until it's cancelled
+    ring->detach(i_ring_slot);
+    if (ring->is_draining(i_ring_slot)) {
+        ring_draining = ring;
+        i_ring_slot_draining = i_ring_slot;
+    }
+    ring = nullptr;
+    i_ring_slot = -1;
+    n_tx_in_flight = 0;
+    has_ring_rx = false;
+}
+
+auto TCPSocket::is_ring_draining() noexcept -> bool {
+    if (ring_draining == nullptr)
+        return false;
+    if (ring_draining->is_draining(i_ring_slot_draining))
+        return true;
+    ring_draining = nullptr;
+    i_ring_slot_draining = -1;
+    return false;
 }
 
-auto TCPSocket::tx_and_rx() noexcept -> bool {
-    char ctrl[CMSG_SPACE(sizeof(struct timeval))];
-    auto cmsg = reinterpret_cast<struct cmsghdr*>(&ctrl);
+auto TCPSocket::ring_rx(const char* data, size_t len) noexcept -> bool {
+    // no room yet; the ring offers the data again once the rx_callback has consumed some
+    if (len > rx_buffer.get_n_free())
+        return false;
+    memcpy(rx_buffer.write_ptr(), data, len);
+    rx_buffer.commit(len);
+    if (!has_ring_rx) {
+        has_ring_rx = true;
+        t_ring_rx = get_time_nanos();
+        if (rx_ready_callback)
+            rx_ready_callback(this);
+    }
+    return true;
+}
+
+void TCPSocket::ring_tx_done(int res) noexcept {
+    logger.logf("% <TCPSocket::%> TX at socket %, size: %\n",
+                LL::get_time_str(&t_str), __FUNCTION__, fd, res);
+    // anything loaded while the send was in flight moves up to the front, along with any
+    //  part the send didn't get to; the in flight bytes are dropped if it failed outright
+    const auto n_done = res > 0 ? static_cast<size_t>(res) : n_tx_in_flight;
+    if (res > 0)
+        tx_completions.on_sent(static_cast<uint32_t>(res), 0);
+    memmove(tx_buffer.get(), tx_buffer.get() + n_done, i_tx_next - n_done);
+    i_tx_next -= n_done;
+    n_tx_in_flight = 0;
+}
 
-    iovec iov{ rx_buffer.data() + i_rx_next, TCP_BUFFER_SIZE - i_rx_next };
+auto TCPSocket::receive() noexcept -> bool {
+    if (ring != nullptr) {
+        // the ring has already received into rx_buffer
+        if (!has_ring_rx)
+            return false;
+        has_ring_rx = false;
+        if (rx_buffer.empty())
+            return false;
+        logger.logf("% <TCPSocket::%> RX at socket %, len: %, t_ring: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, fd, rx_buffer.size(), t_ring_rx);
+        t_rx_last = t_ring_rx;
+        return true;
+    }
+    TimestampControl ctrl;
+
+    // data is received straight into the ring after whatever is still unread
+    const auto n_free = rx_buffer.get_n_free();
+    iovec iov{ rx_buffer.write_ptr(), n_free };
     msghdr msg{ &in_inaddr, sizeof(in_addr),
-                &iov, 1, ctrl,
-                sizeof(ctrl), 0 };
+                &iov, 1, ctrl.buffer,
+                sizeof(ctrl.buffer), 0 };
 
     // non-blocking read of data
     const auto rx_size = recvmsg(fd, &msg, MSG_DONTWAIT);
+    is_rx_pending = (static_cast<size_t>(std::max(rx_size, ssize_t{ 0 })) == n_free);
+    if (rx_size == 0 && n_free)
+        is_peer_closed = true;
     if (rx_size > 0) {
-        i_rx_next += rx_size;
-        Nanos t_kernel{ };
-        timeval kernel_timeval{ };
-        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMP
-                && cmsg->cmsg_len == CMSG_LEN(sizeof(kernel_timeval))) {
-            memcpy(&kernel_timeval, CMSG_DATA(cmsg), sizeof(kernel_timeval));
-            t_kernel = kernel_timeval.tv_sec * NANOS_TO_SECS
-                    + kernel_timeval.tv_usec * NANOS_TO_MICROS; // timestamp converted to ns
+        rx_buffer.commit(rx_size);
+        if (tuning.is_quickack) {
+            // the kernel drops back to delayed acks once it sees fit, so it's asked again
+            const int one{ 1 };
+            setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
         }
+        const auto t_kernel = get_timestamp(msg);
         const auto t_user = get_time_nanos();
         logger.logf("% <TCPSocket::%> RX at socket %, len: %, t_user: %, t_kernel: %, delta: %\n",
-                    LL::get_time_str(&t_str), __FUNCTION__, fd, i_rx_next,
+                    LL::get_time_str(&t_str), __FUNCTION__, fd, rx_buffer.size(),
                     t_user, t_kernel, (t_user - t_kernel));
-        rx_callback(this, t_kernel);
+        t_rx_last = t_kernel;
+    }
+    return (rx_size > 0);
+}
+
+void TCPSocket::tx() noexcept {
+    if (ring != nullptr) {
+        // one send at a time is handed to the ring; data loaded meanwhile goes out next
+        if (i_tx_next > 0 && !n_tx_in_flight
+                && ring->send(i_ring_slot, tx_buffer.get(), i_tx_next))
+            n_tx_in_flight = i_tx_next;
+    } else {
+        send_tx_buffer();
     }
+    // sends are stamped and completed as they leave, which may be some time after they're made
+    if (tx_completions.is_pending())
+        read_tx_completions();
+}
 
-    // non-blocking write out of data in tx buffer
-    if (i_tx_next > 0) {
-        const auto n = send(fd, tx_buffer.data(),
-                            i_tx_next, MSG_DONTWAIT | MSG_NOSIGNAL);
-        logger.logf("% <TCPSocket::%> TX at socket %, size: %\n",
-                    LL::get_time_str(&t_str), __FUNCTION__, fd, n);
+void TCPSocket::send_tx_buffer() noexcept {
+    // non-blocking write out of what's still to send in the tx buffer
+    const auto len = i_tx_next - i_tx_start;
+    if (len > 0) {
+        auto is_zerocopy = tx_completions.is_zerocopy_send(i_tx_start, i_tx_next, size_buffer);
+        auto n = send(fd, tx_buffer.get() + i_tx_start, len,
+                      MSG_DONTWAIT | MSG_NOSIGNAL | (is_zerocopy ? MSG_ZEROCOPY : 0));
+        if (n == -1 && is_zerocopy && errno == ENOBUFS) {
+            // no more pages can be pinned for now; this send is copied
+            is_zerocopy = false;
+            n = send(fd, tx_buffer.get() + i_tx_start, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        }
+        logger.logf("% <TCPSocket::%> TX at socket %, size: %, zerocopy: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, fd, n, is_zerocopy);
+        if (n > 0) {
+            i_tx_start += static_cast<size_t>(n);
+            tx_completions.on_sent(static_cast<uint32_t>(n), is_zerocopy);
+        }
+        // the kernel took only part of it, or none: the rest waits until the socket's
+        //  writable again
+        is_tx_blocked = (n >= 0 && static_cast<size_t>(n) < len) || (n < 0 && get_would_block());
+        if (n < 0 && !is_tx_blocked) {
+            // the connection's failed; nothing more can be sent on it
+            logger.logf("% <TCPSocket::%> TX failed at socket %, dropped: %, error: %\n",
+                        LL::get_time_str(&t_str), __FUNCTION__, fd, len,
+                        std::string(strerror(errno)));
+            i_tx_start = i_tx_next;
+        }
     }
-    i_tx_next = 0;
-    return (rx_size > 0);
+    recycle_tx_buffer();
+}
+
+void TCPSocket::reset() noexcept {
+    detach();
+    if (fd != -1)
+        close(fd);
+    fd = -1;
+    i_tx_next = i_tx_start = 0;
+    rx_buffer.clear();
+    is_rx_pending = false;
+    is_peer_closed = false;
+    is_tx_blocked = false;
+    tx_completions = { };
+    conn = { };
 }
 
 }
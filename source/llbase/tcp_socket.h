@@ -14,9 +14,11 @@
 
 
 #include <functional>
-#include <vector>
+#include <memory>
 #include "sockets.h"
 #include "logging.h"
+#include "ring_buffer.h"
+#include "io_ring.h"
 
 
 namespace LL
@@ -24,18 +26,31 @@ namespace LL
 constexpr size_t TCP_BUFFER_SIZE{ 64 * 1024 * 1024 };
 
 
+/**
+ * @brief State of a connection socket, kept by the TCPServer which owns it
+ */
+struct TCPConnectionState {
+    static constexpr uint32_t I_TABLE_NONE{ UINT32_MAX };
+    uint32_t i_table{ I_TABLE_NONE };   // index in the server's connection table
+    bool is_rx_ready{ false };          // on the server's list of sockets to read
+    bool is_tx_ready{ false };          // on the server's list of sockets to send from
+    bool is_dx{ false };                // on the server's list of sockets to close
+};
+
+
 class TCPSocket {
 public:
     /**
      * @brief Create a new low-latency TCP socket
      * @param logger Logging instance to write to
-     * @details Whether to use stack (array) or heap (vector) memory for this
-     * socket's tx/rx buffers should be determined for the specific application use case.
-     * Stack memory may perform better, depending on the buffer and system parameters.
+     * @param size_buffer Size of each of the tx and rx buffers; a power of two and a multiple
+     * of the page size
+     * @details Neither buffer is zero-filled, so their pages are only committed as they're
+     * first used, and an idle socket costs little more than its address space.
      */
-    explicit TCPSocket(Logger& logger) : logger(logger) {
-        tx_buffer.resize(TCP_BUFFER_SIZE);
-        rx_buffer.resize(TCP_BUFFER_SIZE);
+    explicit TCPSocket(Logger& logger, size_t size_buffer = TCP_BUFFER_SIZE)
+            : tx_buffer(new char[size_buffer]), rx_buffer(size_buffer),
+              size_buffer(size_buffer), logger(logger) {
         rx_callback =
                 [this](auto socket, auto t_rx) { default_rx_callback(socket, t_rx); };
     }
@@ -45,48 +60,180 @@ public:
      * @param iface Interface to connect to
      * @param port Port to connect to
      * @param is_listening Binds the socket to port for incoming connections when true
+     * @param is_reuse_port Lets other listening sockets bind the same port (SO_REUSEPORT)
      * @return The file descriptor (fd) integer if successful, else -1
      */
     auto connect(const std::string& ip, const std::string& iface,
-                 int port, bool is_listening) -> int;
+                 int port, bool is_listening, bool is_reuse_port = false) -> int;
     /**
      * @brief Call to load data into the send (tx) buffer for transmission
      * @param data Data to be sent
      * @param len Length of given data
      */
     void load_tx(const void* data, size_t len) noexcept;
+    /**
+     * @brief Hand the socket's sends and receives to an io_uring instance, instead of making
+     * its own syscalls
+     * @details The ring copies each received chunk onto the end of rx_buffer, where rx()
+     * dispatches it as usual, and sends what's loaded without blocking the caller. Receive
+     * times are taken as the ring hands the data over, rather than from the kernel.
+     * @return False if the ring has no room for the socket, which then keeps to its syscalls
+     */
+    auto attach(IORing& ring) noexcept -> bool;
+    /**
+     * @brief Have the kernel stamp each send as it leaves for the interface, and report the
+     * stamps to tx_timestamp_callback from tx_and_rx()
+     * @details Sends are keyed by the index of their last byte, counting bytes sent from here
+     * on. The kernel may stamp only the last of several sends which it merged into one packet.
+     * @return True when successful; the socket must be connected, or connecting
+     */
+    auto enable_tx_timestamps() noexcept -> bool;
+    /**
+     * @brief Send with MSG_ZEROCOPY whenever there's at least size_min to send, so that the
+     * kernel reads it straight from tx_buffer instead of copying it
+     * @details The data sent then stays where it is in tx_buffer, with whatever's loaded after
+     * it following on, until tx_and_rx() finds the kernel has finished with it and rewinds the
+     * buffer. Small sends are still copied, since pinning pages and reading back completions
+     * costs more than copying a few pages, as are sends from past the middle of the buffer,
+     * which leave it room to rewind. Sends made through an IORing are always copied.
+     * @return True when successful
+     */
+    auto enable_zerocopy(size_t size_min = ZEROCOPY_SIZE_MIN) noexcept -> bool;
     /**
      * @brief Publish tx and rx data to buffers, dispatching an rx_callback if needed
+     * @details The rx_callback reads records in place from rx_buffer.data() and consume()s
+     * those it has handled. Any partial record is left for the next call.
      * @return True when data is ready to read in rx_buffer
      */
-    auto tx_and_rx() noexcept -> bool;
+    inline auto tx_and_rx() noexcept -> bool { return tx_and_rx(rx_callback); }
+    /**
+     * @brief Publish tx and rx data to buffers, dispatching to on_rx instead of the
+     * rx_callback
+     * @details The handler's type is known here, so its call (and whatever parsing it does)
+     * can be inlined into the caller's receive loop, rather than made through a
+     * std::function.
+     * @param on_rx Called as on_rx(TCPSocket*, Nanos t_rx), exactly as the rx_callback is
+     */
+    template<typename Handler>
+    inline auto tx_and_rx(Handler&& on_rx) noexcept -> bool {
+        if (ring != nullptr)
+            ring->reap();
+        const auto is_rx = rx(on_rx);
+        tx();
+        if (ring != nullptr)
+            ring->submit();
+        return is_rx;
+    }
+    /**
+     * @brief Non-blocking read into rx_buffer, dispatching an rx_callback if anything was read
+     * @return True when data was received
+     */
+    inline auto rx() noexcept -> bool { return rx(rx_callback); }
+    /**
+     * @brief Non-blocking read into rx_buffer, dispatching to on_rx if anything was read
+     */
+    template<typename Handler>
+    inline auto rx(Handler&& on_rx) noexcept -> bool {
+        if (!receive())
+            return false;
+        on_rx(this, t_rx_last);
+        return true;
+    }
+    /**
+     * @brief Non-blocking write of everything loaded into the tx buffer, and read of any send
+     * timestamps or zerocopy completions waiting
+     * @details Whatever the kernel doesn't take stays at the front of the buffer, to be sent
+     * first by the next call, and is_tx_blocked is set until the owner clears it once the
+     * socket's writable again (ie: on EPOLLOUT). Only a failed connection's data is dropped.
+     */
+    void tx() noexcept;
+    /**
+     * @brief Close the connection and discard any buffered data, so that the socket can be
+     * reused for a new connection
+     */
+    void reset() noexcept;
+    /**
+     * @brief Whether the ring the socket was last attached to may still be sending from its
+     * tx_buffer, in which case it mustn't be reused for a new connection yet
+     */
+    [[nodiscard]] auto is_ring_draining() noexcept -> bool;
+
+    [[nodiscard]] inline auto get_size_buffer() const noexcept { return size_buffer; }
+    /** @brief Number of bytes loaded which have yet to be sent */
+    [[nodiscard]] inline auto get_n_tx_pending() const noexcept {
+        return i_tx_next - i_tx_start;
+    }
 
     ~TCPSocket() {
+        detach();
         close(fd);
     }
 
     int fd{ -1 };
-    std::vector<char> tx_buffer{ };
+    std::unique_ptr<char[]> tx_buffer;
     size_t i_tx_next{ };
+    // start of what's yet to be sent; what's before it has been, and stays put while any
+    //  zerocopy sends are in flight
+    size_t i_tx_start{ };
 
-    std::vector<char> rx_buffer{ };
-    size_t i_rx_next{ };
+    RingBuffer rx_buffer;
+    // the last read filled the buffer, so the kernel may be holding more data to read
+    bool is_rx_pending{ false };
+    bool is_peer_closed{ false };   // the last read found the peer had closed the connection
+    bool is_tx_blocked{ false };    // the last send couldn't take everything loaded
 
+    // t_rx is the kernel's (nanosecond) timestamp of the read's data
     std::function<void(TCPSocket* s, Nanos t_rx)> rx_callback;
+    // called with the id and kernel timestamp of each send stamped, once enabled
+    std::function<void(TCPSocket* s, uint32_t id, Nanos t_tx)> tx_timestamp_callback{ nullptr };
+    // called when an attached IORing delivers data, or the end of the stream, for its owner
+    //  to schedule an rx()
+    std::function<void(TCPSocket* s)> rx_ready_callback{ nullptr };
+    // called when data is loaded into the tx buffer of a socket which isn't on its owner's
+    //  list to send from, for the owner to schedule a tx()
+    std::function<void(TCPSocket* s)> tx_ready_callback{ nullptr };
+    TCPConnectionState conn{ };
+    // applied when the socket is created (or accepted); quickack is re-armed after each read
+    SocketTuning tuning{ };
 
 private:
+    const size_t size_buffer;
     sockaddr_in in_inaddr{ };
     // callback fn when new data is received and available for consumption
     Logger& logger;
     std::string t_str;
 
+    IORing* ring{ nullptr };    // the ring the socket is attached to, if any
+    int i_ring_slot{ -1 };
+    size_t n_tx_in_flight{ };   // bytes at the front of tx_buffer the ring is sending
+    bool has_ring_rx{ false };  // the ring delivered data which rx() hasn't dispatched yet
+    Nanos t_ring_rx{ };
+    Nanos t_rx_last{ };         // of the data the last receive() read, to be dispatched
+    // the ring and slot the socket was detached from, while operations are still in flight
+    IORing* ring_draining{ nullptr };
+    int i_ring_slot_draining{ -1 };
+
+    TxCompletions tx_completions{ };    // sends still to be stamped or completed, in bytes
+
+    void detach() noexcept;
+    /**
+     * @brief Read into rx_buffer without dispatching, noting the data's time in t_rx_last
+     * @return True when there's data to dispatch
+     */
+    auto receive() noexcept -> bool;
+    void read_tx_completions() noexcept;
+    void recycle_tx_buffer() noexcept;
+    void send_tx_buffer() noexcept;
+    auto ring_rx(const char* data, size_t len) noexcept -> bool;
+    void ring_tx_done(int res) noexcept;
+
     /**
      * @brief Default rx callback simply logs a message on receipt
      */
     void default_rx_callback(TCPSocket* socket, Nanos t_rx) noexcept {
         logger.logf("% <TCPSocket::%> socket: %, len: %, rx: %\n",
                     LL::get_time_str(&t_str), __FUNCTION__,
-                    socket->fd, socket->i_rx_next, t_rx);
+                    socket->fd, socket->rx_buffer.size(), t_rx);
     }
 
 DELETE_DEFAULT_COPY_AND_MOVE(TCPSocket)
@@ -13,13 +13,22 @@
 
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <vector>
+#include <set>
 #include <atomic>
+#include <mutex>
 #include <thread>
 #include <memory>
+#include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 #include <sys/syscall.h>
 
+#include "macros.h"
+
 
 namespace LL
 {
@@ -37,45 +46,270 @@ inline auto pin_thread_to_core(int core_id) noexcept {
     return (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set) == 0);
 }
 
+/**
+ * @brief Placement and scheduling policy for a single named thread.
+ */
+struct ThreadConf {
+    std::string name;           // thread name; a trailing '*' matches any name with that prefix
+    int core_id{ -1 };          // core to pin the thread to, or -1 to float
+    int fifo_priority{ 0 };     // SCHED_FIFO priority (1-99), or 0 for the default policy
+    bool is_busy_spin{ false }; // true when the thread spins instead of blocking
+
+    [[nodiscard]] inline auto is_wildcard() const noexcept {
+        return !name.empty() && name.back() == '*';
+    }
+    [[nodiscard]] inline auto matches(const std::string& thread_name) const noexcept {
+        if (is_wildcard())
+            return thread_name.compare(0, name.size() - 1, name, 0, name.size() - 1) == 0;
+        return thread_name == name;
+    }
+};
+
+/**
+ * @brief Parse a kernel CPU list (eg: "1-3,6") into a set of core ids.
+ */
+inline auto parse_cpu_list(const std::string& list) -> std::set<int> {
+    std::set<int> cores;
+    std::stringstream ss{ list };
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n")
+            continue;
+        const auto i_dash = range.find('-');
+        try {
+            const auto first = std::stoi(range.substr(0, i_dash));
+            const auto last = (i_dash == std::string::npos)
+                              ? first : std::stoi(range.substr(i_dash + 1));
+            for (auto core = first; core <= last; ++core)
+                cores.insert(core);
+        } catch (const std::exception&) {
+            // ignore anything which is not a core range
+        }
+    }
+    return cores;
+}
+
+
+class CPULayout final {
+public:
+    static constexpr const char* SYSFS_ISOLATED{ "/sys/devices/system/cpu/isolated" };
+    static constexpr const char* SYSFS_NOHZ_FULL{ "/sys/devices/system/cpu/nohz_full" };
+
+    /**
+     * @brief Maps named component threads to cores and scheduling policies.
+     * @details Once installed, every thread started with create_and_start_thread() whose
+     * name matches an entry is placed according to that entry, instead of the core_id its
+     * caller passed. Threads without an entry keep the caller's placement.
+     */
+    CPULayout() = default;
+    explicit CPULayout(std::vector<ThreadConf> confs) : confs(std::move(confs)) { }
+
+    /**
+     * @brief Load a layout from a text file, with one thread per line in the format:
+     *  <thread_name> <core_id> [fifo=<priority>] [spin]
+     * @details Blank lines and lines beginning with '#' are ignored.
+     */
+    static auto from_file(const std::string& filename) -> CPULayout {
+        std::ifstream file{ filename };
+        VERIFY(file.is_open(), "<CPULayout> could not open layout file " + filename);
+        CPULayout layout;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::stringstream ss{ line };
+            ThreadConf conf;
+            if (!(ss >> conf.name) || conf.name[0] == '#')
+                continue;
+            VERIFY(static_cast<bool>(ss >> conf.core_id),
+                   "<CPULayout> missing core id for thread " + conf.name);
+            std::string option;
+            while (ss >> option) {
+                if (option == "spin")
+                    conf.is_busy_spin = true;
+                else if (option.rfind("fifo=", 0) == 0)
+                    conf.fifo_priority = std::stoi(option.substr(5));
+                else
+                    FATAL("<CPULayout> unknown option " + option + " for thread " + conf.name);
+            }
+            layout.add(conf);
+        }
+        return layout;
+    }
+
+    inline void add(const ThreadConf& conf) { confs.push_back(conf); }
+
+    /** @brief Find the first entry matching the thread name, or nullptr */
+    [[nodiscard]] auto find(const std::string& thread_name) const noexcept -> const ThreadConf* {
+        for (const auto& conf: confs) {
+            if (conf.matches(thread_name))
+                return &conf;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Check the layout can be applied.
+     * @details Two busy-spinning threads on one core would starve each other, so this is
+     * refused, as are cores which do not exist and out of range priorities. A wildcard entry
+     * may match several threads, which would all share its core, so it may only spin if it
+     * floats.
+     * @return A description of each problem found; empty if the layout is valid
+     */
+    [[nodiscard]] auto validate() const -> std::vector<std::string> {
+        std::vector<std::string> errors;
+        const auto n_cores = static_cast<int>(std::thread::hardware_concurrency());
+        for (size_t i{ }; i < confs.size(); ++i) {
+            const auto& a = confs[i];
+            if (a.core_id >= n_cores)
+                errors.push_back(a.name + " is pinned to core " + std::to_string(a.core_id)
+                                 + ", but only " + std::to_string(n_cores) + " exist");
+            if (a.fifo_priority < 0 || a.fifo_priority > 99)
+                errors.push_back(a.name + " has SCHED_FIFO priority out of range (1-99)");
+            if (a.is_busy_spin && a.is_wildcard() && a.core_id >= 0)
+                errors.push_back(a.name + " may match several threads, which would all busy-spin"
+                                 " on core " + std::to_string(a.core_id));
+            for (size_t j{ i + 1 }; j < confs.size(); ++j) {
+                const auto& b = confs[j];
+                if (a.is_busy_spin && b.is_busy_spin && a.core_id >= 0
+                        && a.core_id == b.core_id)
+                    errors.push_back(a.name + " and " + b.name + " both busy-spin on core "
+                                     + std::to_string(a.core_id));
+            }
+        }
+        return errors;
+    }
+
+    /**
+     * @brief Compare the layout with the kernel's isolcpus= and nohz_full= settings.
+     * @return A description of each busy-spinning thread pinned to a core which is not
+     * isolated or not tickless; empty if there is no mismatch
+     */
+    [[nodiscard]] auto check_isolation() const -> std::vector<std::string> {
+        const auto isolated = parse_cpu_list(read_sysfs(SYSFS_ISOLATED));
+        const auto nohz_full = parse_cpu_list(read_sysfs(SYSFS_NOHZ_FULL));
+        std::vector<std::string> mismatches;
+        for (const auto& conf: confs) {
+            if (!conf.is_busy_spin || conf.core_id < 0)
+                continue;
+            if (!isolated.contains(conf.core_id))
+                mismatches.push_back(conf.name + " busy-spins on core "
+                                     + std::to_string(conf.core_id) + " which is not in isolcpus");
+            if (!nohz_full.contains(conf.core_id))
+                mismatches.push_back(conf.name + " busy-spins on core "
+                                     + std::to_string(conf.core_id) + " which is not in nohz_full");
+        }
+        return mismatches;
+    }
+
+    /**
+     * @brief Install a layout for all threads subsequently started in this process.
+     * @return false (and the layout is not installed) if the layout is invalid
+     */
+    static auto install(const CPULayout& layout) -> bool {
+        const auto errors = layout.validate();
+        for (const auto& e: errors)
+            std::cerr << "<CPULayout> refusing layout: " << e << "\n";
+        if (!errors.empty())
+            return false;
+        std::lock_guard<std::mutex> lock(installed_mutex);
+        get_installed() = layout;
+        return true;
+    }
+
+    /**
+     * @brief Get the installed placement for a thread, falling back to the given core_id
+     * (and the default scheduling policy) when the layout has no entry for it.
+     */
+    static auto lookup(const std::string& thread_name, int core_id) -> ThreadConf {
+        std::lock_guard<std::mutex> lock(installed_mutex);
+        if (const auto conf = get_installed().find(thread_name))
+            return *conf;
+        return { thread_name, core_id, 0, false };
+    }
+
+    [[nodiscard]] inline const auto& get_confs() const noexcept { return confs; }
+
+private:
+    std::vector<ThreadConf> confs;
+    static inline std::mutex installed_mutex;
+
+    /** @brief The process-wide installed layout; guarded by installed_mutex */
+    static auto get_installed() -> CPULayout& {
+        static CPULayout installed;
+        return installed;
+    }
+
+    static auto read_sysfs(const char* path) -> std::string {
+        std::ifstream file{ path };
+        std::string contents;
+        std::getline(file, contents);
+        return contents;
+    }
+};
+
+/**
+ * @brief Set the calling thread's scheduling policy to SCHED_FIFO at the given priority
+ * @return false if the policy could not be set (eg: missing CAP_SYS_NICE)
+ */
+inline auto set_thread_fifo_priority(int priority) noexcept {
+    sched_param param{ };
+    param.sched_priority = priority;
+    return (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0);
+}
+
 /**
  * @brief Create and start a POSIX thread, pinning to the specified core_id
  * @tparam T Type of callable object for the thread to work on
  * @tparam A Variadic parameter pack for the callable T
- * @param core_id Core ID to pin the thread to
+ * @param core_id Core ID to pin the thread to, unless the installed CPULayout places it
  * @param name String identifier for the thread
  * @param fn The callable object for the thread to work on
  * @param args Zero or more arguments passed to the callable fn
  * @return The created thread, or nullptr if thread creation failed
+ * @details The callable and its arguments are moved into the new thread, and the caller
+ * blocks on a futex (via std::atomic::wait) only until the thread has been placed, so
+ * startup costs microseconds rather than a polling interval.
  */
 template<typename T, typename... A>
 inline auto create_and_start_thread(int core_id, const std::string& name, T&& fn, A&& ...args)
 noexcept {
-    std::atomic<bool> running{ false }, failed{ false };
+    enum State : int { STARTING = 0, RUNNING = 1, FAILED = 2 };
+    // shared, since the thread may still be signalling when the caller wakes and returns
+    auto state = std::make_shared<std::atomic<int>>(STARTING);
+    auto conf = CPULayout::lookup(name, core_id);
+    conf.name = name;
 
-    // lambda of thread body, passed to ctor such that any kind of fn and arbitrary
+    // the thread body owns everything it uses, so any kind of fn and arbitrary
     //  arguments/types can be passed to std::thread
-    auto thread_body = [&] {
+    auto thread_body = [state, conf, fn = std::forward<T>(fn),
+                        ...args = std::forward<A>(args)]() mutable {
+        const auto signal = [&state](int s) {
+            state->store(s, std::memory_order_release);
+            state->notify_one();
+        };
         // fail if the thread cannot be pinned to the specified core_id
-        if (core_id >= 0 && !pin_thread_to_core(core_id)) {
-            std::cerr << "<Threading> failed to set core affinity for " << name << " "
-                      << pthread_self() << " to " << core_id << "\n";
-            failed = true;
+        if (conf.core_id >= 0 && !pin_thread_to_core(conf.core_id)) {
+            std::cerr << "<Threading> failed to set core affinity for " << conf.name << " "
+                      << pthread_self() << " to " << conf.core_id << "\n";
+            signal(FAILED);
             return;
         }
-        std::cout << "<Threading> setting core affinity for " << name << " " << pthread_self()
-                  << " to " << core_id << "\n";
-        running = true;
-        // perfect forwarding is used to pass fn's variadic l/rvalues
-        std::forward<T>(fn)((std::forward<A>(args))...);
+        std::cout << "<Threading> setting core affinity for " << conf.name << " "
+                  << pthread_self() << " to " << conf.core_id << "\n";
+        // a real-time policy which can't be applied is reported, but is not fatal
+        if (conf.fifo_priority > 0 && !set_thread_fifo_priority(conf.fifo_priority)) {
+            std::cerr << "<Threading> failed to set SCHED_FIFO priority "
+                      << conf.fifo_priority << " for " << conf.name << "\n";
+        }
+        // name the thread for debuggers and tracing (the kernel limit is 15 chars)
+        pthread_setname_np(pthread_self(), conf.name.substr(0, 15).c_str());
+        signal(RUNNING);
+        fn(args...);
     };
 
     // instantiate thread, waiting for it to start or fail
-    auto t = std::make_unique<std::thread>(thread_body);
-    while (!(running || failed)) {
-        using namespace std::literals::chrono_literals;
-        std::this_thread::sleep_for(50ms);
-    }
-    if (failed) {
+    auto t = std::make_unique<std::thread>(std::move(thread_body));
+    state->wait(STARTING, std::memory_order_acquire);
+    if (state->load(std::memory_order_acquire) == FAILED) {
         t->join();
         t = nullptr;
     }
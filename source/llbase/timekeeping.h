@@ -13,10 +13,24 @@
 #pragma once
 
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <ctime>
+#include <cstdlib>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <cpuid.h>
+#include <x86intrin.h>
+
+#include "macros.h"
+#include "threading.h"
 
 
 namespace LL
@@ -29,14 +43,318 @@ constexpr Nanos MILLIS_TO_SECS{ 1000 };
 constexpr Nanos NANOS_TO_MILLIS = NANOS_TO_MICROS * MICROS_TO_MILLIS;
 constexpr Nanos NANOS_TO_SECS = NANOS_TO_MILLIS * MILLIS_TO_SECS;
 
-/** @brief Get the current time, in nanoseconds */
-inline auto get_time_nanos() noexcept {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count();
+/** @brief Read the CPU's timestamp counter (cycles since reset) */
+inline auto read_cycles() noexcept -> uint64_t {
+    return __rdtsc();
+}
+
+/**
+ * @brief Whether the CPU's timestamp counter is invariant, ie: ticks at a constant rate
+ * through frequency changes and sleep states (the constant_tsc and nonstop_tsc flags).
+ */
+inline auto is_tsc_invariant() noexcept -> bool {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+        return false;
+    return edx & (1u << 8);
+}
+
+/**
+ * @brief Read the CPU's timestamp counter once all prior instructions have completed.
+ * @details Use this to stamp the end of a measured region, so the region's work is not
+ * reordered past the read.
+ */
+inline auto read_cycles_ordered() noexcept -> uint64_t {
+    unsigned int aux;
+    return __rdtscp(&aux);
 }
 
-/** @brief Get the current time, as a string */
+
+class TSCClock final {
+public:
+    // how long the startup calibration measures the cycle rate for
+    static constexpr Nanos T_CALIBRATION{ 10 * NANOS_TO_MILLIS };
+    // the largest fractional rate change a single correction may apply when slewing
+    static constexpr double MAX_SLEW{ 0.01 };
+
+    /**
+     * @brief The process-wide TSC clock, calibrated on first use.
+     * @details Calibration spins for T_CALIBRATION, so call calibrate() at startup rather
+     * than leaving it to the first timestamp taken on a hot path thread.
+     */
+    static auto get() noexcept -> TSCClock& {
+        static TSCClock clock;
+        return clock;
+    }
+
+    /**
+     * @brief Calibrate the process-wide clock now. Call once from main(), before starting
+     * any component threads.
+     */
+    static void calibrate() noexcept {
+        get();
+    }
+
+    /**
+     * @brief Get the current time, in nanoseconds since the epoch.
+     * @details Costs a single rdtsc plus a handful of loads, and is monotonic across calls.
+     * Falls back to CLOCK_MONOTONIC_RAW, aligned to the epoch at calibration, when the TSC
+     * is not invariant, since its rate then changes with the core's frequency.
+     */
+    [[nodiscard]] inline auto now_nanos() const noexcept -> Nanos {
+        if (!is_invariant) [[unlikely]]
+            return read_clock(CLOCK_MONOTONIC_RAW) + epoch_offset;
+        return to_nanos(read_cycles());
+    }
+
+    /**
+     * @brief Convert a cycle stamp taken with read_cycles() into nanoseconds since the epoch.
+     */
+    [[nodiscard]] inline auto to_nanos(uint64_t cycles) const noexcept -> Nanos {
+        // seqlock read, retried in the rare case a correction is being published
+        uint64_t seq, base_cycles_;
+        Nanos base_nanos_;
+        double nanos_per_cycle_;
+        do {
+            seq = n_seq.load(std::memory_order_acquire);
+            base_cycles_ = base_cycles.load(std::memory_order_relaxed);
+            base_nanos_ = base_nanos.load(std::memory_order_relaxed);
+            nanos_per_cycle_ = nanos_per_cycle.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((seq & 1) || seq != n_seq.load(std::memory_order_relaxed));
+        const auto dt_cycles = static_cast<int64_t>(cycles - base_cycles_);
+        return base_nanos_ + static_cast<Nanos>(static_cast<double>(dt_cycles) * nanos_per_cycle_);
+    }
+
+    /**
+     * @brief Correct the clock for drift against CLOCK_MONOTONIC_RAW.
+     * @details The cycle rate is re-measured over the interval since the previous correction,
+     * and any accumulated error is slewed out over the next interval rather than stepped,
+     * so the clock never runs backwards. Call this periodically (eg: every few hundred ms)
+     * from a single housekeeping thread.
+     */
+    void correct() noexcept {
+        const auto [cycles, t_ref] = sample();
+        const auto t_model = to_nanos(cycles);
+        const auto dt_cycles = static_cast<double>(cycles - cycles_last_ref);
+        const auto dt_ref = static_cast<double>(t_ref - t_last_ref);
+        if (dt_cycles <= 0.0 || dt_ref <= 0.0) [[unlikely]]
+            return;
+        const auto slew = std::clamp(static_cast<double>(t_ref - t_model) / dt_ref,
+                                     -MAX_SLEW, MAX_SLEW);
+        publish(cycles, t_model, dt_ref / dt_cycles * (1.0 + slew));
+        cycles_last_ref = cycles;
+        t_last_ref = t_ref;
+    }
+
+    /** @brief Whether now_nanos() reads the TSC, rather than falling back to clock_gettime() */
+    [[nodiscard]] inline auto get_is_invariant() const noexcept { return is_invariant; }
+
+    /** @brief Measured TSC frequency, in cycles per nanosecond (ie: GHz) */
+    [[nodiscard]] inline auto get_cycles_per_nano() const noexcept {
+        return 1.0 / nanos_per_cycle.load(std::memory_order_relaxed);
+    }
+
+private:
+    const bool is_invariant{ is_tsc_invariant() };
+    std::atomic<uint64_t> n_seq{ 0 };
+    std::atomic<uint64_t> base_cycles{ 0 };
+    std::atomic<Nanos> base_nanos{ 0 };
+    std::atomic<double> nanos_per_cycle{ 1.0 };
+    Nanos epoch_offset{ };          // CLOCK_REALTIME - CLOCK_MONOTONIC_RAW at calibration
+    uint64_t cycles_last_ref{ };    // cycle stamp of the last reference sample
+    Nanos t_last_ref{ };            // epoch time of the last reference sample
+
+    /**
+     * @brief Calibrate the cycle rate by spinning against CLOCK_MONOTONIC_RAW.
+     */
+    TSCClock() noexcept {
+        epoch_offset = read_clock(CLOCK_REALTIME) - read_clock(CLOCK_MONOTONIC_RAW);
+        const auto [cycles_0, t_0] = sample();
+        auto [cycles_1, t_1] = sample();
+        while (t_1 - t_0 < T_CALIBRATION)
+            std::tie(cycles_1, t_1) = sample();
+        publish(cycles_1, t_1,
+                static_cast<double>(t_1 - t_0) / static_cast<double>(cycles_1 - cycles_0));
+        cycles_last_ref = cycles_1;
+        t_last_ref = t_1;
+    }
+
+    static inline auto read_clock(clockid_t clock) noexcept -> Nanos {
+        timespec ts{ };
+        clock_gettime(clock, &ts);
+        return ts.tv_sec * NANOS_TO_SECS + ts.tv_nsec;
+    }
+
+    /**
+     * @brief Take a paired (cycles, epoch nanos) reference sample.
+     * @details The cycle stamp is the midpoint of the tightest of a few reads bracketing
+     * the clock_gettime() call, to minimise error from preemption.
+     */
+    auto sample() const noexcept -> std::pair<uint64_t, Nanos> {
+        uint64_t best_window{ UINT64_MAX }, best_cycles{ };
+        Nanos best_t{ };
+        for (int i{ }; i < 5; ++i) {
+            const auto c0 = read_cycles_ordered();
+            const auto t = read_clock(CLOCK_MONOTONIC_RAW);
+            const auto c1 = read_cycles_ordered();
+            if (c1 - c0 < best_window) {
+                best_window = c1 - c0;
+                best_cycles = c0 + (c1 - c0) / 2;
+                best_t = t;
+            }
+        }
+        return { best_cycles, best_t + epoch_offset };
+    }
+
+    /** @brief Publish new conversion parameters to readers (single writer only) */
+    inline void publish(uint64_t cycles, Nanos nanos, double rate) noexcept {
+        const auto seq = n_seq.load(std::memory_order_relaxed);
+        n_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        base_cycles.store(cycles, std::memory_order_relaxed);
+        base_nanos.store(nanos, std::memory_order_relaxed);
+        nanos_per_cycle.store(rate, std::memory_order_relaxed);
+        n_seq.store(seq + 2, std::memory_order_release);
+    }
+};
+
+/**
+ * @brief Get the current time, in nanoseconds since the epoch.
+ * @details Read from the calibrated TSC clock, so it is cheap and monotonic.
+ */
+inline auto get_time_nanos() noexcept -> Nanos {
+    return TSCClock::get().now_nanos();
+}
+
+
+class CoarseClock final {
+public:
+    // period (in us) between updates of the coarse time; ie: 4000 updates per second
+    static constexpr int T_UPDATE_US{ 250 };
+    // period (in ms) between drift corrections of the TSC clock
+    static constexpr Nanos T_CORRECTION_MS{ 500 };
+    // formatted time strings are ctime() style, eg: "Sun Jan 12 13:45:01 2025"
+    static constexpr size_t TIME_STR_SIZE{ 32 };
+    static constexpr size_t N_TIME_STRS{ 4 };
+
+    /**
+     * @brief Start the housekeeping thread which publishes the coarse time and time string.
+     * @details Reference counted, so any number of components may start and stop the clock;
+     * the thread runs until the last one stops it. The thread also periodically corrects
+     * the TSC clock for drift.
+     */
+    static void start() noexcept {
+        std::lock_guard<std::mutex> lock(users_mutex);
+        if (n_users++)
+            return;
+        update(TSCClock::get().now_nanos());
+        is_running = true;
+        thread = create_and_start_thread(-1, "CoarseClock", []() { run(); });
+        VERIFY(thread != nullptr, "<CoarseClock> failed to start thread");
+        // the process may exit() without stopping the clock, eg: from a signal handler or
+        //  a failed VERIFY, and the thread must not be left joinable when it does
+        static const auto is_registered = (std::atexit(stop_at_exit) == 0);
+        (void) is_registered;
+    }
+
+    /** @brief Release the clock; the thread stops once its last user has released it. */
+    static void stop() noexcept {
+        std::lock_guard<std::mutex> lock(users_mutex);
+        if (n_users == 0 || --n_users)
+            return;
+        is_running = false;
+        if (thread != nullptr && thread->joinable())
+            thread->join();
+        thread = nullptr;
+        time_str.store(nullptr, std::memory_order_release);
+        t_nanos.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get the time in epoch nanoseconds, accurate to the update period.
+     * @details A single load while the clock is running, else falls back to the TSC clock.
+     * The time is zero whenever the clock is stopped.
+     */
+    [[nodiscard]] static inline auto get_nanos() noexcept -> Nanos {
+        if (const auto t = t_nanos.load(std::memory_order_relaxed)) [[likely]]
+            return t;
+        return TSCClock::get().now_nanos();
+    }
+
+    /**
+     * @brief Get the current preformatted time string, or nullptr when not running.
+     * @details The string is reformatted only when the second ticks over, into a ring of
+     * buffers, so a reader's copy is only torn if it stalls for several seconds.
+     */
+    [[nodiscard]] static inline auto get_time_cstr() noexcept -> const char* {
+        return time_str.load(std::memory_order_acquire);
+    }
+
+private:
+    static inline std::mutex users_mutex;
+    static inline int n_users{ 0 };
+    static inline std::atomic<bool> is_running{ false };
+    static inline std::unique_ptr<std::thread> thread{ nullptr };
+    static inline std::atomic<Nanos> t_nanos{ 0 };
+    static inline std::atomic<const char*> time_str{ nullptr };
+    static inline std::array<std::array<char, TIME_STR_SIZE>, N_TIME_STRS> time_strs{ };
+    static inline size_t i_time_str{ 0 };
+    static inline time_t t_secs_formatted{ 0 };
+
+    /**
+     * @brief Stop the thread at exit, however many users still hold the clock.
+     * @details The users' lock isn't taken, since exit() may be called while it's held.
+     */
+    static void stop_at_exit() noexcept {
+        is_running = false;
+        if (thread == nullptr || !thread->joinable())
+            return;
+        if (thread->get_id() == std::this_thread::get_id())
+            thread->detach();
+        else
+            thread->join();
+    }
+
+    static void run() noexcept {
+        auto t_last_correction = TSCClock::get().now_nanos();
+        while (is_running) {
+            const auto t = TSCClock::get().now_nanos();
+            update(t);
+            if (t - t_last_correction > T_CORRECTION_MS * NANOS_TO_MILLIS) {
+                TSCClock::get().correct();
+                t_last_correction = t;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(T_UPDATE_US));
+        }
+    }
+
+    /** @brief Publish the given time, reformatting the time string if the second changed */
+    static void update(Nanos t) noexcept {
+        t_nanos.store(t, std::memory_order_relaxed);
+        const auto t_secs = static_cast<time_t>(t / NANOS_TO_SECS);
+        if (t_secs == t_secs_formatted && time_str.load(std::memory_order_relaxed))
+            return;
+        t_secs_formatted = t_secs;
+        i_time_str = (i_time_str + 1) % N_TIME_STRS;
+        auto& s = time_strs[i_time_str];
+        tm t_local{ };
+        localtime_r(&t_secs, &t_local);
+        strftime(s.data(), s.size(), "%a %b %e %H:%M:%S %Y", &t_local);
+        time_str.store(s.data(), std::memory_order_release);
+    }
+};
+
+/**
+ * @brief Get the current time, as a string
+ * @details Copied from the CoarseClock's preformatted string when it is running, which
+ * avoids formatting the time and (once the string has capacity) allocating on every call.
+ */
 inline auto& get_time_str(std::string* time_str) {
+    if (const auto s = CoarseClock::get_time_cstr()) [[likely]] {
+        time_str->assign(s);
+        return *time_str;
+    }
     const auto time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
     time_str->assign(ctime(&time));
     if (!time_str->empty())
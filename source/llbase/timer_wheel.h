@@ -0,0 +1,277 @@
+/**
+ *
+ *  Low-latency C++ Utilities
+ *
+ *  @file timer_wheel.h
+ *  @brief Hierarchical timer wheel for scheduling work from an event loop
+ *  @author Stacy Gaudreau
+ *  @date 2025.01.19
+ *
+ */
+
+
+#pragma once
+
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "macros.h"
+#include "timekeeping.h"
+
+
+namespace LL
+{
+using TimerID = uint64_t;
+constexpr TimerID TIMER_ID_INVALID{ UINT64_MAX };
+
+/**
+ * @brief A hashed, hierarchical timer wheel which is advanced by its owning thread.
+ * @tparam Handler Callable invoked as handler(TimerID id, uint64_t tag) when a timer fires
+ * @details Timers are kept in intrusive lists in a fixed-size table allocated at
+ * construction, so scheduling, cancelling and firing are O(1) and never allocate. The
+ * wheel has four levels: 256 slots of one tick, then three levels of 64 slots, each slot
+ * spanning the whole of the level beneath it. Timers further out than the top level can
+ * reach are parked at its furthest slot and re-placed as the wheel turns. Not thread safe;
+ * the owning thread schedules, cancels and advances the wheel from its own loop. Scheduling
+ * beyond the capacity given is fatal, so size it for the most timers ever outstanding.
+ */
+template<typename Handler>
+class TimerWheel final {
+public:
+    /**
+     * @param capacity Max number of concurrently scheduled timers
+     * @param t_tick Resolution of the wheel, in ns
+     * @param t_start Time the wheel starts turning from, in ns
+     * @param handler Callable invoked for each timer as it fires
+     */
+    TimerWheel(size_t capacity, Nanos t_tick, Nanos t_start, Handler handler)
+            : timers(capacity), t_tick(t_tick), t_start(t_start), t_now(t_start),
+              handler(handler) {
+        VERIFY(t_tick > 0, "<TimerWheel> tick must be positive");
+        VERIFY(capacity < NIL, "<TimerWheel> capacity is too large");
+        heads.fill(NIL);
+        for (uint32_t i{ }; i < capacity; ++i)
+            timers[i].next = (i + 1 < capacity) ? i + 1 : NIL;
+        i_free = capacity ? 0 : NIL;
+    }
+
+    /**
+     * @brief Schedule a timer to fire at (or just after) the given time.
+     * @param t_expiry Absolute time to fire at, in ns. Times in the past fire on the next tick.
+     * @param tag Caller-defined value passed back to the handler
+     * @param t_interval When non-zero, the timer is re-armed this long after each firing
+     * @return ID with which the timer can be cancelled
+     */
+    auto schedule(Nanos t_expiry, uint64_t tag, Nanos t_interval = 0) noexcept -> TimerID {
+        VERIFY(i_free != NIL, "<TimerWheel> timer capacity exhausted");
+        const auto i = i_free;
+        auto& timer = timers[i];
+        i_free = timer.next;
+        timer.tag = tag;
+        timer.interval = (t_interval + t_tick - 1) / t_tick;
+        timer.expiry = to_tick(t_expiry);
+        timer.is_active = true;
+        place(i);
+        ++n_active;
+        return make_id(i, timer.generation);
+    }
+    /**
+     * @brief Schedule a timer to fire a given delay after the wheel's current time.
+     */
+    auto schedule_after(Nanos t_delay, uint64_t tag, Nanos t_interval = 0) noexcept
+    -> TimerID {
+        return schedule(t_now + t_delay, tag, t_interval);
+    }
+
+    /**
+     * @brief Cancel a scheduled timer.
+     * @return false if the timer has already fired (and was not periodic) or was cancelled
+     */
+    auto cancel(TimerID id) noexcept -> bool {
+        const auto i = static_cast<uint32_t>(id);
+        if (id == TIMER_ID_INVALID || i >= timers.size()) [[unlikely]]
+            return false;
+        auto& timer = timers[i];
+        if (!timer.is_active || timer.generation != static_cast<uint32_t>(id >> 32))
+            return false;
+        unlink(i);
+        release(i);
+        return true;
+    }
+
+    /**
+     * @brief Turn the wheel up to the given time, firing every timer which has expired.
+     * @return Number of timers fired
+     */
+    auto advance(Nanos t) noexcept -> size_t {
+        if (t <= t_now)
+            return 0;
+        t_now = t;
+        const auto tick_target = static_cast<uint64_t>(t - t_start) / t_tick;
+        if (n_active == 0) {
+            // nothing to fire, so skip straight ahead
+            tick_now = std::max(tick_now, tick_target);
+            return 0;
+        }
+        size_t n_fired{ };
+        while (tick_now < tick_target) {
+            ++tick_now;
+            const auto i_slot = tick_now & L0_MASK;
+            if (i_slot == 0) {
+                // the bottom level has wrapped around, so refill it from the levels above
+                for (uint32_t level{ 1 }; level < N_LEVELS; ++level) {
+                    const auto i = (tick_now >> shift(level)) & LN_MASK;
+                    cascade(slot_of(level, i));
+                    if (i != 0)
+                        break;
+                }
+            }
+            n_fired += fire(static_cast<uint32_t>(i_slot));
+        }
+        return n_fired;
+    }
+
+    /** @brief Number of timers currently scheduled */
+    [[nodiscard]] inline auto get_n_active() const noexcept { return n_active; }
+    /** @brief The time the wheel was last advanced to, in ns */
+    [[nodiscard]] inline auto get_t_now() const noexcept { return t_now; }
+
+private:
+    static constexpr uint32_t NIL{ UINT32_MAX };
+    static constexpr uint32_t N_LEVELS{ 4 };
+    static constexpr uint32_t L0_BITS{ 8 };
+    static constexpr uint32_t LN_BITS{ 6 };
+    static constexpr uint64_t L0_SIZE{ 1 << L0_BITS };
+    static constexpr uint64_t LN_SIZE{ 1 << LN_BITS };
+    static constexpr uint64_t L0_MASK{ L0_SIZE - 1 };
+    static constexpr uint64_t LN_MASK{ LN_SIZE - 1 };
+    static constexpr uint64_t MAX_DELTA{ 1ull << (L0_BITS + (N_LEVELS - 1) * LN_BITS) };
+    static constexpr size_t N_SLOTS{ L0_SIZE + (N_LEVELS - 1) * LN_SIZE };
+
+    struct Timer {
+        uint64_t expiry{ };     // tick the timer fires on
+        uint64_t interval{ };   // ticks between firings of a periodic timer, else 0
+        uint64_t tag{ };
+        uint32_t prev{ NIL };
+        uint32_t next{ NIL };
+        uint32_t slot{ NIL };
+        uint32_t generation{ 0 };   // guards against cancelling a recycled timer
+        bool is_active{ false };
+    };
+
+    std::vector<Timer> timers;
+    std::array<uint32_t, N_SLOTS> heads{ };
+    uint32_t i_free{ NIL };
+    size_t n_active{ 0 };
+    const Nanos t_tick;
+    const Nanos t_start;
+    Nanos t_now;
+    uint64_t tick_now{ 0 };     // the last tick processed
+    Handler handler;
+
+    static constexpr auto shift(uint32_t level) noexcept -> uint32_t {
+        return L0_BITS + (level - 1) * LN_BITS;
+    }
+    static constexpr auto slot_of(uint32_t level, uint64_t i) noexcept -> uint32_t {
+        return static_cast<uint32_t>(level == 0 ? i : L0_SIZE + (level - 1) * LN_SIZE + i);
+    }
+    static constexpr auto make_id(uint32_t i, uint32_t generation) noexcept -> TimerID {
+        return (static_cast<uint64_t>(generation) << 32) | i;
+    }
+
+    /** @brief Convert an absolute time to the first tick at or after it */
+    inline auto to_tick(Nanos t) const noexcept -> uint64_t {
+        if (t <= t_start)
+            return 0;
+        return static_cast<uint64_t>(t - t_start + t_tick - 1) / t_tick;
+    }
+
+    /**
+     * @brief Link a timer into the slot matching its expiry, relative to the current tick
+     * @param is_cascading True when re-placing from an upper level, in which case a timer
+     * due on the current tick goes into the bottom level slot about to be fired
+     */
+    inline void place(uint32_t i, bool is_cascading = false) noexcept {
+        auto& timer = timers[i];
+        const auto tick_min = is_cascading ? tick_now : tick_now + 1;
+        if (timer.expiry < tick_min)
+            timer.expiry = tick_min;
+        const auto delta = timer.expiry - tick_now;
+        uint32_t slot;
+        if (delta < L0_SIZE) {
+            slot = slot_of(0, timer.expiry & L0_MASK);
+        } else {
+            // far-off timers are parked at the furthest reachable slot for now
+            const auto expiry = delta < MAX_DELTA ? timer.expiry : tick_now + MAX_DELTA - 1;
+            uint32_t level{ 1 };
+            while (level < N_LEVELS - 1 && delta >= (1ull << shift(level + 1)))
+                ++level;
+            slot = slot_of(level, (expiry >> shift(level)) & LN_MASK);
+        }
+        timer.slot = slot;
+        timer.prev = NIL;
+        timer.next = heads[slot];
+        if (timer.next != NIL)
+            timers[timer.next].prev = i;
+        heads[slot] = i;
+    }
+
+    inline void unlink(uint32_t i) noexcept {
+        auto& timer = timers[i];
+        if (timer.prev != NIL)
+            timers[timer.prev].next = timer.next;
+        else
+            heads[timer.slot] = timer.next;
+        if (timer.next != NIL)
+            timers[timer.next].prev = timer.prev;
+        timer.prev = timer.next = timer.slot = NIL;
+    }
+
+    inline void release(uint32_t i) noexcept {
+        auto& timer = timers[i];
+        timer.is_active = false;
+        ++timer.generation;
+        timer.next = i_free;
+        i_free = i;
+        --n_active;
+    }
+
+    /** @brief Re-place every timer in an upper level slot into the levels beneath it */
+    inline void cascade(uint32_t slot) noexcept {
+        auto i = heads[slot];
+        heads[slot] = NIL;
+        while (i != NIL) {
+            const auto next = timers[i].next;
+            place(i, true);
+            i = next;
+        }
+    }
+
+    /** @brief Fire (and re-arm or release) every timer in a bottom level slot */
+    inline auto fire(uint32_t slot) noexcept -> size_t {
+        size_t n_fired{ };
+        // periodic timers are re-armed into a later slot, so popping the head terminates
+        while (heads[slot] != NIL) {
+            const auto i = heads[slot];
+            auto& timer = timers[i];
+            unlink(i);
+            const auto id = make_id(i, timer.generation);
+            const auto tag = timer.tag;
+            if (timer.interval) {
+                timer.expiry += timer.interval;
+                place(i);
+            } else {
+                release(i);
+            }
+            handler(id, tag);
+            ++n_fired;
+        }
+        return n_fired;
+    }
+
+DELETE_DEFAULT_COPY_AND_MOVE(TimerWheel)
+};
+}
@@ -0,0 +1,254 @@
+/**
+ *
+ *  Low-latency C++ Utilities
+ *
+ *  @file tracing.h
+ *  @brief Lightweight span tracing with Chrome trace-event export
+ *  @author Stacy Gaudreau
+ *  @date 2025.01.12
+ *
+ */
+
+
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "macros.h"
+#include "timekeeping.h"
+
+
+namespace LL
+{
+
+/**
+ * @brief A single timed span, recorded by the thread which executed it.
+ * @details The name must point to storage which outlives the tracer, ie: a string literal.
+ */
+struct TraceSpan {
+    const char* name{ nullptr };
+    uint64_t t_begin{ };    // cycle stamp at the start of the span
+    uint64_t t_end{ };      // cycle stamp at the end of the span
+};
+
+
+class TraceBuffer final {
+public:
+    /**
+     * @brief Fixed-size ring of spans owned by (and written from) a single thread.
+     * @details The oldest spans are overwritten once the ring is full, so the buffer always
+     * holds the most recent history of the thread. Capacity must be a power of two.
+     * @param capacity Number of spans the ring holds
+     * @param tid Kernel thread id of the owning thread
+     * @param thread_name Name of the owning thread, shown on the exported timeline
+     */
+    TraceBuffer(size_t capacity, pid_t tid, std::string thread_name)
+            : spans(capacity), mask(capacity - 1), tid(tid),
+              thread_name(std::move(thread_name)) {
+        VERIFY((capacity & mask) == 0, "<TraceBuffer> capacity must be a power of two");
+    }
+
+    /**
+     * @brief Record a completed span. Called only by the owning thread.
+     */
+    inline void record(const char* name, uint64_t t_begin, uint64_t t_end) noexcept {
+        const auto i = i_write.load(std::memory_order_relaxed);
+        spans[i & mask] = { name, t_begin, t_end };
+        i_write.store(i + 1, std::memory_order_release);
+    }
+
+    /** @brief Total number of spans ever recorded (including overwritten ones) */
+    [[nodiscard]] inline auto get_n_recorded() const noexcept {
+        return i_write.load(std::memory_order_acquire);
+    }
+    /** @brief Get the span stored in the ring at the given sequence number */
+    [[nodiscard]] inline const auto& get_span(size_t n) const noexcept {
+        return spans[n & mask];
+    }
+    /** @brief Discard all recorded spans. Not safe while the owning thread is recording. */
+    inline void clear() noexcept {
+        i_write.store(0, std::memory_order_release);
+    }
+    [[nodiscard]] inline auto get_capacity() const noexcept { return spans.size(); }
+    [[nodiscard]] inline auto get_tid() const noexcept { return tid; }
+    [[nodiscard]] inline const auto& get_thread_name() const noexcept { return thread_name; }
+
+private:
+    std::vector<TraceSpan> spans;
+    const size_t mask;
+    std::atomic<size_t> i_write{ 0 };
+    const pid_t tid;
+    const std::string thread_name;
+
+DELETE_DEFAULT_COPY_AND_MOVE(TraceBuffer)
+};
+
+
+class Tracer final {
+public:
+    static constexpr size_t SPANS_PER_THREAD{ 64 * 1024 };
+
+    /**
+     * @brief Enable span recording on all threads.
+     * @details The cycle counter is anchored to the steady clock here, and again at export,
+     * to convert cycle stamps into microseconds on the timeline.
+     */
+    static void enable() noexcept {
+        t_cycles_enabled = read_cycles();
+        t_nanos_enabled = steady_nanos();
+        is_enabled.store(true, std::memory_order_release);
+    }
+    /** @brief Stop recording spans. Previously recorded spans are kept for export. */
+    static void disable() noexcept {
+        is_enabled.store(false, std::memory_order_release);
+    }
+    [[nodiscard]] static inline bool get_is_enabled() noexcept {
+        return is_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Record a completed span on the calling thread's buffer.
+     */
+    static inline void record(const char* name, uint64_t t_begin, uint64_t t_end) noexcept {
+        auto buffer = thread_buffer;
+        if (buffer == nullptr) [[unlikely]]
+            buffer = register_thread();
+        buffer->record(name, t_begin, t_end);
+    }
+
+    /**
+     * @brief Write all recorded spans from every thread to a Chrome trace-event JSON file.
+     * @details The output loads directly into chrome://tracing or ui.perfetto.dev. Spans
+     * still being written by running threads may be dropped or torn, so ideally stop the
+     * traced components before exporting.
+     * @param filename Path of the JSON file to write
+     * @return Number of span events written, or -1 if the file could not be opened
+     */
+    static auto write_chrome_trace(const std::string& filename) -> long {
+        std::ofstream file{ filename };
+        if (!file.is_open())
+            return -1;
+        // measure the cycle rate over the tracing session
+        const auto t_cycles = read_cycles();
+        const auto t_nanos = steady_nanos();
+        const auto dt_cycles = static_cast<double>(t_cycles - t_cycles_enabled);
+        const auto micros_per_cycle = (dt_cycles > 0.0)
+                ? static_cast<double>(t_nanos - t_nanos_enabled) / dt_cycles / 1000.0 : 0.0;
+        const auto pid = getpid();
+        long n_events{ 0 };
+
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        bool is_first{ true };
+        for (const auto& buffer: buffers) {
+            if (!is_first)
+                file << ",\n";
+            is_first = false;
+            file << R"({"name":"thread_name","ph":"M","pid":)" << pid
+                 << R"(,"tid":)" << buffer->get_tid()
+                 << R"(,"args":{"name":")" << buffer->get_thread_name() << "\"}}";
+            const auto n_recorded = buffer->get_n_recorded();
+            const auto n_first = n_recorded > buffer->get_capacity()
+                                 ? n_recorded - buffer->get_capacity() : 0;
+            for (auto n = n_first; n < n_recorded; ++n) {
+                const auto& span = buffer->get_span(n);
+                if (span.name == nullptr || span.t_begin < t_cycles_enabled
+                        || span.t_end < span.t_begin)
+                    continue;
+                file << ",\n" << R"({"name":")" << span.name
+                     << R"(","ph":"X","pid":)" << pid
+                     << R"(,"tid":)" << buffer->get_tid()
+                     << R"(,"ts":)"
+                     << static_cast<double>(span.t_begin - t_cycles_enabled) * micros_per_cycle
+                     << R"(,"dur":)"
+                     << static_cast<double>(span.t_end - span.t_begin) * micros_per_cycle
+                     << "}";
+                ++n_events;
+            }
+        }
+        file << "\n]}\n";
+        return n_events;
+    }
+
+    /**
+     * @brief Discard every thread's recorded spans. For testing only; no thread may be
+     * recording when this is called.
+     */
+    static void reset() noexcept {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        for (auto& buffer: buffers)
+            buffer->clear();
+    }
+
+private:
+    static inline std::atomic<bool> is_enabled{ false };
+    static inline uint64_t t_cycles_enabled{ 0 };
+    static inline int64_t t_nanos_enabled{ 0 };
+    static inline std::mutex buffers_mutex;
+    static inline std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    static inline thread_local TraceBuffer* thread_buffer{ nullptr };
+
+    static inline auto steady_nanos() noexcept -> int64_t {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Allocate the calling thread's buffer on its first recorded span. Takes a lock,
+     * but happens only once per thread.
+     */
+    static auto register_thread() noexcept -> TraceBuffer* {
+        const auto tid = static_cast<pid_t>(syscall(SYS_gettid));
+        char name[32]{ };
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffers.push_back(std::make_unique<TraceBuffer>(SPANS_PER_THREAD, tid, name));
+        thread_buffer = buffers.back().get();
+        return thread_buffer;
+    }
+};
+
+
+/**
+ * @brief RAII span which records its lifetime to the calling thread's trace buffer.
+ * @details Costs one relaxed load when tracing is disabled.
+ */
+class TraceScope final {
+public:
+    explicit TraceScope(const char* name) noexcept
+            : name(name),
+              t_begin(Tracer::get_is_enabled() ? read_cycles() : 0) { }
+    ~TraceScope() {
+        if (t_begin) [[unlikely]]
+            Tracer::record(name, t_begin, read_cycles());
+    }
+
+private:
+    const char* name;
+    const uint64_t t_begin;
+
+DELETE_DEFAULT_COPY_AND_MOVE(TraceScope)
+};
+}
+
+/**
+ * @brief Trace the enclosing scope as a named span. Compiled out when LL_NO_TRACING is defined.
+ */
+#ifdef LL_NO_TRACING
+#define TRACE_SPAN(name)
+#else
+#define TRACE_SPAN_CONCAT_(a, b) a##b
+#define TRACE_SPAN_NAME_(line) TRACE_SPAN_CONCAT_(trace_span_, line)
+#define TRACE_SPAN(name) const LL::TraceScope TRACE_SPAN_NAME_(__LINE__){ name }
+#endif
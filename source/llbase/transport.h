@@ -0,0 +1,112 @@
+/**
+ *
+ *  Low-latency C++ Utilities
+ *
+ *  @file transport.h
+ *  @brief Compile-time transports for components which send and receive streams and datagrams
+ *  @author Stacy Gaudreau
+ *  @date 2025.02.18
+ *
+ */
+
+
+#pragma once
+
+
+#include <concepts>
+#include <functional>
+#include <string>
+
+#include "timekeeping.h"
+#include "sockets.h"
+#include "tcp_socket.h"
+#include "tcp_server.h"
+#include "mcast_socket.h"
+#include "shm_transport.h"
+
+
+namespace LL
+{
+/**
+ * @brief A connection which buffers what's loaded to send, and hands what it receives to its
+ * rx_callback in rx_buffer, as a TCPSocket does, or to a handler given to tx_and_rx()
+ */
+template<typename S>
+concept StreamSocket = requires(S s, const std::string& str, int port, const void* data,
+                                size_t len, std::function<void(S*, Nanos)> on_rx) {
+    { s.connect(str, str, port, true) } -> std::same_as<int>;
+    s.load_tx(data, len);
+    { s.tx_and_rx() } -> std::convertible_to<bool>;
+    { s.tx_and_rx([](S*, Nanos) { }) } -> std::convertible_to<bool>;
+    { s.rx_buffer.data() } -> std::same_as<const char*>;
+    { s.rx_buffer.size() } -> std::same_as<size_t>;
+    s.rx_buffer.consume(len);
+    s.rx_callback = on_rx;
+    { s.fd } -> std::convertible_to<int>;
+    s.tuning = SocketTuning{ };
+};
+
+/**
+ * @brief Accepts connections of the stream socket S, as a TCPServer does
+ */
+template<typename T, typename S>
+concept StreamServer = StreamSocket<S> && requires(
+        T server, const std::string& iface, int port, std::function<void(S*, Nanos)> on_rx,
+        std::function<void()> on_rx_done, std::function<void(S*)> on_dx) {
+    server.listen(iface, port, true);
+    { server.poll() } -> std::convertible_to<int>;
+    { server.tx_and_rx() } -> std::convertible_to<bool>;
+    { server.tx_and_rx([](S*, Nanos) { }, []() { }) } -> std::convertible_to<bool>;
+    server.set_rx_callback(on_rx);
+    server.set_rx_done_callback(on_rx_done);
+    server.set_dx_callback(on_dx);
+    { server.get_socket() } -> std::same_as<S&>;
+};
+
+/**
+ * @brief Publishes to and subscribes to a multicast group, as an McastSocket does
+ */
+template<typename S>
+concept DatagramSocket = requires(S s, const std::string& str, int port, const void* data,
+                                  size_t len, std::function<void(S*, Nanos)> on_rx) {
+    { s.init(str, str, port, true) } -> std::same_as<int>;
+    { s.join_group(str) } -> std::same_as<bool>;
+    s.leave_group();
+    s.load_tx(data, len);
+    s.end_datagram();
+    { s.tx_and_rx() } -> std::convertible_to<bool>;
+    { s.tx_and_rx([](S*, Nanos) { }) } -> std::convertible_to<bool>;
+    { s.rx_buffer.data() } -> std::same_as<const char*>;
+    s.rx_buffer.consume(len);
+    s.rx_buffer.clear();
+    s.rx_callback = on_rx;
+    { s.fd } -> std::convertible_to<int>;
+    s.tuning = SocketTuning{ };
+};
+
+/**
+ * @brief The stream, stream server and datagram types a component is built on
+ * @details Components templated on a transport keep their own logic identical whichever
+ * they're built with. IS_NETWORKED transports can also be bypassed through a PacketRing or
+ * XdpSocket on their interface.
+ */
+template<typename T>
+concept Transport = StreamSocket<typename T::Stream>
+        && StreamServer<typename T::StreamServer, typename T::Stream>
+        && DatagramSocket<typename T::Datagram>
+        && std::same_as<decltype(T::IS_NETWORKED), const bool>;
+
+
+/**
+ * @brief Kernel TCP and UDP multicast sockets
+ */
+struct SocketTransport {
+    using Stream = TCPSocket;
+    using StreamServer = TCPServer;
+    using Datagram = McastSocket;
+    static constexpr bool IS_NETWORKED{ true };
+};
+
+static_assert(Transport<SocketTransport>);
+static_assert(Transport<ShmTransport>);
+}
@@ -0,0 +1,165 @@
+/**
+ *
+ *  Low-latency C++ Utilities
+ *
+ *  @file watchdog.h
+ *  @brief Liveness watchdog which reports stalled worker thread loops
+ *  @author Stacy Gaudreau
+ *  @date 2025.02.02
+ *
+ */
+
+
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "macros.h"
+#include "logging.h"
+#include "loop_progress.h"
+#include "threading.h"
+#include "timekeeping.h"
+
+
+namespace LL
+{
+/**
+ * @brief What the watchdog has observed of a single run loop.
+ */
+struct LoopStats {
+    std::string name;
+    uint64_t n_loops{ };            // loop passes seen at the last sample
+    Nanos t_last_work{ };           // time the loop last did some work
+    Nanos t_worst_iteration{ };     // longest single pass observed, to the sample period
+    size_t n_stalls{ };             // number of times the loop stalled past the threshold
+    bool is_stalled{ false };
+    Nanos t_last_progress{ };       // time the loop's counter was last seen to advance
+};
+
+
+class Watchdog final {
+public:
+    static constexpr Nanos T_SAMPLE_DEFAULT{ 1 * NANOS_TO_MILLIS };
+    static constexpr Nanos T_STALL_DEFAULT{ 100 * NANOS_TO_MILLIS };
+
+    /**
+     * @brief Samples every watched LoopProgress from its own thread, reporting any loop
+     * which makes no progress for longer than the stall threshold.
+     * @details The worst-case iteration time is measured as the longest period a loop's
+     * counter was seen not to advance, so it is accurate to the sampling period.
+     * @param t_stall Time (in ns) without progress after which a loop is reported as stalled
+     * @param t_sample Period (in ns) between samples
+     */
+    Watchdog(Nanos t_stall, Nanos t_sample) : t_stall(t_stall), t_sample(t_sample) { }
+    ~Watchdog() { stop(); }
+
+    void start() {
+        is_running = true;
+        thread = create_and_start_thread(-1, "Watchdog", [this]() { run(); });
+        VERIFY(thread != nullptr, "<Watchdog> failed to start thread");
+    }
+    /** @brief Stop sampling, summarising any loops which exited since the last sample */
+    void stop() {
+        is_running = false;
+        if (thread != nullptr && thread->joinable()) {
+            thread->join();
+            sample(CoarseClock::get_nanos());
+        }
+    }
+
+    /**
+     * @brief Sample all watched loops once, as of the given time.
+     * @details Called periodically by the watchdog thread; public so it can be driven
+     * directly under test.
+     */
+    void sample(Nanos t_now) {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        // stats are updated in place, so only a newly watched loop allocates
+        ++n_sample;
+        LoopProgress::for_each_watched([&](const LoopProgress& p) {
+            auto [it, is_new] = watched.try_emplace(&p);
+            auto& s = it->second.stats;
+            it->second.n_sample = n_sample;
+            if (is_new)
+                s = LoopStats{ p.get_name(), p.get_n_loops(), 0, 0, 0, false, t_now };
+            const auto n_loops = p.get_n_loops();
+            s.t_last_work = p.get_t_last_work();
+            if (n_loops != s.n_loops) {
+                if (s.is_stalled) {
+                    logger.logf("% <Watchdog::%> % recovered after % us\n",
+                                get_time_str(&t_str), __FUNCTION__, s.name,
+                                (t_now - s.t_last_progress) / NANOS_TO_MICROS);
+                }
+                s.n_loops = n_loops;
+                s.t_last_progress = t_now;
+                s.is_stalled = false;
+            }
+            const auto t_no_progress = t_now - s.t_last_progress;
+            s.t_worst_iteration = std::max(s.t_worst_iteration, t_no_progress);
+            if (!s.is_stalled && t_no_progress > t_stall) {
+                s.is_stalled = true;
+                ++s.n_stalls;
+                logger.logf("% <Watchdog::%> % stalled: no progress for % us, "
+                            "last work % us ago\n",
+                            get_time_str(&t_str), __FUNCTION__, s.name,
+                            t_no_progress / NANOS_TO_MICROS,
+                            (t_now - s.t_last_work) / NANOS_TO_MICROS);
+            }
+        });
+        // loops which are no longer watched have exited; summarise them as they go
+        std::erase_if(watched, [&](const auto& entry) {
+            const auto& [w_stats, w_n_sample] = entry.second;
+            if (w_n_sample == n_sample)
+                return false;
+            logger.logf("% <Watchdog::%> % exited, loops: %, worst iteration: % us, "
+                        "stalls: %\n", get_time_str(&t_str), __FUNCTION__, w_stats.name,
+                        w_stats.n_loops, w_stats.t_worst_iteration / NANOS_TO_MICROS,
+                        w_stats.n_stalls);
+            return true;
+        });
+    }
+
+    /** @brief Get the stats of the first watched loop with the given name, if any */
+    [[nodiscard]] auto get_stats(const std::string& name) -> std::optional<LoopStats> {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        for (const auto& [p, w]: watched) {
+            if (w.stats.name == name)
+                return w.stats;
+        }
+        return std::nullopt;
+    }
+
+private:
+    const Nanos t_stall;
+    const Nanos t_sample;
+    std::atomic<bool> is_running{ false };
+    std::unique_ptr<std::thread> thread{ nullptr };
+    /** @brief A watched loop's stats, and the last sample which saw it still watched */
+    struct Watched {
+        LoopStats stats;
+        uint64_t n_sample{ };
+    };
+    std::mutex stats_mutex;
+    std::unordered_map<const LoopProgress*, Watched> watched;
+    uint64_t n_sample{ };
+    Logger logger{ "watchdog.log" };
+    std::string t_str{ };
+
+    void run() {
+        while (is_running) {
+            sample(CoarseClock::get_nanos());
+            std::this_thread::sleep_for(std::chrono::nanoseconds(t_sample));
+        }
+    }
+
+DELETE_DEFAULT_COPY_AND_MOVE(Watchdog)
+};
+}
@@ -0,0 +1,479 @@
+#include "xdp_socket.h"
+
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <linux/if_link.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "sockets.h"
+
+
+namespace LL
+{
+namespace
+{
+// the XDP program compares raw packet bytes as loaded by a little endian CPU
+static_assert(std::endian::native == std::endian::little,
+              "<XdpSocket> the XDP program assumes a little endian host");
+constexpr size_t SIZE_ETH_HEADER{ 14 };
+constexpr size_t SIZE_IP_HEADER{ 20 };
+constexpr size_t SIZE_UDP_HEADER{ 8 };
+constexpr size_t SIZE_HEADERS{ SIZE_ETH_HEADER + SIZE_IP_HEADER + SIZE_UDP_HEADER };
+
+// there's no libbpf in this tree, so the bpf syscall is made directly
+inline auto sys_bpf(bpf_cmd cmd, bpf_attr& attr) noexcept -> int {
+    return static_cast<int>(syscall(__NR_bpf, cmd, &attr, sizeof(attr)));
+}
+inline auto make_insn(uint8_t code, uint8_t dst, uint8_t src, int16_t off,
+                      int32_t imm) noexcept -> bpf_insn {
+    bpf_insn insn{ };
+    insn.code = code;
+    insn.dst_reg = dst & 0xf;
+    insn.src_reg = src & 0xf;
+    insn.off = off;
+    insn.imm = imm;
+    return insn;
+}
+// the key of the program's flow map: both fields as raw network order bytes
+struct FlowKey {
+    uint32_t ip;
+    uint32_t port;
+};
+inline auto checksum_ip(const uint8_t* header) noexcept -> uint16_t {
+    uint32_t sum{ };
+    for (size_t i{ }; i < SIZE_IP_HEADER; i += 2)
+        sum += static_cast<uint32_t>(header[i] << 8 | header[i + 1]);
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return htons(static_cast<uint16_t>(~sum));
+}
+}
+
+
+auto XdpSocket::create(Logger& logger, const std::string& iface, const XdpConfig& conf)
+        -> std::unique_ptr<XdpSocket> {
+    std::unique_ptr<XdpSocket> socket{ new XdpSocket(logger, conf) };
+    if (!socket->init(iface))
+        return nullptr;
+    return socket;
+}
+
+XdpSocket::XdpSocket(Logger& logger, const XdpConfig& conf)
+        : logger(logger), conf(conf) { }
+
+auto XdpSocket::init(const std::string& iface) -> bool {
+    VERIFY(conf.n_frames >= 4 && std::has_single_bit(conf.n_frames),
+           "<XdpSocket> n_frames must be a power of two");
+    VERIFY(conf.size_frame >= 2048 && std::has_single_bit(conf.size_frame),
+           "<XdpSocket> size_frame must be a power of two, no smaller than 2048");
+    const auto fail = [this](const char* what) {
+        logger.logf("% <XdpSocket::%> % failed, error: %; falling back to socket syscalls\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, what,
+                    std::string(std::strerror(errno)));
+        return false;
+    };
+    i_iface = static_cast<int>(if_nametoindex(iface.c_str()));
+    if (!i_iface)
+        return fail("if_nametoindex()");
+    fd = socket(AF_XDP, SOCK_RAW, 0);
+    if (fd < 0)
+        return fail("socket(AF_XDP)");
+
+    // register the UMEM; the first half of its frames receive, the second half send
+    size_umem = static_cast<size_t>(conf.n_frames) * conf.size_frame;
+    auto mapped = mmap(nullptr, size_umem, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (mapped == MAP_FAILED)
+        return fail("mmap() of UMEM");
+    umem = static_cast<char*>(mapped);
+    xdp_umem_reg reg{ };
+    reg.addr = reinterpret_cast<uint64_t>(umem);
+    reg.len = size_umem;
+    reg.chunk_size = conf.size_frame;
+    if (setsockopt(fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) < 0)
+        return fail("setsockopt(XDP_UMEM_REG)");
+    const auto n_ring = conf.n_frames / 2;
+    for (const auto opt: { XDP_UMEM_FILL_RING, XDP_UMEM_COMPLETION_RING, XDP_RX_RING,
+                           XDP_TX_RING }) {
+        if (setsockopt(fd, SOL_XDP, opt, &n_ring, sizeof(n_ring)) < 0)
+            return fail("setsockopt() of ring size");
+    }
+
+    // map the four rings
+    xdp_mmap_offsets off{ };
+    socklen_t len_off{ sizeof(off) };
+    if (getsockopt(fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &len_off) < 0)
+        return fail("getsockopt(XDP_MMAP_OFFSETS)");
+    const auto map_ring = [this, n_ring](Ring& ring, const xdp_ring_offset& ring_off,
+                                         uint64_t pgoff, size_t size_desc) {
+        ring.size_map = ring_off.desc + n_ring * size_desc;
+        auto map = mmap(nullptr, ring.size_map, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, static_cast<off_t>(pgoff));
+        if (map == MAP_FAILED)
+            return false;
+        ring.map = map;
+        ring.producer = reinterpret_cast<uint32_t*>(static_cast<char*>(map) + ring_off.producer);
+        ring.consumer = reinterpret_cast<uint32_t*>(static_cast<char*>(map) + ring_off.consumer);
+        ring.descs = static_cast<char*>(map) + ring_off.desc;
+        ring.size = n_ring;
+        ring.mask = n_ring - 1;
+        return true;
+    };
+    if (!map_ring(ring_fill, off.fr, XDP_UMEM_PGOFF_FILL_RING, sizeof(uint64_t))
+            || !map_ring(ring_comp, off.cr, XDP_UMEM_PGOFF_COMPLETION_RING, sizeof(uint64_t))
+            || !map_ring(ring_rx, off.rx, XDP_PGOFF_RX_RING, sizeof(xdp_desc))
+            || !map_ring(ring_tx, off.tx, XDP_PGOFF_TX_RING, sizeof(xdp_desc)))
+        return fail("mmap() of rings");
+
+    // every receive frame starts out with the kernel
+    auto fill = static_cast<uint64_t*>(ring_fill.descs);
+    for (uint32_t i{ }; i < n_ring; ++i)
+        fill[i] = static_cast<uint64_t>(i) * conf.size_frame;
+    ring_fill.cached = n_ring;
+    __atomic_store_n(ring_fill.producer, ring_fill.cached, __ATOMIC_RELEASE);
+    for (uint32_t i{ n_ring }; i < conf.n_frames; ++i)
+        tx_frames_free.push_back(static_cast<uint64_t>(i) * conf.size_frame);
+
+    sockaddr_xdp addr{ };
+    addr.sxdp_family = AF_XDP;
+    addr.sxdp_ifindex = static_cast<uint32_t>(i_iface);
+    addr.sxdp_queue_id = conf.queue_id;
+    addr.sxdp_flags = conf.is_native ? 0 : XDP_COPY;
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0)
+        return fail("bind()");
+
+    // the link layer and IP source of the datagrams sent
+    ifreq ifr{ };
+    strncpy(ifr.ifr_name, iface.c_str(), IFNAMSIZ - 1);
+    const auto fd_ioctl = socket(AF_INET, SOCK_DGRAM, 0);
+    const auto status = ioctl(fd_ioctl, SIOCGIFHWADDR, &ifr);
+    close(fd_ioctl);
+    if (status < 0)
+        return fail("ioctl(SIOCGIFHWADDR)");
+    memcpy(mac_src, ifr.ifr_hwaddr.sa_data, sizeof(mac_src));
+    inet_pton(AF_INET, get_iface_ip(iface).c_str(), &ip_src);
+    logger.logf("% <XdpSocket::%> xsk fd: %, iface: %, queue: %, frames: %, native: %\n",
+                LL::get_time_str(&t_str), __FUNCTION__, fd, iface, conf.queue_id,
+                conf.n_frames, conf.is_native);
+    return true;
+}
+
+XdpSocket::~XdpSocket() {
+    // closing the link detaches the program from the interface
+    for (const auto f: { fd_link, fd_prog, fd_map_flows, fd_map_xsks, fd }) {
+        if (f >= 0)
+            close(f);
+    }
+    for (auto ring: { &ring_fill, &ring_comp, &ring_rx, &ring_tx }) {
+        if (ring->map)
+            munmap(ring->map, ring->size_map);
+    }
+    if (umem)
+        munmap(umem, size_umem);
+}
+
+auto XdpSocket::attach_program() -> bool {
+    // whatever was created is closed again on failure, so the next attach() starts over
+    const auto fail = [this]() {
+        const auto error = errno;
+        for (auto f: { &fd_prog, &fd_map_xsks, &fd_map_flows }) {
+            if (*f >= 0)
+                close(*f);
+            *f = -1;
+        }
+        errno = error;
+        return false;
+    };
+    bpf_attr attr{ };
+    attr.map_type = BPF_MAP_TYPE_HASH;
+    attr.key_size = sizeof(FlowKey);
+    attr.value_size = sizeof(uint32_t);
+    attr.max_entries = MAX_FLOWS;
+    fd_map_flows = sys_bpf(BPF_MAP_CREATE, attr);
+    if (fd_map_flows < 0)
+        return fail();
+    attr = { };
+    attr.map_type = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size = sizeof(uint32_t);
+    attr.value_size = sizeof(int);
+    attr.max_entries = conf.queue_id + 1;
+    fd_map_xsks = sys_bpf(BPF_MAP_CREATE, attr);
+    if (fd_map_xsks < 0)
+        return fail();
+    attr = { };
+    attr.map_fd = static_cast<uint32_t>(fd_map_xsks);
+    attr.key = reinterpret_cast<uint64_t>(&conf.queue_id);
+    attr.value = reinterpret_cast<uint64_t>(&fd);
+    if (sys_bpf(BPF_MAP_UPDATE_ELEM, attr) < 0)
+        return fail();
+
+    // if the packet is an IPv4 UDP datagram without options or fragmentation for one of the
+    //  flows, redirect it to the socket bound to the queue it arrived on; else pass it on.
+    //  Registers: r1 ctx (xdp_md), r2 data, r3 data_end, r6 ctx kept across calls
+    std::vector<bpf_insn> prog;
+    std::vector<size_t> jumps_to_pass;
+    const auto jump_to_pass = [&](uint8_t code, uint8_t dst, uint8_t src, int32_t imm) {
+        jumps_to_pass.push_back(prog.size());
+        prog.push_back(make_insn(BPF_JMP | code, dst, src, 0, imm));
+    };
+    const auto load_map = [&](int fd_map) {
+        prog.push_back(make_insn(BPF_LD | BPF_IMM | BPF_DW, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0,
+                                 fd_map));
+        prog.push_back(make_insn(0, 0, 0, 0, 0));
+    };
+    prog.push_back(make_insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0));
+    prog.push_back(make_insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_1, 0, 0));
+    prog.push_back(make_insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_3, BPF_REG_1, 4, 0));
+    prog.push_back(make_insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0));
+    prog.push_back(make_insn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, SIZE_HEADERS));
+    jump_to_pass(BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 0);
+    prog.push_back(make_insn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, 12, 0));
+    jump_to_pass(BPF_JNE | BPF_K, BPF_REG_5, 0, htons(ETH_P_IP));
+    prog.push_back(make_insn(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2, 14, 0));
+    jump_to_pass(BPF_JNE | BPF_K, BPF_REG_5, 0, 0x45);
+    prog.push_back(make_insn(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2, 23, 0));
+    jump_to_pass(BPF_JNE | BPF_K, BPF_REG_5, 0, IPPROTO_UDP);
+    prog.push_back(make_insn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, 20, 0));
+    jump_to_pass(BPF_JSET | BPF_K, BPF_REG_5, 0, htons(0x3fff));
+    // the flow key { destination address, destination port } is built on the stack
+    prog.push_back(make_insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_5, BPF_REG_2, 30, 0));
+    prog.push_back(make_insn(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_5, -8, 0));
+    prog.push_back(make_insn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, 36, 0));
+    prog.push_back(make_insn(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_5, -4, 0));
+    load_map(fd_map_flows);
+    prog.push_back(make_insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, BPF_REG_10, 0, 0));
+    prog.push_back(make_insn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0, -8));
+    prog.push_back(make_insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_lookup_elem));
+    jump_to_pass(BPF_JEQ | BPF_K, BPF_REG_0, 0, 0);
+    prog.push_back(make_insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_6, 16, 0));
+    load_map(fd_map_xsks);
+    prog.push_back(make_insn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS));
+    prog.push_back(make_insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map));
+    prog.push_back(make_insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+    const auto i_pass = prog.size();
+    prog.push_back(make_insn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS));
+    prog.push_back(make_insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+    for (const auto i: jumps_to_pass)
+        prog[i].off = static_cast<int16_t>(i_pass - i - 1);
+
+    std::vector<char> log(16 * 1024);
+    const char license[]{ "Dual BSD/GPL" };
+    attr = { };
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.expected_attach_type = BPF_XDP;
+    attr.insns = reinterpret_cast<uint64_t>(prog.data());
+    attr.insn_cnt = static_cast<uint32_t>(prog.size());
+    attr.license = reinterpret_cast<uint64_t>(license);
+    attr.log_buf = reinterpret_cast<uint64_t>(log.data());
+    attr.log_size = static_cast<uint32_t>(log.size());
+    attr.log_level = 1;
+    fd_prog = sys_bpf(BPF_PROG_LOAD, attr);
+    if (fd_prog < 0) {
+        logger.logf("% <XdpSocket::%> program rejected by the verifier:\n%\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, log.data());
+        return fail();
+    }
+    attr = { };
+    attr.link_create.prog_fd = static_cast<uint32_t>(fd_prog);
+    attr.link_create.target_ifindex = static_cast<uint32_t>(i_iface);
+    attr.link_create.attach_type = BPF_XDP;
+    attr.link_create.flags = conf.is_native ? XDP_FLAGS_DRV_MODE : XDP_FLAGS_SKB_MODE;
+    fd_link = sys_bpf(BPF_LINK_CREATE, attr);
+    if (fd_link < 0)
+        return fail();
+    return true;
+}
+
+auto XdpSocket::attach(const std::string& ip, int port, RxHandler on_rx) -> int {
+    in_addr addr{ };
+    VERIFY(inet_pton(AF_INET, ip.c_str(), &addr) == 1,
+           "<XdpSocket> invalid IPv4 address: " + ip);
+    if (n_flows >= MAX_FLOWS)
+        return -1;
+    if (fd_link < 0 && !attach_program()) {
+        logger.logf("% <XdpSocket::%> XDP program attach failed, error: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, std::string(std::strerror(errno)));
+        return -1;
+    }
+    uint32_t i_flow{ };
+    while (i_flow < flows.size() && flows[i_flow].is_attached)
+        ++i_flow;
+    if (i_flow == flows.size())
+        flows.emplace_back();
+    const auto port_net = htons(static_cast<uint16_t>(port));
+    const FlowKey key{ addr.s_addr, port_net };
+    bpf_attr attr{ };
+    attr.map_fd = static_cast<uint32_t>(fd_map_flows);
+    attr.key = reinterpret_cast<uint64_t>(&key);
+    attr.value = reinterpret_cast<uint64_t>(&i_flow);
+    if (sys_bpf(BPF_MAP_UPDATE_ELEM, attr) < 0) {
+        logger.logf("% <XdpSocket::%> flow map update failed, error: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, std::string(std::strerror(errno)));
+        return -1;
+    }
+    flows[i_flow] = { addr.s_addr, port_net, std::move(on_rx), true };
+    ++n_flows;
+    logger.logf("% <XdpSocket::%> flow % attached: %:%\n", LL::get_time_str(&t_str),
+                __FUNCTION__, i_flow, ip, port);
+    return static_cast<int>(i_flow);
+}
+
+void XdpSocket::detach(int i_flow) {
+    auto& flow = flows[static_cast<size_t>(i_flow)];
+    if (!flow.is_attached)
+        return;
+    // any of its packets already in the rx ring find no flow, and are skipped
+    const FlowKey key{ flow.ip, flow.port };
+    bpf_attr attr{ };
+    attr.map_fd = static_cast<uint32_t>(fd_map_flows);
+    attr.key = reinterpret_cast<uint64_t>(&key);
+    sys_bpf(BPF_MAP_DELETE_ELEM, attr);
+    flow = { };
+    --n_flows;
+    logger.logf("% <XdpSocket::%> flow % detached\n", LL::get_time_str(&t_str),
+                __FUNCTION__, i_flow);
+}
+
+auto XdpSocket::send(in_addr addr, int port, const void* data, size_t len) noexcept -> bool {
+    if (!IN_MULTICAST(ntohl(addr.s_addr)))
+        return false;
+    if (len + SIZE_HEADERS > conf.size_frame || len + SIZE_IP_HEADER + SIZE_UDP_HEADER > 0xffff)
+        return false;
+    complete_tx();
+    const auto n_tx_in_ring = ring_tx.cached - __atomic_load_n(ring_tx.consumer,
+                                                               __ATOMIC_ACQUIRE);
+    if (tx_frames_free.empty() || n_tx_in_ring >= ring_tx.size)
+        return false;
+    const auto frame_addr = tx_frames_free.back();
+    tx_frames_free.pop_back();
+    auto frame = reinterpret_cast<uint8_t*>(umem + frame_addr);
+
+    // ethernet: the group's MAC is 01:00:5e followed by the low 23 bits of its address
+    const auto ip_dst = ntohl(addr.s_addr);
+    const uint8_t mac_dst[6]{ 0x01, 0x00, 0x5e, static_cast<uint8_t>((ip_dst >> 16) & 0x7f),
+                              static_cast<uint8_t>(ip_dst >> 8), static_cast<uint8_t>(ip_dst) };
+    memcpy(frame, mac_dst, 6);
+    memcpy(frame + 6, mac_src, 6);
+    const auto eth_type = htons(ETH_P_IP);
+    memcpy(frame + 12, &eth_type, 2);
+    // IPv4, without options
+    auto ip_header = frame + SIZE_ETH_HEADER;
+    const auto len_ip = htons(static_cast<uint16_t>(SIZE_IP_HEADER + SIZE_UDP_HEADER + len));
+    const auto id = htons(id_ip++);
+    const auto frag = htons(0x4000);    // don't fragment
+    ip_header[0] = 0x45;
+    ip_header[1] = 0;
+    memcpy(ip_header + 2, &len_ip, 2);
+    memcpy(ip_header + 4, &id, 2);
+    memcpy(ip_header + 6, &frag, 2);
+    ip_header[8] = conf.ttl;
+    ip_header[9] = IPPROTO_UDP;
+    memset(ip_header + 10, 0, 2);
+    memcpy(ip_header + 12, &ip_src, 4);
+    memcpy(ip_header + 16, &addr.s_addr, 4);
+    const auto checksum = checksum_ip(ip_header);
+    memcpy(ip_header + 10, &checksum, 2);
+    // UDP, with no checksum
+    auto udp_header = ip_header + SIZE_IP_HEADER;
+    const auto port_net = htons(static_cast<uint16_t>(port));
+    const auto len_udp = htons(static_cast<uint16_t>(SIZE_UDP_HEADER + len));
+    memcpy(udp_header, &port_net, 2);
+    memcpy(udp_header + 2, &port_net, 2);
+    memcpy(udp_header + 4, &len_udp, 2);
+    memset(udp_header + 6, 0, 2);
+    memcpy(udp_header + SIZE_UDP_HEADER, data, len);
+
+    auto desc = static_cast<xdp_desc*>(ring_tx.descs) + (ring_tx.cached & ring_tx.mask);
+    desc->addr = frame_addr;
+    desc->len = static_cast<uint32_t>(SIZE_HEADERS + len);
+    desc->options = 0;
+    ++ring_tx.cached;
+    ++n_tx_queued;
+    return true;
+}
+
+void XdpSocket::flush() noexcept {
+    if (!n_tx_queued)
+        return;
+    __atomic_store_n(ring_tx.producer, ring_tx.cached, __ATOMIC_RELEASE);
+    n_tx_queued = 0;
+    // the kernel only transmits from the ring when asked to
+    if (sendto(fd, nullptr, 0, MSG_DONTWAIT, nullptr, 0) < 0
+            && errno != EAGAIN && errno != EBUSY && errno != ENOBUFS) [[unlikely]] {
+        logger.logf("% <XdpSocket::%> sendto() failed, error: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, std::string(std::strerror(errno)));
+    }
+}
+
+void XdpSocket::complete_tx() noexcept {
+    const auto produced = __atomic_load_n(ring_comp.producer, __ATOMIC_ACQUIRE);
+    if (produced == ring_comp.cached)
+        return;
+    const auto addrs = static_cast<const uint64_t*>(ring_comp.descs);
+    for (; ring_comp.cached != produced; ++ring_comp.cached)
+        tx_frames_free.push_back(addrs[ring_comp.cached & ring_comp.mask]);
+    __atomic_store_n(ring_comp.consumer, ring_comp.cached, __ATOMIC_RELEASE);
+}
+
+auto XdpSocket::find_flow(const char* frame, size_t len, const char** payload,
+                          size_t* len_payload) const noexcept -> int {
+    // the program only redirects packets whose headers it has checked
+    const auto ip = frame + SIZE_ETH_HEADER;
+    const auto udp = ip + SIZE_IP_HEADER;
+    uint32_t ip_dst;
+    uint16_t port_dst, len_udp;
+    memcpy(&ip_dst, ip + 16, 4);
+    memcpy(&port_dst, udp + 2, 2);
+    memcpy(&len_udp, udp + 4, 2);
+    const auto len_datagram = static_cast<size_t>(ntohs(len_udp));
+    if (len_datagram < SIZE_UDP_HEADER
+            || SIZE_ETH_HEADER + SIZE_IP_HEADER + len_datagram > len) [[unlikely]]
+        return -1;
+    for (size_t i{ }; i < flows.size(); ++i) {
+        if (flows[i].is_attached && flows[i].ip == ip_dst && flows[i].port == port_dst) {
+            *payload = udp + SIZE_UDP_HEADER;
+            *len_payload = len_datagram - SIZE_UDP_HEADER;
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+auto XdpSocket::poll() noexcept -> size_t {
+    complete_tx();
+    flush();
+    size_t n_delivered{ };
+    const auto produced = __atomic_load_n(ring_rx.producer, __ATOMIC_ACQUIRE);
+    if (produced == ring_rx.cached)
+        return 0;
+    const auto descs = static_cast<const xdp_desc*>(ring_rx.descs);
+    auto fill = static_cast<uint64_t*>(ring_fill.descs);
+    for (; ring_rx.cached != produced; ++ring_rx.cached) {
+        const auto& desc = descs[ring_rx.cached & ring_rx.mask];
+        const char* payload{ nullptr };
+        size_t len{ };
+        const auto i_flow = find_flow(umem + desc.addr, desc.len, &payload, &len);
+        if (i_flow >= 0) {
+            // no room; the frame is kept, and delivery resumes here next time
+            if (!flows[static_cast<size_t>(i_flow)].on_rx(payload, len))
+                break;
+            ++n_delivered;
+        }
+        // the frame goes straight back to the kernel to receive into again
+        fill[ring_fill.cached++ & ring_fill.mask] = desc.addr & ~(uint64_t{ conf.size_frame } - 1);
+    }
+    __atomic_store_n(ring_rx.consumer, ring_rx.cached, __ATOMIC_RELEASE);
+    __atomic_store_n(ring_fill.producer, ring_fill.cached, __ATOMIC_RELEASE);
+    return n_delivered;
+}
+
+}
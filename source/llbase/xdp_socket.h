@@ -0,0 +1,161 @@
+/**
+ *
+ *  Low-latency C++ Utilities
+ *
+ *  @file xdp_socket.h
+ *  @brief An AF_XDP socket transport for UDP multicast feeds
+ *  @author Stacy Gaudreau
+ *  @date 2025.02.14
+ *
+ */
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <linux/if_xdp.h>
+#include <netinet/in.h>
+
+#include "macros.h"
+#include "logging.h"
+
+
+namespace LL
+{
+struct XdpConfig {
+    uint32_t n_frames{ 4096 };      // UMEM frames; half receive, half send. A power of two
+    uint32_t size_frame{ 2048 };    // a power of two, no smaller than 2048
+    uint32_t queue_id{ 0 };         // the interface queue the socket is bound to
+    bool is_native{ false };        // driver (native) XDP, else generic (SKB) mode
+    uint8_t ttl{ 1 };               // of the datagrams sent
+};
+
+
+/**
+ * @brief An AF_XDP socket bound to one queue of an interface, through which UDP datagrams are
+ * received from and sent to a set of flows (destination address and port), bypassing the
+ * kernel's network stack.
+ * @details The socket shares a region of frames (its UMEM) with the kernel through four
+ * rings: the fill ring hands empty frames to the kernel to receive into, the rx ring hands
+ * them back full, the tx ring hands over frames to send, and the completion ring returns them
+ * once sent. All four are mapped into user space, so nothing is copied by the socket itself
+ * and no syscall is made per datagram.
+ *
+ * Packets reach the socket through an XDP program attached to the interface once a flow is,
+ * which redirects IPv4 UDP packets for the attached flows (without IP options or fragments)
+ * and passes everything else on to the kernel as usual. Native mode needs a driver which
+ * supports XDP; generic mode works on any interface, including veth pairs. A send-only socket
+ * attaches no program. Datagrams are sent to multicast groups only, since the destination's
+ * MAC address is then known from the group's address; the source port is the destination's.
+ * The host must still join the groups it receives (ie: with a UDP socket), so that the
+ * interface accepts them. Needs CAP_NET_ADMIN and CAP_NET_RAW (or CAP_BPF).
+ *
+ * Not thread safe; owned by the thread which polls the sockets attached to it.
+ */
+class XdpSocket {
+public:
+    // a flow's UDP payload; returns false when there's no room for it yet, and it's offered
+    //  again (in order, before anything newer for any flow) at the next poll()
+    using RxHandler = std::function<bool(const char* data, size_t len)>;
+    static constexpr size_t MAX_FLOWS{ 64 };
+
+    /**
+     * @brief Create an AF_XDP socket on the given interface's queue
+     * @return The socket, or nullptr if it can't be set up (eg: without the capabilities it
+     * needs, or the queue's taken), in which case sockets should keep to their own syscalls
+     */
+    [[nodiscard]] static auto create(Logger& logger, const std::string& iface,
+                                     const XdpConfig& conf = { }) -> std::unique_ptr<XdpSocket>;
+    ~XdpSocket();
+
+    /**
+     * @brief Deliver the UDP payloads sent to the given address and port to a handler
+     * @return The flow's index, or -1 if there's no room for it or the XDP program couldn't
+     * be attached
+     */
+    auto attach(const std::string& ip, int port, RxHandler on_rx) -> int;
+    /**
+     * @brief Stop delivering a flow's payloads. Its handler is not called again.
+     */
+    void detach(int i_flow);
+    /**
+     * @brief Queue a datagram to a multicast group, which goes out at the next flush()
+     * @param group The group's address, parsed once by the caller rather than per datagram
+     * @return False if it can't be sent: there's no free frame, it doesn't fit one, or the
+     * destination isn't a multicast group
+     */
+    auto send(in_addr group, int port, const void* data, size_t len) noexcept -> bool;
+    /**
+     * @brief Hand the datagrams queued by send() to the kernel
+     */
+    void flush() noexcept;
+    /**
+     * @brief Recycle the frames of completed sends and deliver every payload received
+     * @return Number of payloads delivered
+     */
+    auto poll() noexcept -> size_t;
+
+    [[nodiscard]] inline auto get_n_flows() const noexcept { return n_flows; }
+    [[nodiscard]] inline auto get_n_tx_free() const noexcept { return tx_frames_free.size(); }
+
+private:
+    XdpSocket(Logger& logger, const XdpConfig& conf);
+    auto init(const std::string& iface) -> bool;
+    auto attach_program() -> bool;
+    void complete_tx() noexcept;
+    auto find_flow(const char* frame, size_t len, const char** payload,
+                   size_t* len_payload) const noexcept -> int;
+
+    // a ring shared with the kernel; the producer and consumer indices run freely
+    struct Ring {
+        void* map{ nullptr };
+        size_t size_map{ };
+        uint32_t* producer{ nullptr };
+        uint32_t* consumer{ nullptr };
+        void* descs{ nullptr };
+        uint32_t mask{ };
+        uint32_t size{ };
+        uint32_t cached{ };         // our side's index, published with a release store
+    };
+    struct Flow {
+        uint32_t ip{ };             // network byte order
+        uint16_t port{ };           // network byte order
+        RxHandler on_rx;
+        bool is_attached{ false };
+    };
+
+    Logger& logger;
+    std::string t_str;
+    const XdpConfig conf;
+    int i_iface{ };
+    int fd{ -1 };
+    int fd_prog{ -1 };
+    int fd_link{ -1 };
+    int fd_map_flows{ -1 };
+    int fd_map_xsks{ -1 };
+
+    char* umem{ nullptr };
+    size_t size_umem{ };
+    Ring ring_fill;
+    Ring ring_comp;
+    Ring ring_rx;
+    Ring ring_tx;
+    std::vector<uint64_t> tx_frames_free;
+    uint32_t n_tx_queued{ };        // sends not yet handed to the kernel
+
+    // the headers of each datagram sent
+    uint8_t mac_src[6]{ };
+    uint32_t ip_src{ };             // network byte order
+    uint16_t id_ip{ };
+
+    std::vector<Flow> flows;
+    size_t n_flows{ };
+
+DELETE_DEFAULT_COPY_AND_MOVE(XdpSocket)
+};
+}
@@ -6,83 +6,108 @@ using namespace Common;
 namespace Client
 {
 
-MarketDataConsumer::MarketDataConsumer(ClientID client_id,
-                                       Exchange::MarketUpdateQueue& updates,
-                                       const std::string& iface,
-                                       const std::string& ip_snapshot, int port_snapshot,
-                                       const std::string& ip_incremental,
-                                       int port_incremental)
+template<LL::Transport Transport>
+BasicMarketDataConsumer<Transport>::BasicMarketDataConsumer(
+        ClientID client_id, Exchange::MarketUpdateQueue& updates, const std::string& iface,
+        const std::string& ip_snapshot, int port_snapshot, const std::string& ip_incremental,
+        int port_incremental, LL::McastTransport transport)
         : tx_updates(updates),
           logger("client_market_data_consumer_"
                  + std::to_string(client_id) + ".log"),
           iface(iface),
           ip_snapshot(ip_snapshot),
           port_snapshot(port_snapshot),
-          socket_incremental(logger),
-          socket_snapshot(logger) {
-    auto default_rx_callback = [this](auto socket) {
-        rx_callback(socket);
-    };
-    socket_incremental.rx_callback = default_rx_callback;
-    socket_snapshot.rx_callback = default_rx_callback;
+          socket_incremental(logger, LL::MCAST_BATCHED),
+          socket_snapshot(logger, LL::MCAST_BATCHED) {
     // incremental socket is fully initialised and joined to multicast group here but we leave
     // the snapshot socket initialisation for later, since sync occurs on an as-needed basis
+    socket_incremental.tuning = LL::SocketProfiles::lookup("MDC.incremental");
     auto fd = socket_incremental.init(ip_incremental, iface,
                                       port_incremental, true);
-    ASSERT(fd >= 0, "<MDC> error creating UDP socket for consuming incremental market data, "
+    VERIFY(fd >= 0, "<MDC> error creating UDP socket for consuming incremental market data, "
                     "error: " + std::string(std::strerror(errno)));
     const auto is_joined = socket_incremental.join_group(ip_incremental);
-    ASSERT(is_joined, "<MDC> multicast join failed! error: " + std::string(std::strerror(errno)));
+    VERIFY(is_joined, "<MDC> multicast join failed! error: " + std::string(std::strerror(errno)));
+    // without the ring or XDP socket (or with no room on it), the sockets receive as usual
+    if constexpr (Transport::IS_NETWORKED) {
+        bool is_attached{ true };
+        if (transport == LL::McastTransport::PACKET_RING) {
+            packet_ring = LL::PacketRing::create(logger, iface);
+            if (packet_ring)
+                is_attached = socket_incremental.attach(*packet_ring, ip_incremental,
+                                                        port_incremental);
+        } else if (transport == LL::McastTransport::XDP) {
+            xdp = LL::XdpSocket::create(logger, iface);
+            if (xdp)
+                is_attached = socket_incremental.attach(*xdp, ip_incremental,
+                                                        port_incremental, true);
+        }
+        if (!is_attached) {
+            logger.logf("% <MDC::%> incremental stream not attached to packet ring or XDP "
+                        "socket\n", LL::get_time_str(&t_str), __FUNCTION__);
+        }
+    }
 }
 
-MarketDataConsumer::~MarketDataConsumer() {
+template<LL::Transport Transport>
+BasicMarketDataConsumer<Transport>::~BasicMarketDataConsumer() {
     stop();
-    using namespace std::literals::chrono_literals;
-    std::this_thread::sleep_for(1s);
 }
 
-void MarketDataConsumer::start() {
+template<LL::Transport Transport>
+void BasicMarketDataConsumer<Transport>::start() {
     is_running = true;
     thread = LL::create_and_start_thread(-1, "MarketDataConsumer", [this]() { run(); });
-    ASSERT(thread != nullptr, "<MDC> failed to start thread for market data consumer");
+    VERIFY(thread != nullptr, "<MDC> failed to start thread for market data consumer");
 }
 
-void MarketDataConsumer::stop() {
+template<LL::Transport Transport>
+void BasicMarketDataConsumer<Transport>::stop() {
     is_running = false;
     if (thread != nullptr && thread->joinable())
         thread->join();
 }
 
-void MarketDataConsumer::run() noexcept {
+template<LL::Transport Transport>
+void BasicMarketDataConsumer<Transport>::run() noexcept {
     logger.logf("% <MDC::%> running client data consumer...\n",
                 LL::get_time_str(&t_str), __FUNCTION__);
+    progress.watch();
     while (is_running) {
-        // rx from both udp sockets
-        socket_incremental.tx_and_rx();
-        socket_snapshot.tx_and_rx();
+        // rx from both udp sockets, parsing updates inline in rx_callback()
+        const auto on_rx = [this](Datagram* socket, LL::Nanos t_rx) {
+            rx_callback(socket, t_rx);
+        };
+        size_t n_work = socket_incremental.tx_and_rx(on_rx);
+        n_work += socket_snapshot.tx_and_rx(on_rx);
+        progress.tick(n_work);
+        idle.idle(n_work);
     }
+    progress.unwatch();
 }
 
-void MarketDataConsumer::rx_callback(LL::McastSocket* socket) noexcept {
+template<LL::Transport Transport>
+void BasicMarketDataConsumer<Transport>::rx_callback(Datagram* socket, LL::Nanos t_rx) noexcept {
+    TRACE_SPAN("MDC::rx_callback");
     // rx data on the snapshot socket only when in recovery mode and rebuilding a market snapshot
     const auto is_snapshot = socket->fd == socket_snapshot.fd;
     // log warning if for some reason we get data on snapshot socket while not in recovery
     if (is_snapshot && !is_in_recovery) [[unlikely]] {
-        socket->i_rx_next = 0;
+        socket->rx_buffer.clear();
         logger.logf("% <MDC::%> WARNING rx'd snapshot message but not in recovery\n",
                     LL::get_time_str(&t_str), __FUNCTION__);
         return;
     }
-    if (socket->i_rx_next >= sizeof(Exchange::MDPMarketUpdate)) {
+    if (socket->rx_buffer.size() >= sizeof(Exchange::MDPMarketUpdate)) {
         size_t i{ };
-        for (; i + sizeof(Exchange::MDPMarketUpdate) <= socket->i_rx_next;
+        for (; i + sizeof(Exchange::MDPMarketUpdate) <= socket->rx_buffer.size();
                i += sizeof(Exchange::MDPMarketUpdate)) {
             auto request = reinterpret_cast<const Exchange::MDPMarketUpdate*>(
                     socket->rx_buffer.data() + i);
-            logger.logf("% <MDC::%> rx'd on % socket, len: %, request: %\n",
+            logger.logf("% <MDC::%> rx'd on % socket, len: %, t_rx: %, request: %\n",
                         LL::get_time_str(&t_str), __FUNCTION__,
                         (is_snapshot ? "SNAP" : "INC."), sizeof(Exchange::MDPMarketUpdate),
-                        request->to_str());
+                        t_rx, request->to_str());
             // recovery begins if we lose track of the sequence number
             const auto already_in_recovery = is_in_recovery;
             is_in_recovery = (already_in_recovery || request->n_seq != n_seq_inc_next);
@@ -106,12 +131,13 @@ void MarketDataConsumer::rx_callback(LL::McastSocket* socket) noexcept {
                 tx_updates.increment_write_index();
             }
         }
-        memcpy(socket->rx_buffer.data(), socket->rx_buffer.data() + i, socket->i_rx_next - i);
-        socket->i_rx_next -= i;
+        socket->rx_buffer.consume(i);
     }
 }
 
-void MarketDataConsumer::queue_update(bool is_snapshot, const Exchange::MDPMarketUpdate* update) {
+template<LL::Transport Transport>
+void BasicMarketDataConsumer<Transport>::queue_update(bool is_snapshot,
+                                                      const Exchange::MDPMarketUpdate* update) {
     // queue the update to the correct container for its type
     if (is_snapshot) {
         if (queued_snapshot_updates.find(update->n_seq) != queued_snapshot_updates.end()) {
@@ -130,21 +156,34 @@ void MarketDataConsumer::queue_update(bool is_snapshot, const Exchange::MDPMarke
     snapshot_sync_check();
 }
 
-void MarketDataConsumer::snapshot_sync_start() {
+template<LL::Transport Transport>
+void BasicMarketDataConsumer<Transport>::snapshot_sync_start() {
     // clear both incremental and snapshot update queues, then join the snapshot multicast stream
     queued_snapshot_updates.clear();
     queued_incremental_updates.clear();
+    socket_snapshot.tuning = LL::SocketProfiles::lookup("MDC.snapshot");
     const auto fd = socket_snapshot.init(ip_snapshot, iface, port_snapshot, true);
-    ASSERT(fd >= 0, "<MDC> ERROR creating socket for receiving snapshot stream: "
+    VERIFY(fd >= 0, "<MDC> ERROR creating socket for receiving snapshot stream: "
                     + std::string(strerror(errno)));
     const auto is_joined = socket_snapshot.join_group(ip_snapshot);
-    ASSERT(is_joined, "<MDC> ERROR multicast socket join failed! "
+    VERIFY(is_joined, "<MDC> ERROR multicast socket join failed! "
                     + std::string(strerror(errno)));
+    if constexpr (Transport::IS_NETWORKED) {
+        const auto is_attached = packet_ring
+                ? socket_snapshot.attach(*packet_ring, ip_snapshot, port_snapshot)
+                : xdp ? socket_snapshot.attach(*xdp, ip_snapshot, port_snapshot, true)
+                : true;
+        if (!is_attached) {
+            logger.logf("% <MDC::%> snapshot stream not attached to packet ring or XDP "
+                        "socket\n", LL::get_time_str(&t_str), __FUNCTION__);
+        }
+    }
     logger.logf("% <MDC::%> start sync, stream joined at socket fd: %\n",
                 LL::get_time_str(&t_str), __FUNCTION__, socket_snapshot.fd);
 }
 
-void MarketDataConsumer::snapshot_sync_check() {
+template<LL::Transport Transport>
+void BasicMarketDataConsumer<Transport>::snapshot_sync_check() {
     if (queued_snapshot_updates.empty())
          return;
 
@@ -250,5 +289,6 @@ void MarketDataConsumer::snapshot_sync_check() {
     socket_snapshot.leave_group();
 }
 
+template class BasicMarketDataConsumer<LL::SocketTransport>;
+template class BasicMarketDataConsumer<LL::ShmTransport>;
 }
-
@@ -21,8 +21,11 @@
 #include "llbase/logging.h"
 #include "llbase/lfqueue.h"
 #include "llbase/threading.h"
-#include "llbase/mcast_socket.h"
+#include "llbase/transport.h"
 #include "llbase/timekeeping.h"
+#include "llbase/tracing.h"
+#include "llbase/idle_strategy.h"
+#include "llbase/loop_progress.h"
 #include "exchange/data/ome_market_update.h"
 
 
@@ -30,8 +33,11 @@ using namespace Common;
 
 namespace Client
 {
-class MarketDataConsumer {
+template<LL::Transport Transport>
+class BasicMarketDataConsumer {
 public:
+    using Datagram = typename Transport::Datagram;
+
     /**
      * @brief Client module for receiving and consuming data disseminated from the exchange.
      * @details Connects to the market exchange and receives incremental and snapshot updates of
@@ -43,13 +49,20 @@ public:
      * @param port_snapshot Port for snapshot updates
      * @param ip_incremental Multicast group IP for incremental updates
      * @param port_incremental Port for incremental updates
+     * @param transport Receive both streams from a memory-mapped AF_PACKET ring
+     * (PACKET_RING) or an AF_XDP socket (XDP) on iface instead of from their sockets, where it
+     * can be set up. Ignored unless the Transport IS_NETWORKED.
+     * @details Built on a Transport: updates are received from UDP multicast groups
+     * (SocketTransport), or from groups in shared memory when on the exchange's host
+     * (ShmTransport).
      */
-    MarketDataConsumer(ClientID client_id, Exchange::MarketUpdateQueue& updates,
-                       const std::string& iface, const std::string& ip_snapshot,
-                       int port_snapshot, const std::string& ip_incremental,
-                       int port_incremental);
+    BasicMarketDataConsumer(ClientID client_id, Exchange::MarketUpdateQueue& updates,
+                            const std::string& iface, const std::string& ip_snapshot,
+                            int port_snapshot, const std::string& ip_incremental,
+                            int port_incremental,
+                            LL::McastTransport transport = LL::McastTransport::SOCKET);
 
-    ~MarketDataConsumer();
+    ~BasicMarketDataConsumer();
 
     void start();
 
@@ -69,12 +82,17 @@ PRIVATE_IN_PRODUCTION
      */
     volatile bool is_running{ false };
     std::unique_ptr<std::thread> thread{ nullptr }; // the running thread
+    LL::IdleStrategy idle{ };   // what the run loop does when it finds no work
+    LL::LoopProgress progress{ "MDC" };  // sampled by the liveness watchdog
     std::string t_str{ };
     /*
-     * UDP sockets to receive incremental and snapshot updates on
+     * UDP sockets to receive incremental and snapshot updates on, and the packet ring or XDP
+     * socket they receive from instead, if one's used
      */
-    LL::McastSocket socket_incremental;
-    LL::McastSocket socket_snapshot;
+    std::unique_ptr<LL::PacketRing> packet_ring{ nullptr };
+    std::unique_ptr<LL::XdpSocket> xdp{ nullptr };
+    Datagram socket_incremental;
+    Datagram socket_snapshot;
     /*
      * Incoming queued updates to be processed.
      * Updates are ordered by their n_seq.
@@ -93,8 +111,9 @@ PRIVATE_IN_PRODUCTION
     /**
      * @brief Called whenever there is data to receive on the incremental or snapshot streams.
      * @param socket The calling socket
+     * @param t_rx Kernel timestamp of the data received
      */
-    void rx_callback(LL::McastSocket* socket) noexcept;
+    void rx_callback(Datagram* socket, LL::Nanos t_rx) noexcept;
     /**
      * @brief Process and enqueue a given snapshot or incremental market update.
      * @param is_snapshot Set to false to process as an incremental update
@@ -113,7 +132,10 @@ PRIVATE_IN_PRODUCTION
     void snapshot_sync_check();
 
 
-DELETE_DEFAULT_COPY_AND_MOVE(MarketDataConsumer)
+DELETE_DEFAULT_COPY_AND_MOVE(BasicMarketDataConsumer)
 
 };
+
+using MarketDataConsumer = BasicMarketDataConsumer<LL::SocketTransport>;
+using ShmMarketDataConsumer = BasicMarketDataConsumer<LL::ShmTransport>;
 }
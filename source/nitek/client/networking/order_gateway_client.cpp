@@ -2,12 +2,11 @@
 
 namespace Client
 {
-OrderGatewayClient::OrderGatewayClient(ClientID client,
-                                       Exchange::ClientRequestQueue& rx_requests,
-                                       Exchange::ClientResponseQueue& tx_responses,
-                                       std::string ip,
-                                       const std::string& iface,
-                                       int port)
+template<LL::Transport Transport>
+BasicOrderGatewayClient<Transport>::BasicOrderGatewayClient(
+        ClientID client, Exchange::ClientRequestQueue& rx_requests,
+        Exchange::ClientResponseQueue& tx_responses, std::string ip,
+        const std::string& iface, int port)
         : client_id(client),
           rx_requests(rx_requests),
           tx_responses(tx_responses),
@@ -16,41 +15,49 @@ OrderGatewayClient::OrderGatewayClient(ClientID client,
           port(port),
           logger("client_order_gateway_" + std::to_string(client) + ".log"),
           tcp_socket(logger) {
-    tcp_socket.rx_callback = [this](auto socket, auto t_rx) { rx_callback(socket, t_rx); };
+
 }
 
-OrderGatewayClient::~OrderGatewayClient() {
+template<LL::Transport Transport>
+BasicOrderGatewayClient<Transport>::~BasicOrderGatewayClient() {
     stop();
-    using namespace std::literals::chrono_literals;
-    std::this_thread::sleep_for(1s);
 }
 
-void OrderGatewayClient::start() {
+template<LL::Transport Transport>
+void BasicOrderGatewayClient<Transport>::start() {
     is_running = true;
     // establish connection to exchange order server and start worker thread
+    tcp_socket.tuning = LL::SocketProfiles::lookup("OGC");
     auto fd = tcp_socket.connect(ip, iface, port, false);
-    ASSERT(fd >= 0, "<OGC> failed to create gateway socket at: " + ip + ":" + std::to_string(port)
+    VERIFY(fd >= 0, "<OGC> failed to create gateway socket at: " + ip + ":" + std::to_string(port)
                     + " at iface: " + iface + ", error: " + std::string(std::strerror(errno)));
     thread = LL::create_and_start_thread(-1, "OrderGatewayClient",[this]() { run(); });
-    ASSERT(thread != nullptr, "<OGC> failed to start thread for OrderGatewayClient");
+    VERIFY(thread != nullptr, "<OGC> failed to start thread for OrderGatewayClient");
 }
 
-void OrderGatewayClient::stop() {
+template<LL::Transport Transport>
+void BasicOrderGatewayClient<Transport>::stop() {
     is_running = false;
     if (thread != nullptr && thread->joinable())
         thread->join();
 }
 
-void OrderGatewayClient::run() noexcept {
+template<LL::Transport Transport>
+void BasicOrderGatewayClient<Transport>::run() noexcept {
     logger.logf("% <OGC::%> running order gateway client...\n",
                 LL::get_time_str(&t_str), __FUNCTION__);
+    progress.watch();
     while (is_running) {
-        // receive order confirmations and transmit any outgoing TCP data
-        tcp_socket.tx_and_rx();
+        // receive order confirmations and transmit any outgoing TCP data; responses are
+        //  parsed by rx_callback() inline, rather than through the socket's std::function
+        size_t n_work = tcp_socket.tx_and_rx([this](Stream* socket, LL::Nanos t_rx) {
+            rx_callback(socket, t_rx);
+        });
         // process order requests received from the Trading Engine and push them to the
         // exchange order server over TCP
         for(auto request = rx_requests.get_next_to_read();
             request; request = rx_requests.get_next_to_read()) {
+            TRACE_SPAN("OGC::tx_request");
             logger.logf("% <OGC::%> tx request, client: %, n_seq: %, req: %\n",
                         LL::get_time_str(&t_str), __FUNCTION__, client_id,
                         n_seq_next_request, request->to_str());
@@ -58,19 +65,25 @@ void OrderGatewayClient::run() noexcept {
             tcp_socket.load_tx(request, sizeof(Exchange::OMEClientRequest));
             rx_requests.increment_read_index();
             n_seq_next_request++;
+            ++n_work;
         }
+        progress.tick(n_work);
+        idle.idle(n_work);
     }
+    progress.unwatch();
 }
 
-void OrderGatewayClient::rx_callback(LL::TCPSocket* socket, LL::Nanos t_rx) noexcept {
+template<LL::Transport Transport>
+void BasicOrderGatewayClient<Transport>::rx_callback(Stream* socket, LL::Nanos t_rx) noexcept {
+    TRACE_SPAN("OGC::rx_callback");
     using OrderResponse = Exchange::OGSClientResponse;
     // order response data is received and processed from the TCP socket
     logger.logf("% <OGC::%> rx at socket fd: %, len: %, t: %\n",
-                LL::get_time_str(&t_str), __FUNCTION__, socket->fd, socket->i_rx_next, t_rx);
-    if (socket->i_rx_next >= sizeof(OrderResponse)) {
+                LL::get_time_str(&t_str), __FUNCTION__, socket->fd, socket->rx_buffer.size(), t_rx);
+    if (socket->rx_buffer.size() >= sizeof(OrderResponse)) {
         // one or more responses to handle
         size_t i{ };
-        for (; i + sizeof(OrderResponse) <= socket->i_rx_next; i += sizeof(OrderResponse)) {
+        for (; i + sizeof(OrderResponse) <= socket->rx_buffer.size(); i += sizeof(OrderResponse)) {
             auto response = reinterpret_cast<const OrderResponse*>(socket->rx_buffer.data() + i);
             logger.logf("% <OGC::%> response rx'd: %\n",
                         LL::get_time_str(&t_str), __FUNCTION__, response->to_str());
@@ -95,9 +108,11 @@ void OrderGatewayClient::rx_callback(LL::TCPSocket* socket, LL::Nanos t_rx) noex
             *tx_response = response->ome_response;
             tx_responses.increment_write_index();
         }
-        // shift data in buffer now that blocks have been consumed
-        memcpy(socket->rx_buffer.data(), socket->rx_buffer.data() + i, socket->i_rx_next - i);
-        socket->i_rx_next -= i;
+        // advance past the blocks now consumed; any partial response stays for the next rx
+        socket->rx_buffer.consume(i);
     }
 }
+
+template class BasicOrderGatewayClient<LL::SocketTransport>;
+template class BasicOrderGatewayClient<LL::ShmTransport>;
 }
@@ -16,8 +16,11 @@
 #include "llbase/macros.h"
 #include "nitek/common/types.h"
 #include "llbase/threading.h"
-#include "llbase/tcp_server.h"
+#include "llbase/transport.h"
 #include "llbase/logging.h"
+#include "llbase/tracing.h"
+#include "llbase/idle_strategy.h"
+#include "llbase/loop_progress.h"
 #include "exchange/data/ome_client_request.h"
 #include "exchange/data/ome_client_response.h"
 
@@ -25,12 +28,17 @@ using namespace Common;
 
 namespace Client
 {
-class OrderGatewayClient {
+template<LL::Transport Transport>
+class BasicOrderGatewayClient {
 public:
+    using Stream = typename Transport::Stream;
+
     /**
      * @brief An order gateway client which connects to the Exchange over TCP in order to send and
      * receive order requests and confirmations, as well as receiving and responding to order
      * requests from the Trading Engine component.
+     * @details Built on a Transport: its stream connects to the Exchange's gateway over TCP
+     * (SocketTransport), or through shared memory when they share a host (ShmTransport).
      * @param client ID of the client Trading Engine
      * @param rx_requests Requests for orders incoming from the Trading Engine
      * @param tx_responses Order responses outgoing to the Trading Engine
@@ -38,10 +46,10 @@ public:
      * @param iface Interface to bind to for exchange order server connection
      * @param port TCP port to connect to the order gateway server through
      */
-    OrderGatewayClient(ClientID client, Exchange::ClientRequestQueue& rx_requests,
-                       Exchange::ClientResponseQueue& tx_responses, std::string ip,
-                       const std::string& iface, int port);
-    ~OrderGatewayClient();
+    BasicOrderGatewayClient(ClientID client, Exchange::ClientRequestQueue& rx_requests,
+                            Exchange::ClientResponseQueue& tx_responses, std::string ip,
+                            const std::string& iface, int port);
+    ~BasicOrderGatewayClient();
 
     /**
      * @brief Start the order client thread.
@@ -63,12 +71,14 @@ PRIVATE_IN_PRODUCTION
     LL::Logger logger;
     volatile bool is_running{ false };
     std::unique_ptr<std::thread> thread{ nullptr };
+    LL::IdleStrategy idle{ };   // what the run loop does when it finds no work
+    LL::LoopProgress progress{ "OGC" };  // sampled by the liveness watchdog
     std::string t_str{ };
     // tracks the sequence number for the next outgoing ClientRequest
     size_t n_seq_next_request{ 1 };
     // verifies the sequence of ClientResponse messages rx'd from exchange
     size_t n_seq_next_expected{ 1 };
-    LL::TCPSocket tcp_socket;   // connection with exchange order gateway
+    Stream tcp_socket;          // connection with exchange order gateway
 
 
 PRIVATE_IN_PRODUCTION
@@ -79,9 +89,12 @@ PRIVATE_IN_PRODUCTION
     /**
      * @brief Called when order data received on the socket from the exchange gateway.
      */
-    void rx_callback(LL::TCPSocket* socket, LL::Nanos t_rx) noexcept;
+    void rx_callback(Stream* socket, LL::Nanos t_rx) noexcept;
 
 
-DELETE_DEFAULT_COPY_AND_MOVE(OrderGatewayClient)
+DELETE_DEFAULT_COPY_AND_MOVE(BasicOrderGatewayClient)
 };
+
+using OrderGatewayClient = BasicOrderGatewayClient<LL::SocketTransport>;
+using ShmOrderGatewayClient = BasicOrderGatewayClient<LL::ShmTransport>;
 }
\ No newline at end of file
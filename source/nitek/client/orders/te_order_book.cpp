@@ -16,6 +16,7 @@ TEOrderBook::~TEOrderBook() {
 }
 
 void TEOrderBook::on_market_update(const Exchange::OMEMarketUpdate& update) noexcept {
+    TRACE_SPAN("TEOrderBook::on_market_update");
     // will this update change the best bid or ask price?
     const auto bid_is_updated = bids_by_price && update.side == Side::BUY
             && update.price >= bids_by_price->price;
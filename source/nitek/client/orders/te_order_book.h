@@ -16,6 +16,7 @@
 #include "common/types.h"
 #include "llbase/mempool.h"
 #include "llbase/logging.h"
+#include "llbase/tracing.h"
 #include "client/orders/te_order.h"
 #include "exchange/data/ome_market_update.h"
 
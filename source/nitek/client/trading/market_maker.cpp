@@ -25,6 +25,7 @@ void MarketMaker::on_order_book_update(TickerID ticker,
                                        Price price,
                                        Side side,
                                        TEOrderBook& ob) noexcept {
+    TRACE_SPAN("MarketMaker::on_order_book_update");
     logger.logf("% <MarketMaker::%> ticker: %, price: %, side: %\n",
                 LL::get_time_str(&t_str), __FUNCTION__, ticker,
                 price_to_str(price), side_to_str(side));
@@ -51,6 +52,7 @@ void MarketMaker::on_trade_update(const Exchange::OMEMarketUpdate& update,
 }
 
 void MarketMaker::on_order_response(const Exchange::OMEClientResponse& response) noexcept {
+    TRACE_SPAN("MarketMaker::on_order_response");
     // forward order response to the OrderManager
     logger.logf("% <MarketMaker::%> %\n",
                 LL::get_time_str(&t_str), __FUNCTION__, response.to_str());
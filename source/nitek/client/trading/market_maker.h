@@ -14,6 +14,7 @@
 
 #include "llbase/macros.h"
 #include "llbase/logging.h"
+#include "llbase/tracing.h"
 #include "common/types.h"
 #include "client/trading/trading_engine.h"
 #include "client/trading/feature_engine.h"
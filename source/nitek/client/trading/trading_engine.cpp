@@ -50,9 +50,15 @@ TradingEngine::TradingEngine(ClientID client_id,
 }
 
 void TradingEngine::start() {
+    // span tracing is opt-in, as it costs a cycle stamp pair per traced scope
+    if (std::getenv(TRACE_ENV_VAR) != nullptr && !LL::Tracer::get_is_enabled()) {
+        LL::Tracer::enable();
+        is_tracing = true;
+    }
+    LL::CoarseClock::start();
     is_running = true;
     thread = LL::create_and_start_thread(-1, "TradingEngine", [this]() { run(); });
-    ASSERT(thread != nullptr, "<TE> failed to start thread for trading engine");
+    VERIFY(thread != nullptr, "<TE> failed to start thread for trading engine");
 }
 
 void TradingEngine::stop() {
@@ -71,15 +77,28 @@ void TradingEngine::stop() {
                 LL::get_time_str(&t_str), __FUNCTION__, pman.to_str());
 
     is_running = false;
-    if (thread != nullptr && thread->joinable())
+    if (thread != nullptr && thread->joinable()) {
         thread->join();
+        LL::CoarseClock::stop();
+    }
+    if (is_tracing) {
+        // export the session's spans for viewing in chrome://tracing or ui.perfetto.dev
+        const auto filename = "client_trace_" + client_id_to_str(client_id) + ".json";
+        const auto n_spans = LL::Tracer::write_chrome_trace(filename);
+        logger.logf("% <TE::%> wrote % trace spans to %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, n_spans, filename);
+        LL::Tracer::disable();
+        is_tracing = false;
+    }
 }
 
 void TradingEngine::run() noexcept {
     // handle incoming order responses and market updates to generate trade order requests
     logger.logf("% <TE::%> run trading engine...\n",
                 LL::get_time_str(&t_str), __FUNCTION__);
+    progress.watch();
     while (is_running) {
+        size_t n_work{ };
         // order response handling
         for (auto response = rx_responses.get_next_to_read();
              response; response = rx_responses.get_next_to_read()) {
@@ -88,7 +107,8 @@ void TradingEngine::run() noexcept {
                         response->to_str().c_str());
             on_order_response_callback(*response);
             rx_responses.increment_read_index();
-            t_last_rx_event = LL::get_time_nanos();
+            t_last_rx_event = LL::CoarseClock::get_nanos();
+            ++n_work;
         }
         // incoming market updates
         for (auto update = rx_updates.get_next_to_read();
@@ -96,13 +116,17 @@ void TradingEngine::run() noexcept {
             logger.logf("% <TE::%> rx %\n",
                         LL::get_time_str(&t_str), __FUNCTION__,
                         update->to_str().c_str());
-            // assuming ASSERT() is removed at runtime, doing bounds checking in an assertion
-            // instead of using book_for_ticker .at() saves a bit of runtime latency
+            // ASSERT() is compiled out of release builds, so doing bounds checking in an
+            // assertion instead of using book_for_ticker .at() saves a bit of runtime latency
             ASSERT(update->ticker_id < book_for_ticker.size(), "out of bounds ticker ID!");
             book_for_ticker[update->ticker_id]->on_market_update(*update);
             rx_updates.increment_read_index();
-            t_last_rx_event = LL::get_time_nanos();
+            t_last_rx_event = LL::CoarseClock::get_nanos();
+            ++n_work;
         }
+        progress.tick(n_work);
+        idle.idle(n_work);
     }
+    progress.unwatch();
 }
 }
\ No newline at end of file
@@ -26,7 +26,11 @@
 #include "exchange/orders/ome_order.h"
 #include "nitek/client/orders/te_order_book.h"
 #include "llbase/timekeeping.h"
+#include "llbase/tracing.h"
+#include "llbase/idle_strategy.h"
+#include "llbase/loop_progress.h"
 
+#include <cstdlib>
 #include <string>
 #include <sstream>
 #include <array>
@@ -138,9 +142,14 @@ PRIVATE_IN_PRODUCTION
     LL::Nanos t_last_rx_event{ };  // time last exchange message received
     volatile bool is_running{ false };
     std::unique_ptr<std::thread> thread{ nullptr };
+    LL::IdleStrategy idle{ };   // what the run loop does when it finds no work
+    LL::LoopProgress progress{ "TE" };  // sampled by the liveness watchdog
 
     std::string t_str{ };
     LL::Logger logger;
+    // setting this environment variable enables span tracing for the session
+    static constexpr const char* TRACE_ENV_VAR{ "NITEK_TRACE" };
+    bool is_tracing{ false };   // this engine enabled tracing, so exports it when stopped
 
     FeatureEngine feng;
     PositionManager pman;
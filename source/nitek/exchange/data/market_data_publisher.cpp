@@ -3,64 +3,94 @@
 
 namespace Exchange
 {
-MarketDataPublisher::MarketDataPublisher(
+template<LL::Transport Transport>
+BasicMarketDataPublisher<Transport>::BasicMarketDataPublisher(
         MarketUpdateQueue& ome_market_updates, const std::string& iface,
         const std::string& ip_snapshot, int port_snapshot, const std::string& ip_incremental,
-        int port_incremental)
+        int port_incremental, LL::McastTransport transport)
         : ome_market_updates(ome_market_updates),
           logger("exchange_market_data_publisher.log"),
-          socket_incremental(logger) {
+          socket_incremental(logger, LL::MCAST_BATCHED) {
+    socket_incremental.tuning = LL::SocketProfiles::lookup("MDP.incremental");
     auto fd = socket_incremental.init(ip_incremental, iface,
                                       port_incremental, false);
-    ASSERT(fd >= 0, "<MDP> error creating UDP socket for incremental market data");
-    synthesizer = std::make_unique<SnapshotSynthesizer>(tx_snapshot_updates,
-                                                        iface, ip_snapshot,
-                                                        port_snapshot);
+    VERIFY(fd >= 0, "<MDP> error creating UDP socket for incremental market data");
+    if constexpr (Transport::IS_NETWORKED) {
+        if (transport == LL::McastTransport::XDP) {
+            // without the XDP socket, updates are sent by the socket as usual
+            xdp = LL::XdpSocket::create(logger, iface);
+            if (xdp)
+                socket_incremental.attach(*xdp, ip_incremental, port_incremental, false);
+        }
+    }
+    synthesizer = std::make_unique<BasicSnapshotSynthesizer<Transport>>(
+            tx_snapshot_updates, iface, ip_snapshot, port_snapshot);
 }
 
-MarketDataPublisher::~MarketDataPublisher() {
+template<LL::Transport Transport>
+BasicMarketDataPublisher<Transport>::~BasicMarketDataPublisher() {
     stop();
-    using namespace std::literals::chrono_literals;
-    std::this_thread::sleep_for(1s);
 }
 
-void MarketDataPublisher::start() {
+template<LL::Transport Transport>
+void BasicMarketDataPublisher<Transport>::start() {
+    // updates queued before starting are forwarded first, so the first snapshot reflects them
+    publish_updates();
     is_running = true;
     thread = LL::create_and_start_thread(-1, "MarketDataPublisher",
                                          [this]() { run(); });
-    ASSERT(thread != nullptr, "<MDP> Failed to start thread for market data publisher");
+    VERIFY(thread != nullptr, "<MDP> Failed to start thread for market data publisher");
     synthesizer->start();
 }
 
-void MarketDataPublisher::stop() {
+template<LL::Transport Transport>
+void BasicMarketDataPublisher<Transport>::stop() {
     is_running = false;
     if (thread != nullptr && thread->joinable())
         thread->join();
     synthesizer->stop();
 }
 
-void MarketDataPublisher::run() noexcept {
+template<LL::Transport Transport>
+void BasicMarketDataPublisher<Transport>::run() noexcept {
     logger.logf("% <MDP::%> running data publisher...\n",
                 LL::get_time_str(&t_str), __FUNCTION__);
+    progress.watch();
     while (is_running) {
-        // read and disseminate the matching engine's updates from the queue
-        for (auto u = ome_market_updates.get_next_to_read();
-             ome_market_updates.size() && u;
-             u = ome_market_updates.get_next_to_read()) {
-            logger.logf("% <MDP::%> sending n_seq: %, update: %\n",
-                        LL::get_time_str(&t_str), __FUNCTION__, n_seq_next, u->to_str());
-            // the correct publisher data format has a sequence number prepended to the update
-            socket_incremental.load_tx(&n_seq_next, sizeof(n_seq_next));
-            socket_incremental.load_tx(u, sizeof(OMEMarketUpdate));
-            ome_market_updates.increment_read_index();
-            // update must also be sent to the SS so that it can update its market snapshot
-            auto write_next = tx_snapshot_updates.get_next_to_write();
-            write_next->n_seq = n_seq_next;
-            write_next->ome_update = *u;
-            tx_snapshot_updates.increment_write_index();
-            ++n_seq_next;
-        }
-        socket_incremental.tx_and_rx();
+        size_t n_work = publish_updates();
+        progress.tick(n_work);
+        idle.idle(n_work);
     }
+    progress.unwatch();
 }
+
+template<LL::Transport Transport>
+size_t BasicMarketDataPublisher<Transport>::publish_updates() noexcept {
+    size_t n_work{ };
+    // read and disseminate the matching engine's updates from the queue
+    for (auto u = ome_market_updates.get_next_to_read();
+         ome_market_updates.size() && u;
+         u = ome_market_updates.get_next_to_read()) {
+        TRACE_SPAN("MDP::publish_update");
+        logger.logf("% <MDP::%> sending n_seq: %, update: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, n_seq_next, u->to_str());
+        // the correct publisher data format has a sequence number prepended to the update
+        socket_incremental.load_tx(&n_seq_next, sizeof(n_seq_next));
+        socket_incremental.load_tx(u, sizeof(OMEMarketUpdate));
+        socket_incremental.end_datagram();
+        ome_market_updates.increment_read_index();
+        // update must also be sent to the SS so that it can update its market snapshot
+        auto write_next = tx_snapshot_updates.get_next_to_write();
+        write_next->n_seq = n_seq_next;
+        write_next->ome_update = *u;
+        tx_snapshot_updates.increment_write_index();
+        ++n_seq_next;
+        ++n_work;
+    }
+    n_work += socket_incremental.tx_and_rx();
+    return n_work;
+}
+
+template class BasicMarketDataPublisher<LL::SocketTransport>;
+template class BasicMarketDataPublisher<LL::ShmTransport>;
 }
@@ -16,7 +16,10 @@
 #include <functional>
 #include "llbase/macros.h"
 #include "llbase/logging.h"
-#include "llbase/mcast_socket.h"
+#include "llbase/transport.h"
+#include "llbase/tracing.h"
+#include "llbase/idle_strategy.h"
+#include "llbase/loop_progress.h"
 #include "nitek/common/types.h"
 #include "exchange/data/ome_market_update.h"
 #include "exchange/data/snapshot_synthesizer.h"
@@ -24,7 +27,8 @@
 
 namespace Exchange
 {
-class MarketDataPublisher {
+template<LL::Transport Transport>
+class BasicMarketDataPublisher {
 public:
     /**
      * @brief Publishes market update data in both incremental and snapshot-style to market
@@ -35,12 +39,20 @@ public:
      * @param port_snapshot Port to bind to for snapshot-style updates
      * @param ip_incremental Multicast group IP address to bind to for incremental updates
      * @param port_incremental Port to bind to for incremental updates
+     * @param transport Send incremental updates through an AF_XDP socket on iface (XDP)
+     * instead of the socket's syscalls, where it can be set up. Snapshots are always sent by
+     * their socket, since a queue of the interface takes a single AF_XDP socket. Ignored
+     * unless the Transport IS_NETWORKED.
+     * @details Built on a Transport: updates are published to UDP multicast groups
+     * (SocketTransport), or to groups in shared memory for clients on the exchange's host
+     * (ShmTransport).
      */
-    MarketDataPublisher(MarketUpdateQueue& ome_market_updates,
-                        const std::string& iface, const std::string& ip_snapshot,
-                        int port_snapshot, const std::string& ip_incremental,
-                        int port_incremental);
-    ~MarketDataPublisher();
+    BasicMarketDataPublisher(MarketUpdateQueue& ome_market_updates,
+                             const std::string& iface, const std::string& ip_snapshot,
+                             int port_snapshot, const std::string& ip_incremental,
+                             int port_incremental,
+                             LL::McastTransport transport = LL::McastTransport::SOCKET);
+    ~BasicMarketDataPublisher();
 
     /**
      * @brief Start the data publisher thread.
@@ -56,6 +68,12 @@ public:
     void run() noexcept;
 
 PRIVATE_IN_PRODUCTION
+    /**
+     * @brief Publish every update waiting on the OME's queue, and forward them to the SS.
+     * @return Number of updates published
+     */
+    size_t publish_updates() noexcept;
+
     // incremental update queue from the OME
     MarketUpdateQueue& ome_market_updates;
     size_t n_seq_next{ 1 };    // next sequence number for outgoing incremental updates
@@ -63,13 +81,16 @@ PRIVATE_IN_PRODUCTION
     MDPMarketUpdateQueue tx_snapshot_updates{ Limits::MAX_MARKET_UPDATES };
     volatile bool is_running{ false };
     std::unique_ptr<std::thread> thread{ nullptr };   // tracks the running thread
+    LL::IdleStrategy idle{ };   // what the run loop does when it finds no work
+    LL::LoopProgress progress{ "MDP" };  // sampled by the liveness watchdog
     std::string t_str{ };
     LL::Logger logger;
-    LL::McastSocket socket_incremental;
+    std::unique_ptr<LL::XdpSocket> xdp{ nullptr };   // incremental updates go out through it
+    typename Transport::Datagram socket_incremental;
     // generates snapshots of market data on its own thread
-    std::unique_ptr<SnapshotSynthesizer> synthesizer;
+    std::unique_ptr<BasicSnapshotSynthesizer<Transport>> synthesizer;
 
-DELETE_DEFAULT_COPY_AND_MOVE(MarketDataPublisher)
+DELETE_DEFAULT_COPY_AND_MOVE(BasicMarketDataPublisher)
 
 #ifdef IS_TEST_SUITE
 public:
@@ -77,4 +98,7 @@ public:
     auto& get_snapshot_synthesizer() { return synthesizer; }
 #endif
 };
+
+using MarketDataPublisher = BasicMarketDataPublisher<LL::SocketTransport>;
+using ShmMarketDataPublisher = BasicMarketDataPublisher<LL::ShmTransport>;
 }
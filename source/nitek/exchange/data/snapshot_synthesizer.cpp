@@ -3,38 +3,54 @@
 
 namespace Exchange
 {
-SnapshotSynthesizer::SnapshotSynthesizer(MDPMarketUpdateQueue& tx_updates, const std::string& iface,
-                                         const std::string& ip, int port)
+template<LL::Transport Transport>
+BasicSnapshotSynthesizer<Transport>::BasicSnapshotSynthesizer(
+        MDPMarketUpdateQueue& tx_updates, const std::string& iface, const std::string& ip,
+        int port)
         : tx_updates(tx_updates),
           logger("exchange_snapshot_synthesizer.log"),
-          socket(logger) {
+          socket(logger, SNAPSHOT_BATCHING) {
+    socket.tuning = LL::SocketProfiles::lookup("MDP.snapshot");
     auto fd = socket.init(ip, iface, port, false);
-    ASSERT(fd >= 0, "<SnapshotSynthesizer> error creating UDP socket for snapshot data");
-
+    VERIFY(fd >= 0, "<SnapshotSynthesizer> error creating UDP socket for snapshot data");
+    // full GSO runs of a snapshot are sent from where they're loaded rather than copied
+    if constexpr (Transport::IS_NETWORKED)
+        socket.enable_zerocopy(SNAPSHOT_ZEROCOPY_MIN);
 }
 
-SnapshotSynthesizer::~SnapshotSynthesizer() {
+template<LL::Transport Transport>
+BasicSnapshotSynthesizer<Transport>::~BasicSnapshotSynthesizer() {
     stop();
 }
 
-void SnapshotSynthesizer::start() {
+template<LL::Transport Transport>
+void BasicSnapshotSynthesizer<Transport>::start() {
+    // the first snapshot is published immediately, and then at a regular interval
+    timer_snapshot = timers.schedule(LL::CoarseClock::get_nanos(), TIMER_SNAPSHOT,
+                                     SECONDS_BETWEEN_SNAPSHOTS * LL::NANOS_TO_SECS);
     is_running = true;
     thread = LL::create_and_start_thread(-1, "SnapshotSynthesizer",
                                          [this]() { run(); });
-    ASSERT(thread != nullptr, "<SnapshotSynthesizer> Failed to start thread for "
+    VERIFY(thread != nullptr, "<SnapshotSynthesizer> Failed to start thread for "
                               "snapshot synthesizer");
 }
 
-void SnapshotSynthesizer::stop() {
+template<LL::Transport Transport>
+void BasicSnapshotSynthesizer<Transport>::stop() {
     is_running = false;
     if (thread != nullptr && thread->joinable())
         thread->join();
+    timers.cancel(timer_snapshot);
+    timer_snapshot = LL::TIMER_ID_INVALID;
 }
 
-void SnapshotSynthesizer::run() {
+template<LL::Transport Transport>
+void BasicSnapshotSynthesizer<Transport>::run() {
     logger.logf("% <SS::%> running snapshot synthesizer...\n",
                 LL::get_time_str(&t_str), __FUNCTION__);
+    progress.watch();
     while (is_running) {
+        size_t n_work{ };
         // process each incremental update rx'd from the MDP on the queue
         for (auto update = tx_updates.get_next_to_read();
              tx_updates.size() && update; update = tx_updates.get_next_to_read()) {
@@ -42,17 +58,30 @@ void SnapshotSynthesizer::run() {
                         LL::get_time_str(&t_str), __FUNCTION__, update->to_str());
             add_to_snapshot(update);
             tx_updates.increment_read_index();
+            ++n_work;
         }
-        // a snapshot is published at a defined interval
-        if (LL::get_time_nanos() - t_last_snapshot
-                > SECONDS_BETWEEN_SNAPSHOTS * LL::NANOS_TO_SECS) {
-            t_last_snapshot = LL::get_time_nanos();
-            publish_snapshot();
-        }
+        // scheduled work such as the periodic snapshot fires from the timer wheel
+        n_work += timers.advance(LL::CoarseClock::get_nanos());
+        progress.tick(n_work);
+        idle.idle(n_work);
     }
+    progress.unwatch();
 }
 
-void SnapshotSynthesizer::add_to_snapshot(const MDPMarketUpdate* update_from_publisher) {
+template<LL::Transport Transport>
+void BasicSnapshotSynthesizer<Transport>::on_timer(uint64_t tag) noexcept {
+    switch (tag) {
+    case TIMER_SNAPSHOT:
+        publish_snapshot();
+        break;
+    default:
+        break;
+    }
+}
+
+template<LL::Transport Transport>
+void BasicSnapshotSynthesizer<Transport>::add_to_snapshot(
+        const MDPMarketUpdate* update_from_publisher) {
     // the update is handled similarly to updating the order book in the matching engine,
     //  except only the most recent picture of the market is maintained
     const auto& update = update_from_publisher->ome_update;
@@ -96,7 +125,8 @@ void SnapshotSynthesizer::add_to_snapshot(const MDPMarketUpdate* update_from_pub
     n_seq_last = update_from_publisher->n_seq;
 }
 
-void SnapshotSynthesizer::publish_snapshot() {
+template<LL::Transport Transport>
+void BasicSnapshotSynthesizer<Transport>::publish_snapshot() {
     size_t size_snapshot{ };
     // snapshot begins with start message
     const MDPMarketUpdate SNAPSHOT_START{ size_snapshot++,
@@ -104,6 +134,7 @@ void SnapshotSynthesizer::publish_snapshot() {
     logger.logf("% <SS::%> %\n",
                 LL::get_time_str(&t_str), __FUNCTION__, SNAPSHOT_START.to_str());
     socket.load_tx(&SNAPSHOT_START, sizeof(MDPMarketUpdate));
+    socket.end_datagram();
     // each ticker in the order book is added to the snapshot
     for (size_t ticker{ }; ticker < map_ticker_to_order.size(); ++ticker) {
         const auto& orders = map_ticker_to_order.at(ticker);
@@ -115,6 +146,7 @@ void SnapshotSynthesizer::publish_snapshot() {
         logger.logf("% <SS::%> %\n",
                     LL::get_time_str(&t_str), __FUNCTION__, CLEAR_TICKER.to_str());
         socket.load_tx(&CLEAR_TICKER, sizeof(MDPMarketUpdate));
+        socket.end_datagram();
         // each order for the ticker is then updated
         for (const auto order: orders) {
             if (order != nullptr) {
@@ -122,8 +154,8 @@ void SnapshotSynthesizer::publish_snapshot() {
                 logger.logf("% <SS::%> %\n",
                             LL::get_time_str(&t_str), __FUNCTION__, TICKER_UPDATE.to_str());
                 socket.load_tx(&TICKER_UPDATE, sizeof(MDPMarketUpdate));
-                // publish the snapshot down the wire ASAP since there's an important update
-                socket.tx_and_rx();
+                // each update is its own datagram; they go down the wire in GSO runs
+                socket.end_datagram();
             }
         }
     }
@@ -138,4 +170,6 @@ void SnapshotSynthesizer::publish_snapshot() {
                 LL::get_time_str(&t_str), __FUNCTION__, size_snapshot - 1);
 }
 
-}
\ No newline at end of file
+template class BasicSnapshotSynthesizer<LL::SocketTransport>;
+template class BasicSnapshotSynthesizer<LL::ShmTransport>;
+}
@@ -16,15 +16,19 @@
 #include <array>
 #include "llbase/macros.h"
 #include "llbase/logging.h"
-#include "llbase/mcast_socket.h"
+#include "llbase/transport.h"
 #include "llbase/mempool.h"
 #include "llbase/timekeeping.h"
+#include "llbase/timer_wheel.h"
+#include "llbase/idle_strategy.h"
+#include "llbase/loop_progress.h"
 #include "exchange/data/ome_market_update.h"
 
 
 namespace Exchange
 {
-class SnapshotSynthesizer {
+template<LL::Transport Transport>
+class BasicSnapshotSynthesizer {
 public:
     /**
      * @brief Consumes incremental market updates from the publisher and synthesizes
@@ -34,9 +38,9 @@ public:
      * @param ip Multicast group IP to bind to for snapshot dissemination
      * @param port UDP port to bind to
      */
-    SnapshotSynthesizer(MDPMarketUpdateQueue& tx_updates, const std::string& iface,
-                        const std::string& ip, int port);
-    ~SnapshotSynthesizer();
+    BasicSnapshotSynthesizer(MDPMarketUpdateQueue& tx_updates, const std::string& iface,
+                             const std::string& ip, int port);
+    ~BasicSnapshotSynthesizer();
 
     /**
      * @brief Start the worker thread.
@@ -65,18 +69,42 @@ public:
      *  3. SNAPSHOT_END => also includes the last n_seq used to construct the snapshot
      */
     void publish_snapshot();
+    /**
+     * @brief Handle a scheduled timer firing on the worker thread.
+     */
+    void on_timer(uint64_t tag) noexcept;
 
 PRIVATE_IN_PRODUCTION
+    // tags identifying the synthesizer's scheduled timers
+    enum TimerTag : uint64_t {
+        TIMER_SNAPSHOT = 0
+    };
+    // forwards timers fired by the wheel back to the synthesizer
+    struct TimerHandler {
+        BasicSnapshotSynthesizer* ss;
+        void operator()(LL::TimerID, uint64_t tag) const noexcept { ss->on_timer(tag); }
+    };
+
+    // a snapshot is queued until a sendmmsg() call's worth of full GSO runs is waiting, so
+    //  that each run is long enough to be sent with zerocopy
+    static constexpr LL::McastBatchConfig SNAPSHOT_BATCHING{
+            LL::MCAST_BATCH_SIZE, LL::MCAST_DATAGRAM_SIZE,
+            LL::MCAST_BATCH_SIZE * LL::MCAST_GSO_SEGMENTS, true };
+    // a full GSO run of snapshot updates, each being a datagram of its own
+    static constexpr size_t SNAPSHOT_ZEROCOPY_MIN{ LL::MCAST_GSO_SEGMENTS
+                                                   * sizeof(MDPMarketUpdate) };
+
     MDPMarketUpdateQueue& tx_updates;
     LL::Logger logger;
     volatile bool is_running{ false };
     std::unique_ptr<std::thread> thread{ nullptr };   // tracks the running thread
+    LL::IdleStrategy idle{ };   // what the run loop does when it finds no work
+    LL::LoopProgress progress{ "SS" };  // sampled by the liveness watchdog
     std::string t_str{ };
-    LL::McastSocket socket;
+    typename Transport::Datagram socket;
     std::array<std::array<OMEMarketUpdate*, Limits::MAX_ORDER_IDS>,
                Limits::MAX_TICKERS> map_ticker_to_order;
     size_t n_seq_last{ 0 };
-    LL::Nanos t_last_snapshot{ 0 };
 #ifdef IS_TEST_SUITE
     static constexpr LL::Nanos SECONDS_BETWEEN_SNAPSHOTS{ 1 };
 #else
@@ -84,12 +112,18 @@ PRIVATE_IN_PRODUCTION
 #endif
 
     LL::MemPool<OMEMarketUpdate> update_pool{ Limits::MAX_ORDER_IDS };
+    static constexpr size_t MAX_TIMERS{ 16 };
+    LL::TimerWheel<TimerHandler> timers{ MAX_TIMERS, LL::NANOS_TO_MILLIS,
+                                         LL::CoarseClock::get_nanos(), TimerHandler{ this }};
+    LL::TimerID timer_snapshot{ LL::TIMER_ID_INVALID };
 
-DELETE_DEFAULT_COPY_AND_MOVE(SnapshotSynthesizer)
+DELETE_DEFAULT_COPY_AND_MOVE(BasicSnapshotSynthesizer)
 
 #ifdef IS_TEST_SUITE
 public:
     auto get_is_running() { return is_running; }
 #endif
 };
+
+using SnapshotSynthesizer = BasicSnapshotSynthesizer<LL::SocketTransport>;
 }
@@ -3,67 +3,139 @@
 
 namespace Exchange
 {
-ExchangeServer::ExchangeServer(const std::string& order_iface, int order_port,
-                               const std::string& data_iface,
-                               const std::string& data_incremental_ip,
-                               int data_incremental_port, const std::string& data_snapshot_ip,
-                               int data_snapshot_port)
+template<LL::Transport Transport>
+BasicExchangeServer<Transport>::BasicExchangeServer(
+        const std::string& order_iface, int order_port, const std::string& data_iface,
+        const std::string& data_incremental_ip, int data_incremental_port,
+        const std::string& data_snapshot_ip, int data_snapshot_port,
+        const LL::CPULayout& cpu_layout)
         : order_iface(order_iface),
           order_port(order_port),
           data_iface(data_iface),
           data_incremental_ip(data_incremental_ip),
           data_incremental_port(data_incremental_port),
           data_snapshot_ip(data_snapshot_ip),
-          data_snapshot_port(data_snapshot_port) {
+          data_snapshot_port(data_snapshot_port),
+          cpu_layout(cpu_layout) {
 
 }
 
-ExchangeServer::~ExchangeServer() {
+template<LL::Transport Transport>
+BasicExchangeServer<Transport>::~BasicExchangeServer() {
     stop();
 }
 
-void ExchangeServer::start() {
-    logger.logf("% <ExchangeServer::%> starting Matching Engine\n",
-                LL::get_time_str(&t_str), __FUNCTION__);
-    ome = std::make_unique<OrderMatchingEngine>(&client_requests, &client_responses,
-                                                &market_updates);
+template<LL::Transport Transport>
+void BasicExchangeServer<Transport>::start() {
+    // span tracing is opt-in, as it costs a cycle stamp pair per traced scope
+    if (std::getenv(TRACE_ENV_VAR) != nullptr)
+        LL::Tracer::enable();
+    // each deployment may tune its sockets from a profiles file, looked up as they're created
+    if (const auto profiles_file = std::getenv(SOCKET_PROFILES_ENV_VAR))
+        LL::SocketProfiles::install(LL::SocketProfiles::from_file(profiles_file));
+    // and may ease its run loops off their cores, taking effect as the modules are constructed
+    if (const auto idle_kind = std::getenv(IDLE_ENV_VAR))
+        LL::IdleStrategy::set_default(LL::idle_kind_from_str(idle_kind));
+    // component threads are placed by the CPU layout as they start
+    if (!cpu_layout.get_confs().empty()) {
+        VERIFY(LL::CPULayout::install(cpu_layout), "<ExchangeServer> invalid CPU layout");
+        for (const auto& mismatch: cpu_layout.check_isolation()) {
+            logger.logf("% <ExchangeServer::%> CPU layout mismatch: %\n",
+                        LL::get_time_str(&t_str), __FUNCTION__, mismatch);
+        }
+    }
+    LL::CoarseClock::start();
+    const auto t_start = LL::get_time_nanos();
+    // the modules are independent until started, so they are constructed in parallel
+    logger.logf("% <ExchangeServer::%> constructing Matching Engine, Order Gateway and "
+                "Data Publisher\n", LL::get_time_str(&t_str), __FUNCTION__);
+    auto ome_ready = std::async(std::launch::async, [this]() {
+        return std::make_unique<OrderMatchingEngine>(&client_requests, &client_responses,
+                                                     &market_updates);
+    });
+    auto ogs_ready = std::async(std::launch::async, [this]() {
+        return std::make_unique<BasicOrderGatewayServer<Transport>>(
+                client_requests, client_responses, order_iface, order_port);
+    });
+    auto mdp_ready = std::async(std::launch::async, [this]() {
+        return std::make_unique<BasicMarketDataPublisher<Transport>>(
+                market_updates, data_iface, data_snapshot_ip, data_snapshot_port,
+                data_incremental_ip, data_incremental_port);
+    });
+    ome = ome_ready.get();
+    ogs = ogs_ready.get();
+    mdp = mdp_ready.get();
+    // modules are started downstream first, so nothing is produced before its consumer runs
+    mdp->start();
     ome->start();
-    logger.logf("% <ExchangeServer::%> starting Order Gateway\n",
-                LL::get_time_str(&t_str), __FUNCTION__);
-    ogs = std::make_unique<OrderGatewayServer>(client_requests, client_responses, order_iface,
-                                               order_port);
     ogs->start();
-    logger.logf("% <ExchangeServer::%> starting Data Publisher\n",
-                LL::get_time_str(&t_str), __FUNCTION__);
-    mdp = std::make_unique<MarketDataPublisher>(market_updates, data_iface, data_snapshot_ip,
-                                                data_snapshot_port, data_incremental_ip,
-                                                data_incremental_port);
-    mdp->start();
+    watchdog.start();
     // all child modules started; now run main worker thread
     is_running = true;
     thread = LL::create_and_start_thread(-1, "ExchangeServer",
                                          [this]() { run(); });
-    ASSERT(thread != nullptr, "<ExchangeServer> failed to start thread");
+    VERIFY(thread != nullptr, "<ExchangeServer> failed to start thread");
+    t_startup = LL::get_time_nanos() - t_start;
+    logger.logf("% <ExchangeServer::%> started in % us\n",
+                LL::get_time_str(&t_str), __FUNCTION__, t_startup / LL::NANOS_TO_MICROS);
 }
 
-void ExchangeServer::stop() {
+template<LL::Transport Transport>
+void BasicExchangeServer<Transport>::stop() {
+    const auto t_start = LL::get_time_nanos();
     if (is_running) {
         logger.logf("% <ExchangeServer::%> stopping all running exchange processes...\n",
                     LL::get_time_str(&t_str), __FUNCTION__);
-        is_running = false;
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            is_running = false;
+        }
+        sleep_cv.notify_all();
     }
-    if (thread != nullptr && thread->joinable())
+    if (thread != nullptr && thread->joinable()) {
         thread->join();
+        // each module is stopped once the module feeding it has stopped and its queue is empty
+        ogs->stop();
+        await_drained(client_requests);
+        ome->stop();
+        await_drained(market_updates);
+        mdp->stop();
+        watchdog.stop();
+        LL::CoarseClock::stop();
+        t_shutdown = LL::get_time_nanos() - t_start;
+        logger.logf("% <ExchangeServer::%> stopped in % us\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, t_shutdown / LL::NANOS_TO_MICROS);
+    }
+    if (LL::Tracer::get_is_enabled()) {
+        // export the session's spans for viewing in chrome://tracing or ui.perfetto.dev
+        const auto n_spans = LL::Tracer::write_chrome_trace(TRACE_FILENAME);
+        logger.logf("% <ExchangeServer::%> wrote % trace spans to %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, n_spans, TRACE_FILENAME);
+        LL::Tracer::disable();
+    }
 }
 
-void ExchangeServer::run() {
+template<LL::Transport Transport>
+void BasicExchangeServer<Transport>::run() {
+    std::unique_lock<std::mutex> lock(sleep_mutex);
     while (is_running) {
-        // run the exchange until a signal is received
+        // run the exchange until stopped, sleeping in between
         logger.logf("% <ExchangeServer::%> Sleeping for %ms...\n",
                     LL::get_time_str(&t_str), __FUNCTION__, T_SLEEP_MS);
-        usleep(T_SLEEP_MS * 1000); // sleep which is easily terminated by a SIGINT/other unix signal
+        sleep_cv.wait_for(lock, std::chrono::milliseconds(T_SLEEP_MS),
+                          [this]() { return !is_running; });
     }
 }
 
+template<LL::Transport Transport>
+template<typename Q>
+void BasicExchangeServer<Transport>::await_drained(const Q& queue) const noexcept {
+    const auto t_deadline = std::chrono::steady_clock::now()
+            + std::chrono::milliseconds(T_DRAIN_TIMEOUT_MS);
+    while (queue.size() && std::chrono::steady_clock::now() < t_deadline)
+        std::this_thread::yield();
 }
 
+template class BasicExchangeServer<LL::SocketTransport>;
+template class BasicExchangeServer<LL::ShmTransport>;
+}
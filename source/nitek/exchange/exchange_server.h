@@ -16,7 +16,15 @@
 #include <string>
 #include <memory>
 #include <atomic>
+#include <mutex>
+#include <future>
+#include <condition_variable>
+#include <cstdlib>
+#include "llbase/idle_strategy.h"
 #include "llbase/logging.h"
+#include "llbase/threading.h"
+#include "llbase/tracing.h"
+#include "llbase/watchdog.h"
 #include "exchange/orders/order_matching_engine.h"
 #include "exchange/data/market_data_publisher.h"
 #include "exchange/networking/order_gateway_server.h"
@@ -25,7 +33,8 @@
 
 namespace Exchange
 {
-class ExchangeServer {
+template<LL::Transport Transport>
+class BasicExchangeServer {
 public:
     /**
      * @brief The server-side exchange application which includes all the components
@@ -33,7 +42,9 @@ public:
      * @details At the heart of the Exchange is an order matching engine (OME) which maintains
      * a limit order book and handles matching client orders with one-another. Additionally, an
      * order gateway (OGS), market data server (MDP) and all necessary networking components
-     * for the exchange are encapsulated in this module.
+     * for the exchange are encapsulated in this module. Clients reach the OGS and MDP over
+     * the Transport: the network (SocketTransport), or shared memory (ShmTransport) when
+     * co-located with the exchange.
      * @param order_iface Network interface for the Order Gateway
      * @param order_port Port for the Order Gateway to bind to
      * @param data_iface Network interface for the UDP Market Data server
@@ -41,12 +52,14 @@ public:
      * @param data_incremental_port Port for incremental market data
      * @param data_snapshot_ip Multicast group IP for snapshot market data
      * @param data_snapshot_port Port for market data snapshots
+     * @param cpu_layout Core placement and scheduling of the exchange's threads
      */
-    ExchangeServer(const std::string& order_iface, int order_port,
-                   const std::string& data_iface, const std::string& data_incremental_ip,
-                   int data_incremental_port, const std::string& data_snapshot_ip,
-                   int data_snapshot_port);
-    ~ExchangeServer();
+    BasicExchangeServer(const std::string& order_iface, int order_port,
+                        const std::string& data_iface, const std::string& data_incremental_ip,
+                        int data_incremental_port, const std::string& data_snapshot_ip,
+                        int data_snapshot_port,
+                        const LL::CPULayout& cpu_layout = LL::CPULayout{ });
+    ~BasicExchangeServer();
 
     /**
      * @brief Start the Exchange Server's worker thread.
@@ -54,21 +67,28 @@ public:
      */
     void start();
     /**
-     * @brief The server's main working method.
+     * @brief Stop the server and its child modules.
+     * @details Modules are stopped in the order data flows through them, each once its
+     * input queue has drained (or a timeout passes), so in-flight messages are not lost.
      */
     void stop();
     /**
-     * @brief Stop the server, killing all child threads.
+     * @brief The server's main working method.
      */
     void run();
 
+    /** @brief Measured time (in ns) the last start() took to bring every module up */
+    [[nodiscard]] inline auto get_t_startup() const noexcept { return t_startup; }
+    /** @brief Measured time (in ns) the last stop() took to bring every module down */
+    [[nodiscard]] inline auto get_t_shutdown() const noexcept { return t_shutdown; }
+
 private:
     /*
      * Primary exchange modules
      */
     std::unique_ptr<Exchange::OrderMatchingEngine> ome{ nullptr };
-    std::unique_ptr<Exchange::MarketDataPublisher> mdp{ nullptr };
-    std::unique_ptr<Exchange::OrderGatewayServer> ogs{ nullptr };
+    std::unique_ptr<Exchange::BasicMarketDataPublisher<Transport>> mdp{ nullptr };
+    std::unique_ptr<Exchange::BasicOrderGatewayServer<Transport>> ogs{ nullptr };
     LL::Logger logger{ "exchange_server.log" };
     /*
      * Market data queues
@@ -86,14 +106,35 @@ private:
     int data_incremental_port{ };
     const std::string data_snapshot_ip{ };
     int data_snapshot_port{ };
+    // thread placement, applied when the server starts
+    const LL::CPULayout cpu_layout;
 
     // flag to gracefully terminate the server thread via SIGINT
     std::atomic<bool> is_running{ false };
     std::unique_ptr<std::thread> thread{ nullptr };   // tracks the running thread
     static constexpr int T_SLEEP_MS{ 100 }; // time (in ms) the main server thread sleeps for
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;       // wakes the main server thread early on stop()
+    // longest time (in ms) stop() waits for each module's input queue to drain
+    static constexpr int T_DRAIN_TIMEOUT_MS{ 100 };
+    LL::Nanos t_startup{ };
+    LL::Nanos t_shutdown{ };
+    // reports any module loop which stalls while the server runs
+    LL::Watchdog watchdog{ LL::Watchdog::T_STALL_DEFAULT, LL::Watchdog::T_SAMPLE_DEFAULT };
+
+    /** @brief Wait (up to the drain timeout) for a module's input queue to be emptied */
+    template<typename Q>
+    void await_drained(const Q& queue) const noexcept;
+    // setting this environment variable enables span tracing for the session
+    static constexpr const char* TRACE_ENV_VAR{ "NITEK_TRACE" };
+    static constexpr const char* TRACE_FILENAME{ "exchange_trace.json" };
+    // the file named by this environment variable holds the sockets' tuning profiles
+    static constexpr const char* SOCKET_PROFILES_ENV_VAR{ "NITEK_SOCKET_PROFILES" };
+    // this environment variable names how the modules' run loops idle, eg: BACKOFF
+    static constexpr const char* IDLE_ENV_VAR{ "NITEK_IDLE" };
     std::string t_str{ };
 
-DELETE_DEFAULT_COPY_AND_MOVE(ExchangeServer)
+DELETE_DEFAULT_COPY_AND_MOVE(BasicExchangeServer)
 
 #ifdef IS_TEST_SUITE
 public:
@@ -101,6 +142,10 @@ public:
     auto get_is_OME_running() { return ome->get_is_running(); }
     auto get_is_OGS_running() { return ogs->get_is_running(); }
     auto get_is_MDP_running() { return mdp->get_is_running(); }
+    auto get_OME_idle_kind() { return ome->get_idle_kind(); }
 #endif
 };
+
+using ExchangeServer = BasicExchangeServer<LL::SocketTransport>;
+using ShmExchangeServer = BasicExchangeServer<LL::ShmTransport>;
 }
@@ -19,6 +19,7 @@
 #include "llbase/macros.h"
 #include "llbase/logging.h"
 #include "llbase/threading.h"
+#include "llbase/tracing.h"
 #include "exchange/data/ome_client_request.h"
 
 
@@ -45,6 +46,7 @@ public:
         if (!n_pending_requests) [[unlikely]] {
             return;
         }
+        TRACE_SPAN("FIFOSequencer::sequence_and_publish");
         logger.logf("% <FIFOSequencer::%> pending requests: %\n",
                     LL::get_time_str(&t_str), __FUNCTION__,
                     n_pending_requests);
@@ -74,6 +76,12 @@ public:
         }
         pending_requests.at(n_pending_requests++) = { t_rx, request };
     }
+    /**
+     * @brief Whether another request can be pushed before the next sequence_and_publish()
+     */
+    [[nodiscard]] inline auto has_capacity() const noexcept {
+        return n_pending_requests < pending_requests.size();
+    }
 
     /**
      * @brief Tracks a client request which is awaiting processing
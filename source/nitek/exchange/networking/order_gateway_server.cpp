@@ -3,70 +3,206 @@
 
 namespace Exchange
 {
-OrderGatewayServer::OrderGatewayServer(ClientRequestQueue& tx_requests,
-                                       ClientResponseQueue& rx_responses,
-                                       const std::string& iface, int port)
+template<LL::Transport Transport>
+BasicOrderGatewayServer<Transport>::BasicOrderGatewayServer(
+        ClientRequestQueue& tx_requests, ClientResponseQueue& rx_responses,
+        const std::string& iface, int port, size_t n_reactors)
         : iface(iface),
           port(port),
           rx_responses(rx_responses),
           logger("exchange_order_gateway_server.log"),
-          server(logger),
           fifo(tx_requests, logger) {
-    map_client_to_tx_n_seq.fill(1);
-    map_client_to_rx_n_seq.fill(1);
-    map_client_to_socket.fill(nullptr);
-    server.set_rx_callback([this](auto socket, auto t_rx) {
-        rx_callback(socket, t_rx);
-    });
-    server.set_rx_done_callback([this]() { rx_done_callback(); });
+    VERIFY(n_reactors > 0, "<OGS> at least one reactor is required");
+    for (auto& i_reactor: map_client_to_reactor)
+        i_reactor.store(NO_REACTOR, std::memory_order_relaxed);
+    const bool is_threaded = n_reactors > 1;
+    for (size_t i{ }; i < n_reactors; ++i) {
+        auto* reactor_logger = &logger;
+        if (is_threaded) {
+            reactor_loggers.push_back(std::make_unique<LL::Logger>(
+                    "exchange_order_gateway_server_reactor_" + std::to_string(i) + ".log"));
+            reactor_logger = reactor_loggers.back().get();
+        }
+        auto& reactor = *reactors.emplace_back(
+                std::make_unique<Reactor>(i, *reactor_logger, is_threaded));
+        // reads are dispatched to rx_callback() by the run loops, which hand the server it
+        //  directly; only disconnects go through a std::function
+        reactor.server.set_dx_callback([this, &reactor](auto socket) {
+            dx_callback(reactor, socket);
+        });
+    }
 }
 
-OrderGatewayServer::~OrderGatewayServer() {
+template<LL::Transport Transport>
+BasicOrderGatewayServer<Transport>::~BasicOrderGatewayServer() {
     stop();
-    using namespace std::literals::chrono_literals;
-    std::this_thread::sleep_for(1s);
 }
 
-void OrderGatewayServer::start() {
+template<LL::Transport Transport>
+void BasicOrderGatewayServer<Transport>::start() {
     is_running = true;
-    server.listen(iface, port);
+    const bool is_threaded = reactors.size() > 1;
+    for (auto& reactor: reactors) {
+        reactor->server.get_socket().tuning = LL::SocketProfiles::lookup("OGS");
+        reactor->server.listen(iface, port, is_threaded);
+    }
+    if (is_threaded) {
+        for (auto& reactor: reactors) {
+            reactor->thread = LL::create_and_start_thread(
+                    -1, "OGSReactor" + std::to_string(reactor->i),
+                    [this, &reactor]() { run_reactor(*reactor); });
+            VERIFY(reactor->thread != nullptr, "<OGS> Failed to start thread for reactor: "
+                    + std::to_string(reactor->i));
+        }
+    }
     thread = LL::create_and_start_thread(-1, "OrderGatewayServer",
                                          [this]() { run(); });
-    ASSERT(thread != nullptr, "<OGS> Failed to start thread for order gateway");
+    VERIFY(thread != nullptr, "<OGS> Failed to start thread for order gateway");
 }
 
-void OrderGatewayServer::stop() {
-    // the thread is halted when is_running is false
+template<LL::Transport Transport>
+void BasicOrderGatewayServer<Transport>::stop() {
+    // the threads are halted when is_running is false
     is_running = false;
     if (thread != nullptr && thread->joinable())
         thread->join();
+    for (auto& reactor: reactors) {
+        if (reactor->thread != nullptr && reactor->thread->joinable())
+            reactor->thread->join();
+    }
 }
 
-void OrderGatewayServer::run() {
-    logger.logf("% <OGS::%> running order gateway...\n",
-                LL::get_time_str(&t_str), __FUNCTION__);
+template<LL::Transport Transport>
+void BasicOrderGatewayServer<Transport>::run() {
+    logger.logf("% <OGS::%> running order gateway with % reactor(s)...\n",
+                LL::get_time_str(&t_str), __FUNCTION__, reactors.size());
+    progress.watch();
+    auto& reactor = *reactors.front();
+    const bool is_threaded = reactors.size() > 1;
     while (is_running) {
-        server.poll();
-        server.tx_and_rx();
+        size_t n_work{ };
+        if (is_threaded) {
+            n_work += sequence_reactor_requests();
+        }
+        else {
+            // a single reactor is served inline on this thread
+            n_work += reactor.server.poll();
+            // requests are parsed by rx_callback() inline, rather than through std::functions
+            n_work += reactor.server.tx_and_rx(
+                    [this, &reactor](Stream* socket, LL::Nanos t_rx) {
+                        rx_callback(reactor, socket, t_rx);
+                    },
+                    [this]() { rx_done_callback(); });
+        }
+        n_work += route_responses();
+        progress.tick(n_work);
+        idle.idle(n_work);
+    }
+    progress.unwatch();
+}
 
-        for (auto res = rx_responses.get_next_to_read();
-             rx_responses.size() && res;
-             res = rx_responses.get_next_to_read()) {
-            auto& n_seq_tx_next = map_client_to_tx_n_seq[res->client_id];
-            logger.logf("% <OGS::%> processing cid: %, n_seq: %, response: %\n",
-                        LL::get_time_str(&t_str), __FUNCTION__,
-                        res->client_id, n_seq_tx_next, res->to_str());
-            ASSERT(map_client_to_socket[res->client_id] != nullptr,
-                   "<OGS> missing socket for client: "
-                           + client_id_to_str(res->client_id));
-            map_client_to_socket[res->client_id]->load_tx(&n_seq_tx_next, sizeof(n_seq_tx_next));
-            map_client_to_socket[res->client_id]->load_tx(res, sizeof(OMEClientResponse));
+template<LL::Transport Transport>
+void BasicOrderGatewayServer<Transport>::run_reactor(Reactor& reactor) {
+    reactor.logger.logf("% <OGS::%> running reactor: %...\n",
+                        LL::get_time_str(&reactor.t_str), __FUNCTION__, reactor.i);
+    reactor.progress.watch();
+    while (is_running) {
+        size_t n_work = reactor.server.poll();
+        n_work += load_reactor_responses(reactor);
+        // threaded reactors' requests are sequenced on the gateway thread instead
+        n_work += reactor.server.tx_and_rx(
+                [this, &reactor](Stream* socket, LL::Nanos t_rx) {
+                    rx_callback(reactor, socket, t_rx);
+                },
+                []() { });
+        reactor.progress.tick(n_work);
+        reactor.idle.idle(n_work);
+    }
+    reactor.progress.unwatch();
+}
 
-            rx_responses.increment_read_index();
+template<LL::Transport Transport>
+size_t BasicOrderGatewayServer<Transport>::sequence_reactor_requests() noexcept {
+    // requests from every reactor are sorted together by the sequencer, so that they reach
+    //  the matching engine in the order they arrived, whichever connection they came in on
+    size_t n_requests{ };
+    for (auto& reactor: reactors) {
+        auto& rx_requests = *reactor->rx_requests;
+        for (auto req = rx_requests.get_next_to_read();
+             rx_requests.size() && req && fifo.has_capacity();
+             req = rx_requests.get_next_to_read()) {
+            fifo.push_client_request(req->request, req->t_rx);
+            rx_requests.increment_read_index();
+            ++n_requests;
+        }
+    }
+    fifo.sequence_and_publish();
+    return n_requests;
+}
 
-            ++n_seq_tx_next;
+template<LL::Transport Transport>
+size_t BasicOrderGatewayServer<Transport>::route_responses() noexcept {
+    size_t n_responses{ };
+    for (auto res = rx_responses.get_next_to_read();
+         rx_responses.size() && res;
+         res = rx_responses.get_next_to_read()) {
+        TRACE_SPAN("OGS::tx_response");
+        logger.logf("% <OGS::%> processing cid: %, response: %\n",
+                    LL::get_time_str(&t_str), __FUNCTION__, res->client_id, res->to_str());
+        const auto i_reactor =
+                map_client_to_reactor[res->client_id].load(std::memory_order_acquire);
+        if (i_reactor == NO_REACTOR) [[unlikely]] {
+            // the client disconnected after sending the request
+            logger.logf("% <OGS::%> dropping response for disconnected client: %\n",
+                        LL::get_time_str(&t_str), __FUNCTION__, res->client_id);
         }
+        else if (auto& reactor = *reactors[i_reactor]; reactor.tx_responses) {
+            auto next = reactor.tx_responses->get_next_to_write();
+            *next = *res;
+            reactor.tx_responses->increment_write_index();
+        }
+        else {
+            load_response(reactor, *res);
+        }
+        rx_responses.increment_read_index();
+        ++n_responses;
+    }
+    return n_responses;
+}
+
+template<LL::Transport Transport>
+size_t BasicOrderGatewayServer<Transport>::load_reactor_responses(Reactor& reactor) noexcept {
+    size_t n_responses{ };
+    auto& tx_responses = *reactor.tx_responses;
+    for (auto res = tx_responses.get_next_to_read();
+         tx_responses.size() && res;
+         res = tx_responses.get_next_to_read()) {
+        load_response(reactor, *res);
+        tx_responses.increment_read_index();
+        ++n_responses;
+    }
+    return n_responses;
+}
+
+template<LL::Transport Transport>
+void BasicOrderGatewayServer<Transport>::load_response(
+        Reactor& reactor, const OMEClientResponse& response) noexcept {
+    const auto client_id = response.client_id;
+    // only this reactor's own sockets are used; a client it doesn't serve (any longer) may
+    //  have reconnected to another reactor, which owns that client's new socket
+    auto socket = reactor.map_client_to_socket[client_id];
+    if (socket == nullptr) [[unlikely]] {
+        reactor.logger.logf("% <OGS::%> dropping response for client: % not connected to "
+                            "reactor: %\n", LL::get_time_str(&reactor.t_str), __FUNCTION__,
+                            client_id, reactor.i);
+        return;
     }
+    auto& n_seq_tx_next = reactor.map_client_to_tx_n_seq[client_id];
+    socket->load_tx(&n_seq_tx_next, sizeof(n_seq_tx_next));
+    socket->load_tx(&response, sizeof(OMEClientResponse));
+    ++n_seq_tx_next;
 }
 
-}
\ No newline at end of file
+template class BasicOrderGatewayServer<LL::SocketTransport>;
+template class BasicOrderGatewayServer<LL::ShmTransport>;
+}
@@ -14,14 +14,20 @@
 #pragma once
 
 
+#include <atomic>
 #include <functional>
 #include <string>
 #include <array>
+#include <memory>
+#include <vector>
 #include "llbase/threading.h"
+#include "llbase/lfqueue.h"
 #include "llbase/macros.h"
-#include "llbase/tcp_server.h"
-#include "llbase/tcp_socket.h"
+#include "llbase/transport.h"
 #include "llbase/timekeeping.h"
+#include "llbase/tracing.h"
+#include "llbase/idle_strategy.h"
+#include "llbase/loop_progress.h"
 #include "exchange/networking/fifo_sequencer.h"
 #include "exchange/data/ome_client_response.h"
 #include "exchange/data/ome_client_request.h"
@@ -29,8 +35,19 @@
 
 namespace Exchange
 {
-class OrderGatewayServer {
+template<LL::Transport Transport>
+class BasicOrderGatewayServer {
 public:
+    using Stream = typename Transport::Stream;
+    using StreamServer = typename Transport::StreamServer;
+    // requests received by a reactor thread, handed to the gateway thread to be sequenced
+    using ReactorRequestQueue = LL::LFQueue<FIFOSequencer::PendingClientRequest>;
+    // responses handed back to the reactor thread owning the client's connection, which
+    //  numbers them in that client's sequence
+    using ReactorResponseQueue = LL::LFQueue<OMEClientResponse>;
+    // a client which has no connection open with any reactor
+    static constexpr size_t NO_REACTOR{ SIZE_MAX };
+
     /**
      * @brief An exchange order server which acts as a gateway
      * to process client order requests and respond with
@@ -42,18 +59,24 @@ public:
      * to the corresponding exchange client
      * @param iface Network interface name to bind to
      * @param port Port the interface will listen on
+     * @param n_reactors Number of reactors serving client connections. With one, the
+     * gateway's own thread serves every connection. With more, each reactor runs on its own
+     * thread ("OGSReactor<i>", placed by any installed CPULayout) with its own listener on
+     * the port, and the kernel balances new connections across them (SO_REUSEPORT).
+     * @details Built on a Transport: clients connect over TCP (SocketTransport), or through
+     * shared memory when they share the exchange's host (ShmTransport).
      */
-    OrderGatewayServer(ClientRequestQueue& tx_requests,
-                       ClientResponseQueue& rx_responses,
-                       const std::string& iface, int port);
-    ~OrderGatewayServer();
+    BasicOrderGatewayServer(ClientRequestQueue& tx_requests,
+                            ClientResponseQueue& rx_responses,
+                            const std::string& iface, int port, size_t n_reactors = 1);
+    ~BasicOrderGatewayServer();
 
     /**
-     * @brief Start the order server thread.
+     * @brief Start the order server thread, and any reactor threads.
      */
     void start();
     /**
-     * @brief Stop the order server thread.
+     * @brief Stop the order server thread, and any reactor threads.
      */
     void stop();
     /**
@@ -61,16 +84,64 @@ public:
      */
     void run();
 
-    void rx_callback(LL::TCPSocket* socket, LL::Nanos t_rx) noexcept {
+    /**
+     * @brief One event loop over a share of the gateway's client connections, with its own
+     * stream server (and so, over TCP, its own epoll instance).
+     * @details A reactor on its own thread hands every request it receives to the gateway
+     * thread over rx_requests, and sends the responses handed back over tx_responses. These
+     * queues are only created when the reactor runs on its own thread. The state of each
+     * client connected to a reactor is only ever touched from the reactor's own thread.
+     */
+    struct Reactor {
+        Reactor(size_t i, LL::Logger& logger, bool is_threaded)
+                : i(i), logger(logger), server(logger),
+                  rx_requests(is_threaded ? std::make_unique<ReactorRequestQueue>(
+                          Limits::MAX_PENDING_ORDER_REQUESTS) : nullptr),
+                  tx_responses(is_threaded ? std::make_unique<ReactorResponseQueue>(
+                          Limits::MAX_CLIENT_UPDATES) : nullptr),
+                  progress("OGSReactor" + std::to_string(i)) {
+            map_client_to_tx_n_seq.fill(1);
+            map_client_to_rx_n_seq.fill(1);
+            map_client_to_socket.fill(nullptr);
+        }
+
+        const size_t i;         // index in the gateway's reactors
+        LL::Logger& logger;
+        StreamServer server;    // manages this reactor's client connections
+        std::unique_ptr<ReactorRequestQueue> rx_requests;
+        std::unique_ptr<ReactorResponseQueue> tx_responses;
+        // map client ID -> next sequence number for that client's outgoing response message
+        std::array<size_t, Limits::MAX_N_CLIENTS> map_client_to_tx_n_seq;
+        // map client ID -> next _incoming_ sequence number expected from that client
+        std::array<size_t, Limits::MAX_N_CLIENTS> map_client_to_rx_n_seq;
+        // map client ID -> its connection's socket, if connected to this reactor
+        std::array<Stream*, Limits::MAX_N_CLIENTS> map_client_to_socket;
+        std::unique_ptr<std::thread> thread{ nullptr };
+        LL::IdleStrategy idle{ };
+        LL::LoopProgress progress;
+        std::string t_str;
+
+    DELETE_DEFAULT_COPY_AND_MOVE(Reactor)
+    };
+
+    /**
+     * @brief A reactor thread's main working method.
+     */
+    void run_reactor(Reactor& reactor);
+
+    void rx_callback(Reactor& reactor, Stream* socket, LL::Nanos t_rx) noexcept {
+        TRACE_SPAN("OGS::rx_callback");
+        auto& logger = reactor.logger;
+        auto& t_str = reactor.t_str;
         logger.logf("% <OGS::%> rx at socket: %, len: %, t: %\n",
                     LL::get_time_str(&t_str), __FUNCTION__,
-                    socket->fd, socket->i_rx_next, t_rx);
+                    socket->fd, socket->rx_buffer.size(), t_rx);
 
         // available rx data should be at least one client request in size
         // -> break it up into appropriate chunks and iterate
-        if (socket->i_rx_next >= sizeof(OGSClientRequest)) {
+        if (socket->rx_buffer.size() >= sizeof(OGSClientRequest)) {
             size_t i{ };
-            for (; i + sizeof(OGSClientRequest) <= socket->i_rx_next;
+            for (; i + sizeof(OGSClientRequest) <= socket->rx_buffer.size();
                    i += sizeof(OGSClientRequest)) {
                 auto req = reinterpret_cast<const OGSClientRequest*>(
                         socket->rx_buffer.data() + i);
@@ -78,28 +149,38 @@ public:
                             LL::get_time_str(&t_str),
                             __FUNCTION__, req->to_str());
 
-                // client's first order req; start tracking with a new socket mapping
-                if (map_client_to_socket[req->ome_request.client_id] == nullptr) [[unlikely]] {
-                    map_client_to_socket[req->ome_request.client_id] = socket;
+                // client's first order req; claim the client for this reactor and start
+                // tracking it with a new socket mapping
+                const auto client_id = req->ome_request.client_id;
+                auto& client_socket = reactor.map_client_to_socket[client_id];
+                if (client_socket == nullptr) [[unlikely]] {
+                    auto i_reactor = NO_REACTOR;
+                    if (!map_client_to_reactor[client_id].compare_exchange_strong(
+                            i_reactor, reactor.i, std::memory_order_acq_rel)) {
+                        // todo: this should send a response back to client
+                        logger.logf("% <OGS::%> rx'd req from client: % on socket: %! "
+                                    "already connected to reactor: %\n",
+                                    LL::get_time_str(&t_str), __FUNCTION__, client_id,
+                                    socket->fd, i_reactor);
+                        continue;
+                    }
+                    client_socket = socket;
                 }
 
                 // current req socket does not match the mapped one
                 // -> log error and skip the order request
-                if (map_client_to_socket[req->ome_request.client_id] != socket) {
+                if (client_socket != socket) {
                     // todo: this should send a response back to client
                     logger.logf("% <OGS::%> rx'd req from client: %"
                                 " on socket: %! expected: %\n",
                                 LL::get_time_str(&t_str),
-                                __FUNCTION__,
-                                req->ome_request.client_id, socket->fd,
-                                map_client_to_socket[req->ome_request.client_id]->fd);
+                                __FUNCTION__, client_id, socket->fd, client_socket->fd);
                     continue;
                 }
 
                 // sanity check for sequence number
                 // if seq mismatch -> log error and ignore order request
-                auto& n_seq_rx_next =
-                        map_client_to_rx_n_seq[req->ome_request.client_id];
+                auto& n_seq_rx_next = reactor.map_client_to_rx_n_seq[client_id];
                 if (req->n_seq != n_seq_rx_next) {
                     // todo: this should send a rejection back to client
                     logger.logf("% <OGS::%> seq number error! client: %, n_seq expected: % "
@@ -109,14 +190,20 @@ public:
                     continue;
                 }
 
-                // increment client seq number and fwd order to the
-                // exchange FIFO sequencer
+                // increment client seq number and fwd order to the exchange FIFO
+                // sequencer, directly or through the gateway thread
                 ++n_seq_rx_next;
-                fifo.push_client_request(req->ome_request, t_rx);
+                if (reactor.rx_requests) {
+                    auto next = reactor.rx_requests->get_next_to_write();
+                    *next = { t_rx, req->ome_request };
+                    reactor.rx_requests->increment_write_index();
+                }
+                else {
+                    fifo.push_client_request(req->ome_request, t_rx);
+                }
             }
-            memcpy(socket->rx_buffer.data(), socket->rx_buffer.data() + i,
-                   socket->i_rx_next - i);
-            socket->i_rx_next -= i;
+            // requests are consumed in place; any partial request stays for the next rx
+            socket->rx_buffer.consume(i);
         }
     }
 
@@ -127,32 +214,78 @@ public:
         fifo.sequence_and_publish();
     };
 
+    /**
+     * @brief Forget a closed connection's socket, which the server is about to reuse, so
+     * its client can connect again, to any reactor
+     * @details The client starts a new session, numbering its requests (and expecting its
+     * responses numbered) from 1 again.
+     */
+    void dx_callback(Reactor& reactor, Stream* socket) noexcept {
+        for (size_t client{ }; client < reactor.map_client_to_socket.size(); ++client) {
+            if (reactor.map_client_to_socket[client] == socket) {
+                reactor.logger.logf("% <OGS::%> client: % disconnected from socket: %\n",
+                                    LL::get_time_str(&reactor.t_str), __FUNCTION__, client,
+                                    socket->fd);
+                reactor.map_client_to_socket[client] = nullptr;
+                reactor.map_client_to_rx_n_seq[client] = 1;
+                reactor.map_client_to_tx_n_seq[client] = 1;
+                map_client_to_reactor[client].store(NO_REACTOR, std::memory_order_release);
+            }
+        }
+    }
+
 private:
     const std::string iface;
     const int port{ 0 };
     ClientResponseQueue& rx_responses;  // order responses received from OME to send to clients
     volatile bool is_running{ false };
     std::unique_ptr<std::thread> thread{ nullptr };   // tracks the running thread
+    LL::IdleStrategy idle{ };   // what the run loop does when it finds no work
+    LL::LoopProgress progress{ "OGS" };  // sampled by the liveness watchdog
     std::string t_str;
     LL::Logger logger;
-    LL::TCPServer server;   // server instance manages client connections
+    // threaded reactors each log to their own file, so as not to share the gateway's logger
+    std::vector<std::unique_ptr<LL::Logger>> reactor_loggers;
+    std::vector<std::unique_ptr<Reactor>> reactors;   // serve the client connections
     // FIFO queue for processing client orderreq's in the proper sequence
     FIFOSequencer fifo;
-    // map client ID -> next sequence number for that client's outgoing
-    // response message
-    std::array<size_t, Limits::MAX_N_CLIENTS> map_client_to_tx_n_seq;
-    // map client ID -> next _incoming_ sequence number expected
-    // to be received from a client
-    std::array<size_t, Limits::MAX_N_CLIENTS> map_client_to_rx_n_seq;
-    // mapping of client to their connection's corresponding TCPSocket
-    std::array<LL::TCPSocket*, Limits::MAX_N_CLIENTS> map_client_to_socket;
+    // mapping of client to the reactor which serves their connection, or NO_REACTOR;
+    //  claimed and released by the reactors' threads, and read by the gateway's
+    std::array<std::atomic<size_t>, Limits::MAX_N_CLIENTS> map_client_to_reactor;
 
-DELETE_DEFAULT_COPY_AND_MOVE(OrderGatewayServer)
+    /**
+     * @brief Hand requests received by the reactor threads to the FIFO sequencer, for as
+     * long as it has room, and publish them in the order they were received
+     * @return Number of requests handed over
+     */
+    size_t sequence_reactor_requests() noexcept;
+    /**
+     * @brief Send each response from the matching engine to the reactor serving its client:
+     * loaded directly when the reactor runs on this thread, else handed to its thread
+     * @return Number of responses processed
+     */
+    size_t route_responses() noexcept;
+    /**
+     * @brief Load the responses handed back to a reactor thread to send to their clients
+     * @return Number of responses loaded
+     */
+    size_t load_reactor_responses(Reactor& reactor) noexcept;
+    /**
+     * @brief Number a response in its client's sequence and load it to send on the
+     * client's connection with the reactor, or drop it if the client isn't connected there
+     * (it disconnected, or has since reconnected to another reactor)
+     */
+    void load_response(Reactor& reactor, const OMEClientResponse& response) noexcept;
+
+DELETE_DEFAULT_COPY_AND_MOVE(BasicOrderGatewayServer)
 
 #ifdef IS_TEST_SUITE
 public:
     auto get_is_running() { return is_running; }
+    auto& get_reactors() { return reactors; }
 #endif
 };
-}
 
+using OrderGatewayServer = BasicOrderGatewayServer<LL::SocketTransport>;
+using ShmOrderGatewayServer = BasicOrderGatewayServer<LL::ShmTransport>;
+}
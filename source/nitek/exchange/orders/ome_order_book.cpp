@@ -16,8 +16,6 @@ OMEOrderBook::~OMEOrderBook() {
 //    logger.logf("% <OMEOrderBook::%>\n%\n",
 //                LL::get_time_str(&t_str), __FUNCTION__,
 //                to_str(false, true));
-    using namespace std::literals::chrono_literals;
-    std::this_thread::sleep_for(500ms);
     bids_by_price = asks_by_price = nullptr;
     for (auto& oids: map_client_id_to_order) {
         oids.fill(nullptr);
@@ -20,8 +20,6 @@ OrderMatchingEngine::OrderMatchingEngine(ClientRequestQueue* rx_requests,
 
 OrderMatchingEngine::~OrderMatchingEngine() {
     stop();
-    using namespace std::literals::chrono_literals;
-    std::this_thread::sleep_for(1s);
     rx_requests = nullptr;
     tx_responses = nullptr;
     tx_market_updates = nullptr;
@@ -31,9 +29,11 @@ OrderMatchingEngine::~OrderMatchingEngine() {
 }
 
 void OrderMatchingEngine::start() {
+    // set before the thread starts, so an immediate stop() can't be missed by run()
+    is_running = true;
     thread = LL::create_and_start_thread(-1, "OME",
                                          [this]() { run(); });
-    ASSERT(thread != nullptr, "<OME> Failed to start thread for matching engine");
+    VERIFY(thread != nullptr, "<OME> Failed to start thread for matching engine");
 }
 
 void OrderMatchingEngine::stop() {
@@ -44,6 +44,7 @@ void OrderMatchingEngine::stop() {
 }
 
 void OrderMatchingEngine::process_client_request(const OMEClientRequest* request) noexcept {
+    TRACE_SPAN("OME::process_client_request");
     switch (request->type) {
     case OMEClientRequest::Type::NEW:
         order_book_for_ticker[request->ticker_id]->add(
@@ -65,10 +66,10 @@ void OrderMatchingEngine::process_client_request(const OMEClientRequest* request
 }
 
 void OrderMatchingEngine::run() noexcept {
-    is_running = true;
     logger.logf("% <OME::%> accepting client order requests...\n",
                 LL::get_time_str(&t_str), __FUNCTION__);
     // consume client order requests received on the queue
+    progress.watch();
     while (is_running) {
         const auto request = rx_requests->get_next_to_read();
         if (request != nullptr) [[likely]] {
@@ -78,7 +79,10 @@ void OrderMatchingEngine::run() noexcept {
             process_client_request(request);
             rx_requests->increment_read_index();
         }
+        progress.tick(request != nullptr);
+        idle.idle(request != nullptr);
     }
+    progress.unwatch();
 }
 void OrderMatchingEngine::send_client_response(const OMEClientResponse* response) noexcept {
     logger.logf("% <OME::%> tx response: %\n",
@@ -17,6 +17,9 @@
 #include "llbase/lfqueue.h"
 #include "llbase/threading.h"
 #include "llbase/logging.h"
+#include "llbase/tracing.h"
+#include "llbase/idle_strategy.h"
+#include "llbase/loop_progress.h"
 #include "exchange/data/ome_client_request.h"
 #include "exchange/data/ome_client_response.h"
 #include "exchange/data/ome_market_update.h"
@@ -77,6 +80,7 @@ public:
      * @brief True when the matching engine worker thread is running
      */
     inline bool get_is_running() const noexcept { return is_running; };
+    inline auto get_idle_kind() const noexcept { return idle.get_kind(); };
 
 PRIVATE_IN_PRODUCTION
     // an order book mapped from each ticker
@@ -89,6 +93,8 @@ PRIVATE_IN_PRODUCTION
     MarketUpdateQueue* tx_market_updates{ nullptr };
     std::unique_ptr<std::thread> thread{ nullptr };   // tracks the running thread
     volatile bool is_running{ false };  // tracks running thread state
+    LL::IdleStrategy idle{ };   // what the run loop does when it finds no work
+    LL::LoopProgress progress{ "OME" };  // sampled by the liveness watchdog
     std::string t_str;
     LL::Logger logger;
 
@@ -16,6 +16,7 @@ void shutdown_handler(int) {
     logger = nullptr;
     ome = nullptr;
     std::this_thread::sleep_for(5s);
+    LL::CoarseClock::stop();
     exit(EXIT_SUCCESS);
 }
 
@@ -24,6 +25,8 @@ int main(int, char**) {
     using namespace LL;
 
     std::signal(SIGINT, shutdown_handler);
+    TSCClock::calibrate();
+    CoarseClock::start();
     logger = std::make_unique<Logger>("nitek_main.log");
     ClientRequestQueue client_requests{ Limits::MAX_CLIENT_UPDATES };
     ClientResponseQueue client_responses{ Limits::MAX_CLIENT_UPDATES };
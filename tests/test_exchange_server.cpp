@@ -65,6 +65,34 @@ TEST_F(ExchangeServerBasics, runs_and_terminates) {
     EXPECT_FALSE(exchange->get_is_running());
 }
 
+TEST_F(ExchangeServerBasics, reports_startup_and_shutdown_times) {
+    // start and stop are measured, and stop brings every module down without fixed sleeps
+    exchange = std::make_unique<ExchangeServer>(order_iface, order_port, data_iface,
+                                                data_incremental_ip, data_incremental_port,
+                                                data_snapshot_ip, data_snapshot_port);
+    exchange->start();
+    EXPECT_GT(exchange->get_t_startup(), 0);
+    exchange->stop();
+    EXPECT_GT(exchange->get_t_shutdown(), 0);
+    EXPECT_LT(exchange->get_t_shutdown(), LL::NANOS_TO_SECS);
+    EXPECT_FALSE(exchange->get_is_OME_running());
+    EXPECT_FALSE(exchange->get_is_OGS_running());
+    EXPECT_FALSE(exchange->get_is_MDP_running());
+}
+
+TEST_F(ExchangeServerBasics, modules_idle_as_configured) {
+    // the deployment's idle kind is applied before the modules are constructed
+    setenv("NITEK_IDLE", "BACKOFF", 1);
+    exchange = std::make_unique<ExchangeServer>(order_iface, order_port, data_iface,
+                                                data_incremental_ip, data_incremental_port,
+                                                data_snapshot_ip, data_snapshot_port);
+    exchange->start();
+    unsetenv("NITEK_IDLE");
+    EXPECT_EQ(exchange->get_OME_idle_kind(), IdleKind::BACKOFF);
+    exchange->stop();
+    IdleStrategy::set_default(IdleKind::BUSY_SPIN);
+}
+
 
 /*
  * Integration tests which verify the inner workings of
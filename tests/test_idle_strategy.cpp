@@ -0,0 +1,57 @@
+#include "gtest/gtest.h"
+#include "llbase/idle_strategy.h"
+
+#include <chrono>
+
+
+using namespace LL;
+
+
+class IdleStrategyBasics : public ::testing::Test {
+protected:
+    void SetUp() override { }
+    void TearDown() override {
+        IdleStrategy::set_default(IdleKind::BUSY_SPIN);
+    }
+};
+
+
+TEST_F(IdleStrategyBasics, uses_process_wide_default) {
+    // strategies take the deployment's default kind unless one is given
+    EXPECT_EQ(IdleStrategy{ }.get_kind(), IdleKind::BUSY_SPIN);
+    IdleStrategy::set_default(IdleKind::BACKOFF);
+    EXPECT_EQ(IdleStrategy{ }.get_kind(), IdleKind::BACKOFF);
+    EXPECT_EQ(IdleStrategy{ IdleKind::YIELD }.get_kind(), IdleKind::YIELD);
+}
+
+TEST_F(IdleStrategyBasics, kind_is_parsed_from_its_name) {
+    // a deployment names its idle kind as it's printed
+    EXPECT_EQ(idle_kind_from_str("BUSY_SPIN"), IdleKind::BUSY_SPIN);
+    EXPECT_EQ(idle_kind_from_str("PAUSE"), IdleKind::PAUSE);
+    EXPECT_EQ(idle_kind_from_str("YIELD"), IdleKind::YIELD);
+    EXPECT_EQ(idle_kind_from_str("BACKOFF"), IdleKind::BACKOFF);
+    EXPECT_EXIT(idle_kind_from_str("NAP"), ::testing::ExitedWithCode(EXIT_FAILURE),
+                "unknown idle kind NAP");
+}
+
+TEST_F(IdleStrategyBasics, backoff_resets_when_work_is_done) {
+    // idle passes accumulate until a pass does some work
+    IdleStrategy idle{ IdleKind::BACKOFF };
+    for (int i{ }; i < 10; ++i)
+        idle.idle(0);
+    EXPECT_EQ(idle.get_n_idle(), 10);
+    idle.idle(1);
+    EXPECT_EQ(idle.get_n_idle(), 0);
+}
+
+TEST_F(IdleStrategyBasics, backoff_sleeps_once_spins_are_exhausted) {
+    // after spinning and yielding, backoff sleeps for progressively longer
+    IdleStrategy idle{ IdleKind::BACKOFF };
+    for (uint32_t i{ }; i < IdleStrategy::N_SPINS + IdleStrategy::N_YIELDS; ++i)
+        idle.idle(0);
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i{ }; i < 20; ++i)
+        idle.idle(0);
+    const auto dt = std::chrono::steady_clock::now() - t0;
+    EXPECT_GE(dt, std::chrono::nanoseconds(IdleStrategy::T_SLEEP_MAX));
+}
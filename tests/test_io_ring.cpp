@@ -0,0 +1,201 @@
+#include "gtest/gtest.h"
+#include "llbase/io_ring.h"
+#include "llbase/tcp_socket.h"
+#include "llbase/tcp_server.h"
+#include "llbase/mcast_socket.h"
+
+#include <string>
+#include <thread>
+
+
+using namespace LL;
+
+
+// base tests for the io_uring socket backend
+class IORingBasics : public ::testing::Test {
+protected:
+    std::string logfile{ "io_ring_tests.log" };
+    std::unique_ptr<Logger> logger;
+    std::unique_ptr<IORing> ring;
+    static const int PORT{ 12345 };
+    std::string IP{ "127.0.0.1" };
+    std::string IFACE{ "lo" };
+    std::string IP_MCAST_GROUP{ "239.0.0.1" };
+    static constexpr size_t SIZE_BUFFER{ 1024 * 1024 };
+
+    void SetUp() override {
+        logger = std::make_unique<Logger>(logfile);
+        ring = IORing::create(*logger, { .n_files = 8 });
+        if (ring == nullptr)
+            GTEST_SKIP() << "io_uring is not available here";
+    }
+
+    void TearDown() override {
+    }
+
+    // poll the server and client until the client has n bytes to read
+    template<typename T>
+    static void wait_for_rx(TCPServer& server, T& client, size_t n) {
+        using namespace std::literals::chrono_literals;
+        for (int i{ }; i < 100 && client.rx_buffer.size() < n; ++i) {
+            std::this_thread::sleep_for(5ms);
+            server.poll();
+            server.tx_and_rx();
+            client.tx_and_rx();
+        }
+    }
+};
+
+
+TEST_F(IORingBasics, attaches_and_detaches_sockets) {
+    // each attached socket takes a slot, which is handed back once the socket closes
+    auto server = std::make_unique<TCPSocket>(*logger, SIZE_BUFFER);
+    server->connect(IP, IFACE, PORT, true);
+    ASSERT_EQ(ring->get_n_slots_free(), 8);
+    {
+        auto client = std::make_unique<TCPSocket>(*logger, SIZE_BUFFER);
+        client->connect(IP, IFACE, PORT, false);
+        ASSERT_TRUE(client->attach(*ring));
+        ring->submit();
+        EXPECT_EQ(ring->get_n_slots_free(), 7);
+    }
+    // the cancelled receive completes, and the slot is free again
+    using namespace std::literals::chrono_literals;
+    for (int i{ }; i < 100 && ring->get_n_slots_free() < 8; ++i) {
+        std::this_thread::sleep_for(5ms);
+        ring->reap();
+    }
+    EXPECT_EQ(ring->get_n_slots_free(), 8);
+}
+
+TEST_F(IORingBasics, server_and_client_exchange_data) {
+    // a TCPServer and a client both on the ring send each other data
+    TCPServer server{ *logger, 2, SIZE_BUFFER };
+    server.set_io_ring(ring.get());
+    server.listen(IFACE, PORT);
+    std::string rx_server;
+    server.set_rx_callback([&](TCPSocket* s, Nanos) {
+        rx_server.append(s->rx_buffer.data(), s->rx_buffer.size());
+        s->rx_buffer.consume(s->rx_buffer.size());
+        s->load_tx("pong", 4);
+    });
+    TCPSocket client{ *logger, SIZE_BUFFER };
+    ASSERT_GT(client.connect(IP, IFACE, PORT, false), 0);
+    ASSERT_TRUE(client.attach(*ring));
+    client.load_tx("ping", 4);
+    wait_for_rx(server, client, 4);
+    EXPECT_EQ(rx_server, "ping");
+    ASSERT_EQ(client.rx_buffer.size(), 4);
+    EXPECT_EQ(std::string(client.rx_buffer.data(), 4), "pong");
+    EXPECT_EQ(client.i_tx_next, 0);
+}
+
+TEST_F(IORingBasics, closes_connection_when_peer_leaves) {
+    // the end of a connection's stream is seen through the ring, and its socket recycled
+    TCPServer server{ *logger, 2, SIZE_BUFFER };
+    server.set_io_ring(ring.get());
+    server.listen(IFACE, PORT);
+    auto client = std::make_unique<TCPSocket>(*logger, SIZE_BUFFER);
+    ASSERT_GT(client->connect(IP, IFACE, PORT, false), 0);
+    using namespace std::literals::chrono_literals;
+    for (int i{ }; i < 100 && server.get_connections().empty(); ++i) {
+        std::this_thread::sleep_for(5ms);
+        server.poll();
+        server.tx_and_rx();
+    }
+    ASSERT_EQ(server.get_connections().size(), 1);
+    client->reset();
+    for (int i{ }; i < 100 && !server.get_connections().empty(); ++i) {
+        std::this_thread::sleep_for(5ms);
+        server.poll();
+        server.tx_and_rx();
+    }
+    EXPECT_TRUE(server.get_connections().empty());
+    EXPECT_EQ(server.get_n_sockets_free(), 2);
+}
+
+TEST_F(IORingBasics, pools_closed_socket_once_ring_is_done_with_it) {
+    // a connection closed while the ring is still sending from it isn't handed to a new one
+    //  until the ring has finished with its tx buffer
+    TCPServer server{ *logger, 2, SIZE_BUFFER };
+    server.set_io_ring(ring.get());
+    server.set_tx_high_watermark(0);
+    server.listen(IFACE, PORT);
+    auto client = std::make_unique<TCPSocket>(*logger, SIZE_BUFFER);
+    ASSERT_GT(client->connect(IP, IFACE, PORT, false), 0);
+    using namespace std::literals::chrono_literals;
+    for (int i{ }; i < 100 && server.get_connections().empty(); ++i) {
+        std::this_thread::sleep_for(5ms);
+        server.poll();
+        server.tx_and_rx();
+    }
+    ASSERT_EQ(server.get_connections().size(), 1);
+    // the send is still in flight when the connection's closed for being over the watermark
+    server.get_connections()[0]->load_tx("data", 4);
+    server.tx_and_rx();
+    EXPECT_TRUE(server.get_connections().empty());
+    EXPECT_EQ(server.get_n_sockets_free(), 1);
+    for (int i{ }; i < 100 && server.get_n_sockets_free() < 2; ++i) {
+        std::this_thread::sleep_for(5ms);
+        server.poll();
+        server.tx_and_rx();
+    }
+    EXPECT_EQ(server.get_n_sockets_free(), 2);
+}
+
+TEST_F(IORingBasics, multicast_socket_receives) {
+    // datagrams sent by one attached McastSocket are received by another
+    McastSocket rx_socket{ *logger };
+    ASSERT_NE(rx_socket.init(IP_MCAST_GROUP, IFACE, PORT, true), -1);
+    ASSERT_TRUE(rx_socket.join_group(IP_MCAST_GROUP));
+    std::string rx;
+    rx_socket.rx_callback = [&](McastSocket* s, Nanos) {
+        rx.append(s->rx_buffer.data(), s->rx_buffer.size());
+        s->rx_buffer.consume(s->rx_buffer.size());
+    };
+    ASSERT_TRUE(rx_socket.attach(*ring));
+    McastSocket tx_socket{ *logger };
+    ASSERT_NE(tx_socket.init(IP_MCAST_GROUP, IFACE, PORT, false), -1);
+    ASSERT_TRUE(tx_socket.attach(*ring));
+    tx_socket.load_tx("data", 4);
+    using namespace std::literals::chrono_literals;
+    for (int i{ }; i < 100 && rx.empty(); ++i) {
+        tx_socket.tx_and_rx();
+        std::this_thread::sleep_for(5ms);
+        rx_socket.tx_and_rx();
+    }
+    EXPECT_EQ(rx, "data");
+    EXPECT_EQ(tx_socket.i_tx_next, 0);
+}
+
+TEST_F(IORingBasics, multicast_socket_sends_each_datagram) {
+    // datagrams loaded together go out a send each, however much is loaded in all
+    McastSocket rx_socket{ *logger };
+    ASSERT_NE(rx_socket.init(IP_MCAST_GROUP, IFACE, PORT + 1, true), -1);
+    ASSERT_TRUE(rx_socket.join_group(IP_MCAST_GROUP));
+    size_t n_rx{ };
+    rx_socket.rx_callback = [&](McastSocket* s, Nanos) {
+        n_rx += s->rx_buffer.size();
+        s->rx_buffer.consume(s->rx_buffer.size());
+    };
+    ASSERT_TRUE(rx_socket.attach(*ring));
+    McastSocket tx_socket{ *logger };
+    ASSERT_NE(tx_socket.init(IP_MCAST_GROUP, IFACE, PORT + 1, false), -1);
+    ASSERT_TRUE(tx_socket.attach(*ring));
+    // more than the largest UDP payload, which would fail as a single send
+    const std::string datagram(1000, 'x');
+    const size_t n_datagrams{ 80 };
+    for (size_t i{ }; i < n_datagrams; ++i) {
+        tx_socket.load_tx(datagram.data(), datagram.size());
+        tx_socket.end_datagram();
+    }
+    using namespace std::literals::chrono_literals;
+    for (int i{ }; i < 100 && n_rx < n_datagrams * datagram.size(); ++i) {
+        tx_socket.tx_and_rx();
+        std::this_thread::sleep_for(5ms);
+        rx_socket.tx_and_rx();
+    }
+    EXPECT_EQ(n_rx, n_datagrams * datagram.size());
+    EXPECT_EQ(tx_socket.i_tx_next, 0);
+    EXPECT_TRUE(tx_socket.tx_datagram_ends.empty());
+}
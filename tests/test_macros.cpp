@@ -0,0 +1,51 @@
+#include "gtest/gtest.h"
+#include "llbase/macros.h"
+
+#include <string>
+
+
+class MacrosBasics : public ::testing::Test {
+protected:
+    int n_msg_built{ 0 };
+
+    auto build_msg() -> std::string {
+        ++n_msg_built;
+        return "check failed";
+    }
+
+    void SetUp() override { }
+    void TearDown() override { }
+};
+
+
+TEST_F(MacrosBasics, message_is_not_built_when_check_passes) {
+    // the message of a passing check is never evaluated
+    ASSERT(n_msg_built == 0, build_msg());
+    VERIFY(n_msg_built == 0, build_msg());
+    EXPECT_EQ(n_msg_built, 0);
+}
+
+TEST_F(MacrosBasics, verify_exits_on_failure) {
+    // a failed VERIFY exits with its message, in every build configuration
+    EXPECT_EXIT(VERIFY(n_msg_built != 0, build_msg()),
+                ::testing::ExitedWithCode(EXIT_FAILURE), "check failed");
+}
+
+TEST_F(MacrosBasics, fatal_exits) {
+    // FATAL always exits with its message
+    EXPECT_EXIT(FATAL("fatal error"), ::testing::ExitedWithCode(EXIT_FAILURE), "fatal error");
+}
+
+#ifdef LL_NO_ASSERTS
+TEST_F(MacrosBasics, assert_is_compiled_out) {
+    // neither the condition nor the message of a compiled out ASSERT is evaluated
+    ASSERT(++n_msg_built == 0, build_msg());
+    EXPECT_EQ(n_msg_built, 0);
+}
+#else
+TEST_F(MacrosBasics, assert_exits_on_failure) {
+    // a failed ASSERT exits with its message
+    EXPECT_EXIT(ASSERT(n_msg_built != 0, build_msg()),
+                ::testing::ExitedWithCode(EXIT_FAILURE), "check failed");
+}
+#endif
@@ -66,6 +66,22 @@ TEST_F(MarketDataConsumerBasics, snapshot_sync_is_started) {
     EXPECT_NE(-1, mdc->socket_snapshot.fd);
 }
 
+TEST_F(MarketDataConsumerBasics, streams_are_attached_to_packet_ring) {
+    // with a packet ring, each stream is received from it once joined
+    auto mdc = std::make_unique<MarketDataConsumer>(2, updates,
+                                                    IFACE, IP_SNAPSHOT, PORT_SNAPSHOT,
+                                                    IP_INCREMENTAL, PORT_INCREMENTAL,
+                                                    McastTransport::PACKET_RING);
+    if (mdc->packet_ring == nullptr)
+        GTEST_SKIP() << "AF_PACKET rings are not available here";
+    EXPECT_EQ(mdc->packet_ring->get_n_flows(), 1);
+    mdc->snapshot_sync_start();
+    EXPECT_EQ(mdc->packet_ring->get_n_flows(), 2);
+    // recovery completing leaves the snapshot stream, and its flow
+    mdc->socket_snapshot.leave_group();
+    EXPECT_EQ(mdc->packet_ring->get_n_flows(), 1);
+}
+
 TEST_F(MarketDataConsumerBasics, incremental_update_is_queued) {
     // an incremental update is queued by the queue_update method
     auto mdc = std::make_unique<MarketDataConsumer>(2, updates,
@@ -289,3 +305,45 @@ TEST_F(MarketDataConsumerIntegration, receives_and_recovers_via_combined_data) {
     // recovery should have completed
     EXPECT_FALSE(mdc->is_in_recovery);
 }
+
+TEST_F(MarketDataConsumerIntegration, recovers_via_snapshot_through_shared_memory) {
+    /*
+     * a co-located consumer recovers from a publisher's snapshot and incremental data passed
+     * through shared memory, and carries on receiving incremental updates afterwards
+     */
+    auto mdp_shm = std::make_unique<ShmMarketDataPublisher>(
+            updates_to_publisher, IFACE, IP_SNAPSHOT, PORT_SNAPSHOT + 100, IP_INCREMENTAL,
+            PORT_INCREMENTAL + 100);
+    auto mdc_shm = std::make_unique<ShmMarketDataConsumer>(
+            1, updates_to_client, IFACE, IP_SNAPSHOT, PORT_SNAPSHOT + 100, IP_INCREMENTAL,
+            PORT_INCREMENTAL + 100);
+    mdc_shm->start();
+    ome->start();
+    mdp_shm->start();
+    // force recovery mode
+    mdc_shm->is_in_recovery = true;
+    mdc_shm->snapshot_sync_start();
+    for (auto& o: orders)
+        ome->send_market_update(&o);
+    // wait long enough for a snapshot to be published and received
+    for (int i{ }; i < 300 && mdc_shm->is_in_recovery; ++i)
+        std::this_thread::sleep_for(10ms);
+    ASSERT_FALSE(mdc_shm->is_in_recovery);
+    EXPECT_EQ(mdc_shm->socket_snapshot.fd, -1);
+    // incremental updates are received in order once recovered
+    while (mdc_shm->tx_updates.get_next_to_read() != nullptr)
+        mdc_shm->tx_updates.increment_read_index();
+    for (auto& o: orders)
+        ome->send_market_update(&o);
+    for (int i{ }; i < 100 && mdc_shm->tx_updates.size() < orders.size(); ++i)
+        std::this_thread::sleep_for(1ms);
+    ASSERT_EQ(mdc_shm->tx_updates.size(), orders.size());
+    for (const auto& o: orders) {
+        EXPECT_EQ(*mdc_shm->tx_updates.get_next_to_read(), o);
+        mdc_shm->tx_updates.increment_read_index();
+    }
+    EXPECT_FALSE(mdc_shm->is_in_recovery);
+    mdp_shm->stop();
+    ome->stop();
+    mdc_shm->stop();
+}
@@ -45,6 +45,21 @@ TEST_F(SnapshotSynthesizerBasics, starts_and_stops_worker_thread) {
     EXPECT_FALSE(ss->get_is_running());
 }
 
+TEST_F(SnapshotSynthesizerBasics, snapshot_burst_sent_with_zerocopy) {
+    // a snapshot queues enough equal sized updates for full GSO runs, which are sent with
+    //  zerocopy from where they were loaded
+    auto ss = std::make_unique<SnapshotSynthesizer>(updates, IFACE, IP, PORT);
+    if (!ss->socket.get_is_gso())
+        GTEST_SKIP() << "UDP GSO unsupported";
+    for (size_t i{ }; i < 4 * LL::MCAST_GSO_SEGMENTS; ++i) {
+        const MDPMarketUpdate update{ i + 1, { OMEMarketUpdate::Type::ADD, i, 0, Side::BUY,
+                                               100, 10, i + 1 }};
+        ss->add_to_snapshot(&update);
+    }
+    ss->publish_snapshot();
+    EXPECT_GT(ss->socket.get_n_zerocopy_sent(), 0);
+}
+
 
 /*
  * Base tests for MarketDataPublisher
@@ -147,7 +162,7 @@ TEST_F(MarketDataPublisherUpdates, publishes_incremental_update) {
     EXPECT_NE(nullptr, market_updates.get_next_to_read());
     // callback to validate data received at socket
     bool some_data_was_received{ false };
-    socket_rx->rx_callback = [&](LL::McastSocket* socket) {
+    socket_rx->rx_callback = [&](LL::McastSocket* socket, LL::Nanos) {
         (void) socket;
         some_data_was_received = true;
     };
@@ -184,13 +199,17 @@ TEST_F(MarketDataPublisherUpdates, publishes_empty_snapshot) {
     mdp->start();
     // callback to validate data received at socket
     bool some_data_was_received{ false };
-    socket_rx->rx_callback = [&](LL::McastSocket* socket) {
+    socket_rx->rx_callback = [&](LL::McastSocket* socket, LL::Nanos) {
         (void) socket;
         some_data_was_received = true;
     };
-    // receive on the socket
-    std::this_thread::sleep_for(10ms);
-    socket_rx->tx_and_rx();
+    // receive on the socket, giving the synthesizer time to scan its books for the snapshot
+    //  (each of its updates arrives as a datagram of its own)
+    const size_t size_snapshot{ 10 * (sizeof(size_t) + sizeof(OMEMarketUpdate)) };
+    for (int i{ }; i < 100 && socket_rx->rx_buffer.size() < size_snapshot; ++i) {
+        std::this_thread::sleep_for(10ms);
+        socket_rx->tx_and_rx();
+    }
     // at this point some data must have been received
     EXPECT_TRUE(some_data_was_received);
     // the first update message should be a START_SNAPSHOT and its sequence number zero
@@ -297,13 +316,17 @@ TEST_F(MarketDataPublisherUpdates, publishes_snapshot_for_single_ticker) {
     mdp->start();
     // callback to validate data received at socket
     bool some_data_was_received{ false };
-    socket_rx->rx_callback = [&](LL::McastSocket* socket) {
+    socket_rx->rx_callback = [&](LL::McastSocket* socket, LL::Nanos) {
         (void) socket;
         some_data_was_received = true;
     };
-    // receive on the socket
-    std::this_thread::sleep_for(10ms);
-    socket_rx->tx_and_rx();
+    // receive on the socket, giving the synthesizer time to scan its books for the snapshot
+    //  (each of its updates arrives as a datagram of its own)
+    const size_t size_snapshot{ 11 * (sizeof(size_t) + sizeof(OMEMarketUpdate)) };
+    for (int i{ }; i < 100 && socket_rx->rx_buffer.size() < size_snapshot; ++i) {
+        std::this_thread::sleep_for(10ms);
+        socket_rx->tx_and_rx();
+    }
     // at this point some data must have been received
     EXPECT_TRUE(some_data_was_received);
     // the first update message should be a START_SNAPSHOT and its sequence number zero
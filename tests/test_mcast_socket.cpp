@@ -2,6 +2,8 @@
 #include "llbase/mcast_socket.h"
 #include "llbase/sockets.h"
 
+#include <chrono>
+#include <cstring>
 #include <string>
 #include <unistd.h>
 #include <sys/socket.h>
@@ -21,6 +23,12 @@ protected:
     std::string IP{ "127.0.0.1" };   // ip address for test sockets
     std::string IFACE{ "lo" };        // interface name for test sockets
 
+    // kernel timestamps are CLOCK_REALTIME, which the TSC clock may drift from by a little
+    static auto get_time_realtime() -> Nanos {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
     void SetUp() override {
         logger = std::make_unique<Logger>(logfile);
     }
@@ -147,7 +155,7 @@ TEST_F(MulticastSockets, tx_and_rx_receives) {
     EXPECT_EQ(n_sent, 4);
     // rx callback to validate
     bool callback_executed{ false };
-    rx_socket->rx_callback = [&](McastSocket* socket) {
+    rx_socket->rx_callback = [&](McastSocket* socket, Nanos) {
         (void) socket;
         callback_executed = true;
     };
@@ -157,11 +165,293 @@ TEST_F(MulticastSockets, tx_and_rx_receives) {
     rx_socket->tx_and_rx();
     // validate msg
     EXPECT_TRUE(callback_executed);
-    EXPECT_EQ(rx_socket->i_rx_next, tx_msg.size());
-    EXPECT_EQ(std::string(rx_socket->rx_buffer.begin(),
-                          rx_socket->rx_buffer.begin() + tx_msg.size()), tx_msg);
+    EXPECT_EQ(rx_socket->rx_buffer.size(), tx_msg.size());
+    EXPECT_EQ(std::string(rx_socket->rx_buffer.data(), tx_msg.size()), tx_msg);
     // clean up
     if (tx_fd)
         close(tx_fd);
 }
 
+
+TEST_F(MulticastSockets, batched_tx_sends_each_datagram) {
+    // a batched socket sends each ended datagram on its own, all in a single call
+    auto tx_socket = std::make_unique<McastSocket>(*logger, McastBatchConfig{ .n_batch = 8 });
+    tx_socket->init(IP_MCAST_GROUP, IFACE, PORT, false);
+    auto rx_socket = std::make_unique<McastSocket>(*logger);
+    rx_socket->init(IP_MCAST_GROUP, IFACE, PORT, true);
+    ASSERT_TRUE(rx_socket->join_group(IP_MCAST_GROUP));
+    for (const auto& msg: { "one", "two", "six" }) {
+        tx_socket->load_tx(msg, 3);
+        tx_socket->end_datagram();
+    }
+    EXPECT_EQ(tx_socket->tx_datagram_ends.size(), 3);
+    tx_socket->tx_and_rx();
+    EXPECT_EQ(tx_socket->i_tx_next, 0);
+    EXPECT_TRUE(tx_socket->tx_datagram_ends.empty());
+    // the datagrams keep their boundaries
+    using namespace std::literals::chrono_literals;
+    std::this_thread::sleep_for(10ms);
+    char buffer[64];
+    for (const auto& msg: { "one", "two", "six" }) {
+        const auto n = recv(rx_socket->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        ASSERT_EQ(n, 3);
+        EXPECT_EQ(std::string(buffer, n), msg);
+    }
+}
+
+TEST_F(MulticastSockets, batched_tx_flushes_when_batch_is_queued) {
+    // queued datagrams are sent from end_datagram() as soon as n_tx_flush are waiting
+    auto tx_socket = std::make_unique<McastSocket>(
+            *logger, McastBatchConfig{ .n_batch = 8, .n_tx_flush = 2 });
+    tx_socket->init(IP_MCAST_GROUP, IFACE, PORT, false);
+    tx_socket->load_tx("one", 3);
+    tx_socket->end_datagram();
+    EXPECT_EQ(tx_socket->i_tx_next, 3);
+    tx_socket->load_tx("two", 3);
+    tx_socket->end_datagram();
+    EXPECT_EQ(tx_socket->i_tx_next, 0);
+    EXPECT_TRUE(tx_socket->tx_datagram_ends.empty());
+}
+
+TEST_F(MulticastSockets, batched_rx_packs_datagrams) {
+    // several datagrams are received in one call and packed together in rx_buffer
+    auto rx_socket = std::make_unique<McastSocket>(*logger, McastBatchConfig{ .n_batch = 8 });
+    rx_socket->init(IP_MCAST_GROUP, IFACE, PORT, true);
+    ASSERT_TRUE(rx_socket->join_group(IP_MCAST_GROUP));
+    size_t n_callbacks{ };
+    rx_socket->rx_callback = [&](McastSocket*, Nanos) { ++n_callbacks; };
+    auto tx_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in tx_addr{ };
+    tx_addr.sin_family = AF_INET;
+    tx_addr.sin_port = htons(PORT);
+    tx_addr.sin_addr.s_addr = inet_addr(IP_MCAST_GROUP.c_str());
+    ASSERT_NE(connect(tx_fd, (sockaddr*) &tx_addr, sizeof(tx_addr)), -1);
+    for (const auto& msg: { "one", "two", "six" })
+        ASSERT_EQ(send(tx_fd, msg, 3, 0), 3);
+    using namespace std::literals::chrono_literals;
+    std::this_thread::sleep_for(10ms);
+    EXPECT_TRUE(rx_socket->tx_and_rx());
+    EXPECT_EQ(n_callbacks, 1);
+    ASSERT_EQ(rx_socket->rx_buffer.size(), 9);
+    EXPECT_EQ(std::string(rx_socket->rx_buffer.data(), 9), "onetwosix");
+    close(tx_fd);
+}
+
+TEST_F(MulticastSockets, batched_rx_drops_truncated_datagrams) {
+    // a datagram larger than the slot it's received into is dropped, not delivered in part
+    auto rx_socket = std::make_unique<McastSocket>(
+            *logger, McastBatchConfig{ .n_batch = 8, .size_datagram = 8 });
+    rx_socket->init(IP_MCAST_GROUP, IFACE, PORT, true);
+    ASSERT_TRUE(rx_socket->join_group(IP_MCAST_GROUP));
+    rx_socket->rx_callback = [&](McastSocket*, Nanos) { };
+    auto tx_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in tx_addr{ };
+    tx_addr.sin_family = AF_INET;
+    tx_addr.sin_port = htons(PORT);
+    tx_addr.sin_addr.s_addr = inet_addr(IP_MCAST_GROUP.c_str());
+    ASSERT_NE(connect(tx_fd, (sockaddr*) &tx_addr, sizeof(tx_addr)), -1);
+    for (const auto& msg: { "one", "truncated", "six" })
+        ASSERT_EQ(send(tx_fd, msg, strlen(msg), 0), static_cast<ssize_t>(strlen(msg)));
+    using namespace std::literals::chrono_literals;
+    std::this_thread::sleep_for(10ms);
+    EXPECT_TRUE(rx_socket->tx_and_rx());
+    ASSERT_EQ(rx_socket->rx_buffer.size(), 6);
+    EXPECT_EQ(std::string(rx_socket->rx_buffer.data(), 6), "onesix");
+    close(tx_fd);
+}
+
+TEST_F(MulticastSockets, dispatches_to_handler_given) {
+    // a handler handed to tx_and_rx() is called instead of the rx_callback
+    auto rx_socket = std::make_unique<McastSocket>(*logger, MCAST_BATCHED);
+    rx_socket->init(IP_MCAST_GROUP, IFACE, PORT, true);
+    ASSERT_TRUE(rx_socket->join_group(IP_MCAST_GROUP));
+    size_t n_callbacks{ };
+    rx_socket->rx_callback = [&](McastSocket*, Nanos) { ++n_callbacks; };
+    auto tx_socket = std::make_unique<McastSocket>(*logger, MCAST_BATCHED);
+    tx_socket->init(IP_MCAST_GROUP, IFACE, PORT, false);
+    tx_socket->load_tx("one", 3);
+    tx_socket->end_datagram();
+    tx_socket->load_tx("two", 3);
+    EXPECT_FALSE(tx_socket->tx_and_rx([](McastSocket*, Nanos) { }));
+    using namespace std::literals::chrono_literals;
+    std::this_thread::sleep_for(10ms);
+    std::string rx;
+    EXPECT_TRUE(rx_socket->tx_and_rx([&](McastSocket* s, Nanos t_rx) {
+        EXPECT_GT(t_rx, 0);
+        rx.append(s->rx_buffer.data(), s->rx_buffer.size());
+        s->rx_buffer.consume(s->rx_buffer.size());
+    }));
+    EXPECT_EQ(rx, "onetwo");
+    EXPECT_EQ(n_callbacks, 0);
+}
+
+TEST_F(MulticastSockets, gso_tx_keeps_datagram_boundaries) {
+    // runs of equal sized datagrams sent with GSO still arrive as separate datagrams, as do
+    //  the odd sized ones around them
+    auto tx_socket = std::make_unique<McastSocket>(
+            *logger, McastBatchConfig{ .n_batch = 8, .is_gso = true });
+    tx_socket->init(IP_MCAST_GROUP, IFACE, PORT, false);
+    if (!tx_socket->get_is_gso())
+        GTEST_SKIP() << "UDP GSO is not available here";
+    auto rx_socket = std::make_unique<McastSocket>(*logger);
+    rx_socket->init(IP_MCAST_GROUP, IFACE, PORT, true);
+    ASSERT_TRUE(rx_socket->join_group(IP_MCAST_GROUP));
+    const std::vector<std::string> msgs{ "one", "two", "six", "seven", "ten", "eleven" };
+    for (const auto& msg: msgs) {
+        tx_socket->load_tx(msg.data(), msg.size());
+        tx_socket->end_datagram();
+    }
+    tx_socket->tx_and_rx();
+    EXPECT_EQ(tx_socket->i_tx_next, 0);
+    using namespace std::literals::chrono_literals;
+    std::this_thread::sleep_for(10ms);
+    char buffer[64];
+    for (const auto& msg: msgs) {
+        const auto n = recv(rx_socket->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        ASSERT_EQ(n, static_cast<ssize_t>(msg.size()));
+        EXPECT_EQ(std::string(buffer, n), msg);
+    }
+    EXPECT_EQ(recv(rx_socket->fd, buffer, sizeof(buffer), MSG_DONTWAIT), -1);
+}
+
+TEST_F(MulticastSockets, gso_tx_splits_runs_at_segment_limit) {
+    // more equal sized datagrams than the kernel segments from one send all arrive
+    auto tx_socket = std::make_unique<McastSocket>(
+            *logger, McastBatchConfig{ .n_batch = 8, .is_gso = true });
+    tx_socket->init(IP_MCAST_GROUP, IFACE, PORT, false);
+    if (!tx_socket->get_is_gso())
+        GTEST_SKIP() << "UDP GSO is not available here";
+    auto rx_socket = std::make_unique<McastSocket>(*logger);
+    rx_socket->init(IP_MCAST_GROUP, IFACE, PORT, true);
+    ASSERT_TRUE(rx_socket->join_group(IP_MCAST_GROUP));
+    constexpr size_t N{ MCAST_GSO_SEGMENTS + 6 };
+    for (size_t i{ }; i < N; ++i) {
+        tx_socket->load_tx(&i, sizeof(i));
+        tx_socket->end_datagram();
+    }
+    tx_socket->tx_and_rx();
+    using namespace std::literals::chrono_literals;
+    std::this_thread::sleep_for(10ms);
+    for (size_t i{ }; i < N; ++i) {
+        size_t rx{ };
+        ASSERT_EQ(recv(rx_socket->fd, &rx, sizeof(rx), MSG_DONTWAIT), sizeof(rx));
+        EXPECT_EQ(rx, i);
+    }
+}
+
+TEST_F(MulticastSockets, rx_is_kernel_timestamped) {
+    // datagrams are dispatched with the kernel's nanosecond timestamp of the first's arrival,
+    //  whether received singly or in batches
+    for (const auto& batching: { McastBatchConfig{ }, McastBatchConfig{ .n_batch = 8 }}) {
+        auto rx_socket = std::make_unique<McastSocket>(*logger, batching);
+        rx_socket->init(IP_MCAST_GROUP, IFACE, PORT, true);
+        ASSERT_TRUE(rx_socket->join_group(IP_MCAST_GROUP));
+        Nanos t_rx{ };
+        rx_socket->rx_callback = [&](McastSocket* socket, Nanos t) {
+            t_rx = t;
+            socket->rx_buffer.consume(socket->rx_buffer.size());
+        };
+        auto tx_socket = std::make_unique<McastSocket>(*logger);
+        tx_socket->init(IP_MCAST_GROUP, IFACE, PORT, false);
+        const auto t_sent = get_time_realtime();
+        tx_socket->load_tx("data", 4);
+        tx_socket->tx_and_rx();
+        using namespace std::literals::chrono_literals;
+        std::this_thread::sleep_for(10ms);
+        ASSERT_TRUE(rx_socket->tx_and_rx());
+        EXPECT_GE(t_rx, t_sent);
+        EXPECT_LE(t_rx, get_time_realtime());
+    }
+}
+
+TEST_F(MulticastSockets, tx_timestamps_are_reported) {
+    // each send is stamped by the kernel, keyed by its count, whether batched or not
+    for (const auto& batching: { McastBatchConfig{ }, McastBatchConfig{ .n_batch = 8 }}) {
+        auto tx_socket = std::make_unique<McastSocket>(*logger, batching);
+        tx_socket->init(IP_MCAST_GROUP, IFACE, PORT, false);
+        ASSERT_TRUE(tx_socket->enable_tx_timestamps());
+        std::vector<std::pair<uint32_t, Nanos>> stamps;
+        tx_socket->tx_timestamp_callback = [&](McastSocket*, uint32_t id, Nanos t_tx) {
+            stamps.emplace_back(id, t_tx);
+        };
+        const auto t_start = get_time_realtime();
+        for (const auto& msg: { "one", "three" }) {
+            tx_socket->load_tx(msg, strlen(msg));
+            tx_socket->end_datagram();
+            tx_socket->tx_and_rx();
+        }
+        using namespace std::literals::chrono_literals;
+        std::this_thread::sleep_for(10ms);
+        tx_socket->tx_and_rx();
+        ASSERT_EQ(stamps.size(), 2);
+        EXPECT_EQ(stamps[0].first, 0);
+        EXPECT_EQ(stamps[1].first, 1);
+        EXPECT_GE(stamps[0].second, t_start);
+        EXPECT_GE(stamps[1].second, stamps[0].second);
+    }
+}
+
+TEST_F(MulticastSockets, zerocopy_send_completes) {
+    // datagrams sent with MSG_ZEROCOPY arrive whole, whether batched or not, and the tx
+    //  buffer rewinds once the kernel is done with them
+    for (const auto& batching: { McastBatchConfig{ }, McastBatchConfig{ .n_batch = 8 }}) {
+        auto tx_socket = std::make_unique<McastSocket>(*logger, batching);
+        tx_socket->init(IP_MCAST_GROUP, IFACE, PORT, false);
+        ASSERT_TRUE(tx_socket->enable_zerocopy(1));
+        auto rx_socket = std::make_unique<McastSocket>(*logger);
+        rx_socket->init(IP_MCAST_GROUP, IFACE, PORT, true);
+        ASSERT_TRUE(rx_socket->join_group(IP_MCAST_GROUP));
+        for (const auto& msg: { "one", "two" }) {
+            tx_socket->load_tx(msg, 3);
+            tx_socket->end_datagram();
+        }
+        tx_socket->tx_and_rx();
+        using namespace std::literals::chrono_literals;
+        for (int i{ }; i < 100 && tx_socket->i_tx_next; ++i) {
+            std::this_thread::sleep_for(5ms);
+            tx_socket->tx_and_rx();
+        }
+        EXPECT_EQ(tx_socket->i_tx_next, 0);
+        EXPECT_EQ(tx_socket->i_tx_start, 0);
+        std::this_thread::sleep_for(10ms);
+        char buffer[16];
+        std::string rx;
+        for (ssize_t n; (n = recv(rx_socket->fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0;)
+            rx.append(buffer, n);
+        EXPECT_EQ(rx, "onetwo");
+    }
+}
+
+TEST_F(MulticastSockets, zerocopy_gated_on_each_message) {
+    // only the messages in a batched call which are large enough are sent with zerocopy, not
+    //  every message once the call as a whole is
+    auto tx_socket = std::make_unique<McastSocket>(*logger, McastBatchConfig{ .n_batch = 8 });
+    tx_socket->init(IP_MCAST_GROUP, IFACE, PORT, false);
+    ASSERT_TRUE(tx_socket->enable_zerocopy(1000));
+    const std::string large(1200, 'x');
+    for (const auto& msg: { std::string{ "small" }, large, std::string{ "tiny" }, large }) {
+        tx_socket->load_tx(msg.data(), msg.size());
+        tx_socket->end_datagram();
+    }
+    tx_socket->tx_and_rx();
+    EXPECT_EQ(tx_socket->get_n_zerocopy_sent(), 2);
+}
+
+TEST_F(MulticastSockets, zerocopy_streams_past_buffer_size) {
+    // sending steadily, without waiting for completions, streams more than the tx buffer
+    //  holds: sends from its back half are copied, so it rewinds rather than overflowing
+    auto tx_socket = std::make_unique<McastSocket>(*logger);
+    tx_socket->init(IP_MCAST_GROUP, IFACE, PORT, false);
+    ASSERT_TRUE(tx_socket->enable_zerocopy(1));
+    const std::string datagram(60000, 'x');
+    for (size_t n{ }; n < 2 * MCAST_BUFFER_SIZE; n += datagram.size()) {
+        tx_socket->load_tx(datagram.data(), datagram.size());
+        tx_socket->tx_and_rx();
+    }
+    using namespace std::literals::chrono_literals;
+    for (int i{ }; i < 100 && tx_socket->i_tx_next; ++i) {
+        std::this_thread::sleep_for(5ms);
+        tx_socket->tx_and_rx();
+    }
+    EXPECT_EQ(tx_socket->i_tx_next, 0);
+}
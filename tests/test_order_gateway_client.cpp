@@ -58,6 +58,39 @@ TEST_F(OrderGatewayClientBasics, starts_and_stops_worker_thread) {
     EXPECT_FALSE(ogc->is_running);
 }
 
+TEST_F(OrderGatewayClientBasics, exchanges_with_server_through_shared_memory) {
+    // a co-located client and gateway pass requests and responses through shared memory
+    Exchange::ClientRequestQueue requests_to_OME{ Exchange::Limits::MAX_CLIENT_UPDATES };
+    Exchange::ClientResponseQueue responses_from_OME{ Exchange::Limits::MAX_CLIENT_UPDATES };
+    const int port_shm{ PORT + 50 };
+    auto ogs = std::make_unique<Exchange::ShmOrderGatewayServer>(
+            requests_to_OME, responses_from_OME, IFACE, port_shm);
+    ogs->start();
+    auto ogc = std::make_unique<ShmOrderGatewayClient>(client_id, requests_from_TE,
+                                                       responses_to_TE, IP, IFACE, port_shm);
+    ogc->start();
+    using Request = Exchange::OMEClientRequest;
+    const auto tx_req = Request{ Request::Type::NEW, client_id, 1, 1, Side::BUY, 100, 50 };
+    *requests_from_TE.get_next_to_write() = tx_req;
+    requests_from_TE.increment_write_index();
+    using namespace std::literals::chrono_literals;
+    for (int i{ }; i < 100 && !requests_to_OME.size(); ++i)
+        std::this_thread::sleep_for(1ms);
+    ASSERT_NE(requests_to_OME.size(), 0);
+    EXPECT_EQ(*requests_to_OME.get_next_to_read(), tx_req);
+    using Response = Exchange::OMEClientResponse;
+    const auto tx_res = Response{ Response::Type::ACCEPTED, client_id, 1, 1, 1, Side::BUY,
+                                  100, 50, 0 };
+    *responses_from_OME.get_next_to_write() = tx_res;
+    responses_from_OME.increment_write_index();
+    for (int i{ }; i < 100 && !responses_to_TE.size(); ++i)
+        std::this_thread::sleep_for(1ms);
+    ASSERT_NE(responses_to_TE.size(), 0);
+    EXPECT_EQ(*responses_to_TE.get_next_to_read(), tx_res);
+    ogc->stop();
+    ogs->stop();
+}
+
 
 using namespace std::literals::chrono_literals;
 
@@ -49,6 +49,123 @@ TEST_F(OrderGatewayServerBasics, starts_and_stops_worker_thread) {
     EXPECT_FALSE(ogs->get_is_running());
 }
 
+TEST_F(OrderGatewayServerBasics, serves_clients_across_reactor_threads) {
+    // with several reactors, each listens on the shared port from its own thread; requests
+    // from all of them are sequenced together and responses go back on the right connection
+    auto ogs = std::make_unique<OrderGatewayServer>(client_request_queue,
+                                                    client_response_queue,
+                                                    IFACE, PORT, 2);
+    ASSERT_EQ(ogs->get_reactors().size(), 2);
+    ogs->start();
+    using namespace std::literals::chrono_literals;
+    std::this_thread::sleep_for(10ms);
+    LL::Logger logger{ "order_gateway_server_reactors_tests.log" };
+    std::vector<std::unique_ptr<LL::TCPSocket>> clients;
+    for (ClientID c{ 1 }; c <= 4; ++c) {
+        auto& client = clients.emplace_back(std::make_unique<LL::TCPSocket>(logger));
+        ASSERT_GT(client->connect("127.0.0.1", IFACE, PORT, false), 0);
+        OGSClientRequest request{ 1, { OMEClientRequest::Type::NEW,
+                                       c, 3, 1, Side::BUY, 100, 50 }};
+        client->load_tx(&request, sizeof(request));
+        client->tx_and_rx();
+    }
+    for (int i{ }; i < 100 && client_request_queue.size() < clients.size(); ++i)
+        std::this_thread::sleep_for(10ms);
+    ASSERT_EQ(client_request_queue.size(), clients.size());
+    // respond to the last client, wherever its connection landed
+    OMEClientResponse response{ OMEClientResponse::Type::ACCEPTED, 4, 3, 1, 1, Side::BUY,
+                                100, 50, 50 };
+    *client_response_queue.get_next_to_write() = response;
+    client_response_queue.increment_write_index();
+    auto& client = clients.back();
+    for (int i{ }; i < 100 && client->rx_buffer.size() < sizeof(OGSClientResponse); ++i) {
+        std::this_thread::sleep_for(10ms);
+        client->tx_and_rx();
+    }
+    ASSERT_EQ(client->rx_buffer.size(), sizeof(OGSClientResponse));
+    auto res = reinterpret_cast<const OGSClientResponse*>(client->rx_buffer.data());
+    EXPECT_EQ(res->ome_response, response);
+    EXPECT_EQ(res->n_seq, 1);
+    ogs->stop();
+}
+
+TEST_F(OrderGatewayServerBasics, accepts_orders_after_client_reconnects) {
+    // a client which disconnects and connects again starts a new session, with requests and
+    // responses numbered from 1 again
+    auto ogs = std::make_unique<OrderGatewayServer>(client_request_queue,
+                                                    client_response_queue,
+                                                    IFACE, PORT);
+    ogs->start();
+    using namespace std::literals::chrono_literals;
+    LL::Logger logger{ "order_gateway_server_reconnect_tests.log" };
+    OGSClientRequest request{ 1, { OMEClientRequest::Type::NEW, 1, 3, 1, Side::BUY, 100, 50 }};
+    for (size_t n_session{ 1 }; n_session <= 2; ++n_session) {
+        auto client = std::make_unique<LL::TCPSocket>(logger);
+        ASSERT_GT(client->connect("127.0.0.1", IFACE, PORT, false), 0);
+        request.ome_request.order_id = n_session;
+        client->load_tx(&request, sizeof(request));
+        client->tx_and_rx();
+        for (int i{ }; i < 100 && client_request_queue.size() < n_session; ++i)
+            std::this_thread::sleep_for(10ms);
+        ASSERT_EQ(client_request_queue.size(), n_session);
+        OMEClientResponse response{ OMEClientResponse::Type::ACCEPTED, 1, 3, n_session,
+                                    n_session, Side::BUY, 100, 50, 50 };
+        *client_response_queue.get_next_to_write() = response;
+        client_response_queue.increment_write_index();
+        for (int i{ }; i < 100 && client->rx_buffer.size() < sizeof(OGSClientResponse); ++i) {
+            std::this_thread::sleep_for(10ms);
+            client->tx_and_rx();
+        }
+        ASSERT_EQ(client->rx_buffer.size(), sizeof(OGSClientResponse));
+        auto res = reinterpret_cast<const OGSClientResponse*>(client->rx_buffer.data());
+        EXPECT_EQ(res->ome_response, response);
+        EXPECT_EQ(res->n_seq, 1);
+        // hang up, and give the server time to see the connection close
+        client.reset();
+        std::this_thread::sleep_for(50ms);
+    }
+    ogs->stop();
+}
+
+TEST_F(OrderGatewayServerBasics, serves_client_on_one_connection_across_reactors) {
+    // a client is served on the first connection it sends from, whichever reactor takes a
+    // second connection of its; responses only go out on the first
+    auto ogs = std::make_unique<OrderGatewayServer>(client_request_queue,
+                                                    client_response_queue,
+                                                    IFACE, PORT, 2);
+    ogs->start();
+    using namespace std::literals::chrono_literals;
+    LL::Logger logger{ "order_gateway_server_reactors_tests.log" };
+    OGSClientRequest request{ 1, { OMEClientRequest::Type::NEW, 1, 3, 1, Side::BUY, 100, 50 }};
+    std::vector<std::unique_ptr<LL::TCPSocket>> clients;
+    for (int n{ }; n < 4; ++n) {
+        auto& client = clients.emplace_back(std::make_unique<LL::TCPSocket>(logger));
+        ASSERT_GT(client->connect("127.0.0.1", IFACE, PORT, false), 0);
+        client->load_tx(&request, sizeof(request));
+        client->tx_and_rx();
+        for (int i{ }; i < 100 && client_request_queue.size() < 1; ++i)
+            std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(50ms);
+    ASSERT_EQ(client_request_queue.size(), 1);
+    OMEClientResponse response{ OMEClientResponse::Type::ACCEPTED, 1, 3, 1, 1, Side::BUY,
+                                100, 50, 50 };
+    *client_response_queue.get_next_to_write() = response;
+    client_response_queue.increment_write_index();
+    for (int i{ }; i < 100 && clients[0]->rx_buffer.size() < sizeof(OGSClientResponse); ++i) {
+        std::this_thread::sleep_for(10ms);
+        for (auto& client: clients)
+            client->tx_and_rx();
+    }
+    ASSERT_EQ(clients[0]->rx_buffer.size(), sizeof(OGSClientResponse));
+    auto res = reinterpret_cast<const OGSClientResponse*>(clients[0]->rx_buffer.data());
+    EXPECT_EQ(res->ome_response, response);
+    EXPECT_EQ(res->n_seq, 1);
+    for (size_t n{ 1 }; n < clients.size(); ++n)
+        EXPECT_EQ(clients[n]->rx_buffer.size(), 0);
+    ogs->stop();
+}
+
 
 // FIFO sequencer base tests
 class FIFOSequencerBasics : public ::testing::Test {
@@ -199,10 +316,10 @@ TEST_F(OrderGatewayServerOrders, sends_order_response_to_client) {
     auto fd = client->connect(IP, IFACE, PORT, false);
     ASSERT_GT(fd, 0);
     // configure a callback on the client socket to read a response message
-    OGSClientResponse* res{ nullptr };
+    const OGSClientResponse* res{ nullptr };
     auto client_rx_callback = [&](LL::TCPSocket* socket, LL::Nanos t_rx) {
         (void) t_rx;
-        res = reinterpret_cast<OGSClientResponse*> (socket->rx_buffer.data());
+        res = reinterpret_cast<const OGSClientResponse*> (socket->rx_buffer.data());
     };
     client->rx_callback = client_rx_callback;
     // transmit an order request from the client
@@ -0,0 +1,145 @@
+#include "gtest/gtest.h"
+#include "llbase/packet_ring.h"
+#include "llbase/mcast_socket.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+using namespace LL;
+
+
+// base tests for the AF_PACKET receive ring
+class PacketRingBasics : public ::testing::Test {
+protected:
+    std::string logfile{ "packet_ring_tests.log" };
+    std::unique_ptr<Logger> logger;
+    std::unique_ptr<PacketRing> ring;
+    static const int PORT{ 12345 };
+    std::string IP{ "127.0.0.1" };
+    std::string IFACE{ "lo" };
+    int fd_tx{ -1 };
+
+    void SetUp() override {
+        logger = std::make_unique<Logger>(logfile);
+        ring = PacketRing::create(*logger, IFACE, { .size_block = 1 << 16, .n_blocks = 4 });
+        if (ring == nullptr)
+            GTEST_SKIP() << "AF_PACKET rings are not available here";
+        fd_tx = socket(AF_INET, SOCK_DGRAM, 0);
+    }
+
+    void TearDown() override {
+        if (fd_tx >= 0)
+            close(fd_tx);
+    }
+
+    // send a datagram over loopback to the given port
+    void send_to(int port, const std::string& data) const {
+        sockaddr_in addr{ AF_INET, htons(static_cast<uint16_t>(port)),
+                          { inet_addr(IP.c_str()) }, { }};
+        sendto(fd_tx, data.data(), data.size(), 0, reinterpret_cast<const sockaddr*>(&addr),
+               sizeof(addr));
+    }
+
+    // poll the ring until n payloads have been delivered, or it's taken too long
+    void wait_for_rx(size_t n, size_t& n_rx) const {
+        using namespace std::literals::chrono_literals;
+        for (int i{ }; i < 100 && n_rx < n; ++i) {
+            std::this_thread::sleep_for(5ms);
+            n_rx += ring->poll();
+        }
+    }
+};
+
+
+TEST_F(PacketRingBasics, delivers_payloads_of_attached_flows) {
+    // only payloads sent to an attached address and port reach its handler, in order
+    std::vector<std::string> rx;
+    const auto i_flow = ring->attach(IP, PORT, [&](const char* data, size_t len) {
+        rx.emplace_back(data, len);
+        return true;
+    });
+    ASSERT_GE(i_flow, 0);
+    EXPECT_EQ(ring->get_n_flows(), 1);
+    send_to(PORT + 1, "other");
+    for (const auto& msg: { "one", "two", "three" })
+        send_to(PORT, msg);
+    size_t n_rx{ };
+    wait_for_rx(3, n_rx);
+    ASSERT_EQ(rx.size(), 3);
+    EXPECT_EQ(rx[0], "one");
+    EXPECT_EQ(rx[1], "two");
+    EXPECT_EQ(rx[2], "three");
+}
+
+TEST_F(PacketRingBasics, holds_payload_until_there_is_room) {
+    // a payload the handler has no room for is offered again at the next poll()
+    std::vector<std::string> rx;
+    bool has_room{ false };
+    ring->attach(IP, PORT, [&](const char* data, size_t len) {
+        if (!has_room)
+            return false;
+        rx.emplace_back(data, len);
+        return true;
+    });
+    send_to(PORT, "one");
+    send_to(PORT, "two");
+    size_t n_rx{ };
+    wait_for_rx(1, n_rx);
+    EXPECT_EQ(n_rx, 0);
+    has_room = true;
+    wait_for_rx(2, n_rx);
+    ASSERT_EQ(rx.size(), 2);
+    EXPECT_EQ(rx[0], "one");
+    EXPECT_EQ(rx[1], "two");
+}
+
+TEST_F(PacketRingBasics, detached_flow_is_not_delivered) {
+    // a detached flow's handler is never called again, and its slot is reused
+    size_t n_first{ }, n_second{ };
+    const auto i_flow = ring->attach(IP, PORT, [&](const char*, size_t) {
+        ++n_first;
+        return true;
+    });
+    ring->detach(i_flow);
+    EXPECT_EQ(ring->get_n_flows(), 0);
+    send_to(PORT, "data");
+    EXPECT_EQ(ring->attach(IP, PORT + 1, [&](const char*, size_t) {
+        ++n_second;
+        return true;
+    }), i_flow);
+    send_to(PORT + 1, "data");
+    size_t n_rx{ };
+    wait_for_rx(1, n_rx);
+    EXPECT_EQ(n_first, 0);
+    EXPECT_EQ(n_second, 1);
+}
+
+TEST_F(PacketRingBasics, multicast_socket_receives_from_ring) {
+    // a socket attached to the ring is handed its datagrams by it, and not by the kernel
+    McastSocket rx_socket{ *logger, MCAST_BATCHED };
+    ASSERT_NE(rx_socket.init(IP, IFACE, PORT, true), -1);
+    std::string rx;
+    rx_socket.rx_callback = [&](McastSocket* s, Nanos) {
+        rx.append(s->rx_buffer.data(), s->rx_buffer.size());
+        s->rx_buffer.consume(s->rx_buffer.size());
+    };
+    ASSERT_TRUE(rx_socket.attach(*ring, IP, PORT));
+    send_to(PORT, "one");
+    send_to(PORT, "two");
+    using namespace std::literals::chrono_literals;
+    for (int i{ }; i < 100 && rx.size() < 6; ++i) {
+        std::this_thread::sleep_for(5ms);
+        rx_socket.tx_and_rx();
+    }
+    EXPECT_EQ(rx, "onetwo");
+    char buffer[16];
+    EXPECT_EQ(recv(rx_socket.fd, buffer, sizeof(buffer), MSG_DONTWAIT), -1);
+    // leaving the group hands the flow back
+    rx_socket.leave_group();
+    EXPECT_EQ(ring->get_n_flows(), 0);
+}
@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+#include "llbase/ring_buffer.h"
+
+#include <string>
+#include <unistd.h>
+
+
+using namespace LL;
+
+
+class RingBufferBasics : public ::testing::Test {
+protected:
+    const size_t CAPACITY{ static_cast<size_t>(sysconf(_SC_PAGESIZE)) };
+    RingBuffer ring{ CAPACITY };
+
+    void write(const std::string& s) {
+        ASSERT_LE(s.size(), ring.get_n_free());
+        std::memcpy(ring.write_ptr(), s.data(), s.size());
+        ring.commit(s.size());
+    }
+
+    void SetUp() override { }
+    void TearDown() override { }
+};
+
+
+TEST_F(RingBufferBasics, is_empty_at_first) {
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(ring.size(), 0);
+    EXPECT_EQ(ring.get_n_free(), CAPACITY);
+    EXPECT_EQ(ring.get_capacity(), CAPACITY);
+}
+
+TEST_F(RingBufferBasics, reads_back_what_was_written) {
+    // committed data is read in place and consumed
+    write("hello");
+    EXPECT_EQ(ring.size(), 5);
+    EXPECT_EQ(std::string(ring.data(), ring.size()), "hello");
+    ring.consume(2);
+    EXPECT_EQ(std::string(ring.data(), ring.size()), "llo");
+    EXPECT_EQ(ring.get_n_free(), CAPACITY - 3);
+    ring.clear();
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST_F(RingBufferBasics, records_are_contiguous_across_the_wrap) {
+    // a record written across the end of the ring reads back contiguously
+    const std::string filler(CAPACITY - 3, 'x');
+    write(filler);
+    ring.consume(filler.size());
+    write("wrapped!");
+    EXPECT_EQ(std::string(ring.data(), ring.size()), "wrapped!");
+    ring.consume(ring.size());
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST_F(RingBufferBasics, fills_to_capacity) {
+    // the whole ring can be used, from any starting point
+    write("abc");
+    ring.consume(3);
+    write(std::string(CAPACITY, 'y'));
+    EXPECT_EQ(ring.get_n_free(), 0);
+    EXPECT_EQ(ring.data()[0], 'y');
+    EXPECT_EQ(ring.data()[CAPACITY - 1], 'y');
+}
@@ -0,0 +1,186 @@
+#include "gtest/gtest.h"
+#include "llbase/shm_transport.h"
+#include "llbase/transport.h"
+
+#include <cerrno>
+#include <string>
+#include <vector>
+
+
+using namespace LL;
+
+
+// base tests for the shared memory stream transport
+class ShmSocketBasics : public ::testing::Test {
+protected:
+    std::string logfile{ "shm_transport_tests.log" };
+    std::unique_ptr<Logger> logger;
+    static const int PORT{ 12400 };     // port whose region the test sockets use
+    static constexpr size_t SIZE_BUFFER{ 1 << 16 };
+    std::string IP{ "127.0.0.1" };
+    std::string IFACE{ "lo" };
+
+    void SetUp() override {
+        logger = std::make_unique<Logger>(logfile);
+    }
+
+    // drive both ends until the server has accepted and the client sees its data go out
+    static void exchange(ShmServer& server, ShmSocket& client) {
+        for (int i{ }; i < 4; ++i) {
+            server.poll();
+            client.tx_and_rx();
+            server.tx_and_rx();
+        }
+    }
+};
+
+
+TEST_F(ShmSocketBasics, client_is_refused_without_listener) {
+    // connecting to a port nobody listens on fails as a refused TCP connection would
+    ShmSocket client{ *logger, SIZE_BUFFER };
+    errno = 0;
+    EXPECT_EQ(client.connect(IP, IFACE, PORT + 99, false), -1);
+    EXPECT_EQ(errno, ECONNREFUSED);
+}
+
+TEST_F(ShmSocketBasics, client_and_server_exchange_data) {
+    // what each end loads arrives in the other's rx_buffer, in order
+    ShmServer server{ *logger, SIZE_BUFFER };
+    server.listen(IFACE, PORT);
+    ShmSocket client{ *logger, SIZE_BUFFER };
+    ASSERT_NE(client.connect(IP, IFACE, PORT, false), -1);
+    std::string rx_server, rx_client;
+    server.set_rx_callback([&](ShmSocket* s, Nanos) {
+        rx_server.append(s->rx_buffer.data(), s->rx_buffer.size());
+        s->rx_buffer.consume(s->rx_buffer.size());
+        s->load_tx("pong", 4);
+    });
+    client.rx_callback = [&](ShmSocket* s, Nanos) {
+        rx_client.append(s->rx_buffer.data(), s->rx_buffer.size());
+        s->rx_buffer.consume(s->rx_buffer.size());
+    };
+    EXPECT_EQ(server.poll(), 1);
+    EXPECT_EQ(server.get_connections().size(), 1);
+    client.load_tx("ping", 4);
+    client.load_tx("ping", 4);
+    exchange(server, client);
+    EXPECT_EQ(rx_server, "pingping");
+    EXPECT_EQ(rx_client, "pong");
+}
+
+TEST_F(ShmSocketBasics, server_recycles_closed_connection) {
+    // a client which disconnects is handed to the dx callback, and its slot freed for others
+    ShmServer server{ *logger, SIZE_BUFFER };
+    server.listen(IFACE, PORT + 1);
+    std::vector<ShmSocket*> dx;
+    server.set_dx_callback([&](ShmSocket* s) { dx.push_back(s); });
+    for (int i{ }; i < 2 * static_cast<int>(SHM_MAX_CONNECTIONS); ++i) {
+        ShmSocket client{ *logger, SIZE_BUFFER };
+        ASSERT_NE(client.connect(IP, IFACE, PORT + 1, false), -1);
+        ASSERT_EQ(server.poll(), 1);
+        client.reset();
+        server.tx_and_rx();
+        ASSERT_EQ(dx.size(), static_cast<size_t>(i + 1));
+        EXPECT_TRUE(server.get_connections().empty());
+    }
+}
+
+TEST_F(ShmSocketBasics, unsent_data_is_kept_until_there_is_room) {
+    // whatever doesn't fit the peer's ring is sent first once the peer's read some of it
+    ShmServer server{ *logger, 4 * SHM_STREAM_SIZE };
+    server.listen(IFACE, PORT + 2);
+    std::string rx;
+    server.set_rx_callback([&](ShmSocket* s, Nanos) {
+        rx.append(s->rx_buffer.data(), s->rx_buffer.size());
+        s->rx_buffer.consume(s->rx_buffer.size());
+    });
+    ShmSocket client{ *logger, 4 * SHM_STREAM_SIZE };
+    ASSERT_NE(client.connect(IP, IFACE, PORT + 2, false), -1);
+    ASSERT_EQ(server.poll(), 1);
+    std::string tx;
+    for (size_t i{ }; tx.size() < 2 * SHM_STREAM_SIZE; ++i)
+        tx += std::to_string(i) + ",";
+    client.load_tx(tx.data(), tx.size());
+    client.tx();
+    EXPECT_EQ(client.get_n_tx_pending(), tx.size() - SHM_STREAM_SIZE);
+    for (int i{ }; i < 8 && rx.size() < tx.size(); ++i) {
+        server.tx_and_rx();
+        client.tx();
+    }
+    EXPECT_EQ(client.get_n_tx_pending(), 0);
+    EXPECT_EQ(rx, tx);
+}
+
+
+// base tests for the shared memory multicast transport
+class ShmMcastSocketBasics : public ::testing::Test {
+protected:
+    std::string logfile{ "shm_transport_tests.log" };
+    std::unique_ptr<Logger> logger;
+    static const int PORT{ 12410 };
+    std::string IP_GROUP{ "239.0.0.10" };
+    std::string IFACE{ "lo" };
+
+    void SetUp() override {
+        logger = std::make_unique<Logger>(logfile);
+    }
+
+    // open a subscriber to the group, appending what it receives to rx
+    auto subscribe(int port, std::string& rx) {
+        auto socket = std::make_unique<ShmMcastSocket>(*logger);
+        EXPECT_NE(socket->init(IP_GROUP, IFACE, port, true), -1);
+        EXPECT_TRUE(socket->join_group(IP_GROUP));
+        socket->rx_callback = [&rx](ShmMcastSocket* s, Nanos) {
+            rx.append(s->rx_buffer.data(), s->rx_buffer.size());
+            s->rx_buffer.consume(s->rx_buffer.size());
+        };
+        return socket;
+    }
+};
+
+
+TEST_F(ShmMcastSocketBasics, subscribers_receive_published_datagrams) {
+    // every subscriber receives the datagrams published after it joined, packed in order
+    ShmMcastSocket publisher{ *logger, MCAST_BATCHED };
+    ASSERT_NE(publisher.init(IP_GROUP, IFACE, PORT, false), -1);
+    std::string rx_first, rx_second, rx_late;
+    auto first = subscribe(PORT, rx_first);
+    auto second = subscribe(PORT, rx_second);
+    for (const auto& msg: { "one", "two" }) {
+        publisher.load_tx(msg, 3);
+        publisher.end_datagram();
+    }
+    publisher.tx_and_rx();
+    EXPECT_EQ(publisher.i_tx_next, 0);
+    auto late = subscribe(PORT, rx_late);
+    publisher.load_tx("six", 3);
+    publisher.end_datagram();
+    publisher.tx_and_rx();
+    first->tx_and_rx();
+    second->tx_and_rx();
+    late->tx_and_rx();
+    EXPECT_EQ(rx_first, "onetwosix");
+    EXPECT_EQ(rx_second, "onetwosix");
+    EXPECT_EQ(rx_late, "six");
+}
+
+TEST_F(ShmMcastSocketBasics, lapped_subscriber_counts_overrun) {
+    // a subscriber which falls a ring behind loses what was overwritten, then carries on
+    ShmMcastSocket publisher{ *logger };
+    ASSERT_NE(publisher.init(IP_GROUP, IFACE, PORT + 1, false), -1);
+    std::string rx;
+    auto subscriber = subscribe(PORT + 1, rx);
+    const std::string datagram(1000, 'x');
+    for (size_t n{ }; n < 2 * SHM_MCAST_SIZE; n += datagram.size()) {
+        publisher.load_tx(datagram.data(), datagram.size());
+        publisher.tx_and_rx();
+    }
+    subscriber->tx_and_rx();
+    EXPECT_EQ(subscriber->get_n_rx_overruns(), 1);
+    EXPECT_TRUE(rx.empty());
+    publisher.load_tx("next", 4);
+    publisher.tx_and_rx();
+    subscriber->tx_and_rx();
+    EXPECT_EQ(rx, "next");
+}
+
@@ -4,6 +4,9 @@
 
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <climits>
+#include <cstdio>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -20,6 +23,7 @@ protected:
     int socket_fd{ -1 };
     int socket_fd_udp{ -1 };
     std::string logfile{ "sockets.log" };
+    std::string profiles_file{ "socket_profiles.txt" };
 
     void SetUp() override {
         // open a test TCP socket
@@ -46,6 +50,8 @@ protected:
     void TearDown() override {
         close(socket_fd);
         close(socket_fd_udp);
+        SocketProfiles::install({ });
+        std::remove(profiles_file.c_str());
     }
 };
 
@@ -95,19 +101,45 @@ TEST_F(SocketUtils, set_no_tcp_send_delay) {
     EXPECT_EQ(1, optval);
 }
 
-TEST_F(SocketUtils, software_timestamps_are_set) {
+TEST_F(SocketUtils, timestamping_is_set) {
     int optval{ }; // result of reading socket options
     socklen_t optlen = sizeof(optval);
-    // default has software timestamps disabled
-    getsockopt(socket_fd, SOL_SOCKET,
-               SO_TIMESTAMP, (void*) &optval, &optlen);
+    // default has timestamping disabled
+    getsockopt(socket_fd_udp, SOL_SOCKET,
+               SO_TIMESTAMPING, (void*) &optval, &optlen);
     EXPECT_EQ(0, optval);
     // fn call succeeds
-    EXPECT_TRUE(set_software_timestamps(socket_fd));
-    // software timestamp option is now set
-    getsockopt(socket_fd, SOL_SOCKET,
-               SO_TIMESTAMP, (void*) &optval, &optlen);
-    EXPECT_EQ(1, optval);
+    EXPECT_TRUE(set_timestamping(socket_fd_udp));
+    // receive timestamps are now generated and reported, but not send timestamps
+    getsockopt(socket_fd_udp, SOL_SOCKET,
+               SO_TIMESTAMPING, (void*) &optval, &optlen);
+    EXPECT_TRUE(optval & SOF_TIMESTAMPING_RX_SOFTWARE);
+    EXPECT_TRUE(optval & SOF_TIMESTAMPING_SOFTWARE);
+    EXPECT_FALSE(optval & SOF_TIMESTAMPING_TX_SOFTWARE);
+    // ... until they're asked for too
+    EXPECT_TRUE(set_timestamping(socket_fd_udp, true));
+    getsockopt(socket_fd_udp, SOL_SOCKET,
+               SO_TIMESTAMPING, (void*) &optval, &optlen);
+    EXPECT_TRUE(optval & SOF_TIMESTAMPING_TX_SOFTWARE);
+    EXPECT_TRUE(optval & SOF_TIMESTAMPING_OPT_ID);
+}
+
+TEST_F(SocketUtils, tx_completions_count_sends) {
+    // sends are counted towards stamping only once it's enabled, and zerocopy ones regardless
+    TxCompletions tx{ };
+    tx.on_sent(10, 1);
+    EXPECT_EQ(tx.n_tx_sent, 0);
+    EXPECT_TRUE(tx.is_zerocopy_pending());
+    ASSERT_TRUE(tx.enable_tx_timestamps(socket_fd_udp));
+    tx.on_sent(10, 0);
+    EXPECT_EQ(tx.n_tx_sent, 10);
+    EXPECT_TRUE(tx.is_pending());
+    // zerocopy is used from its minimum size, and only in the first half of the buffer
+    EXPECT_FALSE(tx.is_zerocopy_send(0, 1024, 4096));
+    ASSERT_TRUE(tx.enable_zerocopy(socket_fd_udp, 512));
+    EXPECT_FALSE(tx.is_zerocopy_send(0, 256, 4096));
+    EXPECT_TRUE(tx.is_zerocopy_send(0, 1024, 4096));
+    EXPECT_FALSE(tx.is_zerocopy_send(1024, 2048, 4096));
 }
 
 TEST_F(SocketUtils, detects_blocking_operation) {
@@ -216,3 +248,77 @@ TEST_F(SocketUtils, create_udp_server_socket_succeeds) {
     if (fd != -1)
         close(fd);
 }
+
+TEST_F(SocketUtils, tuning_is_applied_and_read_back) {
+    // each setting of a tuning is applied, and holds when read back
+    Logger logger{ logfile };
+    const auto tuning = SocketTuning::from_str("busy_poll=50 rcvbuf=65536 sndbuf=65536 "
+                                               "incoming_cpu=0 quickack notsent_lowat=16384");
+    EXPECT_EQ(apply_socket_tuning(socket_fd, tuning, false, logger), 0);
+    int optval{ };
+    socklen_t optlen = sizeof(optval);
+    getsockopt(socket_fd, SOL_SOCKET, SO_BUSY_POLL, &optval, &optlen);
+    EXPECT_EQ(optval, 50);
+    getsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &optval, &optlen);
+    EXPECT_GE(optval, 65536);   // the kernel doubles it, for its own bookkeeping
+    getsockopt(socket_fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &optval, &optlen);
+    EXPECT_EQ(optval, 16384);
+    // multicast loopback is set on UDP sockets only
+    EXPECT_EQ(apply_socket_tuning(socket_fd_udp, SocketTuning::from_str("mcast_loop=0"), true,
+                                  logger), 0);
+    getsockopt(socket_fd_udp, IPPROTO_IP, IP_MULTICAST_LOOP, &optval, &optlen);
+    EXPECT_EQ(optval, 0);
+}
+
+TEST_F(SocketUtils, tuning_not_applied_is_counted) {
+    // a buffer the kernel caps (when not forced past its limits) is reported as failed
+    Logger logger{ logfile };
+    SocketTuning tuning{ };
+    tuning.size_sndbuf = INT_MAX / 4;
+    EXPECT_EQ(apply_socket_tuning(socket_fd, tuning, false, logger), 1);
+    EXPECT_EQ(apply_socket_tuning(socket_fd, { }, false, logger), 0);
+}
+
+TEST_F(SocketUtils, created_socket_is_tuned) {
+    // the tuning of a socket's config is applied when it's created
+    Logger logger{ logfile };
+    SocketConfig conf{ };
+    conf.iface = "lo";
+    conf.is_listening = true;
+    conf.is_udp = true;
+    conf.port = 0;
+    conf.tuning.size_rcvbuf = 1 << 18;
+    const auto fd = create_socket(conf, logger);
+    ASSERT_NE(fd, -1);
+    int optval{ };
+    socklen_t optlen = sizeof(optval);
+    getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &optval, &optlen);
+    EXPECT_GE(optval, 1 << 18);
+    close(fd);
+}
+
+TEST_F(SocketUtils, loads_socket_profiles_from_file) {
+    // each line of a profiles file tunes the sockets it names
+    {
+        std::ofstream f{ profiles_file };
+        f << "# socket options\n"
+          << "OGS busy_poll=50 prefer_busy_poll busy_poll_budget=8 quickack\n"
+          << "\n"
+          << "MDC.* rcvbuf=4194304 force_buffers mcast_loop=0 hw_timestamps\n";
+    }
+    SocketProfiles::install(SocketProfiles::from_file(profiles_file));
+    const auto ogs = SocketProfiles::lookup("OGS");
+    EXPECT_EQ(ogs.busy_poll_us, 50);
+    EXPECT_TRUE(ogs.is_prefer_busy_poll);
+    EXPECT_EQ(ogs.busy_poll_budget, 8);
+    EXPECT_TRUE(ogs.is_quickack);
+    const auto mdc = SocketProfiles::lookup("MDC.snapshot");
+    EXPECT_EQ(mdc.size_rcvbuf, 4194304);
+    EXPECT_TRUE(mdc.is_force_buffers);
+    EXPECT_EQ(mdc.mcast_loop, 0);
+    EXPECT_TRUE(mdc.is_hw_timestamps);
+    // sockets with no profile keep the kernel's defaults
+    EXPECT_EQ(SocketProfiles::lookup("OGC").busy_poll_us, -1);
+    SocketProfiles::install({ });
+    EXPECT_EQ(SocketProfiles::lookup("OGS").busy_poll_us, -1);
+}
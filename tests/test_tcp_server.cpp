@@ -5,6 +5,7 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
 
 
 using namespace LL;
@@ -42,6 +43,25 @@ TEST_F(TCPServerBasics, enters_listening_mode) {
     ASSERT_NE(-1, server->get_fd_epoll());
 }
 
+TEST_F(TCPServerBasics, shares_port_with_reuse_port) {
+    // servers listening with reuse_port share the port, and between them accept every client
+    using namespace std::literals::chrono_literals;
+    auto server_a = std::make_unique<TCPServer>(*logger);
+    auto server_b = std::make_unique<TCPServer>(*logger);
+    server_a->listen(IFACE, PORT, true);
+    server_b->listen(IFACE, PORT, true);
+    std::vector<std::unique_ptr<TCPSocket>> clients;
+    for (size_t i{ }; i < 8; ++i) {
+        clients.push_back(std::make_unique<TCPSocket>(*logger));
+        ASSERT_GT(clients.back()->connect(IP, IFACE, PORT, false), 0);
+    }
+    std::this_thread::sleep_for(50ms);
+    server_a->poll();
+    server_b->poll();
+    EXPECT_EQ(server_a->get_connections().size() + server_b->get_connections().size(),
+              clients.size());
+}
+
 TEST_F(TCPServerBasics, accepts_new_rx_client) {
     // server.poll() finds and adds new TCPSocket rx client
     using namespace std::literals::chrono_literals;
@@ -70,6 +90,130 @@ TEST_F(TCPServerBasics, accepts_multiple_new_rx_clients) {
     ASSERT_EQ(server->get_rx_sockets().size(), 2);  // multiple clients should exist
 }
 
+TEST_F(TCPServerBasics, hands_out_pooled_sockets) {
+    // accepted connections are given sockets from the preallocated pool
+    using namespace std::literals::chrono_literals;
+    auto server = std::make_unique<TCPServer>(*logger, 2, get_page_size());
+    server->listen(IFACE, PORT);
+    ASSERT_EQ(server->get_n_sockets_free(), 2);
+    auto client = std::make_unique<TCPSocket>(*logger);
+    client->connect(IP, IFACE, PORT, false);
+    std::this_thread::sleep_for(10ms);
+    server->poll();
+    ASSERT_EQ(server->get_rx_sockets().size(), 1);
+    EXPECT_EQ(server->get_n_sockets_free(), 1);
+    EXPECT_EQ(server->get_rx_sockets()[0]->get_size_buffer(), get_page_size());
+}
+
+TEST_F(TCPServerBasics, grows_pool_when_exhausted) {
+    // more connections than were pooled are still accepted
+    using namespace std::literals::chrono_literals;
+    auto server = std::make_unique<TCPServer>(*logger, 1, get_page_size());
+    server->listen(IFACE, PORT);
+    auto client1 = std::make_unique<TCPSocket>(*logger);
+    auto client2 = std::make_unique<TCPSocket>(*logger);
+    client1->connect(IP, IFACE, PORT, false);
+    client2->connect(IP, IFACE, PORT, false);
+    std::this_thread::sleep_for(10ms);
+    server->poll();
+    EXPECT_EQ(server->get_rx_sockets().size(), 2);
+    EXPECT_EQ(server->get_n_sockets_free(), 0);
+}
+
+TEST_F(TCPServerBasics, recycles_socket_on_disconnect) {
+    // a closed connection's socket is returned to the pool, after the dx callback
+    using namespace std::literals::chrono_literals;
+    auto server = std::make_unique<TCPServer>(*logger, 2, get_page_size());
+    TCPSocket* socket_dx{ nullptr };
+    server->set_dx_callback([&](TCPSocket* socket) { socket_dx = socket; });
+    server->listen(IFACE, PORT);
+    auto client = std::make_unique<TCPSocket>(*logger);
+    client->connect(IP, IFACE, PORT, false);
+    std::this_thread::sleep_for(10ms);
+    server->poll();
+    ASSERT_EQ(server->get_rx_sockets().size(), 1);
+    auto socket = server->get_rx_sockets()[0];
+    client.reset();     // client hangs up
+    std::this_thread::sleep_for(10ms);
+    server->poll();
+    server->tx_and_rx();
+    EXPECT_EQ(socket_dx, socket);
+    EXPECT_EQ(socket->fd, -1);
+    EXPECT_TRUE(server->get_rx_sockets().empty());
+    EXPECT_EQ(server->get_n_sockets_free(), 2);
+}
+
+TEST_F(TCPServerBasics, reads_only_sockets_with_data) {
+    // a connection stays in the table, but drops off the rx list once it has been drained
+    using namespace std::literals::chrono_literals;
+    auto server = std::make_unique<TCPServer>(*logger, 2, get_page_size());
+    server->listen(IFACE, PORT);
+    auto client = std::make_unique<TCPSocket>(*logger);
+    client->connect(IP, IFACE, PORT, false);
+    std::this_thread::sleep_for(10ms);
+    server->poll();
+    server->tx_and_rx();
+    EXPECT_EQ(server->get_connections().size(), 1);
+    EXPECT_TRUE(server->get_rx_sockets().empty());
+    // new data puts it back on the rx list
+    const std::string msg{ "hello" };
+    client->load_tx(msg.data(), msg.size());
+    client->tx_and_rx();
+    std::this_thread::sleep_for(10ms);
+    server->poll();
+    ASSERT_EQ(server->get_rx_sockets().size(), 1);
+    EXPECT_TRUE(server->tx_and_rx());
+    EXPECT_TRUE(server->get_rx_sockets().empty());
+}
+
+TEST_F(TCPServerBasics, sends_only_from_sockets_with_data) {
+    // a connection is on the tx list only while it has data loaded to send
+    using namespace std::literals::chrono_literals;
+    auto server = std::make_unique<TCPServer>(*logger, 2, get_page_size());
+    server->listen(IFACE, PORT);
+    auto client = std::make_unique<TCPSocket>(*logger);
+    client->connect(IP, IFACE, PORT, false);
+    std::this_thread::sleep_for(10ms);
+    server->poll();
+    server->tx_and_rx();
+    ASSERT_EQ(server->get_connections().size(), 1);
+    EXPECT_TRUE(server->get_tx_sockets().empty());
+    // loading data lists it once, and sending drops it off again
+    auto s = server->get_connections()[0];
+    const std::string msg{ "hello" };
+    s->load_tx(msg.data(), msg.size());
+    s->load_tx(msg.data(), msg.size());
+    ASSERT_EQ(server->get_tx_sockets().size(), 1);
+    server->tx_and_rx();
+    EXPECT_TRUE(server->get_tx_sockets().empty());
+    EXPECT_FALSE(s->conn.is_tx_ready);
+    std::this_thread::sleep_for(10ms);
+    client->tx_and_rx([](auto, auto) { });
+    EXPECT_EQ(client->rx_buffer.size(), 2 * msg.size());
+}
+
+TEST_F(TCPServerBasics, removes_closed_connection_from_table) {
+    // a closed connection is removed from the table, which stays densely indexed
+    using namespace std::literals::chrono_literals;
+    auto server = std::make_unique<TCPServer>(*logger, 2, get_page_size());
+    server->listen(IFACE, PORT);
+    auto client1 = std::make_unique<TCPSocket>(*logger);
+    auto client2 = std::make_unique<TCPSocket>(*logger);
+    client1->connect(IP, IFACE, PORT, false);
+    client2->connect(IP, IFACE, PORT, false);
+    std::this_thread::sleep_for(10ms);
+    server->poll();
+    server->tx_and_rx();
+    ASSERT_EQ(server->get_connections().size(), 2);
+    client1.reset();    // the first client hangs up
+    std::this_thread::sleep_for(10ms);
+    server->poll();
+    server->tx_and_rx();
+    ASSERT_EQ(server->get_connections().size(), 1);
+    EXPECT_EQ(server->get_connections()[0]->conn.i_table, 0);
+    EXPECT_NE(server->get_connections()[0]->fd, -1);
+}
+
 TEST_F(TCPServerBasics, receives_data_from_client) {
     // the server receives some test data from a connected client socket
     //  and all respective rx callback methods are executed to indicate
@@ -85,7 +229,7 @@ TEST_F(TCPServerBasics, receives_data_from_client) {
     server->set_rx_callback([&](TCPSocket* socket, Nanos t_rx) {
         std::cout << "Server: rx callback\n";
         logger->logf("<TCPServer::rx_callback> TCP message received socket: % size: % time: %\n",
-                     socket->fd, socket->i_rx_next, t_rx);
+                     socket->fd, socket->rx_buffer.size(), t_rx);
         res_server_rx = 700;
     });
     server->set_rx_done_callback([&]() {
@@ -108,6 +252,35 @@ TEST_F(TCPServerBasics, receives_data_from_client) {
     EXPECT_EQ(res_server_rx_done, 800);
 }
 
+TEST_F(TCPServerBasics, dispatches_to_handlers_given) {
+    // handlers handed to tx_and_rx() are called instead of the callbacks set on the server
+    using namespace std::literals::chrono_literals;
+    auto server = std::make_unique<TCPServer>(*logger);
+    server->listen(IFACE, PORT);
+    size_t n_callbacks{ };
+    server->set_rx_callback([&](TCPSocket*, Nanos) { ++n_callbacks; });
+    server->set_rx_done_callback([&]() { ++n_callbacks; });
+    auto client = std::make_unique<TCPSocket>(*logger);
+    client->connect(IP, IFACE, PORT, false);
+    server->poll();
+    const std::string msg{ "hello" };
+    client->load_tx(msg.data(), msg.size());
+    client->tx_and_rx();
+    std::this_thread::sleep_for(10ms);
+    server->poll();
+    std::string rx;
+    size_t n_rx_done{ };
+    EXPECT_TRUE(server->tx_and_rx(
+            [&](TCPSocket* s, Nanos) {
+                rx.append(s->rx_buffer.data(), s->rx_buffer.size());
+                s->rx_buffer.consume(s->rx_buffer.size());
+            },
+            [&]() { ++n_rx_done; }));
+    EXPECT_EQ(rx, msg);
+    EXPECT_EQ(n_rx_done, 1);
+    EXPECT_EQ(n_callbacks, 0);
+}
+
 TEST_F(TCPServerBasics, multiple_clients_communicate) {
     /*
      * multiple clients connect, send and receive
@@ -136,12 +309,12 @@ TEST_F(TCPServerBasics, multiple_clients_communicate) {
         std::cout << "server: rx_callback\n";
         logger->logf("<Server::rx_callback> server received message at socket: % size: % "
                      "time: %\n",
-                     socket->fd, socket->i_rx_next, t_rx);
-        const auto msg = std::string(socket->rx_buffer.data(), socket->i_rx_next);
+                     socket->fd, socket->rx_buffer.size(), t_rx);
+        const auto msg = std::string(socket->rx_buffer.data(), socket->rx_buffer.size());
         server_rx_messages.push_back(msg);
         const auto reply = "server->" + msg;
         logger->logf("\t-> (server) message received: %\n", msg);
-        socket->i_rx_next = 0;
+        socket->rx_buffer.clear();
         socket->load_tx(reply.data(), reply.length());
     });
     server->listen(IFACE, PORT);
@@ -149,7 +322,7 @@ TEST_F(TCPServerBasics, multiple_clients_communicate) {
     // client logs the message received in its callback
     auto client_rx_callback = [&](TCPSocket* socket, Nanos t_rx) {
         std::cout << "client: rx_callback\n";
-        auto msg = std::string(socket->rx_buffer.data(), socket->i_rx_next);
+        auto msg = std::string(socket->rx_buffer.data(), socket->rx_buffer.size());
         // find the client number matching this socket's fd
         size_t n{ };
         for (; n < n_client_to_fd.size(); ++n) {
@@ -158,10 +331,10 @@ TEST_F(TCPServerBasics, multiple_clients_communicate) {
         }
         // log the message received
         client_rx_messages.at(n).push_back(msg);
-        socket->i_rx_next = 0;
+        socket->rx_buffer.clear();
         logger->logf(
                 "<TCPSocket::rx_callback> client received message at socket: % size: % time: %\n",
-                socket->fd, socket->i_rx_next, t_rx);
+                socket->fd, socket->rx_buffer.size(), t_rx);
         logger->logf("\t-> message received: %\n", msg);
     };
     // make 5 clients and connect them each to the server
@@ -209,4 +382,103 @@ TEST_F(TCPServerBasics, multiple_clients_communicate) {
             EXPECT_EQ(expected, client_rx_messages.at(i).at(x));
         }
     }
-}
\ No newline at end of file
+}
+TEST_F(TCPServerBasics, flushes_blocked_connection_when_writable) {
+    // a connection whose peer isn't keeping up holds what it couldn't send, and sends it once
+    //  epoll says there's room, without losing any
+    using namespace std::literals::chrono_literals;
+    auto server = std::make_unique<TCPServer>(*logger, 2, 16 * 1024 * 1024);
+    server->listen(IFACE, PORT);
+    auto client = std::make_unique<TCPSocket>(*logger);
+    client->connect(IP, IFACE, PORT, false);
+    std::this_thread::sleep_for(10ms);
+    server->poll();
+    server->tx_and_rx();
+    ASSERT_EQ(server->get_connections().size(), 1);
+    auto connection = server->get_connections()[0];
+    // small socket buffers each way, so that the kernel soon stops taking more
+    int size_kernel_buffer{ 16 * 1024 };
+    setsockopt(connection->fd, SOL_SOCKET, SO_SNDBUF, &size_kernel_buffer, sizeof(int));
+    setsockopt(client->fd, SOL_SOCKET, SO_RCVBUF, &size_kernel_buffer, sizeof(int));
+    std::vector<char> data(4 * 1024 * 1024);
+    for (size_t i{ }; i < data.size(); ++i)
+        data[i] = static_cast<char>(i % 251);
+    connection->load_tx(data.data(), data.size());
+    server->tx_and_rx();
+    EXPECT_TRUE(connection->is_tx_blocked);
+    EXPECT_GT(connection->get_n_tx_pending(), 0);
+    std::vector<char> rx;
+    client->rx_callback = [&](TCPSocket* s, Nanos) {
+        rx.insert(rx.end(), s->rx_buffer.data(), s->rx_buffer.data() + s->rx_buffer.size());
+        s->rx_buffer.consume(s->rx_buffer.size());
+    };
+    for (int i{ }; i < 100000 && rx.size() < data.size(); ++i) {
+        client->tx_and_rx();
+        server->poll();
+        server->tx_and_rx();
+    }
+    EXPECT_TRUE(rx == data);
+    EXPECT_EQ(connection->get_n_tx_pending(), 0);
+    EXPECT_EQ(server->get_connections().size(), 1);
+}
+
+TEST_F(TCPServerBasics, closes_connection_over_tx_high_watermark) {
+    // a connection holding more unsent data than the high-watermark is closed
+    using namespace std::literals::chrono_literals;
+    auto server = std::make_unique<TCPServer>(*logger, 2, 16 * 1024 * 1024);
+    server->set_tx_high_watermark(1024 * 1024);
+    TCPSocket* socket_dx{ nullptr };
+    server->set_dx_callback([&](TCPSocket* socket) { socket_dx = socket; });
+    server->listen(IFACE, PORT);
+    auto client = std::make_unique<TCPSocket>(*logger);
+    client->connect(IP, IFACE, PORT, false);
+    std::this_thread::sleep_for(10ms);
+    server->poll();
+    server->tx_and_rx();
+    ASSERT_EQ(server->get_connections().size(), 1);
+    auto connection = server->get_connections()[0];
+    // small socket buffers each way, so that the kernel soon stops taking more
+    int size_kernel_buffer{ 16 * 1024 };
+    setsockopt(connection->fd, SOL_SOCKET, SO_SNDBUF, &size_kernel_buffer, sizeof(int));
+    setsockopt(client->fd, SOL_SOCKET, SO_RCVBUF, &size_kernel_buffer, sizeof(int));
+    std::vector<char> data(4 * 1024 * 1024);
+    connection->load_tx(data.data(), data.size());
+    server->tx_and_rx();
+    EXPECT_EQ(socket_dx, connection);
+    EXPECT_TRUE(server->get_connections().empty());
+}
+
+TEST_F(TCPServerBasics, drops_connection_closed_over_watermark_from_rx_sockets) {
+    // a connection closed for lagging while it still has data waiting to be read leaves the
+    //  list of sockets to read as it's recycled
+    using namespace std::literals::chrono_literals;
+    const auto size_socket_buffer = 16 * get_page_size();
+    auto server = std::make_unique<TCPServer>(*logger, 2, size_socket_buffer);
+    server->set_tx_high_watermark(size_socket_buffer / 8);
+    TCPSocket* socket_dx{ nullptr };
+    server->set_dx_callback([&](TCPSocket* socket) { socket_dx = socket; });
+    server->set_rx_callback([](TCPSocket*, Nanos) { });
+    server->listen(IFACE, PORT);
+    auto client = std::make_unique<TCPSocket>(*logger);
+    client->connect(IP, IFACE, PORT, false);
+    std::this_thread::sleep_for(10ms);
+    server->poll();
+    server->tx_and_rx();
+    ASSERT_EQ(server->get_connections().size(), 1);
+    auto connection = server->get_connections()[0];
+    // small socket buffers toward the client, so that the kernel soon stops taking more
+    int size_kernel_buffer{ 4 * 1024 };
+    setsockopt(connection->fd, SOL_SOCKET, SO_SNDBUF, &size_kernel_buffer, sizeof(int));
+    setsockopt(client->fd, SOL_SOCKET, SO_RCVBUF, &size_kernel_buffer, sizeof(int));
+    // more from the client than the connection's rx buffer holds, so it stays listed to read
+    std::vector<char> data(4 * size_socket_buffer);
+    client->load_tx(data.data(), data.size());
+    client->tx_and_rx();
+    std::this_thread::sleep_for(10ms);
+    server->poll();
+    connection->load_tx(data.data(), 3 * size_socket_buffer / 4);
+    server->tx_and_rx();
+    EXPECT_EQ(socket_dx, connection);
+    EXPECT_TRUE(server->get_connections().empty());
+    EXPECT_TRUE(server->get_rx_sockets().empty());
+}
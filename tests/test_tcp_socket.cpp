@@ -2,6 +2,8 @@
 #include "llbase/tcp_socket.h"
 #include "llbase/sockets.h"
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 #include <unistd.h>
 #include <sys/socket.h>
@@ -20,6 +22,12 @@ protected:
     std::string IP{ "127.0.0.1" };   // ip address for test sockets
     std::string IFACE{ "lo" };        // interface name for test sockets
 
+    // kernel timestamps are CLOCK_REALTIME, which the TSC clock may drift from by a little
+    static auto get_time_realtime() -> Nanos {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
     void SetUp() override {
         logger = std::make_unique<Logger>(logfile);
     }
@@ -60,6 +68,15 @@ TEST_F(TCPSocketBasics, loading_tx_buffer) {
     ASSERT_EQ(1, socket->i_tx_next);
 }
 
+TEST_F(TCPSocketBasics, tx_buffer_loads_to_capacity) {
+    // the tx buffer can be filled right up to its last byte
+    const auto size_buffer = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto socket = std::make_unique<TCPSocket>(*logger, size_buffer);
+    const std::vector<char> data(size_buffer, 'x');
+    socket->load_tx(data.data(), data.size());
+    EXPECT_EQ(socket->i_tx_next, size_buffer);
+}
+
 TEST_F(TCPSocketBasics, binds_and_listens) {
     /*
      * socket listens to local address/port
@@ -174,16 +191,187 @@ TEST_F(TCPSocketBasics, tx_and_rx_receives) {
     std::this_thread::sleep_for(10ms);
     ASSERT_EQ(bytes_sent, s.size());    // anything under ~1kb should be sent in a single trip
     // a call to the client's tx_and_rx() should now receive the data
-    ASSERT_EQ(socket_client->i_rx_next, 0); // the rx buffer is empty at first
+    ASSERT_EQ(socket_client->rx_buffer.size(), 0); // the rx buffer is empty at first
     socket_client->tx_and_rx();
     std::this_thread::sleep_for(10ms);
-    ASSERT_NE(socket_client->i_rx_next, 0); // ... and now the rx buffer has data in it
+    ASSERT_NE(socket_client->rx_buffer.size(), 0); // ... and now the rx buffer has data in it
     // validate the received data is the same as was sent
-    EXPECT_EQ(socket_client->i_rx_next, s.length());
-    auto s_rx = std::string{ socket_client->rx_buffer.begin(),
-                             socket_client->rx_buffer.begin() + (int) socket_client->i_rx_next };
+    EXPECT_EQ(socket_client->rx_buffer.size(), s.length());
+    auto s_rx = std::string{ socket_client->rx_buffer.data(), socket_client->rx_buffer.size() };
     EXPECT_EQ(s_rx, s);
     // cleanup
     if (fd_rx)
         close(fd_rx);
-}
\ No newline at end of file
+}
+TEST_F(TCPSocketBasics, rx_is_kernel_timestamped) {
+    // received data is dispatched with the kernel's nanosecond timestamp of its arrival
+    using namespace std::literals::chrono_literals;
+    auto socket_srv = std::make_unique<TCPSocket>(*logger);
+    ASSERT_NE(-1, socket_srv->connect(IP, IFACE, PORT, true));
+    auto socket_client = std::make_unique<TCPSocket>(*logger);
+    ASSERT_NE(-1, socket_client->connect(IP, IFACE, PORT, false));
+    std::this_thread::sleep_for(10ms);
+    auto fd_rx = accept(socket_srv->fd, nullptr, nullptr);
+    ASSERT_NE(-1, fd_rx);
+    Nanos t_rx{ };
+    socket_client->rx_callback = [&](TCPSocket* s, Nanos t) {
+        t_rx = t;
+        s->rx_buffer.consume(s->rx_buffer.size());
+    };
+    const auto t_sent = get_time_realtime();
+    ASSERT_EQ(send(fd_rx, "data", 4, 0), 4);
+    std::this_thread::sleep_for(10ms);
+    ASSERT_TRUE(socket_client->tx_and_rx());
+    // stamped after it was sent, and well before it was read
+    EXPECT_GE(t_rx, t_sent);
+    EXPECT_LE(t_rx, get_time_realtime());
+    close(fd_rx);
+}
+
+TEST_F(TCPSocketBasics, tx_timestamps_are_reported) {
+    // each send is stamped by the kernel, keyed by the index of its last byte
+    using namespace std::literals::chrono_literals;
+    auto socket_srv = std::make_unique<TCPSocket>(*logger);
+    ASSERT_NE(-1, socket_srv->connect(IP, IFACE, PORT, true));
+    auto socket_client = std::make_unique<TCPSocket>(*logger);
+    ASSERT_NE(-1, socket_client->connect(IP, IFACE, PORT, false));
+    std::this_thread::sleep_for(10ms);
+    auto fd_rx = accept(socket_srv->fd, nullptr, nullptr);
+    ASSERT_NE(-1, fd_rx);
+    ASSERT_TRUE(socket_client->enable_tx_timestamps());
+    std::vector<std::pair<uint32_t, Nanos>> stamps;
+    socket_client->tx_timestamp_callback = [&](TCPSocket*, uint32_t id, Nanos t_tx) {
+        stamps.emplace_back(id, t_tx);
+    };
+    const auto t_start = get_time_realtime();
+    for (const auto& msg: { "one", "three" }) {
+        socket_client->load_tx(msg, strlen(msg));
+        socket_client->tx_and_rx();
+        std::this_thread::sleep_for(10ms);
+    }
+    socket_client->tx_and_rx();
+    ASSERT_EQ(stamps.size(), 2);
+    EXPECT_EQ(stamps[0].first, 2);
+    EXPECT_EQ(stamps[1].first, 7);
+    EXPECT_GE(stamps[0].second, t_start);
+    EXPECT_GE(stamps[1].second, stamps[0].second);
+    close(fd_rx);
+}
+
+TEST_F(TCPSocketBasics, zerocopy_send_completes) {
+    // a large send is made with MSG_ZEROCOPY, arrives whole, and once the kernel is done
+    //  with it, the tx buffer rewinds; smaller sends are copied as usual
+    using namespace std::literals::chrono_literals;
+    auto socket_srv = std::make_unique<TCPSocket>(*logger);
+    ASSERT_NE(-1, socket_srv->connect(IP, IFACE, PORT, true));
+    auto socket_client = std::make_unique<TCPSocket>(*logger);
+    ASSERT_NE(-1, socket_client->connect(IP, IFACE, PORT, false));
+    std::this_thread::sleep_for(10ms);
+    auto fd_rx = accept(socket_srv->fd, nullptr, nullptr);
+    ASSERT_NE(-1, fd_rx);
+    ASSERT_TRUE(socket_client->enable_zerocopy());
+    std::vector<char> data(2 * ZEROCOPY_SIZE_MIN);
+    for (size_t i{ }; i < data.size(); ++i)
+        data[i] = static_cast<char>(i);
+    socket_client->load_tx(data.data(), data.size());
+    socket_client->tx_and_rx();
+    for (int i{ }; i < 100 && socket_client->i_tx_next; ++i) {
+        std::this_thread::sleep_for(5ms);
+        socket_client->tx_and_rx();
+    }
+    EXPECT_EQ(socket_client->i_tx_next, 0);
+    EXPECT_EQ(socket_client->i_tx_start, 0);
+    socket_client->load_tx("tail", 4);
+    socket_client->tx_and_rx();
+    EXPECT_EQ(socket_client->i_tx_next, 0);
+    std::this_thread::sleep_for(10ms);
+    std::vector<char> rx(data.size() + 8);
+    size_t n_rx{ };
+    for (ssize_t n; (n = recv(fd_rx, rx.data() + n_rx, rx.size() - n_rx, MSG_DONTWAIT)) > 0;)
+        n_rx += static_cast<size_t>(n);
+    ASSERT_EQ(n_rx, data.size() + 4);
+    EXPECT_TRUE(std::equal(data.begin(), data.end(), rx.begin()));
+    EXPECT_EQ(std::string(rx.data() + data.size(), 4), "tail");
+    close(fd_rx);
+}
+
+TEST_F(TCPSocketBasics, zerocopy_streams_past_buffer_size) {
+    // loading steadily, without waiting for completions, streams many times the tx buffer's
+    //  size: sends from its back half are copied, so it rewinds rather than overflowing
+    using namespace std::literals::chrono_literals;
+    auto socket_srv = std::make_unique<TCPSocket>(*logger);
+    ASSERT_NE(-1, socket_srv->connect(IP, IFACE, PORT, true));
+    auto socket_client = std::make_unique<TCPSocket>(*logger, 8 * ZEROCOPY_SIZE_MIN);
+    ASSERT_NE(-1, socket_client->connect(IP, IFACE, PORT, false));
+    std::this_thread::sleep_for(10ms);
+    auto fd_rx = accept(socket_srv->fd, nullptr, nullptr);
+    ASSERT_NE(-1, fd_rx);
+    ASSERT_TRUE(socket_client->enable_zerocopy());
+    std::vector<char> data(ZEROCOPY_SIZE_MIN);
+    std::vector<char> rx(data.size());
+    size_t n_tx{ }, n_rx{ };
+    bool is_rx_intact{ true };
+    const auto drain = [&]() {
+        for (ssize_t n; (n = recv(fd_rx, rx.data(), rx.size(), MSG_DONTWAIT)) > 0;) {
+            for (ssize_t i{ }; i < n; ++i)
+                is_rx_intact &= (rx[i] == static_cast<char>(n_rx + i));
+            n_rx += static_cast<size_t>(n);
+        }
+    };
+    while (n_tx < 8 * socket_client->get_size_buffer()) {
+        for (size_t i{ }; i < data.size(); ++i)
+            data[i] = static_cast<char>(n_tx + i);
+        socket_client->load_tx(data.data(), data.size());
+        n_tx += data.size();
+        socket_client->tx_and_rx();
+        drain();
+    }
+    for (int i{ }; i < 100 && (n_rx < n_tx || socket_client->i_tx_next); ++i) {
+        std::this_thread::sleep_for(5ms);
+        socket_client->tx_and_rx();
+        drain();
+    }
+    EXPECT_EQ(n_rx, n_tx);
+    EXPECT_TRUE(is_rx_intact);
+    EXPECT_EQ(socket_client->i_tx_next, 0);
+    close(fd_rx);
+}
+
+TEST_F(TCPSocketBasics, partial_send_keeps_unsent_remainder) {
+    // whatever the kernel won't take yet stays loaded and goes out first, in order, as the
+    //  peer catches up
+    using namespace std::literals::chrono_literals;
+    auto socket_srv = std::make_unique<TCPSocket>(*logger);
+    ASSERT_NE(-1, socket_srv->connect(IP, IFACE, PORT, true));
+    auto socket_client = std::make_unique<TCPSocket>(*logger);
+    ASSERT_NE(-1, socket_client->connect(IP, IFACE, PORT, false));
+    std::this_thread::sleep_for(10ms);
+    auto fd_rx = accept(socket_srv->fd, nullptr, nullptr);
+    ASSERT_NE(-1, fd_rx);
+    // small socket buffers each way, so that the kernel soon stops taking more
+    int size_kernel_buffer{ 16 * 1024 };
+    setsockopt(socket_client->fd, SOL_SOCKET, SO_SNDBUF, &size_kernel_buffer, sizeof(int));
+    setsockopt(fd_rx, SOL_SOCKET, SO_RCVBUF, &size_kernel_buffer, sizeof(int));
+    std::vector<char> data(4 * 1024 * 1024);
+    for (size_t i{ }; i < data.size(); ++i)
+        data[i] = static_cast<char>(i % 251);
+    socket_client->load_tx(data.data(), data.size() / 2);
+    socket_client->tx_and_rx();
+    // the peer isn't reading, so only part of it was sent
+    EXPECT_TRUE(socket_client->is_tx_blocked);
+    EXPECT_GT(socket_client->get_n_tx_pending(), 0);
+    socket_client->load_tx(data.data() + data.size() / 2, data.size() / 2);
+    std::vector<char> rx(data.size());
+    size_t n_rx{ };
+    for (int i{ }; i < 100000 && n_rx < rx.size(); ++i) {
+        const auto n = recv(fd_rx, rx.data() + n_rx, rx.size() - n_rx, MSG_DONTWAIT);
+        if (n > 0)
+            n_rx += static_cast<size_t>(n);
+        socket_client->tx_and_rx();
+    }
+    ASSERT_EQ(n_rx, data.size());
+    EXPECT_TRUE(rx == data);
+    EXPECT_EQ(socket_client->get_n_tx_pending(), 0);
+    EXPECT_EQ(socket_client->i_tx_next, 0);
+    close(fd_rx);
+}
@@ -4,6 +4,9 @@
 #include <thread>
 #include <numeric>
 #include <vector>
+#include <set>
+#include <fstream>
+#include <cstdio>
 
 
 void threaded_fn(bool sleep) {
@@ -68,4 +71,76 @@ TEST_F(ThreadingBasics, naive_thread_pool_multithreaded_accumulation) {
     // sum all partials
     const auto res = std::accumulate(partial_sums.begin(), partial_sums.end(), 0);
     ASSERT_EQ(res, sum);
-}
\ No newline at end of file
+}
+
+class CPULayoutBasics : public ::testing::Test {
+protected:
+    std::string filename{ "test_cpu_layout.conf" };
+
+    void SetUp() override { }
+    void TearDown() override {
+        CPULayout::install(CPULayout{ });
+        std::remove(filename.c_str());
+    }
+};
+
+
+TEST_F(CPULayoutBasics, refuses_busy_spinning_threads_sharing_a_core) {
+    // two spinning threads on one core are refused, but a blocking one may share it
+    CPULayout layout{{{ "OME", 0, 0, true }, { "<LL::Logger>", 0, 0, false }}};
+    EXPECT_TRUE(layout.validate().empty());
+    layout.add({ "MarketDataPublisher", 0, 0, true });
+    EXPECT_EQ(layout.validate().size(), 1);
+    EXPECT_FALSE(CPULayout::install(layout));
+}
+
+TEST_F(CPULayoutBasics, refuses_busy_spinning_wildcard_pinned_to_a_core) {
+    // every thread a wildcard matches would spin on its one core, so it may only spin floating
+    CPULayout layout{{{ "Reactor*", 0, 0, false }, { "Gateway*", -1, 0, true }}};
+    EXPECT_TRUE(layout.validate().empty());
+    layout.add({ "Engine*", 0, 0, true });
+    EXPECT_EQ(layout.validate().size(), 1);
+    EXPECT_FALSE(CPULayout::install(layout));
+}
+
+TEST_F(CPULayoutBasics, matches_thread_names_by_prefix) {
+    // a trailing wildcard matches any thread name with that prefix
+    CPULayout layout{{{ "Order*", 0, 0, false }}};
+    EXPECT_NE(layout.find("OrderGatewayServer"), nullptr);
+    EXPECT_EQ(layout.find("OME"), nullptr);
+}
+
+TEST_F(CPULayoutBasics, parses_cpu_lists) {
+    // kernel cpu lists of single cores and ranges are expanded
+    EXPECT_EQ(parse_cpu_list("1-3,6\n"), (std::set<int>{ 1, 2, 3, 6 }));
+    EXPECT_TRUE(parse_cpu_list("").empty());
+}
+
+TEST_F(CPULayoutBasics, loads_layout_from_file) {
+    // each line of a layout file places one thread
+    {
+        std::ofstream f{ filename };
+        f << "# thread core options\n"
+          << "OME 0 fifo=80 spin\n"
+          << "\n"
+          << "TradingEngine -1\n";
+    }
+    const auto layout = CPULayout::from_file(filename);
+    ASSERT_EQ(layout.get_confs().size(), 2);
+    const auto ome = layout.find("OME");
+    ASSERT_NE(ome, nullptr);
+    EXPECT_EQ(ome->core_id, 0);
+    EXPECT_EQ(ome->fifo_priority, 80);
+    EXPECT_TRUE(ome->is_busy_spin);
+    EXPECT_FALSE(layout.find("TradingEngine")->is_busy_spin);
+}
+
+TEST_F(CPULayoutBasics, installed_layout_places_threads) {
+    // a thread started with no core is pinned by the installed layout
+    ASSERT_TRUE(CPULayout::install(CPULayout{{{ "PinnedWorker", 0, 0, true }}}));
+    int cpu{ -1 };
+    auto t = create_and_start_thread(-1, "PinnedWorker", [&cpu]() { cpu = sched_getcpu(); });
+    ASSERT_NE(t, nullptr);
+    t->join();
+    EXPECT_EQ(cpu, 0);
+}
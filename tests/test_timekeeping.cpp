@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+#include "llbase/timekeeping.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+
+
+using namespace LL;
+
+
+class TSCClockBasics : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // calibrate up front, so it isn't counted in any test's timings
+        TSCClock::get();
+    }
+    void TearDown() override { }
+
+    static Nanos system_nanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+};
+
+
+TEST_F(TSCClockBasics, calibrated_to_epoch_time) {
+    // the tsc clock reads close to the system wall clock
+    const auto t_sys = system_nanos();
+    const auto t_tsc = get_time_nanos();
+    EXPECT_LT(std::abs(t_tsc - t_sys), 5 * NANOS_TO_MILLIS);
+    EXPECT_GT(TSCClock::get().get_cycles_per_nano(), 0.0);
+}
+
+TEST_F(TSCClockBasics, detects_invariant_tsc) {
+    // the tsc is only read directly when the kernel also reports it as constant and nonstop
+    std::ifstream cpuinfo{ "/proc/cpuinfo" };
+    std::string flags, line;
+    while (std::getline(cpuinfo, line) && flags.empty())
+        if (line.rfind("flags", 0) == 0)
+            flags = line + " ";
+    const auto has_flag = [&](const std::string& f) {
+        return flags.find(" " + f + " ") != std::string::npos;
+    };
+    EXPECT_EQ(TSCClock::get().get_is_invariant(),
+              has_flag("constant_tsc") && has_flag("nonstop_tsc"));
+}
+
+TEST_F(TSCClockBasics, is_monotonic) {
+    // successive reads never go backwards
+    auto t_prev = get_time_nanos();
+    for (int i{ }; i < 100000; ++i) {
+        const auto t = get_time_nanos();
+        ASSERT_GE(t, t_prev);
+        t_prev = t;
+    }
+}
+
+TEST_F(TSCClockBasics, tracks_elapsed_time) {
+    // the measured duration of a sleep agrees with the steady clock
+    const auto t0_steady = std::chrono::steady_clock::now();
+    const auto t0 = get_time_nanos();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const auto dt = get_time_nanos() - t0;
+    const auto dt_steady = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0_steady).count();
+    EXPECT_LT(std::abs(dt - dt_steady), NANOS_TO_MILLIS);
+}
+
+TEST_F(TSCClockBasics, correction_does_not_step_backwards) {
+    // drift corrections slew the clock rather than stepping it
+    auto& clock = TSCClock::get();
+    const auto t_before = clock.now_nanos();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    clock.correct();
+    EXPECT_GE(clock.now_nanos(), t_before);
+}
+
+
+class CoarseClockBasics : public ::testing::Test {
+protected:
+    void SetUp() override { }
+    void TearDown() override { }
+};
+
+
+TEST_F(CoarseClockBasics, publishes_time_while_running) {
+    // the coarse time and time string are only published between start and stop
+    EXPECT_EQ(CoarseClock::get_time_cstr(), nullptr);
+    CoarseClock::start();
+    ASSERT_NE(CoarseClock::get_time_cstr(), nullptr);
+    EXPECT_LT(std::abs(CoarseClock::get_nanos() - get_time_nanos()), 5 * NANOS_TO_MILLIS);
+    CoarseClock::stop();
+    EXPECT_EQ(CoarseClock::get_time_cstr(), nullptr);
+}
+
+TEST_F(CoarseClockBasics, time_str_matches_ctime_format) {
+    // the preformatted string has the same layout as ctime(), minus its newline
+    std::string t_str{ };
+    get_time_str(&t_str);
+    const auto t_ctime = t_str;
+    CoarseClock::start();
+    get_time_str(&t_str);
+    CoarseClock::stop();
+    EXPECT_EQ(t_str.size(), std::string(t_ctime.c_str()).size());
+}
+
+TEST_F(CoarseClockBasics, runs_until_last_user_stops) {
+    // nested starts keep the clock running until every user has stopped it
+    CoarseClock::start();
+    CoarseClock::start();
+    CoarseClock::stop();
+    EXPECT_NE(CoarseClock::get_time_cstr(), nullptr);
+    CoarseClock::stop();
+    EXPECT_EQ(CoarseClock::get_time_cstr(), nullptr);
+}
+
+TEST_F(CoarseClockBasics, exits_cleanly_while_running) {
+    // a process which exits without stopping the clock doesn't abort on its joinable thread
+    EXPECT_EXIT({
+                    CoarseClock::start();
+                    exit(EXIT_SUCCESS);
+                }, ::testing::ExitedWithCode(EXIT_SUCCESS), "");
+}
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "llbase/timer_wheel.h"
+
+#include <vector>
+
+
+using namespace LL;
+
+
+struct FiredTimers {
+    std::vector<uint64_t>* tags;
+    void operator()(TimerID, uint64_t tag) const noexcept { tags->push_back(tag); }
+};
+
+
+class TimerWheelBasics : public ::testing::Test {
+protected:
+    static constexpr Nanos T_TICK{ NANOS_TO_MILLIS };
+    static constexpr Nanos T0{ 1000 * NANOS_TO_SECS };
+    std::vector<uint64_t> fired{ };
+    TimerWheel<FiredTimers> wheel{ 64, T_TICK, T0, FiredTimers{ &fired }};
+
+    void SetUp() override { }
+    void TearDown() override { }
+};
+
+
+TEST_F(TimerWheelBasics, fires_timer_at_expiry) {
+    // a timer fires once the wheel is advanced past its expiry, and not before
+    wheel.schedule(T0 + 10 * T_TICK, 7);
+    EXPECT_EQ(wheel.get_n_active(), 1);
+    EXPECT_EQ(wheel.advance(T0 + 9 * T_TICK), 0);
+    EXPECT_TRUE(fired.empty());
+    EXPECT_EQ(wheel.advance(T0 + 10 * T_TICK), 1);
+    ASSERT_EQ(fired.size(), 1);
+    EXPECT_EQ(fired[0], 7);
+    EXPECT_EQ(wheel.get_n_active(), 0);
+}
+
+TEST_F(TimerWheelBasics, fires_timers_in_expiry_order) {
+    // timers spread across several levels of the wheel fire in order of expiry
+    wheel.schedule(T0 + 20000 * T_TICK, 3);
+    wheel.schedule(T0 + 300 * T_TICK, 2);
+    wheel.schedule(T0 + 5 * T_TICK, 1);
+    wheel.schedule(T0 + 2000000 * T_TICK, 4);
+    for (Nanos t{ T0 }; t <= T0 + 2000000 * T_TICK; t += 100 * T_TICK)
+        wheel.advance(t);
+    EXPECT_EQ(fired, (std::vector<uint64_t>{ 1, 2, 3, 4 }));
+}
+
+TEST_F(TimerWheelBasics, far_off_timer_does_not_fire_early) {
+    // a timer beyond the reach of the wheel is re-placed until it is due
+    const Nanos t_expiry{ T0 + 100000000 * T_TICK };
+    wheel.schedule(t_expiry, 1);
+    for (Nanos t{ T0 }; t < t_expiry; t += 50000 * T_TICK)
+        wheel.advance(t);
+    EXPECT_TRUE(fired.empty());
+    wheel.advance(t_expiry);
+    EXPECT_EQ(fired.size(), 1);
+}
+
+TEST_F(TimerWheelBasics, cancelled_timer_does_not_fire) {
+    // a cancelled timer is removed, and its stale id cannot cancel a recycled timer
+    const auto id = wheel.schedule(T0 + 10 * T_TICK, 1);
+    EXPECT_TRUE(wheel.cancel(id));
+    EXPECT_FALSE(wheel.cancel(id));
+    wheel.schedule(T0 + 10 * T_TICK, 2);
+    EXPECT_FALSE(wheel.cancel(id));
+    wheel.advance(T0 + 20 * T_TICK);
+    EXPECT_EQ(fired, (std::vector<uint64_t>{ 2 }));
+}
+
+TEST_F(TimerWheelBasics, periodic_timer_rearms) {
+    // a periodic timer fires once per interval until cancelled
+    const auto id = wheel.schedule_after(10 * T_TICK, 1, 10 * T_TICK);
+    for (int i{ 1 }; i <= 50; ++i)
+        wheel.advance(T0 + i * T_TICK);
+    EXPECT_EQ(fired.size(), 5);
+    EXPECT_TRUE(wheel.cancel(id));
+    wheel.advance(T0 + 100 * T_TICK);
+    EXPECT_EQ(fired.size(), 5);
+}
+
+TEST_F(TimerWheelBasics, past_expiry_fires_on_next_tick) {
+    // a timer scheduled in the past fires as soon as the wheel next turns
+    wheel.advance(T0 + 100 * T_TICK);
+    wheel.schedule(T0, 1);
+    wheel.advance(T0 + 101 * T_TICK);
+    EXPECT_EQ(fired.size(), 1);
+}
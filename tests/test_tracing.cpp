@@ -0,0 +1,76 @@
+#include "gtest/gtest.h"
+#include "llbase/tracing.h"
+#include "llbase/threading.h"
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+
+
+using namespace LL;
+namespace fs = std::filesystem;
+
+
+class TracingBasics : public ::testing::Test {
+protected:
+    std::string filename{ "test_trace.json" };
+
+    void SetUp() override {
+        Tracer::reset();
+    }
+
+    void TearDown() override {
+        Tracer::disable();
+        Tracer::reset();
+        if (fs::exists(filename))
+            fs::remove(filename);
+    }
+
+    std::string read_trace() {
+        std::ifstream f{ filename };
+        std::stringstream ss;
+        ss << f.rdbuf();
+        return ss.str();
+    }
+};
+
+
+TEST_F(TracingBasics, buffer_wraps_and_keeps_latest_spans) {
+    // the ring overwrites the oldest spans once full
+    TraceBuffer buffer{ 4, 1, "test" };
+    for (uint64_t i{ }; i < 6; ++i)
+        buffer.record("span", i, i + 1);
+    EXPECT_EQ(buffer.get_n_recorded(), 6);
+    EXPECT_EQ(buffer.get_span(5).t_begin, 5);
+    EXPECT_EQ(buffer.get_span(2).t_begin, 2);
+}
+
+TEST_F(TracingBasics, spans_not_recorded_when_disabled) {
+    // no spans are exported when tracing is switched off
+    {
+        TRACE_SPAN("disabled_span");
+    }
+    Tracer::enable();
+    EXPECT_EQ(Tracer::write_chrome_trace(filename), 0);
+    EXPECT_EQ(read_trace().find("disabled_span"), std::string::npos);
+}
+
+TEST_F(TracingBasics, spans_exported_as_chrome_trace_json) {
+    // spans recorded on several threads are all written to the trace file
+    Tracer::enable();
+    {
+        TRACE_SPAN("main_span");
+    }
+    auto t = create_and_start_thread(-1, "TraceWorker", []() {
+        TRACE_SPAN("worker_span");
+    });
+    ASSERT_NE(t, nullptr);
+    t->join();
+    EXPECT_EQ(Tracer::write_chrome_trace(filename), 2);
+    const auto json = read_trace();
+    EXPECT_NE(json.find(R"("traceEvents")"), std::string::npos);
+    EXPECT_NE(json.find(R"("name":"main_span","ph":"X")"), std::string::npos);
+    EXPECT_NE(json.find(R"("name":"worker_span","ph":"X")"), std::string::npos);
+    EXPECT_NE(json.find(R"("args":{"name":"TraceWorker"})"), std::string::npos);
+}
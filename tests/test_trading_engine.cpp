@@ -1,4 +1,7 @@
 #include "gtest/gtest.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <vector>
 #include "common/types.h"
 #include "nitek/client/trading/trading_engine.h"
@@ -86,6 +89,26 @@ TEST_F(TradingEngineBasics, run_consumes_updates) {
     EXPECT_EQ(te->book_for_ticker.at(TICKER)->order_pool.get_n_blocks_used(), N_MESSAGES);
 }
 
+TEST_F(TradingEngineBasics, exports_trace_when_enabled) {
+    // with tracing opted into, the client's spans are written out when the engine stops
+    const std::string filename{ "client_trace_" + client_id_to_str(CLIENT) + ".json" };
+    std::remove(filename.c_str());
+    setenv(TradingEngine::TRACE_ENV_VAR, "1", 1);
+    auto update = te->rx_updates.get_next_to_write();
+    *update = Update(Update::Type::ADD, 1, TICKER, Side::BUY, 100, 50, 1);
+    te->rx_updates.increment_write_index();
+    te->start();
+    std::this_thread::sleep_for(20ms);
+    te->stop();
+    unsetenv(TradingEngine::TRACE_ENV_VAR);
+    EXPECT_FALSE(LL::Tracer::get_is_enabled());
+    std::ifstream file{ filename };
+    ASSERT_TRUE(file.is_open());
+    const std::string trace{ std::istreambuf_iterator<char>(file), { }};
+    EXPECT_NE(trace.find("TEOrderBook::on_market_update"), std::string::npos);
+    std::remove(filename.c_str());
+}
+
 TEST_F(TradingEngineBasics, on_order_book_update) {
     /*
      *  the on_order_book_update() method updates the feature engine
@@ -0,0 +1,67 @@
+#include "gtest/gtest.h"
+#include "llbase/watchdog.h"
+
+
+using namespace LL;
+
+
+class WatchdogBasics : public ::testing::Test {
+protected:
+    static constexpr Nanos T_STALL{ 10 * NANOS_TO_MILLIS };
+    static constexpr Nanos T0{ 1000 * NANOS_TO_SECS };
+    Watchdog watchdog{ T_STALL, NANOS_TO_MILLIS };
+    LoopProgress progress{ "TestLoop" };
+
+    void SetUp() override {
+        progress.watch();
+    }
+    void TearDown() override {
+        progress.unwatch();
+    }
+};
+
+
+TEST_F(WatchdogBasics, progress_is_cache_line_private) {
+    // each loop's counters sit on their own cache line
+    EXPECT_EQ(alignof(LoopProgress), 64);
+    EXPECT_EQ(sizeof(LoopProgress) % 64, 0);
+}
+
+TEST_F(WatchdogBasics, samples_watched_loops) {
+    // the watchdog sees the loop's passes and the time it last did work
+    progress.tick(0);
+    progress.tick(1);
+    watchdog.sample(T0);
+    const auto stats = watchdog.get_stats("TestLoop");
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->n_loops, 2);
+    EXPECT_GT(stats->t_last_work, 0);
+    EXPECT_FALSE(stats->is_stalled);
+}
+
+TEST_F(WatchdogBasics, reports_stall_and_recovery) {
+    // a loop which stops advancing past the threshold is stalled until it advances again
+    watchdog.sample(T0);
+    progress.tick(1);
+    watchdog.sample(T0 + NANOS_TO_MILLIS);
+    watchdog.sample(T0 + NANOS_TO_MILLIS + 2 * T_STALL);
+    auto stats = watchdog.get_stats("TestLoop");
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_TRUE(stats->is_stalled);
+    EXPECT_EQ(stats->n_stalls, 1);
+    EXPECT_EQ(stats->t_worst_iteration, 2 * T_STALL);
+    progress.tick(1);
+    watchdog.sample(T0 + 3 * T_STALL);
+    stats = watchdog.get_stats("TestLoop");
+    EXPECT_FALSE(stats->is_stalled);
+    EXPECT_EQ(stats->n_stalls, 1);
+}
+
+TEST_F(WatchdogBasics, forgets_loops_which_exit) {
+    // an unwatched loop is dropped from the watchdog's stats
+    watchdog.sample(T0);
+    ASSERT_TRUE(watchdog.get_stats("TestLoop").has_value());
+    progress.unwatch();
+    watchdog.sample(T0 + NANOS_TO_MILLIS);
+    EXPECT_FALSE(watchdog.get_stats("TestLoop").has_value());
+}
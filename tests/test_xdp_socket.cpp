@@ -0,0 +1,177 @@
+#include "gtest/gtest.h"
+#include "llbase/xdp_socket.h"
+#include "llbase/mcast_socket.h"
+
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+using namespace LL;
+
+
+// base tests for the AF_XDP socket, over a veth pair in generic (SKB) mode
+class XdpSocketBasics : public ::testing::Test {
+protected:
+    std::string logfile{ "xdp_socket_tests.log" };
+    std::unique_ptr<Logger> logger;
+    static const int PORT{ 12345 };
+    std::string IP_MCAST_GROUP{ "239.0.0.9" };
+    // datagrams are sent out of IFACE_TX and arrive at IFACE_RX
+    std::string IFACE_TX{ "llxdp0" };
+    std::string IFACE_RX{ "llxdp1" };
+    std::string IP_TX{ "10.77.0.1" };
+    bool has_veth{ false };
+
+    void SetUp() override {
+        logger = std::make_unique<Logger>(logfile);
+        has_veth = !std::system(("ip link add " + IFACE_TX + " type veth peer name " + IFACE_RX
+                                 + " >/dev/null 2>&1").c_str());
+        if (!has_veth)
+            GTEST_SKIP() << "a veth pair can't be created here";
+        std::system(("ip addr add " + IP_TX + "/24 dev " + IFACE_TX + " && ip addr add "
+                     "10.77.0.2/24 dev " + IFACE_RX + " && ip link set " + IFACE_TX + " up"
+                     " && ip link set " + IFACE_RX + " up").c_str());
+    }
+
+    void TearDown() override {
+        if (has_veth)
+            std::system(("ip link del " + IFACE_TX + " >/dev/null 2>&1").c_str());
+    }
+
+    // create an XdpSocket, skipping the test where AF_XDP isn't available
+    auto create(const std::string& iface) {
+        return XdpSocket::create(*logger, iface, { .n_frames = 64 });
+    }
+
+    // send a datagram to the multicast group from a plain UDP socket out of IFACE_TX
+    void send_to_group(const std::string& data) const {
+        const auto fd = socket(AF_INET, SOCK_DGRAM, 0);
+        in_addr iface_addr{ inet_addr(IP_TX.c_str()) };
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &iface_addr, sizeof(iface_addr));
+        sockaddr_in addr{ AF_INET, htons(PORT), { inet_addr(IP_MCAST_GROUP.c_str()) }, { }};
+        sendto(fd, data.data(), data.size(), 0, reinterpret_cast<const sockaddr*>(&addr),
+               sizeof(addr));
+        close(fd);
+    }
+
+    // poll the socket until n payloads have been delivered, or it's taken too long
+    static void wait_for_rx(XdpSocket& xsk, size_t n, size_t& n_rx) {
+        using namespace std::literals::chrono_literals;
+        for (int i{ }; i < 100 && n_rx < n; ++i) {
+            std::this_thread::sleep_for(5ms);
+            n_rx += xsk.poll();
+        }
+    }
+};
+
+
+TEST_F(XdpSocketBasics, receives_datagrams_of_attached_flows) {
+    // datagrams for an attached flow are redirected to the socket, in order
+    auto xsk = create(IFACE_RX);
+    if (xsk == nullptr)
+        GTEST_SKIP() << "AF_XDP is not available here";
+    std::vector<std::string> rx;
+    ASSERT_GE(xsk->attach(IP_MCAST_GROUP, PORT, [&](const char* data, size_t len) {
+        rx.emplace_back(data, len);
+        return true;
+    }), 0);
+    EXPECT_EQ(xsk->get_n_flows(), 1);
+    for (const auto& msg: { "one", "two", "three" })
+        send_to_group(msg);
+    size_t n_rx{ };
+    wait_for_rx(*xsk, 3, n_rx);
+    ASSERT_EQ(rx.size(), 3);
+    EXPECT_EQ(rx[0], "one");
+    EXPECT_EQ(rx[1], "two");
+    EXPECT_EQ(rx[2], "three");
+}
+
+TEST_F(XdpSocketBasics, sends_datagrams_to_group) {
+    // datagrams sent by one socket arrive whole at another, and their frames are recycled
+    auto xsk_tx = create(IFACE_TX);
+    auto xsk_rx = create(IFACE_RX);
+    if (xsk_tx == nullptr || xsk_rx == nullptr)
+        GTEST_SKIP() << "AF_XDP is not available here";
+    std::string rx;
+    xsk_rx->attach(IP_MCAST_GROUP, PORT, [&](const char* data, size_t len) {
+        rx.append(data, len);
+        return true;
+    });
+    const auto n_tx_free = xsk_tx->get_n_tx_free();
+    in_addr group{ }, unicast{ };
+    ASSERT_EQ(inet_pton(AF_INET, IP_MCAST_GROUP.c_str(), &group), 1);
+    ASSERT_EQ(inet_pton(AF_INET, "10.77.0.2", &unicast), 1);
+    EXPECT_FALSE(xsk_tx->send(unicast, PORT, "data", 4));   // not a multicast group
+    ASSERT_TRUE(xsk_tx->send(group, PORT, "data", 4));
+    ASSERT_TRUE(xsk_tx->send(group, PORT, "more", 4));
+    xsk_tx->flush();
+    size_t n_rx{ };
+    wait_for_rx(*xsk_rx, 2, n_rx);
+    EXPECT_EQ(rx, "datamore");
+    xsk_tx->poll();
+    EXPECT_EQ(xsk_tx->get_n_tx_free(), n_tx_free);
+}
+
+TEST_F(XdpSocketBasics, holds_datagram_until_there_is_room) {
+    // a datagram the handler has no room for is offered again at the next poll()
+    auto xsk = create(IFACE_RX);
+    if (xsk == nullptr)
+        GTEST_SKIP() << "AF_XDP is not available here";
+    std::vector<std::string> rx;
+    bool has_room{ false };
+    xsk->attach(IP_MCAST_GROUP, PORT, [&](const char* data, size_t len) {
+        if (!has_room)
+            return false;
+        rx.emplace_back(data, len);
+        return true;
+    });
+    send_to_group("one");
+    send_to_group("two");
+    size_t n_rx{ };
+    wait_for_rx(*xsk, 1, n_rx);
+    EXPECT_EQ(n_rx, 0);
+    has_room = true;
+    wait_for_rx(*xsk, 2, n_rx);
+    ASSERT_EQ(rx.size(), 2);
+    EXPECT_EQ(rx[0], "one");
+    EXPECT_EQ(rx[1], "two");
+}
+
+TEST_F(XdpSocketBasics, multicast_sockets_exchange_through_xdp) {
+    // batched datagrams loaded into one attached McastSocket reach another, whole
+    auto xsk_tx = create(IFACE_TX);
+    auto xsk_rx = create(IFACE_RX);
+    if (xsk_tx == nullptr || xsk_rx == nullptr)
+        GTEST_SKIP() << "AF_XDP is not available here";
+    McastSocket tx_socket{ *logger, MCAST_BATCHED };
+    ASSERT_NE(tx_socket.init(IP_MCAST_GROUP, IFACE_TX, PORT, false), -1);
+    ASSERT_TRUE(tx_socket.attach(*xsk_tx, IP_MCAST_GROUP, PORT, false));
+    EXPECT_EQ(xsk_tx->get_n_flows(), 0);
+    McastSocket rx_socket{ *logger, MCAST_BATCHED };
+    ASSERT_NE(rx_socket.init(IP_MCAST_GROUP, IFACE_RX, PORT, true), -1);
+    ASSERT_TRUE(rx_socket.attach(*xsk_rx, IP_MCAST_GROUP, PORT, true));
+    std::string rx;
+    rx_socket.rx_callback = [&](McastSocket* s, Nanos) {
+        rx.append(s->rx_buffer.data(), s->rx_buffer.size());
+        s->rx_buffer.consume(s->rx_buffer.size());
+    };
+    for (const auto& msg: { "one", "two" }) {
+        tx_socket.load_tx(msg, 3);
+        tx_socket.end_datagram();
+    }
+    tx_socket.tx_and_rx();
+    EXPECT_EQ(tx_socket.i_tx_next, 0);
+    using namespace std::literals::chrono_literals;
+    for (int i{ }; i < 100 && rx.size() < 6; ++i) {
+        std::this_thread::sleep_for(5ms);
+        rx_socket.tx_and_rx();
+    }
+    EXPECT_EQ(rx, "onetwo");
+    rx_socket.leave_group();
+    EXPECT_EQ(xsk_rx->get_n_flows(), 0);
+}